@@ -0,0 +1,105 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GEOMETRY_REGION_H_
+#define MIR_GEOMETRY_REGION_H_
+
+#include "mir/geometry/rectangle.h"
+#include "mir/geometry/rectangles.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+namespace mir
+{
+namespace geometry
+{
+
+/**
+ * A set of points, supporting union, subtraction and intersection.
+ *
+ * Unlike Rectangles, the area covered is what matters: the region is kept
+ * as horizontal bands of non-overlapping rectangles, so two regions covering
+ * the same points compare equal however they were built.
+ */
+class Region
+{
+public:
+    Region();
+    explicit Region(Rectangle const& rect);
+    explicit Region(Rectangles const& rects);
+
+    void add(Rectangle const& rect);
+    void add(Region const& other);
+    void subtract(Rectangle const& rect);
+    void subtract(Region const& other);
+    void intersect(Rectangle const& rect);
+    void intersect(Region const& other);
+
+    bool empty() const;
+    bool contains(Rectangle const& rect) const;
+    bool overlaps(Rectangle const& rect) const;
+    Rectangle bounding_rectangle() const;
+    /// The bounding rectangle of the part of rect outside the region (empty if there is none)
+    Rectangle bounding_rectangle_outside(Rectangle const& rect) const;
+
+    /// The region as a minimal(ish) set of non-overlapping rectangles
+    Rectangles rectangles() const;
+
+    bool operator==(Region const& other) const;
+    bool operator!=(Region const& other) const;
+
+private:
+    struct Span
+    {
+        int left;
+        int right;
+    };
+
+    struct Band
+    {
+        int top;
+        int bottom;
+        size_t first_span;  ///< Index of the band's first span in spans
+        size_t end_span;    ///< One past the band's last span
+    };
+
+    using BandIterator = std::vector<Band>::const_iterator;
+
+    /// Append a band whose spans have been appended to spans from first_span
+    void close_band(int top, int bottom, size_t first_span);
+    void copy_bands(Region const& from, BandIterator first, BandIterator last);
+    template<typename Op>
+    void combine_bands(
+        Region const& a, BandIterator a_first, BandIterator a_last,
+        Region const& b, BandIterator b_first, BandIterator b_last,
+        Op op);
+
+    /// Replace the bands affected by other with the result of op(in this, in other)
+    template<typename Op>
+    void apply(Region const& other, Op op);
+
+    std::vector<Band> bands;    ///< Sorted and disjoint, with no identical adjacent bands
+    std::vector<Span> spans;    ///< Per band: sorted, disjoint and non-adjacent
+};
+
+std::ostream& operator<<(std::ostream& out, Region const& value);
+
+}
+}
+
+#endif /* MIR_GEOMETRY_REGION_H_ */
@@ -26,6 +26,7 @@ namespace miral
 /** Enable the display configuration options.
  *   * display-config  {clone,sidebyside,single,static=<filename>}
  *   * translucent     {on,off}
+ *   * adaptive-sync   {on,off}
  */
 void display_configuration_options(mir::Server& server);
 }
@@ -170,6 +170,15 @@ public:
     auto focus_mode() -> mir::optional_value<MirFocusMode>&;
     ///@}
 
+    /// If the client accepts tearing to have its frames shown sooner
+    /// Fullscreen windows that are scanned out directly may then be flipped to
+    /// without waiting for vblank.
+    /// \remark Since MirAL 3.4
+    ///@{
+    auto allow_tearing() const -> mir::optional_value<bool> const&;
+    auto allow_tearing() -> mir::optional_value<bool>&;
+    ///@}
+
 private:
     friend auto make_surface_spec(WindowSpecification const& miral_spec) -> mir::shell::SurfaceSpecification;
     struct Self;
@@ -24,6 +24,7 @@
 #include <memory>
 #include <functional>
 #include <chrono>
+#include <optional>
 
 namespace mir
 {
@@ -41,6 +42,15 @@ typedef std::function<bool()> DisplayPauseHandler;
 typedef std::function<bool()> DisplayResumeHandler;
 typedef std::function<void()> DisplayConfigurationChangeHandler;
 
+/**
+ * When the outputs of a DisplaySyncGroup last refreshed, and how often they do.
+ */
+struct VBlankTiming
+{
+    Frame last_vblank;                          /**< The most recent vblank seen */
+    std::chrono::nanoseconds refresh_interval;  /**< Time between successive vblanks */
+};
+
 /**
  * DisplaySyncGroup represents a group of displays that need to be output
  * in unison as a single post() call.
@@ -78,6 +88,16 @@ public:
      */
     virtual std::chrono::milliseconds recommended_sleep() const = 0;
 
+    /**
+     * The timing of the most recent vblank of the DisplayBuffers in this
+     * group, if the platform knows it. This allows the compositor to predict
+     * when the next vblank will occur and schedule rendering accordingly.
+     *
+     * Displays without a fixed refresh cadence (such as adaptive sync
+     * outputs waiting on a bypassed client) have no next vblank to predict.
+     */
+    virtual auto vblank_timing() const -> std::optional<VBlankTiming> { return std::nullopt; }
+
     virtual ~DisplaySyncGroup() = default;
 protected:
     DisplaySyncGroup() = default;
@@ -124,6 +144,23 @@ public:
      */
     virtual void configure(DisplayConfiguration const& conf) = 0;
 
+    /**
+     * Executes a functor for each output group that configure(conf) would leave in place.
+     *
+     * The DisplaySyncGroups passed to \p f, and their DisplayBuffers, remain valid
+     * (and may continue to be used) while configure(conf) is applied; all others may be
+     * destroyed by it. This allows the compositor to keep rendering to outputs that are
+     * not affected by a configuration change.
+     *
+     * The default reports no groups, so configure() is assumed to replace them all.
+     *
+     * \param conf [in] Configuration that is about to be applied with configure().
+     * \param f    [in] Functor to call for each DisplaySyncGroup that would be preserved.
+     */
+    virtual void for_each_display_sync_group_preserved_by(
+        DisplayConfiguration const& /*conf*/,
+        std::function<void(DisplaySyncGroup&)> const& /*f*/) {}
+
     /**
      * Registers a handler for display configuration changes.
      *
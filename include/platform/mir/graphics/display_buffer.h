@@ -68,6 +68,21 @@ public:
     **/
     virtual bool overlay(RenderableList const& renderlist) = 0;
 
+    /** Show as much of renderlist as the hardware can, leaving the rest to
+     *  be composited by the caller.
+     *  \param [in,out] renderlist
+     *      The renderables that should appear on the screen. On return it
+     *      holds only those the caller must still render (possibly none,
+     *      meaning the rendered frame is just the background).
+     *  \returns
+     *      True if the hardware shows the whole list and nothing should be
+     *      rendered, as for overlay().
+    **/
+    virtual bool overlay_some(RenderableList& renderlist)
+    {
+        return overlay(renderlist);
+    }
+
     /**
      * Returns a transformation that the renderer must apply to all rendering.
      * There is usually no transformation required (just the identity matrix)
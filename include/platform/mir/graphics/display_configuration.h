@@ -143,6 +143,11 @@ struct DisplayConfigurationOutput
 
     mir::optional_value<geometry::Size> custom_logical_size;
 
+    /** Whether the output can vary its refresh rate to match the content (adaptive sync) */
+    bool vrr_capable{false};
+    /** Whether variable refresh rate is requested; only meaningful if vrr_capable */
+    bool vrr_enabled{false};
+
     /** The logical rectangle occupied by the output, based on its position,
         current mode and orientation (rotation) */
     geometry::Rectangle extents() const;
@@ -187,6 +192,8 @@ struct UserDisplayConfigurationOutput
     MirOutputGammaSupported const& gamma_supported;
     std::vector<uint8_t const> const& edid;
     mir::optional_value<geometry::Size>& custom_logical_size;
+    bool const& vrr_capable;
+    bool& vrr_enabled;
 
     UserDisplayConfigurationOutput(DisplayConfigurationOutput& main);
     geometry::Rectangle extents() const;
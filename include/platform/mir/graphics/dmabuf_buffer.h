@@ -60,6 +60,16 @@ public:
     virtual auto planes() const -> std::vector<PlaneDescriptor> const& = 0;
 
     virtual auto size() const -> geometry::Size = 0;
+
+    /**
+     * Note that the display would scan this buffer out directly, given a suitable format and modifier
+     *
+     * This lets the buffer's producer learn that it is worth allocating with a layout the
+     * display can scan out. The default does nothing.
+     */
+    virtual void mark_scanout_candidate()
+    {
+    }
 };
 }
 }
@@ -310,6 +310,14 @@ struct EGLExtensions
             PFNEGLQUERYDEBUGKHRPROC query);
     };
 
+    struct SwapBuffersWithDamage
+    {
+        SwapBuffersWithDamage(EGLDisplay dpy);
+
+        /// Either eglSwapBuffersWithDamageKHR or eglSwapBuffersWithDamageEXT
+        PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC const eglSwapBuffersWithDamage;
+    };
+
     struct EXTImageDmaBufImportModifiers
     {
         EXTImageDmaBufImportModifiers(EGLDisplay dpy);
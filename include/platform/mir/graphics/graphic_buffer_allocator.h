@@ -20,10 +20,12 @@
 #define MIR_GRAPHICS_GRAPHIC_BUFFER_ALLOCATOR_H_
 
 #include "mir/graphics/buffer.h"
+#include "mir/geometry/rectangles.h"
 
 #include <vector>
 #include <memory>
 #include <functional>
+#include <optional>
 
 struct wl_display;
 struct wl_resource;
@@ -78,14 +80,33 @@ public:
      */
     virtual void unbind_display(wl_display* display) = 0;
 
+    /**
+     * Import a hardware (non-wl_shm) client buffer
+     *
+     * \param buffer [in]      The wl_buffer
+     * \param surface [in]     The wl_surface the buffer was committed to
+     * \param on_consumed [in] Closure to call when the compositor has consumed the buffer
+     * \param on_release [in]  Closure to call when the compositor no longer needs the buffer
+     */
     virtual std::shared_ptr<Buffer> buffer_from_resource(
         wl_resource* buffer,
+        wl_resource* surface,
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release) = 0;
 
+    /**
+     * Import a wl_shm buffer
+     *
+     * \param buffer [in]           The wl_shm buffer
+     * \param wayland_executor [in] An Executor that spawns tasks on the Wayland event loop
+     * \param damage [in]           The area of buffer that has changed since it was last
+     *                              imported, or an empty optional if that isn't known
+     * \param on_consumed [in]      Closure to call when the compositor has consumed the buffer
+     */
     virtual auto buffer_from_shm(
         wl_resource* buffer,
         std::shared_ptr<mir::Executor> wayland_executor,
+        std::optional<geometry::Rectangles> const& damage,
         std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer> = 0;
 
 protected:
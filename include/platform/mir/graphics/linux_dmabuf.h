@@ -23,6 +23,11 @@
 
 #include <EGL/egl.h>
 
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <sys/types.h>
+
 #include "mir/graphics/buffer.h"
 #include "mir/graphics/egl_extensions.h"
 
@@ -43,30 +48,81 @@ namespace graphics
 {
 
 class DmaBufFormatDescriptors;
+class DmaBufFeedbackTables;
+class DmaBufSurfaceFeedback;
+
+/// A DRM fourcc format along with the layout modifier it is used with
+struct DRMFormatModifier
+{
+    uint32_t format;
+    uint64_t modifier;
+};
 
-class LinuxDmaBufUnstable : public mir::wayland::LinuxDmabufV1::Global
+/**
+ * The zwp_linux_dmabuf_v1 global
+ *
+ * Version 4 (dmabuf feedback) is only advertised if EGL can tell us the DRM device
+ * it renders with, as feedback must name it.
+ */
+class LinuxDmaBufUnstable : public mir::wayland::Global
 {
 public:
+    /**
+     * \param scanout_formats  Format/modifier pairs the display hardware can scan out.
+     *                         Those which can also be imported are sent as a preferred
+     *                         scanout tranche of surface feedback once the display has
+     *                         found the surface's buffers could be scanned out directly.
+     */
     LinuxDmaBufUnstable(
         wl_display* display,
         EGLDisplay dpy,
         std::shared_ptr<EGLExtensions> egl_extensions,
-        EGLExtensions::EXTImageDmaBufImportModifiers const& dmabuf_ext);
+        EGLExtensions::EXTImageDmaBufImportModifiers const& dmabuf_ext,
+        std::vector<DRMFormatModifier> const& scanout_formats = {});
 
+    /**
+     * \param surface  The wl_surface buffer was committed to; its feedback is updated if
+     *                 the display marks the buffer as a scanout candidate
+     */
     std::shared_ptr<Buffer> buffer_from_resource(
         wl_resource* buffer,
+        wl_resource* surface,
         std::shared_ptr<renderer::gl::Context> ctx,
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release,
         std::shared_ptr<Executor> wayland_executor);
 
+    auto interface_name() const -> char const* override;
+
+    struct ImportCounts
+    {
+        uint64_t hits;      ///< Buffers resubmitted from an already-imported dmabuf
+        uint64_t misses;    ///< Buffers that needed a new texture for their dmabuf
+    };
+
+    /// EGLImage cache totals across every instance since the server started
+    static auto import_counts() -> ImportCounts;
+
 private:
     class Instance;
-    void bind(wl_resource* new_resource) override;
+
+    LinuxDmaBufUnstable(
+        wl_display* display,
+        EGLDisplay dpy,
+        std::shared_ptr<EGLExtensions> egl_extensions,
+        EGLExtensions::EXTImageDmaBufImportModifiers const& dmabuf_ext,
+        std::vector<DRMFormatModifier> const& scanout_formats,
+        std::optional<dev_t> main_device);
+
+    static void bind_thunk(wl_client* client, void* data, uint32_t version, uint32_t id);
+    void bind(wl_resource* new_resource);
 
     EGLDisplay const dpy;
     std::shared_ptr<EGLExtensions> const egl_extensions;
     std::shared_ptr<DmaBufFormatDescriptors> const formats;
+    /// Format table and preference tranches sent to dmabuf feedback objects; null if not offered
+    std::shared_ptr<DmaBufFeedbackTables const> const feedback;
+    std::shared_ptr<DmaBufSurfaceFeedback> const surface_feedback;
 };
 
 }
@@ -21,8 +21,11 @@
 
 #include <experimental/optional>
 #include <mir/geometry/rectangle.h>
+#include <mir/geometry/rectangles.h>
+#include <mir/graphics/buffer_id.h>
 #include <glm/glm.hpp>
 #include <memory>
+#include <optional>
 #include <vector>
 
 namespace mir
@@ -71,6 +74,41 @@ public:
     virtual glm::mat4 transformation() const = 0;
 
     virtual bool shaped() const = 0;  // meaning the pixel format has alpha
+
+    /**
+     * The parts of the renderable (in screen coordinates) that are known to be
+     * opaque even though the pixel format has alpha. Opacity is still subject
+     * to alpha().
+     *
+     * \return The opaque region, or an empty optional if nothing beyond
+     *         shaped() is known.
+     */
+    virtual std::optional<std::vector<geometry::Rectangle>> opaque_region() const
+    {
+        return std::nullopt;
+    }
+
+    /**
+     * The area of buffer() (in buffer coordinates) whose content differs from
+     * that of the previously composited buffer \a previous.
+     *
+     * \return The changed area, or an empty optional if unknown, in which case
+     *         the whole buffer must be assumed to have changed.
+     */
+    virtual std::optional<geometry::Rectangles> damage_since(BufferID /*previous*/) const
+    {
+        return std::nullopt;
+    }
+
+    /**
+     * Whether the client accepts tearing to have its buffers shown sooner.
+     * The display may then flip to them without waiting for vblank when
+     * they are scanned out directly.
+     */
+    virtual bool allow_tearing() const
+    {
+        return false;
+    }
 protected:
     Renderable() = default;
     Renderable(Renderable const&) = delete;
@@ -19,6 +19,10 @@
 #ifndef MIR_PLATFORM_TEXTURE_H_
 #define MIR_PLATFORM_TEXTURE_H_
 
+#include "mir/geometry/rectangles.h"
+
+#include <optional>
+
 namespace mir
 {
 namespace graphics
@@ -79,6 +83,37 @@ public:
      */
     virtual void add_syncpoint() = 0;
 };
+
+/**
+ * A Texture whose content lives in CPU memory (such as an shm buffer), so has
+ * to be uploaded to the GPU before it can be rendered.
+ *
+ * Rather than bind() a texture of the buffer's own, the renderer can keep one
+ * texture per renderable and have each new buffer upload into it, so that only
+ * the parts that changed need copying.
+ */
+class UploadableTexture
+{
+public:
+    virtual ~UploadableTexture() = default;
+
+    /**
+     * Upload this buffer's content into the texture bound to GL_TEXTURE_2D.
+     *
+     * \note This must be called with a current GL context
+     *
+     * \param [in] damage  The area (in buffer coordinates) whose content differs
+     *                     from the bound texture's, which must already have this
+     *                     buffer's size and format. An empty optional (re)allocates
+     *                     the texture and uploads everything.
+     */
+    virtual void upload_to_bound_texture(std::optional<geometry::Rectangles> const& damage) = 0;
+
+protected:
+    UploadableTexture() = default;
+    UploadableTexture(UploadableTexture const&) = delete;
+    UploadableTexture& operator=(UploadableTexture const&) = delete;
+};
 }
 }
 }
@@ -24,6 +24,9 @@
 #include "mir_toolkit/common.h"
 #include <glm/glm.hpp>
 
+#include <chrono>
+#include <optional>
+
 namespace mir
 {
 namespace renderer
@@ -39,6 +42,17 @@ public:
     virtual void render(graphics::RenderableList const&) const = 0;
     virtual void suspend() = 0; // called when render() is skipped
 
+    /**
+     * The GPU time taken by the oldest rendered frame whose timing has become
+     * known since the last call. GPU work completes asynchronously, so this
+     * lags render() by a frame or two. Measuring isn't free, so renderers
+     * may not start timing frames until this is first called.
+     *
+     * \return The frame's GPU time, or an empty optional if no timing is
+     *         (yet) available or the renderer can't measure it.
+     */
+    virtual auto completed_gpu_time() -> std::optional<std::chrono::nanoseconds> = 0;
+
 protected:
     Renderer() = default;
     Renderer(const Renderer&) = delete;
@@ -19,6 +19,8 @@
 #ifndef MIR_RENDERER_GL_RENDER_TARGET_H_
 #define MIR_RENDERER_GL_RENDER_TARGET_H_
 
+#include "mir/geometry/rectangles.h"
+
 namespace mir
 {
 namespace renderer
@@ -41,6 +43,16 @@ public:
      * free GL-related resources such as textures and buffers.
      */
     virtual void swap_buffers() = 0;
+    /**
+     * Swap buffers, hinting that only the given region of the frame
+     * changed since the last swap.
+     * The damage is in render target pixels, with the origin at the
+     * top-left. Targets that can't make use of the hint just swap.
+     */
+    virtual void swap_buffers_with_damage(geometry::Rectangles const& /*damage*/)
+    {
+        swap_buffers();
+    }
     /** Binds any necessary resources (fbos, textures if any)
      * in preparation for drawing.
      */
@@ -0,0 +1,67 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_SW_RENDER_TARGET_H_
+#define MIR_RENDERER_SW_RENDER_TARGET_H_
+
+#include "mir/renderer/sw/pixel_source.h"
+
+#include <memory>
+
+namespace mir
+{
+namespace renderer
+{
+namespace software
+{
+
+/**
+ * A display buffer that can be rendered to by the CPU.
+ *
+ * Display buffers that support this (via native_display_buffer()) are
+ * composited by the software renderer, so need no GPU at all.
+ */
+class RenderTarget
+{
+public:
+    virtual ~RenderTarget() = default;
+
+    /**
+     * Map the buffer that the next frame should be rendered into.
+     *
+     * \note    The content of the mapping is undefined; the renderer
+     *          redraws every pixel.
+     * \note    The mapping must be released before calling swap_buffers().
+     */
+    virtual auto map_back_buffer() -> std::unique_ptr<Mapping<unsigned char>> = 0;
+
+    /**
+     * Make the most recently rendered buffer the one to be displayed by the
+     * next post().
+     */
+    virtual void swap_buffers() = 0;
+
+protected:
+    RenderTarget() = default;
+    RenderTarget(RenderTarget const&) = delete;
+    RenderTarget& operator=(RenderTarget const&) = delete;
+};
+
+}
+}
+}
+
+#endif // MIR_RENDERER_SW_RENDER_TARGET_H_
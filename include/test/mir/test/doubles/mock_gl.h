@@ -67,6 +67,7 @@ public:
     MOCK_METHOD1(glEnable, void(GLenum));
     MOCK_METHOD1(glEnableVertexAttribArray, void(GLuint));
     MOCK_METHOD0(glFinish, void());
+    MOCK_METHOD0(glFlush, void());
     MOCK_METHOD4(glFramebufferRenderbuffer,
                  void(GLenum, GLenum, GLenum, GLuint));
     MOCK_METHOD5(glFramebufferTexture2D,
@@ -99,6 +100,9 @@ public:
                  void(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum,
                       GLenum,const GLvoid*));
     MOCK_METHOD3(glTexParameteri, void(GLenum, GLenum, GLenum));
+    MOCK_METHOD9(glTexSubImage2D,
+                 void(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum,
+                      GLenum, const GLvoid*));
     MOCK_METHOD2(glUniform1f, void(GLint, GLfloat));
     MOCK_METHOD3(glUniform2f, void(GLint, GLfloat, GLfloat));
     MOCK_METHOD2(glUniform1i, void(GLint, GLint));
@@ -89,6 +89,8 @@ struct StubSurface : scene::Surface
         geometry::DeltaX) override {}
     auto focus_mode() const -> MirFocusMode override { return mir_focus_mode_focusable; }
     void set_focus_mode(MirFocusMode) override {}
+    auto allow_tearing() const -> bool override { return false; }
+    void set_allow_tearing(bool) override {}
 };
 }
 }
@@ -0,0 +1,447 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/geometry/region.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <ostream>
+
+namespace geom = mir::geometry;
+
+namespace
+{
+int const none = std::numeric_limits<int>::max();
+
+bool is_empty(geom::Rectangle const& rect)
+{
+    return rect.size.width <= geom::Width{0} || rect.size.height <= geom::Height{0};
+}
+
+/// The bands of [first, last) that overlap [top, bottom) vertically
+template<typename Iterator>
+auto overlapping(Iterator first, Iterator last, int top, int bottom) -> std::pair<Iterator, Iterator>
+{
+    auto const from = std::partition_point(first, last, [top](auto const& band) { return band.bottom <= top; });
+    auto const to = std::partition_point(from, last, [bottom](auto const& band) { return band.top < bottom; });
+    return {from, to};
+}
+
+/// Sweep the span boundaries of [a, a_end) and [b, b_end), appending the intervals op() selects
+template<typename Span, typename Op>
+void combine_spans(Span const* a, Span const* a_end, Span const* b, Span const* b_end, Op op, std::vector<Span>& out)
+{
+    bool in_a = false;
+    bool in_b = false;
+    bool in_result = false;
+    int left = 0;
+
+    for (;;)
+    {
+        auto const next_a = a == a_end ? none : in_a ? a->right : a->left;
+        auto const next_b = b == b_end ? none : in_b ? b->right : b->left;
+        auto const x = std::min(next_a, next_b);
+
+        if (x == none)
+            break;
+
+        if (next_a == x)
+        {
+            if (in_a) ++a;
+            in_a = !in_a;
+        }
+        if (next_b == x)
+        {
+            if (in_b) ++b;
+            in_b = !in_b;
+        }
+
+        auto const now_in_result = op(in_a, in_b);
+        if (now_in_result && !in_result)
+            left = x;
+        else if (!now_in_result && in_result)
+            out.push_back(Span{left, x});
+        in_result = now_in_result;
+    }
+}
+}
+
+void geom::Region::close_band(int top, int bottom, size_t first_span)
+{
+    auto const span_count = spans.size() - first_span;
+
+    if (span_count == 0)
+        return;
+
+    if (!bands.empty())
+    {
+        auto& previous = bands.back();
+        if (previous.bottom == top &&
+            previous.end_span - previous.first_span == span_count &&
+            std::equal(
+                spans.begin() + previous.first_span, spans.begin() + previous.end_span,
+                spans.begin() + first_span,
+                [](Span const& l, Span const& r) { return l.left == r.left && l.right == r.right; }))
+        {
+            // Same spans as the band above: extend that instead
+            previous.bottom = bottom;
+            spans.resize(first_span);
+            return;
+        }
+    }
+
+    bands.push_back(Band{top, bottom, first_span, spans.size()});
+}
+
+void geom::Region::copy_bands(Region const& from, BandIterator first, BandIterator last)
+{
+    if (first == last)
+        return;
+
+    // Only the first band might coalesce with what we already have...
+    auto const first_span = spans.size();
+    spans.insert(spans.end(), from.spans.begin() + first->first_span, from.spans.begin() + first->end_span);
+    close_band(first->top, first->bottom, first_span);
+
+    if (++first == last)
+        return;
+
+    // ...the rest are canonical already, so can be copied wholesale
+    auto const source_offset = first->first_span;
+    auto const offset = spans.size();
+    spans.insert(spans.end(), from.spans.begin() + first->first_span, from.spans.begin() + std::prev(last)->end_span);
+    for (; first != last; ++first)
+    {
+        bands.push_back(Band{
+            first->top,
+            first->bottom,
+            first->first_span - source_offset + offset,
+            first->end_span - source_offset + offset});
+    }
+}
+
+template<typename Op>
+void geom::Region::combine_bands(
+    Region const& a, BandIterator a_first, BandIterator a_last,
+    Region const& b, BandIterator b_first, BandIterator b_last,
+    Op op)
+{
+    auto y = std::min(
+        a_first == a_last ? none : a_first->top,
+        b_first == b_last ? none : b_first->top);
+
+    while (y != none)
+    {
+        while (a_first != a_last && a_first->bottom <= y) ++a_first;
+        while (b_first != b_last && b_first->bottom <= y) ++b_first;
+
+        bool const in_a = a_first != a_last && a_first->top <= y;
+        bool const in_b = b_first != b_last && b_first->top <= y;
+
+        auto const next = std::min(
+            a_first == a_last ? none : in_a ? a_first->bottom : a_first->top,
+            b_first == b_last ? none : in_b ? b_first->bottom : b_first->top);
+
+        if (next == none)
+            break;
+
+        if (in_a || in_b)
+        {
+            auto const a_spans = in_a ? a.spans.data() + a_first->first_span : nullptr;
+            auto const b_spans = in_b ? b.spans.data() + b_first->first_span : nullptr;
+
+            auto const first_span = spans.size();
+            combine_spans(
+                a_spans, in_a ? a.spans.data() + a_first->end_span : nullptr,
+                b_spans, in_b ? b.spans.data() + b_first->end_span : nullptr,
+                op, spans);
+            close_band(y, next, first_span);
+        }
+
+        y = next;
+    }
+}
+
+template<typename Op>
+void geom::Region::apply(Region const& other, Op op)
+{
+    bool const keeps_this = op(true, false);
+    bool const keeps_other = op(false, true);
+
+    if (other.bands.empty())
+    {
+        if (!keeps_this)
+            *this = Region{};
+        return;
+    }
+
+    // Only our bands overlapping the other region can change...
+    auto const affected = overlapping(
+        bands.cbegin(), bands.cend(), other.bands.front().top, other.bands.back().bottom);
+
+    // ...and unless op() keeps what is only in other, only other's bands overlapping ours matter
+    auto relevant = std::make_pair(other.bands.cbegin(), other.bands.cend());
+    if (!keeps_other)
+    {
+        if (affected.first == affected.second)
+        {
+            if (!keeps_this)
+                *this = Region{};
+            return;
+        }
+
+        relevant = overlapping(
+            other.bands.cbegin(), other.bands.cend(), affected.first->top, std::prev(affected.second)->bottom);
+    }
+
+    Region result;
+    result.bands.reserve(bands.size() + other.bands.size());
+    result.spans.reserve(spans.size() + other.spans.size());
+
+    if (keeps_this)
+        result.copy_bands(*this, bands.cbegin(), affected.first);
+
+    result.combine_bands(*this, affected.first, affected.second, other, relevant.first, relevant.second, op);
+
+    if (keeps_this)
+        result.copy_bands(*this, affected.second, bands.cend());
+
+    *this = std::move(result);
+}
+
+geom::Region::Region() = default;
+
+geom::Region::Region(Rectangle const& rect)
+{
+    if (!is_empty(rect))
+    {
+        spans.push_back(Span{rect.left().as_int(), rect.right().as_int()});
+        bands.push_back(Band{rect.top().as_int(), rect.bottom().as_int(), 0, 1});
+    }
+}
+
+geom::Region::Region(Rectangles const& rects)
+{
+    for (auto const& rect : rects)
+        add(rect);
+}
+
+void geom::Region::add(Rectangle const& rect)
+{
+    add(Region{rect});
+}
+
+void geom::Region::add(Region const& other)
+{
+    apply(other, [](bool a, bool b) { return a || b; });
+}
+
+void geom::Region::subtract(Rectangle const& rect)
+{
+    subtract(Region{rect});
+}
+
+void geom::Region::subtract(Region const& other)
+{
+    apply(other, [](bool a, bool b) { return a && !b; });
+}
+
+void geom::Region::intersect(Rectangle const& rect)
+{
+    intersect(Region{rect});
+}
+
+void geom::Region::intersect(Region const& other)
+{
+    apply(other, [](bool a, bool b) { return a && b; });
+}
+
+bool geom::Region::empty() const
+{
+    return bands.empty();
+}
+
+bool geom::Region::contains(Rectangle const& rect) const
+{
+    if (is_empty(rect))
+        return true;
+
+    auto const top = rect.top().as_int();
+    auto const bottom = rect.bottom().as_int();
+    auto const left = rect.left().as_int();
+    auto const right = rect.right().as_int();
+
+    // Gaps are not represented, so the rectangle is covered only if
+    // consecutive bands span it without a break
+    auto const candidates = overlapping(bands.cbegin(), bands.cend(), top, bottom);
+    auto y = top;
+    for (auto band = candidates.first; band != candidates.second; ++band)
+    {
+        if (band->top > y)
+            return false;
+
+        auto const covering = std::find_if(
+            spans.begin() + band->first_span, spans.begin() + band->end_span,
+            [&](Span const& span) { return span.left <= left && right <= span.right; });
+
+        if (covering == spans.begin() + band->end_span)
+            return false;
+
+        y = band->bottom;
+    }
+
+    return y >= bottom;
+}
+
+bool geom::Region::overlaps(Rectangle const& rect) const
+{
+    if (is_empty(rect))
+        return false;
+
+    auto const left = rect.left().as_int();
+    auto const right = rect.right().as_int();
+
+    auto const candidates = overlapping(bands.cbegin(), bands.cend(), rect.top().as_int(), rect.bottom().as_int());
+    for (auto band = candidates.first; band != candidates.second; ++band)
+    {
+        auto const overlapping_span = std::find_if(
+            spans.begin() + band->first_span, spans.begin() + band->end_span,
+            [&](Span const& span) { return span.left < right && left < span.right; });
+
+        if (overlapping_span != spans.begin() + band->end_span)
+            return true;
+    }
+
+    return false;
+}
+
+geom::Rectangle geom::Region::bounding_rectangle() const
+{
+    if (bands.empty())
+        return {};
+
+    auto left = spans[bands.front().first_span].left;
+    auto right = spans[bands.front().end_span - 1].right;
+    for (auto const& band : bands)
+    {
+        left = std::min(left, spans[band.first_span].left);
+        right = std::max(right, spans[band.end_span - 1].right);
+    }
+
+    auto const top = bands.front().top;
+    auto const bottom = bands.back().bottom;
+
+    return {{left, top}, {right - left, bottom - top}};
+}
+
+geom::Rectangle geom::Region::bounding_rectangle_outside(Rectangle const& rect) const
+{
+    if (is_empty(rect))
+        return {};
+
+    auto const top = rect.top().as_int();
+    auto const bottom = rect.bottom().as_int();
+    auto const left = rect.left().as_int();
+    auto const right = rect.right().as_int();
+
+    int outside_top{none}, outside_bottom{0}, outside_left{right}, outside_right{left};
+    auto const add_outside = [&](int y0, int y1, int x0, int x1)
+        {
+            outside_top = std::min(outside_top, y0);
+            outside_bottom = std::max(outside_bottom, y1);
+            outside_left = std::min(outside_left, x0);
+            outside_right = std::max(outside_right, x1);
+        };
+
+    auto const candidates = overlapping(bands.cbegin(), bands.cend(), top, bottom);
+    auto y = top;
+    for (auto band = candidates.first; band != candidates.second; ++band)
+    {
+        if (band->top > y)
+            add_outside(y, band->top, left, right);   // A gap between bands
+
+        auto const band_top = std::max(band->top, top);
+        auto const band_bottom = std::min(band->bottom, bottom);
+        auto const first = spans.begin() + band->first_span;
+        auto const last = spans.begin() + band->end_span;
+
+        // Leftmost point not covered by a span...
+        auto x0 = left;
+        for (auto span = first; span != last && span->left <= x0; ++span)
+            x0 = std::max(x0, span->right);
+
+        if (x0 < right)
+        {
+            // ...and rightmost
+            auto x1 = right;
+            for (auto span = last; span != first && std::prev(span)->right >= x1; --span)
+                x1 = std::min(x1, std::prev(span)->left);
+
+            add_outside(band_top, band_bottom, x0, x1);
+        }
+
+        y = band_bottom;
+    }
+
+    if (y < bottom)
+        add_outside(y, bottom, left, right);
+
+    if (outside_top == none)
+        return {};
+
+    return {{outside_left, outside_top}, {outside_right - outside_left, outside_bottom - outside_top}};
+}
+
+geom::Rectangles geom::Region::rectangles() const
+{
+    Rectangles result;
+    for (auto const& band : bands)
+    {
+        for (auto span = band.first_span; span != band.end_span; ++span)
+        {
+            result.add({
+                {spans[span].left, band.top},
+                {spans[span].right - spans[span].left, band.bottom - band.top}});
+        }
+    }
+    return result;
+}
+
+bool geom::Region::operator==(Region const& other) const
+{
+    // Both are canonical, so equal regions have identical bands and spans
+    return std::equal(
+            bands.begin(), bands.end(), other.bands.begin(), other.bands.end(),
+            [](Band const& l, Band const& r)
+            {
+                return l.top == r.top && l.bottom == r.bottom &&
+                       l.first_span == r.first_span && l.end_span == r.end_span;
+            }) &&
+        std::equal(
+            spans.begin(), spans.end(), other.spans.begin(), other.spans.end(),
+            [](Span const& l, Span const& r) { return l.left == r.left && l.right == r.right; });
+}
+
+bool geom::Region::operator!=(Region const& other) const
+{
+    return !(*this == other);
+}
+
+std::ostream& geom::operator<<(std::ostream& out, Region const& value)
+{
+    return out << value.rectangles();
+}
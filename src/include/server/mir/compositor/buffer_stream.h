@@ -26,6 +26,7 @@
 #include "mir/graphics/buffer_id.h"
 
 #include <memory>
+#include <optional>
 
 namespace mir
 {
@@ -49,6 +50,15 @@ public:
     virtual void drop_old_buffers() = 0;
     virtual auto has_submitted_buffer() const -> bool = 0;
     virtual auto framedropping() const -> bool = 0;
+
+    /**
+     * The area (in buffer coordinates) that changed between two submitted buffers
+     *
+     * \return The changed area, or an empty optional if it is not known (in which
+     *         case the whole of \a current must be treated as damaged)
+     */
+    virtual auto damage_between(graphics::BufferID previous, graphics::BufferID current) const
+        -> std::optional<geometry::Rectangles> = 0;
 };
 
 }
@@ -19,8 +19,11 @@
 #ifndef MIR_COMPOSITOR_COMPOSITOR_H_
 #define MIR_COMPOSITOR_COMPOSITOR_H_
 
+#include <functional>
+
 namespace mir
 {
+namespace graphics { class DisplaySyncGroup; }
 namespace compositor
 {
 
@@ -32,6 +35,31 @@ public:
     virtual void start() = 0;
     virtual void stop() = 0;
 
+    /**
+     * Stop compositing while \p change reconfigures the display, then start again.
+     *
+     * The DisplaySyncGroups for which \p preserved returns true are guaranteed to
+     * remain valid throughout \p change, so compositing may carry on for them and
+     * only needs restarting for the groups that are replaced. The default
+     * implementation stops and restarts compositing for everything.
+     */
+    virtual void reconfigure(
+        std::function<bool(graphics::DisplaySyncGroup const&)> const& /*preserved*/,
+        std::function<void()> const& change)
+    {
+        stop();
+        try
+        {
+            change();
+        }
+        catch (...)
+        {
+            start();
+            throw;
+        }
+        start();
+    }
+
 protected:
     Compositor() = default;
     Compositor(Compositor const&) = delete;
@@ -21,6 +21,8 @@
 
 #include "mir/graphics/renderable.h"
 
+#include <chrono>
+
 namespace mir
 {
 namespace compositor
@@ -35,6 +37,14 @@ public:
     virtual void renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables) = 0;
     virtual void rendered_frame(SubCompositorId id) = 0;
     virtual void finished_frame(SubCompositorId id) = 0;
+    /// CPU time spent building the frame and submitting it for rendering
+    virtual void frame_cpu_time(SubCompositorId id, std::chrono::nanoseconds time) = 0;
+    /// GPU time spent rendering a frame; reported once known, which may be some frames later
+    virtual void frame_gpu_time(SubCompositorId id, std::chrono::nanoseconds time) = 0;
+    /// Whether frame_gpu_time() makes use of the times; measuring them has a cost, so is skipped if not
+    virtual bool wants_gpu_times() const = 0;
+    /// Time spent posting the frame to the display, including any wait for the page flip
+    virtual void frame_post_wait(SubCompositorId id, std::chrono::nanoseconds time) = 0;
     virtual void started() = 0;
     virtual void stopped() = 0;
     virtual void scheduled() = 0;
@@ -0,0 +1,79 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_FRAME_SCHEDULER_H_
+#define MIR_COMPOSITOR_FRAME_SCHEDULER_H_
+
+#include <chrono>
+#include <memory>
+
+namespace mir
+{
+namespace graphics
+{
+class DisplaySyncGroup;
+}
+namespace compositor
+{
+
+/**
+ * Decides when a compositing thread should next sample the scene.
+ *
+ * Sampling the scene too early adds latency, as the frame then waits for
+ * vblank with content that may already be out of date; sampling too late
+ * misses the vblank altogether. Each DisplaySyncGroup has its own scheduler.
+ */
+class FrameScheduler
+{
+public:
+    virtual ~FrameScheduler() = default;
+
+    /**
+     * How long to wait before compositing the next frame.
+     *
+     * Called by the compositing thread each time it has posted a frame.
+     *
+     * \param [in] group        The group that was just posted.
+     * \param [in] render_time  How long it took to composite the frame,
+     *                          excluding the time spent in post().
+     */
+    virtual auto delay_after_post(
+        graphics::DisplaySyncGroup const& group,
+        std::chrono::nanoseconds render_time) -> std::chrono::nanoseconds = 0;
+
+protected:
+    FrameScheduler() = default;
+    FrameScheduler(FrameScheduler const&) = delete;
+    FrameScheduler& operator=(FrameScheduler const&) = delete;
+};
+
+class FrameSchedulerFactory
+{
+public:
+    virtual ~FrameSchedulerFactory() = default;
+
+    virtual auto create_scheduler_for(graphics::DisplaySyncGroup const& group) -> std::unique_ptr<FrameScheduler> = 0;
+
+protected:
+    FrameSchedulerFactory() = default;
+    FrameSchedulerFactory(FrameSchedulerFactory const&) = delete;
+    FrameSchedulerFactory& operator=(FrameSchedulerFactory const&) = delete;
+};
+
+}
+}
+
+#endif /* MIR_COMPOSITOR_FRAME_SCHEDULER_H_ */
@@ -55,6 +55,7 @@ class Scene;
 class DisplayBufferCompositorFactory;
 class Compositor;
 class CompositorReport;
+class FrameSchedulerFactory;
 }
 namespace frontend
 {
@@ -236,6 +237,7 @@ public:
     virtual std::shared_ptr<compositor::DisplayBufferCompositorFactory> the_display_buffer_compositor_factory();
     virtual std::shared_ptr<compositor::DisplayBufferCompositorFactory> wrap_display_buffer_compositor_factory(
         std::shared_ptr<compositor::DisplayBufferCompositorFactory> const& wrapped);
+    virtual std::shared_ptr<compositor::FrameSchedulerFactory> the_frame_scheduler_factory();
     /** @} */
 
     /** @name compositor configuration - dependencies
@@ -398,6 +400,7 @@ protected:
     CachedPtr<shell::DisplayLayout>     shell_display_layout;
     CachedPtr<compositor::DisplayBufferCompositorFactory> display_buffer_compositor_factory;
     CachedPtr<compositor::Compositor> compositor;
+    CachedPtr<compositor::FrameSchedulerFactory> frame_scheduler_factory;
     CachedPtr<compositor::CompositorReport> compositor_report;
     CachedPtr<logging::Logger> logger;
     CachedPtr<graphics::DisplayReport> display_report;
@@ -22,6 +22,7 @@
 #include <mir_toolkit/common.h>
 #include "mir/graphics/buffer_id.h"
 #include "mir/geometry/size.h"
+#include "mir/geometry/rectangles.h"
 #include <functional>
 #include <memory>
 
@@ -43,6 +44,16 @@ public:
 
     virtual void submit_buffer(std::shared_ptr<graphics::Buffer> const& buffer) = 0;
 
+    /**
+     * Submit a buffer, along with the area that changed since the previously submitted buffer
+     *
+     * \param [in] buffer  The new buffer
+     * \param [in] damage  The changed area, in buffer coordinates
+     */
+    virtual void submit_buffer(
+        std::shared_ptr<graphics::Buffer> const& buffer,
+        geometry::Rectangles const& damage) = 0;
+
     virtual void set_frame_posted_callback(
         std::function<void(geometry::Size const&)> const& callback) = 0;
 
@@ -26,6 +26,7 @@
 #include "mir/optional_value.h"
 #include "surface_state_tracker.h"
 
+#include <optional>
 #include <vector>
 #include <list>
 
@@ -42,6 +43,8 @@ struct StreamInfo
     std::shared_ptr<compositor::BufferStream> stream;
     geometry::Displacement displacement;
     optional_value<geometry::Size> size;
+    /// Area of the stream (relative to its top left) that is opaque regardless of pixel format
+    std::optional<std::vector<geometry::Rectangle>> opaque_region{};
 };
 
 class SurfaceObserver;
@@ -157,6 +160,12 @@ public:
     virtual auto focus_mode() const -> MirFocusMode = 0;
     virtual void set_focus_mode(MirFocusMode focus_mode) = 0;
     ///@}
+
+    /// Whether the client accepts tearing to have its frames shown sooner
+    ///@{
+    virtual auto allow_tearing() const -> bool = 0;
+    virtual void set_allow_tearing(bool allow) = 0;
+    ///@}
 };
 }
 }
@@ -24,12 +24,15 @@
 #include "mir/frontend/surface_id.h"
 #include "mir/geometry/point.h"
 #include "mir/geometry/displacement.h"
+#include "mir/geometry/rectangle.h"
 #include "mir/graphics/buffer_properties.h"
 #include "mir/graphics/display_configuration.h"
 #include "mir/frontend/buffer_stream_id.h"
 
 #include <string>
 #include <memory>
+#include <optional>
+#include <vector>
 
 namespace mir
 {
@@ -51,6 +54,8 @@ struct StreamSpecification
     std::weak_ptr<frontend::BufferStream> stream;
     geometry::Displacement displacement;
     optional_value<geometry::Size> size;
+    /// Area of the stream (relative to its top left) that is opaque regardless of pixel format
+    std::optional<std::vector<geometry::Rectangle>> opaque_region{};
 };
 auto operator==(StreamSpecification const& lhs, StreamSpecification const& rhs) -> bool;
 
@@ -120,6 +125,9 @@ struct SurfaceSpecification
 
     /// How the surface should gain and lose focus
     optional_value<MirFocusMode> focus_mode;
+
+    /// If the client accepts tearing to have its frames shown sooner
+    optional_value<bool> allow_tearing;
 };
 bool operator==(SurfaceSpecification const& lhs, SurfaceSpecification const& rhs);
 bool operator!=(SurfaceSpecification const& lhs, SurfaceSpecification const& rhs);
@@ -1194,6 +1194,9 @@ void miral::BasicWindowManager::modify_window(WindowInfo& window_info, WindowSpe
 
     if (modifications.confine_pointer().is_set())
         std::shared_ptr<scene::Surface>(window)->set_confine_pointer_state(modifications.confine_pointer().value());
+
+    if (modifications.allow_tearing().is_set())
+        std::shared_ptr<scene::Surface>(window)->set_allow_tearing(modifications.allow_tearing().value());
 }
 
 auto miral::BasicWindowManager::info_for_window_id(std::string const& id) const -> WindowInfo&
@@ -48,6 +48,11 @@ char const* const display_scale_opt = "display-scale";
 char const* const display_scale_descr = "Scale for all displays";
 char const* const display_scale_default = "1.0";
 
+char const* const display_adaptive_sync_opt = "adaptive-sync";
+char const* const display_adaptive_sync_descr = "Let fullscreen clients set the refresh rate of capable displays [{on,off}]";
+char const* const display_adaptive_sync_off = "off";
+char const* const display_adaptive_sync_on = "on";
+
 class PixelFormatSelector : public mg::DisplayConfigurationPolicy
 {
 public:
@@ -121,12 +126,36 @@ void ScaleSetter::apply_to(mg::DisplayConfiguration& conf)
         });
 }
 
+class AdaptiveSyncSetter : public mg::DisplayConfigurationPolicy
+{
+public:
+    AdaptiveSyncSetter(std::shared_ptr<mg::DisplayConfigurationPolicy> const& base_policy)
+        : base_policy{base_policy}
+    {
+    }
+
+    void apply_to(mg::DisplayConfiguration& conf) override;
+private:
+    std::shared_ptr<mg::DisplayConfigurationPolicy> const base_policy;
+};
+
+void AdaptiveSyncSetter::apply_to(mg::DisplayConfiguration& conf)
+{
+    base_policy->apply_to(conf);
+    conf.for_each_output(
+        [&](mg::UserDisplayConfigurationOutput& output)
+        {
+            output.vrr_enabled = output.vrr_capable;
+        });
+}
+
 void miral::display_configuration_options(mir::Server& server)
 {
     // Add choice of monitor configuration
     server.add_configuration_option(display_config_opt, display_config_descr,   sidebyside_opt_val);
     server.add_configuration_option(display_alpha_opt,  display_alpha_descr,    display_alpha_off);
     server.add_configuration_option(display_scale_opt,  display_scale_descr,    display_scale_default);
+    server.add_configuration_option(display_adaptive_sync_opt, display_adaptive_sync_descr, display_adaptive_sync_off);
 
     server.wrap_display_configuration_policy(
         [&](std::shared_ptr<mg::DisplayConfigurationPolicy> const& wrapped)
@@ -136,6 +165,7 @@ void miral::display_configuration_options(mir::Server& server)
             auto display_layout = options->get<std::string>(display_config_opt);
             auto with_alpha = options->get<std::string>(display_alpha_opt) == display_alpha_on;
             auto const scale_str = options->get<std::string>(display_scale_opt);
+            auto const adaptive_sync = options->get<std::string>(display_adaptive_sync_opt) == display_adaptive_sync_on;
 
             double scale{0};
             static double const scale_min = 0.01;
@@ -169,6 +199,10 @@ void miral::display_configuration_options(mir::Server& server)
                 {
                     mir::fatal_error("Display scale option can't be used with static display configuration");
                 }
+                if (adaptive_sync)
+                {
+                    mir::fatal_error("Adaptive sync option can't be used with static display configuration");
+                }
                 layout_selector = std::make_shared<StaticDisplayConfig>(display_layout.substr(strlen(static_opt_val)));
             }
 
@@ -177,6 +211,11 @@ void miral::display_configuration_options(mir::Server& server)
                 layout_selector = std::make_shared<ScaleSetter>(layout_selector, scale);
             }
 
+            if (adaptive_sync)
+            {
+                layout_selector = std::make_shared<AdaptiveSyncSetter>(layout_selector);
+            }
+
             // Whatever the layout select a pixel format with requested alpha
             return std::make_shared<PixelFormatSelector>(layout_selector, with_alpha);
         });
@@ -43,6 +43,7 @@ char const* const mode = "mode";
 char const* const orientation = "orientation";
 char const* const scale = "scale";
 char const* const group = "group";
+char const* const adaptive_sync = "adaptive-sync";
 char const* const orientation_value[] = { "normal", "left", "inverted", "right" };
 
 auto as_string(MirOrientation orientation) -> char const*
@@ -242,6 +243,14 @@ try
                         output_config.scale = s.as<float>();
                     }
 
+                    if (auto const a = port_config[adaptive_sync])
+                    {
+                        auto const value = a.as<std::string>();
+                        if (value != state_enabled && value != state_disabled)
+                            throw mir::AbnormalExit{error_prefix + "invalid 'adaptive-sync' (" + value + ") for port: " + port_name};
+                        output_config.adaptive_sync = (value == state_enabled);
+                    }
+
                     layout_config[output_id] = output_config;
                 }
             }
@@ -363,6 +372,10 @@ void miral::StaticDisplayConfig::apply_to(mg::DisplayConfiguration& conf)
                 {
                     conf_output.logical_group_id = mg::DisplayConfigurationLogicalGroupId{};
                 }
+
+                conf_output.vrr_enabled = conf_output.vrr_capable &&
+                                          conf.adaptive_sync.is_set() &&
+                                          conf.adaptive_sync.value();
             }
             else
             {
@@ -403,6 +416,12 @@ void miral::StaticDisplayConfig::apply_to(mg::DisplayConfiguration& conf)
                            "\n        # scale: " << conf_output.scale
                         << "\n        # group: " << conf_output.logical_group_id.as_value()
                         << "\t# Outputs with the same non-zero value are treated as a single display";
+
+                    if (conf_output.vrr_capable)
+                    {
+                        out << "\n        # adaptive-sync: " << (conf_output.vrr_enabled ? state_enabled : state_disabled)
+                            << "\t# {enabled, disabled}, defaults to disabled. Lets a fullscreen client set the refresh rate";
+                    }
                 }
             }
             else
@@ -59,6 +59,7 @@ private:
         mir::optional_value<float>  scale;
         mir::optional_value<MirOrientation>  orientation;
         mir::optional_value<int> group_id;
+        mir::optional_value<bool> adaptive_sync;
     };
 
     using Id2Config = std::map<Id, Config>;
@@ -56,7 +56,8 @@ miral::WindowSpecification::Self::Self(mir::shell::SurfaceSpecification const& s
     exclusive_rect(spec.exclusive_rect),
     application_id(spec.application_id),
     server_side_decorated(spec.server_side_decorated),
-    focus_mode(spec.focus_mode)
+    focus_mode(spec.focus_mode),
+    allow_tearing(spec.allow_tearing)
 {
     if (spec.aux_rect_placement_offset_x.is_set() && spec.aux_rect_placement_offset_y.is_set())
         aux_rect_placement_offset = Displacement{spec.aux_rect_placement_offset_x.value(), spec.aux_rect_placement_offset_y.value()};
@@ -441,6 +442,16 @@ auto miral::WindowSpecification::focus_mode() -> mir::optional_value<MirFocusMod
     return self->focus_mode;
 }
 
+auto miral::WindowSpecification::allow_tearing() const -> mir::optional_value<bool> const&
+{
+    return self->allow_tearing;
+}
+
+auto miral::WindowSpecification::allow_tearing() -> mir::optional_value<bool>&
+{
+    return self->allow_tearing;
+}
+
 auto miral::WindowSpecification::userdata() -> mir::optional_value<std::shared_ptr<void>>&
 {
     return self->userdata;
@@ -74,6 +74,7 @@ struct WindowSpecification::Self
     mir::optional_value<std::string> application_id;
     mir::optional_value<bool> server_side_decorated;
     mir::optional_value<MirFocusMode> focus_mode;
+    mir::optional_value<bool> allow_tearing;
     mir::optional_value<std::shared_ptr<void>> userdata;
 };
 
@@ -133,6 +133,7 @@ std::ostream& mg::operator<<(std::ostream& out, mg::DisplayConfigurationOutput c
     out << std::endl;
 
     out << "\torientation: " << val.orientation << '\n';
+    out << "\tvariable refresh rate: " << (val.vrr_capable ? (val.vrr_enabled ? "enabled" : "disabled") : "unsupported") << '\n';
     out << "}" << std::endl;
 
     return out;
@@ -189,7 +190,9 @@ bool mg::operator==(mg::DisplayConfigurationOutput const& val1,
                (val1.modes.size() == val2.modes.size()) &&
                (val1.custom_logical_size == val2.custom_logical_size) &&
                (val1.scale == val2.scale) &&
-               (val1.form_factor == val2.form_factor)};
+               (val1.form_factor == val2.form_factor) &&
+               (val1.vrr_capable == val2.vrr_capable) &&
+               (val1.vrr_enabled == val2.vrr_enabled)};
 
     if (equal)
     {
@@ -331,7 +334,9 @@ mg::UserDisplayConfigurationOutput::UserDisplayConfigurationOutput(
         gamma(main.gamma),
         gamma_supported(main.gamma_supported),
         edid(*reinterpret_cast<std::vector<uint8_t const>*>(&main.edid)),
-        custom_logical_size(main.custom_logical_size)
+        custom_logical_size(main.custom_logical_size),
+        vrr_capable(main.vrr_capable),
+        vrr_enabled(main.vrr_enabled)
 {
 }
 
@@ -39,6 +39,26 @@ auto maybe_platform_base_ext() -> std::optional<mg::EGLExtensions::PlatformBaseE
     }
 }
 
+auto swap_buffers_with_damage_for(EGLDisplay dpy) -> PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC
+{
+    auto const egl_extensions = eglQueryString(dpy, EGL_EXTENSIONS);
+    if (!egl_extensions)
+        return nullptr;
+
+    if (strstr(egl_extensions, "EGL_KHR_swap_buffers_with_damage"))
+    {
+        return reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(
+            eglGetProcAddress("eglSwapBuffersWithDamageKHR"));
+    }
+
+    if (strstr(egl_extensions, "EGL_EXT_swap_buffers_with_damage"))
+    {
+        return reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(
+            eglGetProcAddress("eglSwapBuffersWithDamageEXT"));
+    }
+
+    return nullptr;
+}
 }
 
 mg::EGLExtensions::EGLExtensions() :
@@ -204,3 +224,13 @@ mg::EGLExtensions::EXTImageDmaBufImportModifiers::EXTImageDmaBufImportModifiers(
             std::runtime_error{"EGL_EXT_image_dma_buf_import_modifiers not supported"}));
     }
 }
+
+mg::EGLExtensions::SwapBuffersWithDamage::SwapBuffersWithDamage(EGLDisplay dpy)
+    : eglSwapBuffersWithDamage{swap_buffers_with_damage_for(dpy)}
+{
+    if (!eglSwapBuffersWithDamage)
+    {
+        BOOST_THROW_EXCEPTION((
+            std::runtime_error{"EGL implementation doesn't support EGL_{KHR,EXT}_swap_buffers_with_damage"}));
+    }
+}
@@ -30,6 +30,7 @@
 #include "mir/graphics/buffer_basic.h"
 #include "mir/graphics/dmabuf_buffer.h"
 #include "mir/executor.h"
+#include "mir/anonymous_shm_file.h"
 
 #define MIR_LOG_COMPONENT "linux-dmabuf-import"
 #include "mir/log.h"
@@ -39,11 +40,27 @@
 #include <EGL/eglext.h>
 
 #include <mutex>
+#include <chrono>
+#include <cinttypes>
 #include <vector>
 #include <optional>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <cstring>
 #include <drm_fourcc.h>
+#include <sys/stat.h>
 #include <wayland-server.h>
 
+namespace mir
+{
+namespace wayland
+{
+// The generated Global has a fixed version; ours depends on whether feedback can be offered
+extern struct wl_interface const zwp_linux_dmabuf_v1_interface_data;
+}
+}
+
 namespace mg = mir::graphics;
 namespace mw = mir::wayland;
 namespace geom = mir::geometry;
@@ -369,6 +386,100 @@ BufferGLDescription const ExternalOES = {
     "}\n"
 };
 
+/// EGLImage cache hits and misses of every dmabuf global, logged once a second while there are imports
+class ImportStats
+{
+public:
+    void record(bool hit)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        ++(hit ? total.hits : total.misses);
+        ++(hit ? recent_hits : recent_misses);
+
+        auto const now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds{1})
+        {
+            mir::log_debug(
+                "dmabuf EGLImage cache: %" PRIu64 " hits, %" PRIu64 " misses",
+                recent_hits,
+                recent_misses);
+
+            last_report = now;
+            recent_hits = 0;
+            recent_misses = 0;
+        }
+    }
+
+    auto counts() -> mg::LinuxDmaBufUnstable::ImportCounts
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return total;
+    }
+
+private:
+    std::mutex mutex;
+    mg::LinuxDmaBufUnstable::ImportCounts total{0, 0};
+    std::chrono::steady_clock::time_point last_report{std::chrono::steady_clock::now()};
+    uint64_t recent_hits{0};
+    uint64_t recent_misses{0};
+};
+
+auto import_stats() -> ImportStats&
+{
+    static ImportStats stats;
+    return stats;
+}
+
+/**
+ * A texture bound to an imported dmabuf's EGLImage
+ *
+ * The texture is deleted on the Wayland thread, with the context it was created in
+ * current, once the WlDmaBufBuffer and every Mir buffer submitted from it let go.
+ */
+class ImportedTexture
+{
+public:
+    // Note: Must be called with ctx current
+    ImportedTexture(
+        std::shared_ptr<mir::renderer::gl::Context> ctx,
+        std::shared_ptr<mir::Executor> wayland_executor)
+        : ctx{std::move(ctx)},
+          wayland_executor{std::move(wayland_executor)},
+          tex{gen_texture()}
+    {
+    }
+
+    ~ImportedTexture()
+    {
+        wayland_executor->spawn(
+            [context = ctx, tex = tex]()
+            {
+              context->make_current();
+
+              glDeleteTextures(1, &tex);
+
+              context->release_current();
+            });
+    }
+
+    ImportedTexture(ImportedTexture const&) = delete;
+    ImportedTexture& operator=(ImportedTexture const&) = delete;
+
+    std::shared_ptr<mir::renderer::gl::Context> const ctx;
+    std::shared_ptr<mir::Executor> const wayland_executor;
+    GLuint const tex;
+    /// The EGLImage tex is currently targeted at
+    EGLImageKHR image{EGL_NO_IMAGE_KHR};
+
+private:
+    static auto gen_texture() -> GLuint
+    {
+        GLuint tex;
+        glGenTextures(1, &tex);
+        return tex;
+    }
+};
+
 /**
  * Holds on to all imported dmabuf buffers, and allows looking up by wl_buffer
  *
@@ -400,7 +511,7 @@ public:
               planes_{std::move(plane_params)},
               image{EGL_NO_IMAGE_KHR}
     {
-        reimport_egl_image();
+        import_egl_image();
     }
 
     ~WlDmaBufBuffer()
@@ -443,15 +554,60 @@ public:
         return desc;
     }
     /**
-     * Reimport dmabufs into EGL
+     * The texture bound to this buffer's EGLImage, for use in ctx
      *
-     * This is necessary to call each time the buffer is re-submitted by the client,
-     * to ensure any state is properly synchronised.
+     * Clients cycle through a small set of buffers, so the texture is kept for as
+     * long as the buffer lives and resubmitting the buffer costs no new import.
+     *
+     * \note   This must be called with ctx current
+     */
+    auto texture_for(
+        std::shared_ptr<mir::renderer::gl::Context> const& ctx,
+        std::shared_ptr<mir::Executor> const& wayland_executor) -> std::shared_ptr<ImportedTexture>
+    {
+        bool const hit{texture && texture->ctx == ctx};
+        import_stats().record(hit);
+
+        if (!hit)
+        {
+            texture = std::make_shared<ImportedTexture>(ctx, wayland_executor);
+
+            glBindTexture(desc.target, texture->tex);
+            glTexParameteri(desc.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(desc.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(desc.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(desc.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+
+        /* The texture is an EGLImage sibling, so it already sees whatever the client
+         * has rendered since; it only needs re-targeting if the image has changed.
+         */
+        if (texture->image != image)
+        {
+            glBindTexture(desc.target, texture->tex);
+            egl_extensions->base(dpy).glEGLImageTargetTexture2DOES(desc.target, image);
+            texture->image = image;
+        }
+
+        return texture;
+    }
+
+    auto modifier() -> uint64_t
+    {
+        return modifier_;
+    }
+
+    auto planes() -> std::vector<PlaneInfo> const&
+    {
+        return planes_;
+    }
+private:
+    /**
+     * Import the dmabufs into EGL
      *
-     * \return  An EGLImageKHR handle to the imported
      * \throws  A std::system_error containing the EGL error on failure.
      */
-    auto reimport_egl_image() -> EGLImageKHR
+    void import_egl_image()
     {
         std::vector<EGLint> attributes;
 
@@ -482,10 +638,6 @@ public:
             }
         }
         attributes.push_back(EGL_NONE);
-        if (image != EGL_NO_IMAGE_KHR)
-        {
-            egl_extensions->base(dpy).eglDestroyImageKHR(dpy, image);
-        }
         image = egl_extensions->base(dpy).eglCreateImageKHR(
             dpy,
             EGL_NO_CONTEXT,
@@ -500,20 +652,9 @@ public:
                 "Failed to import supplied dmabuf";
             BOOST_THROW_EXCEPTION((mg::egl_error(msg)));
         }
-
-        return image;
     }
 
-    auto modifier() -> uint64_t
-    {
-        return modifier_;
-    }
 
-    auto planes() -> std::vector<PlaneInfo> const&
-    {
-        return planes_;
-    }
-private:
     EGLDisplay const dpy;
     std::shared_ptr<mg::EGLExtensions> const egl_extensions;
     BufferGLDescription const& desc;
@@ -523,6 +664,7 @@ private:
     uint64_t const modifier_;
     std::vector<PlaneInfo> const planes_;
     EGLImageKHR image;
+    std::shared_ptr<ImportedTexture> texture;
 
     struct EGLPlaneAttribs
     {
@@ -572,7 +714,7 @@ public:
         EGLDisplay dpy,
         std::shared_ptr<mg::EGLExtensions> egl_extensions,
         std::shared_ptr<mg::DmaBufFormatDescriptors const> formats)
-        : mir::wayland::LinuxBufferParamsV1(new_resource, Version<3>{}),
+        : mir::wayland::LinuxBufferParamsV1(new_resource, Version<4>{}),
           consumed{false},
           dpy{dpy},
           egl_extensions{std::move(egl_extensions)},
@@ -855,13 +997,6 @@ private:
     }
 };
 
-GLuint get_tex_id()
-{
-    GLuint tex;
-    glGenTextures(1, &tex);
-    return tex;
-}
-
 bool drm_format_has_alpha(uint32_t format)
 {
     /* TODO: We should really have something like libweston/pixel-formats.h
@@ -894,55 +1029,28 @@ class WaylandDmabufTexBuffer :
     public mg::DMABufBuffer
 {
 public:
-    // Note: Must be called with a current EGL context
     WaylandDmabufTexBuffer(
+        std::shared_ptr<ImportedTexture> texture,
         WlDmaBufBuffer& source,
-        mg::EGLExtensions const& extensions,
-        std::shared_ptr<mir::renderer::gl::Context> ctx,
-        EGLDisplay dpy,
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release,
-        std::shared_ptr<mir::Executor> wayland_executor)
-        : ctx{std::move(ctx)},
-          tex{get_tex_id()},
+        std::function<void()>&& on_scanout_candidate)
+        : texture{std::move(texture)},
           desc{source.descriptor()},
           on_consumed{std::move(on_consumed)},
           on_release{std::move(on_release)},
+          on_scanout_candidate{std::move(on_scanout_candidate)},
           size_{source.size()},
           layout_{source.layout()},
           has_alpha{drm_format_has_alpha(source.format())},
           planes_{source.planes()},
           modifier_{source.modifier()},
-          fourcc{source.format()},
-          wayland_executor{std::move(wayland_executor)}
+          fourcc{source.format()}
     {
-        eglBindAPI(EGL_OPENGL_ES_API);
-
-        auto const target = source.descriptor().target;
-
-        glBindTexture(target, tex);
-        extensions.base(dpy).glEGLImageTargetTexture2DOES(target, source.reimport_egl_image());
-        // tex is now an EGLImage sibling, so we can free the EGLImage without
-        // freeing the backing data.
-
-        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
 
     ~WaylandDmabufTexBuffer() override
     {
-        wayland_executor->spawn(
-            [context = ctx, tex = tex]()
-            {
-              context->make_current();
-
-              glDeleteTextures(1, &tex);
-
-              context->release_current();
-            });
-
         on_release();
     }
 
@@ -988,7 +1096,7 @@ public:
 
     void bind() override
     {
-        glBindTexture(desc.target, tex);
+        glBindTexture(desc.target, texture->tex);
 
         std::lock_guard<decltype(consumed_mutex)> lock(consumed_mutex);
         on_consumed();
@@ -1014,14 +1122,22 @@ public:
         return planes_;
     }
 
+    void mark_scanout_candidate() override
+    {
+        std::lock_guard<decltype(scanout_candidate_mutex)> lock(scanout_candidate_mutex);
+        on_scanout_candidate();
+        on_scanout_candidate = [](){};
+    }
+
 private:
-    std::shared_ptr<mir::renderer::gl::Context> const ctx;
-    GLuint const tex;
+    std::shared_ptr<ImportedTexture> const texture;
     BufferGLDescription const& desc;
 
     std::mutex consumed_mutex;
     std::function<void()> on_consumed;
     std::function<void()> const on_release;
+    std::mutex scanout_candidate_mutex;
+    std::function<void()> on_scanout_candidate;
 
     geom::Size const size_;
     Layout const layout_;
@@ -1030,13 +1146,314 @@ private:
     std::vector<mg::DMABufBuffer::PlaneDescriptor> const planes_;
     std::optional<uint64_t> const modifier_;
     uint32_t const fourcc;
+};
 
-    std::shared_ptr<mir::Executor> const wayland_executor;
+
+}
+
+namespace
+{
+bool has_extension(char const* extensions, char const* extension)
+{
+    return extensions && strstr(extensions, extension);
+}
+
+/**
+ * The DRM device node EGL renders with, preferring its render node
+ *
+ * This is what linux-dmabuf feedback advertises as the main device; clients
+ * allocate buffers on it when they can't be scanned out directly.
+ */
+auto main_device_for(EGLDisplay dpy) -> std::optional<dev_t>
+{
+    if (!has_extension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), "EGL_EXT_device_query"))
+    {
+        return {};
+    }
+
+    auto const eglQueryDisplayAttribEXT =
+        reinterpret_cast<PFNEGLQUERYDISPLAYATTRIBEXTPROC>(eglGetProcAddress("eglQueryDisplayAttribEXT"));
+    auto const eglQueryDeviceStringEXT =
+        reinterpret_cast<PFNEGLQUERYDEVICESTRINGEXTPROC>(eglGetProcAddress("eglQueryDeviceStringEXT"));
+    if (!eglQueryDisplayAttribEXT || !eglQueryDeviceStringEXT)
+    {
+        return {};
+    }
+
+    EGLAttrib device_attrib;
+    if (eglQueryDisplayAttribEXT(dpy, EGL_DEVICE_EXT, &device_attrib) != EGL_TRUE)
+    {
+        return {};
+    }
+    auto const device = reinterpret_cast<EGLDeviceEXT>(device_attrib);
+    auto const device_extensions = eglQueryDeviceStringEXT(device, EGL_EXTENSIONS);
+
+    char const* node{nullptr};
+#ifdef EGL_DRM_RENDER_NODE_FILE_EXT
+    if (has_extension(device_extensions, "EGL_EXT_device_drm_render_node"))
+    {
+        node = eglQueryDeviceStringEXT(device, EGL_DRM_RENDER_NODE_FILE_EXT);
+    }
+#endif
+    if (!node && has_extension(device_extensions, "EGL_EXT_device_drm"))
+    {
+        node = eglQueryDeviceStringEXT(device, EGL_DRM_DEVICE_FILE_EXT);
+    }
+    if (!node)
+    {
+        return {};
+    }
+
+    struct stat info;
+    if (stat(node, &info) == -1 || !S_ISCHR(info.st_mode))
+    {
+        return {};
+    }
+    return info.st_rdev;
+}
+}
+
+/**
+ * The format table and preference tranches shared by all dmabuf feedback objects
+ *
+ * The table is written once and never modified, so every feedback object can
+ * send the same file.
+ */
+class mg::DmaBufFeedbackTables
+{
+public:
+    DmaBufFeedbackTables(
+        dev_t main_device,
+        DmaBufFormatDescriptors const& formats,
+        std::vector<DRMFormatModifier> const& scanout_formats)
+        : main_device{main_device}
+    {
+        struct TableEntry
+        {
+            uint32_t format;
+            uint32_t padding;
+            uint64_t modifier;
+        };
+        static_assert(sizeof(TableEntry) == 16, "linux-dmabuf format table entries are 16 bytes");
+
+        std::vector<TableEntry> entries;
+        bool table_full{false};
+        for (auto i = 0u; i < formats.num_formats() && !table_full; ++i)
+        {
+            auto const [format, modifiers, external_only] = formats[i];
+            for (auto const modifier : modifiers)
+            {
+                if (entries.size() > std::numeric_limits<uint16_t>::max())
+                {
+                    mir::log_warning(
+                        "Too many dma-buf format/modifier pairs for the linux-dmabuf format table; "
+                        "ignoring all after the first %zu",
+                        entries.size());
+                    table_full = true;
+                    break;
+                }
+
+                auto const fourcc = static_cast<uint32_t>(format);
+                auto const index = static_cast<uint16_t>(entries.size());
+                entries.push_back(TableEntry{fourcc, 0, modifier});
+                render_tranche.push_back(index);
+
+                auto const can_scanout = std::any_of(
+                    scanout_formats.begin(),
+                    scanout_formats.end(),
+                    [fourcc, modifier](auto const& candidate)
+                    {
+                        return candidate.format == fourcc && candidate.modifier == modifier;
+                    });
+                if (can_scanout)
+                {
+                    scanout_tranche.push_back(index);
+                }
+            }
+        }
+
+        table_size = entries.size() * sizeof(TableEntry);
+        table = std::make_unique<mir::AnonymousShmFile>(table_size);
+        ::memcpy(table->base_ptr(), entries.data(), table_size);
+
+        mir::log_debug(
+            "linux-dmabuf feedback: %zu format/modifier pairs, %zu of which can be scanned out",
+            render_tranche.size(),
+            scanout_tranche.size());
+    }
+
+    std::unique_ptr<mir::AnonymousShmFile> table;
+    size_t table_size;
+    dev_t const main_device;
+    std::vector<uint16_t> render_tranche;
+    std::vector<uint16_t> scanout_tranche;
 };
 
+namespace
+{
+/// Owns a wl_array for the duration of an event send
+class WlArray
+{
+public:
+    template<typename T>
+    WlArray(T const* data, size_t count)
+    {
+        wl_array_init(&array);
+        if (count > 0)
+        {
+            auto const size = count * sizeof(T);
+            ::memcpy(wl_array_add(&array, size), data, size);
+        }
+    }
+
+    ~WlArray()
+    {
+        wl_array_release(&array);
+    }
 
+    WlArray(WlArray const&) = delete;
+    WlArray& operator=(WlArray const&) = delete;
+
+    auto get() -> wl_array*
+    {
+        return &array;
+    }
+
+private:
+    wl_array array;
+};
+
+class LinuxDmabufFeedback : public mir::wayland::LinuxDmabufFeedbackV1
+{
+public:
+    LinuxDmabufFeedback(
+        wl_resource* new_resource,
+        std::shared_ptr<mg::DmaBufFeedbackTables const> tables,
+        bool include_scanout)
+        : mir::wayland::LinuxDmabufFeedbackV1(new_resource, Version<4>{}),
+          tables{std::move(tables)}
+    {
+        send(include_scanout);
+    }
+
+    /// Send the complete feedback, ending with done
+    void send(bool include_scanout)
+    {
+        send_format_table_event(
+            mir::Fd{mir::IntOwnedFd{tables->table->fd()}},
+            static_cast<uint32_t>(tables->table_size));
+
+        WlArray device{&tables->main_device, 1};
+        send_main_device_event(device.get());
+
+        /* We only scan out from the device we render with, so the scanout
+         * tranche targets the main device, ahead of the render-only tranche.
+         */
+        if (include_scanout && !tables->scanout_tranche.empty())
+        {
+            send_tranche(tables->main_device, tables->scanout_tranche, TrancheFlags::scanout);
+        }
+        send_tranche(tables->main_device, tables->render_tranche, 0);
+
+        send_done_event();
+    }
+
+private:
+    std::shared_ptr<mg::DmaBufFeedbackTables const> const tables;
+
+    void send_tranche(dev_t target_device, std::vector<uint16_t> const& indices, uint32_t flags)
+    {
+        WlArray device{&target_device, 1};
+        send_tranche_target_device_event(device.get());
+
+        send_tranche_flags_event(flags);
+
+        WlArray formats{indices.data(), indices.size()};
+        send_tranche_formats_event(formats.get());
+
+        send_tranche_done_event();
+    }
+};
 }
 
+/**
+ * The feedback objects clients have asked for each surface
+ *
+ * A surface is only offered the scanout tranche once the display has found one
+ * of its buffers to be a bypass or overlay candidate; its feedback is then resent.
+ * Nothing tells us when a surface stops being a candidate, so the offer stands
+ * until the surface is destroyed.
+ *
+ * \note This is not threadsafe, and should only be accessed on the Wayland thread
+ */
+class mg::DmaBufSurfaceFeedback
+{
+public:
+    explicit DmaBufSurfaceFeedback(std::shared_ptr<DmaBufFeedbackTables const> tables)
+        : tables{std::move(tables)}
+    {
+    }
+
+    void create_feedback(wl_resource* id, mw::Surface& surface)
+    {
+        auto& state = state_for(surface);
+        auto const feedback = new LinuxDmabufFeedback{id, tables, state.scanout_candidate};
+        state.feedback.push_back(mw::make_weak(feedback));
+    }
+
+    void mark_scanout_candidate(mw::Surface& surface)
+    {
+        auto& state = state_for(surface);
+        if (state.scanout_candidate || tables->scanout_tranche.empty())
+        {
+            return;
+        }
+        state.scanout_candidate = true;
+
+        for (auto const& feedback : state.feedback)
+        {
+            if (feedback)
+            {
+                feedback.value().send(true);
+            }
+        }
+    }
+
+private:
+    struct SurfaceState
+    {
+        mw::Weak<mw::Surface> surface;
+        bool scanout_candidate{false};
+        std::vector<mw::Weak<LinuxDmabufFeedback>> feedback;
+    };
+
+    auto state_for(mw::Surface& surface) -> SurfaceState&
+    {
+        // Forget destroyed surfaces (whose address a new surface may now have)
+        for (auto i = surfaces.begin(); i != surfaces.end();)
+        {
+            if (i->second.surface)
+            {
+                ++i;
+            }
+            else
+            {
+                i = surfaces.erase(i);
+            }
+        }
+
+        auto& state = surfaces[&surface];
+        if (!state.surface)
+        {
+            state.surface = mw::make_weak(&surface);
+        }
+        return state;
+    }
+
+    std::shared_ptr<DmaBufFeedbackTables const> const tables;
+    std::unordered_map<mw::Surface const*, SurfaceState> surfaces;
+};
+
 class mg::LinuxDmaBufUnstable::Instance : public mir::wayland::LinuxDmabufV1
 {
 public:
@@ -1044,12 +1461,22 @@ public:
         wl_resource* new_resource,
         EGLDisplay dpy,
         std::shared_ptr<EGLExtensions> egl_extensions,
-        std::shared_ptr<DmaBufFormatDescriptors const> formats)
-        : mir::wayland::LinuxDmabufV1(new_resource, Version<3>{}),
+        std::shared_ptr<DmaBufFormatDescriptors const> formats,
+        std::shared_ptr<DmaBufFeedbackTables const> feedback,
+        std::shared_ptr<DmaBufSurfaceFeedback> surface_feedback)
+        : mir::wayland::LinuxDmabufV1(new_resource, Version<4>{}),
           dpy{dpy},
           egl_extensions{std::move(egl_extensions)},
-          formats{std::move(formats)}
+          formats{std::move(formats)},
+          feedback{std::move(feedback)},
+          surface_feedback{std::move(surface_feedback)}
     {
+        // From version 4 the format and modifier events are replaced by feedback objects
+        if (wl_resource_get_version(resource) >= 4)
+        {
+            return;
+        }
+
         for (auto i = 0u; i < this->formats->num_formats(); ++i)
         {
             auto [format, modifiers, external_only] = (*(this->formats))[i];
@@ -1074,25 +1501,70 @@ private:
         new LinuxDmaBufParams{params_id, dpy, egl_extensions, formats};
     }
 
+    void get_default_feedback(struct wl_resource* id) override
+    {
+        new LinuxDmabufFeedback{id, feedback, false};
+    }
+
+    void get_surface_feedback(struct wl_resource* id, struct wl_resource* surface) override
+    {
+        surface_feedback->create_feedback(id, *mw::Surface::from(surface));
+    }
+
     EGLDisplay const dpy;
     std::shared_ptr<EGLExtensions> const egl_extensions;
     std::shared_ptr<DmaBufFormatDescriptors const> const formats;
+    std::shared_ptr<DmaBufFeedbackTables const> const feedback;
+    std::shared_ptr<DmaBufSurfaceFeedback> const surface_feedback;
 };
 
 mg::LinuxDmaBufUnstable::LinuxDmaBufUnstable(
     wl_display* display,
     EGLDisplay dpy,
     std::shared_ptr<EGLExtensions> egl_extensions,
-    EGLExtensions::EXTImageDmaBufImportModifiers const& dmabuf_ext)
-    : mir::wayland::LinuxDmabufV1::Global(display, Version<3>{}),
+    EGLExtensions::EXTImageDmaBufImportModifiers const& dmabuf_ext,
+    std::vector<DRMFormatModifier> const& scanout_formats)
+    : LinuxDmaBufUnstable(display, dpy, std::move(egl_extensions), dmabuf_ext, scanout_formats, main_device_for(dpy))
+{
+}
+
+mg::LinuxDmaBufUnstable::LinuxDmaBufUnstable(
+    wl_display* display,
+    EGLDisplay dpy,
+    std::shared_ptr<EGLExtensions> egl_extensions,
+    EGLExtensions::EXTImageDmaBufImportModifiers const& dmabuf_ext,
+    std::vector<DRMFormatModifier> const& scanout_formats,
+    std::optional<dev_t> main_device)
+    : mw::Global{
+          wl_global_create(
+              display,
+              &mw::zwp_linux_dmabuf_v1_interface_data,
+              main_device ? 4 : 3,
+              this,
+              &bind_thunk)},
       dpy{dpy},
       egl_extensions{std::move(egl_extensions)},
-      formats{std::make_shared<DmaBufFormatDescriptors>(dpy, dmabuf_ext)}
+      formats{std::make_shared<DmaBufFormatDescriptors>(dpy, dmabuf_ext)},
+      feedback{main_device ?
+          std::make_shared<DmaBufFeedbackTables>(*main_device, *formats, scanout_formats) : nullptr},
+      surface_feedback{feedback ? std::make_shared<DmaBufSurfaceFeedback>(feedback) : nullptr}
 {
+    if (!feedback)
+    {
+        mir::log_warning(
+            "Failed to determine the DRM device used for rendering; "
+            "not offering linux-dmabuf feedback (version 4)");
+    }
+}
+
+auto mg::LinuxDmaBufUnstable::interface_name() const -> char const*
+{
+    return mw::LinuxDmabufV1::interface_name;
 }
 
 auto mg::LinuxDmaBufUnstable::buffer_from_resource(
     wl_resource* buffer,
+    wl_resource* surface,
     std::shared_ptr<renderer::gl::Context> ctx,
     std::function<void()>&& on_consumed,
     std::function<void()>&& on_release,
@@ -1101,19 +1573,64 @@ auto mg::LinuxDmaBufUnstable::buffer_from_resource(
 {
     if (auto dmabuf = WlDmaBufBuffer::maybe_dmabuf_from_wl_buffer(buffer))
     {
+        eglBindAPI(EGL_OPENGL_ES_API);
+
+        std::function<void()> on_scanout_candidate{[](){}};
+        if (surface_feedback)
+        {
+            on_scanout_candidate =
+                [executor = wayland_executor,
+                 weak_feedback = std::weak_ptr<DmaBufSurfaceFeedback>{surface_feedback},
+                 weak_surface = mw::make_weak(mw::Surface::from(surface))]()
+                {
+                    executor->spawn(
+                        [weak_feedback, weak_surface]()
+                        {
+                            auto const feedback = weak_feedback.lock();
+                            if (feedback && weak_surface)
+                            {
+                                feedback->mark_scanout_candidate(weak_surface.value());
+                            }
+                        });
+                };
+        }
+
         return std::make_shared<WaylandDmabufTexBuffer>(
+            dmabuf->texture_for(ctx, wayland_executor),
             *dmabuf,
-            *egl_extensions,
-            std::move(ctx),
-            dpy,
             std::move(on_consumed),
             std::move(on_release),
-            std::move(wayland_executor));
+            std::move(on_scanout_candidate));
     }
     return nullptr;
 }
 
+auto mg::LinuxDmaBufUnstable::import_counts() -> ImportCounts
+{
+    return import_stats().counts();
+}
+
+void mg::LinuxDmaBufUnstable::bind_thunk(wl_client* client, void* data, uint32_t version, uint32_t id)
+{
+    auto const me = static_cast<LinuxDmaBufUnstable*>(data);
+    // libwayland has already checked that version is no higher than the global's
+    auto const resource = wl_resource_create(client, &mw::zwp_linux_dmabuf_v1_interface_data, version, id);
+    if (resource == nullptr)
+    {
+        wl_client_post_no_memory(client);
+        BOOST_THROW_EXCEPTION((std::bad_alloc{}));
+    }
+    try
+    {
+        me->bind(resource);
+    }
+    catch(...)
+    {
+        mw::internal_error_processing_request(client, "LinuxDmabufV1 global bind");
+    }
+}
+
 void mg::LinuxDmaBufUnstable::bind(wl_resource* new_resource)
 {
-    new LinuxDmaBufUnstable::Instance{new_resource, dpy, egl_extensions, formats};
+    new LinuxDmaBufUnstable::Instance{new_resource, dpy, egl_extensions, formats, feedback, surface_feedback};
 }
@@ -20,6 +20,7 @@
 #include "buffer_from_wl_shm.h"
 #include "shm_buffer.h"
 
+#include "egl_context_executor.h"
 #include "mir/renderer/sw/pixel_source.h"
 #include "mir/executor.h"
 
@@ -29,13 +30,20 @@
 #include <boost/throw_exception.hpp>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <optional>
 
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GLES2/gl2.h>
 
 #include <wayland-server-core.h>
 #include <wayland-server-protocol.h>
 #include <cassert>
 #include <cstring>
+#include <endian.h>
 
 namespace mg = mir::graphics;
 namespace mgc = mir::graphics::common;
@@ -75,6 +83,62 @@ MirPixelFormat wl_format_to_mir_format(uint32_t format)
     }
 }
 
+namespace
+{
+/// A texture with the pixels of a wl_buffer, as of the last time they were uploaded
+class WlShmTexture
+{
+public:
+    explicit WlShmTexture(std::shared_ptr<mgc::EGLContextExecutor> egl_delegate)
+        : egl_delegate{std::move(egl_delegate)}
+    {
+    }
+
+    ~WlShmTexture()
+    {
+        if (id != 0)
+        {
+            egl_delegate->spawn(
+                [id = id]()
+                {
+                    glDeleteTextures(1, &id);
+                });
+        }
+    }
+
+    /// \note This must be called with a current GL context
+    void bind()
+    {
+        bool const needs_initialisation = id == 0;
+        if (needs_initialisation)
+        {
+            glGenTextures(1, &id);
+        }
+        glBindTexture(GL_TEXTURE_2D, id);
+        if (needs_initialisation)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+    }
+
+    bool complete{false};   ///< Whether all of the pixels made it into the texture
+
+private:
+    std::shared_ptr<mgc::EGLContextExecutor> const egl_delegate;
+    GLuint id{0};
+};
+
+/// Passes a wl_buffer's texture on from one import of the wl_buffer to the next
+struct WlShmTextureSlot
+{
+    std::mutex mutex;
+    std::shared_ptr<WlShmTexture> latest;
+};
+}
+
 /**
  * A shared-pointer-like handle to a wl_buffer
  *
@@ -190,6 +254,12 @@ public:
         }
         return LockedHandle{};
     }
+
+    /// The slot shared by every import of this wl_buffer
+    auto texture_slot() const -> std::shared_ptr<WlShmTextureSlot>
+    {
+        return resource->texture_slot;
+    }
 private:
     struct WlResource
     {
@@ -255,6 +325,7 @@ private:
         std::mutex mutex;
         wl_resource* buffer;
         std::shared_ptr<mir::Executor> const wayland_executor;
+        std::shared_ptr<WlShmTextureSlot> const texture_slot{std::make_shared<WlShmTextureSlot>()};
         wl_listener destruction_listener;
     };
 
@@ -301,6 +372,108 @@ private:
     }
 };
 
+namespace
+{
+bool has_extension(char const* extensions, char const* extension)
+{
+    return extensions && strstr(extensions, extension);
+}
+
+/// EGL_KHR_fence_sync entry points
+struct FenceSync
+{
+    FenceSync()
+        : eglCreateSyncKHR{
+            reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"))},
+          eglDestroySyncKHR{
+            reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"))},
+          eglClientWaitSyncKHR{
+            reinterpret_cast<PFNEGLCLIENTWAITSYNCKHRPROC>(eglGetProcAddress("eglClientWaitSyncKHR"))}
+    {
+    }
+
+    bool usable_on(EGLDisplay display) const
+    {
+        return display != EGL_NO_DISPLAY &&
+            has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_fence_sync") &&
+            eglCreateSyncKHR && eglDestroySyncKHR && eglClientWaitSyncKHR;
+    }
+
+    static auto instance() -> FenceSync const&
+    {
+        static FenceSync const fence_sync;
+        return fence_sync;
+    }
+
+    PFNEGLCREATESYNCKHRPROC const eglCreateSyncKHR;
+    PFNEGLDESTROYSYNCKHRPROC const eglDestroySyncKHR;
+    PFNEGLCLIENTWAITSYNCKHRPROC const eglClientWaitSyncKHR;
+};
+
+/// CPU pixels owned by the Mapping itself, for when the wl_buffer can no longer be read
+class CopiedMapping : public mir::renderer::software::Mapping<unsigned char const>
+{
+public:
+    CopiedMapping(
+        MirPixelFormat format,
+        mir::geometry::Size size,
+        mir::geometry::Stride stride)
+        : buffer{std::make_unique<unsigned char[]>(size.height.as_uint32_t() * stride.as_uint32_t())},
+          format_{format},
+          size_{size},
+          stride_{stride}
+    {
+        ::memset(buffer.get(), 0, len());
+    }
+
+    auto format() const -> MirPixelFormat override
+    {
+        return format_;
+    }
+
+    auto stride() const -> mir::geometry::Stride override
+    {
+        return stride_;
+    }
+
+    auto size() const -> mir::geometry::Size override
+    {
+        return size_;
+    }
+
+    auto data() -> unsigned char const* override
+    {
+        return buffer.get();
+    }
+
+    auto len() const -> size_t override
+    {
+        return size().height.as_uint32_t() * stride().as_uint32_t();
+    }
+
+    auto writeable_data() -> unsigned char*
+    {
+        return buffer.get();
+    }
+private:
+    std::unique_ptr<unsigned char[]> const buffer;
+    MirPixelFormat format_;
+    mir::geometry::Size size_;
+    mir::geometry::Stride stride_;
+};
+}
+
+/**
+ * A wl_shm buffer, uploaded to a texture as soon as it is committed
+ *
+ * The upload runs on the EGLContextExecutor's thread, so the compositor only has
+ * to wait on a fence (which has usually signalled by the time the buffer is drawn).
+ * Once the pixels have been copied the wl_buffer is released, letting the client
+ * reuse it immediately; any later CPU reads are served from the texture.
+ *
+ * The texture stays with the wl_buffer, so when the client commits it again only
+ * the damage has to be uploaded.
+ */
 class WlShmBuffer :
     public mg::common::ShmBuffer,
     public mir::renderer::software::ReadMappableBuffer
@@ -309,19 +482,61 @@ public:
     WlShmBuffer(
         SharedWlBuffer buffer,
         std::shared_ptr<mgc::EGLContextExecutor> egl_delegate,
+        void const* client,
         mir::geometry::Size const& size,
         mir::geometry::Stride stride,
         MirPixelFormat format,
+        std::optional<mir::geometry::Rectangles> const& damage,
         std::function<void()>&& on_consumed)
-        : ShmBuffer(size, format, std::move(egl_delegate)),
+        : ShmBuffer(size, format, egl_delegate),
           on_consumed{std::move(on_consumed)},
+          egl_delegate{std::move(egl_delegate)},
+          client{client},
           buffer{std::move(buffer)},
           stride_{stride}
     {
+        if (this->egl_delegate)
+        {
+            upload = std::make_shared<Upload>(this, this->buffer->texture_slot(), damage);
+            this->egl_delegate->spawn(
+                client,
+                [upload = upload]()
+                {
+                    std::lock_guard<std::mutex> lock{upload->mutex};
+                    if (upload->buffer)
+                    {
+                        upload->buffer->upload_on_egl_thread(*upload);
+                    }
+                    upload->done = true;
+                    upload->done_changed.notify_all();
+                });
+        }
+    }
+
+    ~WlShmBuffer()
+    {
+        if (upload)
+        {
+            // Waits out an upload in progress, and stops one that has yet to start
+            std::lock_guard<std::mutex> lock{upload->mutex};
+            upload->buffer = nullptr;
+        }
     }
 
     void bind() override
     {
+        if (upload)
+        {
+            std::unique_lock<std::mutex> lock{upload->mutex};
+            upload->done_changed.wait(lock, [this]() { return upload->done; });
+            upload->wait_for_fence();
+            upload->texture->bind();
+            lock.unlock();
+
+            notify_consumed();
+            return;
+        }
+
         ShmBuffer::bind();
         std::lock_guard<std::mutex> lock{upload_mutex};
         if (!uploaded)
@@ -336,6 +551,129 @@ public:
     {
         notify_consumed();
 
+        if (auto mapping = map_shm())
+        {
+            return mapping;
+        }
+        else if (upload)
+        {
+            return read_back_texture();
+        }
+        else
+        {
+            mir::log_debug("Wayland buffer destroyed before use; rendering will be incomplete");
+            return std::make_unique<CopiedMapping>(pixel_format(), size(), stride_);
+        }
+    }
+
+private:
+    struct Upload
+    {
+        Upload(
+            WlShmBuffer* buffer,
+            std::shared_ptr<WlShmTextureSlot> slot,
+            std::optional<mir::geometry::Rectangles> const& damage)
+            : buffer{buffer},
+              slot{std::move(slot)},
+              damage{damage}
+        {
+        }
+
+        ~Upload()
+        {
+            if (fence != EGL_NO_SYNC_KHR)
+            {
+                FenceSync::instance().eglDestroySyncKHR(display, fence);
+            }
+        }
+
+        /// \note Must be called with mutex held
+        void wait_for_fence()
+        {
+            if (fence == EGL_NO_SYNC_KHR)
+            {
+                return;
+            }
+
+            auto const& fence_sync = FenceSync::instance();
+            auto const status = fence_sync.eglClientWaitSyncKHR(display, fence, 0, fence_timeout.count());
+            if (status != EGL_CONDITION_SATISFIED_KHR)
+            {
+                mir::log_warning("Timed out waiting for shm buffer upload; rendering may be incomplete");
+            }
+            fence_sync.eglDestroySyncKHR(display, fence);
+            fence = EGL_NO_SYNC_KHR;
+        }
+
+        // Don't hang the compositor on a wedged GPU
+        static constexpr std::chrono::nanoseconds fence_timeout{std::chrono::milliseconds{100}};
+
+        std::mutex mutex;
+        std::condition_variable done_changed;
+        WlShmBuffer* buffer;        ///< nullptr once the WlShmBuffer has been destroyed
+        std::shared_ptr<WlShmTextureSlot> const slot;
+        std::optional<mir::geometry::Rectangles> const damage;
+        std::shared_ptr<WlShmTexture> texture;  ///< Set once the upload has run
+        bool done{false};
+        EGLDisplay display{EGL_NO_DISPLAY};
+        EGLSyncKHR fence{EGL_NO_SYNC_KHR};
+    };
+
+    /// \note Runs on the EGL thread, with upload.mutex held
+    void upload_on_egl_thread(Upload& upload)
+    {
+        {
+            std::lock_guard<std::mutex> lock{upload.slot->mutex};
+            auto& latest = upload.slot->latest;
+
+            /* The texture from the previous import already has the wl_buffer's old pixels,
+             * so it can be patched up with the damage. References are only taken with the
+             * slot locked, so the use count can only drop underneath us: if nothing else
+             * holds the texture, the previous import has gone and no longer needs its pixels.
+             */
+            std::optional<mir::geometry::Rectangles> damage;
+            if (latest && latest.use_count() == 1 && latest->complete && upload.damage)
+            {
+                damage = upload.damage;
+            }
+            else
+            {
+                latest = std::make_shared<WlShmTexture>(egl_delegate);
+            }
+            upload.texture = latest;
+
+            upload.texture->bind();
+            if (auto const mapping = map_shm())
+            {
+                upload_to_texture(mapping->data(), mapping->stride(), damage);
+                upload.texture->complete = true;
+            }
+            else
+            {
+                mir::log_debug("Wayland buffer destroyed before use; rendering will be incomplete");
+                upload.texture->complete = false;
+            }
+        }
+
+        auto const& fence_sync = FenceSync::instance();
+        upload.display = eglGetCurrentDisplay();
+        if (fence_sync.usable_on(upload.display))
+        {
+            upload.fence = fence_sync.eglCreateSyncKHR(upload.display, EGL_SYNC_FENCE_KHR, nullptr);
+            glFlush();
+        }
+        else
+        {
+            glFinish();
+        }
+
+        // glTex[Sub]Image2D() has copied the pixels out, so the client can have its buffer back
+        std::lock_guard<std::mutex> lock{shm_mutex};
+        buffer.reset();
+    }
+
+    auto map_shm() -> std::unique_ptr<mir::renderer::software::Mapping<unsigned char const>>
+    {
         class Mapping : public mir::renderer::software::Mapping<unsigned char const>
         {
         public:
@@ -385,64 +723,87 @@ public:
             WlShmBuffer* const parent;
         };
 
-        if (auto locked_buffer = buffer.lock())
+        std::lock_guard<std::mutex> lock{shm_mutex};
+        if (buffer)
         {
-            return std::make_unique<Mapping>(std::move(locked_buffer), this);
-        }
-        else
-        {
-            mir::log_debug("Wayland buffer destroyed before use; rendering will be incomplete");
-            class FallbackMapping : public mir::renderer::software::Mapping<unsigned char const>
+            if (auto locked_buffer = buffer->lock())
             {
-            public:
-                FallbackMapping(
-                    MirPixelFormat format,
-                    mir::geometry::Size size,
-                    mir::geometry::Stride stride)
-                    : buffer{std::make_unique<unsigned char[]>(size.height.as_uint32_t() * stride.as_uint32_t())},
-                      format_{format},
-                      size_{size},
-                      stride_{stride}
-                {
-                    ::memset(buffer.get(), 0, len());
-                }
-
-                auto format() const -> MirPixelFormat override
-                {
-                    return format_;
-                }
+                return std::make_unique<Mapping>(std::move(locked_buffer), this);
+            }
+        }
+        return nullptr;
+    }
 
-                auto stride() const -> mir::geometry::Stride override
-                {
-                    return stride_;
-                }
+    /// Once the wl_buffer has gone back to the client, the texture holds the only copy of the pixels
+    auto read_back_texture() -> std::unique_ptr<mir::renderer::software::Mapping<unsigned char const>>
+    {
+        mir::geometry::Stride const rgba_stride{size().width.as_uint32_t() * 4};
+        auto mapping = std::make_unique<CopiedMapping>(pixel_format(), size(), rgba_stride);
 
-                auto size() const -> mir::geometry::Size override
-                {
-                    return size_;
-                }
+        bool swap_red_blue;
+        switch (pixel_format())
+        {
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        case mir_pixel_format_abgr_8888:
+        case mir_pixel_format_xbgr_8888:
+            swap_red_blue = false;
+            break;
+        case mir_pixel_format_argb_8888:
+        case mir_pixel_format_xrgb_8888:
+            swap_red_blue = true;
+            break;
+#endif
+        default:
+            mir::log_warning(
+                "Cannot read back shm buffer of pixel format %i; rendering will be incomplete",
+                pixel_format());
+            return mapping;
+        }
 
-                auto data() -> unsigned char const* override
+        std::promise<void> read;
+        egl_delegate->spawn(
+            client,
+            [this, &read, pixels = mapping->writeable_data()]()
+            {
+                // This is queued behind the upload, so the texture has been set
+                upload->texture->bind();
+                GLint texture;
+                glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+
+                GLuint framebuffer;
+                glGenFramebuffers(1, &framebuffer);
+                glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+                if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
                 {
-                    return buffer.get();
+                    glReadPixels(
+                        0, 0,
+                        size().width.as_int(), size().height.as_int(),
+                        GL_RGBA, GL_UNSIGNED_BYTE,
+                        pixels);
                 }
-
-                auto len() const -> size_t override
+                else
                 {
-                    return size().height.as_uint32_t() * stride().as_uint32_t();
+                    mir::log_warning("Failed to read back shm buffer texture; rendering will be incomplete");
                 }
-            private:
-                std::unique_ptr<unsigned char[]> const buffer;
-                MirPixelFormat format_;
-                mir::geometry::Size size_;
-                mir::geometry::Stride stride_;
-            };
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glDeleteFramebuffers(1, &framebuffer);
+                read.set_value();
+            });
+        read.get_future().wait();
 
-            return std::make_unique<FallbackMapping>(pixel_format(), size(), stride_);
+        if (swap_red_blue)
+        {
+            auto const pixels = mapping->writeable_data();
+            for (size_t i = 0; i < mapping->len(); i += 4)
+            {
+                std::swap(pixels[i], pixels[i + 2]);
+            }
         }
+
+        return mapping;
     }
 
-private:
     void notify_consumed()
     {
         bool has_not_been_consumed{false};
@@ -454,10 +815,17 @@ private:
 
     std::atomic<bool> consumed{false};
     std::function<void()> on_consumed;
+    std::shared_ptr<mgc::EGLContextExecutor> const egl_delegate;
+    /// Keeps all of a client's uploads on one EGL thread, in order
+    void const* const client;
+
+    std::shared_ptr<Upload> upload;     ///< Unset if there's no EGL thread to upload on
 
     std::mutex upload_mutex;
     bool uploaded{false};
-    SharedWlBuffer const buffer;
+
+    std::mutex shm_mutex;
+    std::optional<SharedWlBuffer> buffer;   ///< Unset once the pixels have been uploaded
     mir::geometry::Stride const stride_;
 };
 
@@ -465,6 +833,7 @@ auto mg::wayland::buffer_from_wl_shm(
     wl_resource* buffer,
     std::shared_ptr<Executor> executor,
     std::shared_ptr<common::EGLContextExecutor> egl_delegate,
+    std::optional<geometry::Rectangles> const& damage,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
 {
     auto const shm_buffer = wl_shm_buffer_get(buffer);
@@ -475,11 +844,13 @@ auto mg::wayland::buffer_from_wl_shm(
     return std::make_shared<WlShmBuffer>(
         SharedWlBuffer{buffer, std::move(executor)},
         std::move(egl_delegate),
+        wl_resource_get_client(buffer),
         mir::geometry::Size{
             wl_shm_buffer_get_width(shm_buffer),
             wl_shm_buffer_get_height(shm_buffer)
         },
         mir::geometry::Stride{wl_shm_buffer_get_stride(shm_buffer)},
         wl_format_to_mir_format(wl_shm_buffer_get_format(shm_buffer)),
+        damage,
         std::move(on_consumed));
 }
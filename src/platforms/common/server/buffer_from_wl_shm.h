@@ -20,8 +20,11 @@
 #ifndef MIR_GRAPHICS_GL_WAYLAND_SHM_PROVIDER_H_
 #define MIR_GRAPHICS_GL_WAYLAND_SHM_PROVIDER_H_
 
+#include "mir/geometry/rectangles.h"
+
 #include <memory>
 #include <functional>
+#include <optional>
 
 struct wl_resource;
 
@@ -46,11 +49,18 @@ namespace wayland
  * The returned buffer will support the mg::gl::Texture and
  * mir::renderer::sw::PixelSource interfaces.
  *
- * \note This must be called on the Wayland thread, with a current GL context
+ * The pixels are uploaded to a texture on egl_delegate's thread straight away,
+ * after which the wl_buffer is released back to the client. The texture is kept
+ * with the wl_buffer, so importing it again only has to upload the damage.
+ *
+ * \note This must be called on the Wayland thread
  *
  * \param buffer        [in]    The Wayland SHM buffer to import
  * \param executor      [in]    An Executor that will defer work to the Wayland event loop
- * \param egl_delegate  [in]    An EGL-context-thread delegator
+ * \param egl_delegate  [in]    An EGL-context-thread delegator, or nullptr if the buffer
+ *                              will only ever be read by the CPU
+ * \param damage        [in]    The area of buffer that has changed since it was last imported,
+ *                              or an empty optional if that isn't known
  * \param on_consumed   [in]    Closure to call when the compositor has consumed this buffer
  * \return                      An mg::Buffer supporting being rendered from in GL and read by the CPU.
  */
@@ -58,6 +68,7 @@ auto buffer_from_wl_shm(
     wl_resource* buffer,
     std::shared_ptr<Executor> executor,
     std::shared_ptr<common::EGLContextExecutor> egl_delegate,
+    std::optional<geometry::Rectangles> const& damage,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>;
 }
 }
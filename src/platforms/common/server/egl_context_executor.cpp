@@ -19,58 +19,191 @@
 #include "egl_context_executor.h"
 #include "mir/renderer/gl/context.h"
 
+#define MIR_LOG_COMPONENT "egl-context-executor"
+#include "mir/log.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+
 namespace mgc = mir::graphics::common;
 
+namespace
+{
+// Beyond this, more threads just contend for the GPU
+unsigned const max_default_threads{4};
+
+auto milliseconds(std::chrono::steady_clock::duration duration) -> double
+{
+    return std::chrono::duration<double, std::milli>{duration}.count();
+}
+
+/* std::hash of a pointer is just its value, and affinities (such as wl_client*)
+ * are aligned, so the low bits are all zero. Mix the bits (with MurmurHash3's
+ * finaliser) before they pick a worker.
+ */
+auto hash_affinity(void const* affinity) -> uint64_t
+{
+    uint64_t hash = reinterpret_cast<uintptr_t>(affinity);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+}
+
+mgc::EGLContextExecutor::Worker::Worker(std::unique_ptr<mir::renderer::gl::Context> ctx)
+    : ctx{std::move(ctx)}
+{
+}
+
 mgc::EGLContextExecutor::EGLContextExecutor(
     std::unique_ptr<mir::renderer::gl::Context> context)
-    : ctx{std::move(context)},
-      egl_thread(std::thread{process_loop, this})
 {
+    workers.push_back(std::make_unique<Worker>(std::move(context)));
+    workers.back()->egl_thread = std::thread{process_loop, this, workers.back().get()};
+}
+
+mgc::EGLContextExecutor::EGLContextExecutor(
+    std::function<std::unique_ptr<mir::renderer::gl::Context>()> const& make_context,
+    unsigned threads)
+{
+    // Create every context up front, so a failure leaves no threads to clean up
+    for (auto i = 0u; i != std::max(threads, 1u); ++i)
+    {
+        workers.push_back(std::make_unique<Worker>(make_context()));
+    }
+    for (auto const& worker : workers)
+    {
+        worker->egl_thread = std::thread{process_loop, this, worker.get()};
+    }
 }
 
 mgc::EGLContextExecutor::~EGLContextExecutor() noexcept
 {
+    for (auto const& worker : workers)
     {
-        std::lock_guard<std::mutex> lock{mutex};
-        shutdown_requested = true;
+        {
+            std::lock_guard<std::mutex> lock{worker->mutex};
+            worker->shutdown_requested = true;
+        }
+        worker->new_work.notify_all();
+    }
+    for (auto const& worker : workers)
+    {
+        worker->egl_thread.join();
     }
-    new_work.notify_all();
-    egl_thread.join();
 }
 
 void mgc::EGLContextExecutor::spawn(
     std::function<void()>&& functor)
 {
+    spawn_on(*workers[next_worker++ % workers.size()], std::move(functor));
+}
+
+void mgc::EGLContextExecutor::spawn(
+    void const* affinity,
+    std::function<void()>&& functor)
+{
+    spawn_on(*workers[hash_affinity(affinity) % workers.size()], std::move(functor));
+}
+
+auto mgc::EGLContextExecutor::default_thread_count() -> unsigned
+{
+    if (auto const threads = getenv("MIR_EGL_CONTEXT_EXECUTOR_THREADS"))
+    {
+        auto const requested = atoi(threads);
+        if (requested > 0)
+        {
+            return requested;
+        }
+        mir::log_warning("Ignoring invalid MIR_EGL_CONTEXT_EXECUTOR_THREADS=\"%s\"", threads);
+    }
+
+    return std::clamp(std::thread::hardware_concurrency(), 1u, max_default_threads);
+}
+
+void mgc::EGLContextExecutor::spawn_on(
+    Worker& worker,
+    std::function<void()>&& functor)
+{
+    size_t depth;
     {
-        std::lock_guard<std::mutex> lock{mutex};
-        work_queue.emplace_back(std::move(functor));
+        std::lock_guard<std::mutex> lock{worker.mutex};
+        worker.work_queue.push_back(Work{std::move(functor), std::chrono::steady_clock::now()});
+        depth = worker.work_queue.size();
     }
-    new_work.notify_all();
+    worker.new_work.notify_all();
+    stats.queued(depth);
 }
 
-void mgc::EGLContextExecutor::process_loop(mgc::EGLContextExecutor* const me)
+void mgc::EGLContextExecutor::process_loop(
+    mgc::EGLContextExecutor* const me,
+    Worker* const worker)
 {
-    me->ctx->make_current();
+    worker->ctx->make_current();
 
-    std::unique_lock<std::mutex> lock{me->mutex};
-    while (!me->shutdown_requested)
+    std::vector<Work> work_queue;
+    std::unique_lock<std::mutex> lock{worker->mutex};
+    while (!worker->shutdown_requested || !worker->work_queue.empty())
     {
-        for (auto& work : me->work_queue)
+        if (worker->work_queue.empty())
         {
-            work();
+            worker->new_work.wait(lock);
+            continue;
         }
-        me->work_queue.clear();
 
-        me->new_work.wait(lock);
+        // Run the work without the lock held, so that work can itself spawn more work
+        swap(work_queue, worker->work_queue);
+        lock.unlock();
+
+        for (auto& work : work_queue)
+        {
+            me->stats.ran(std::chrono::steady_clock::now() - work.queued);
+            work.functor();
+        }
+        // …and ensure any functor cleanup happens with the EGL context current, too.
+        work_queue.clear();
+
+        lock.lock();
     }
 
-    // Drain the work-queue
-    for (auto& work : me->work_queue)
+    worker->ctx->release_current();
+}
+
+void mgc::EGLContextExecutor::Stats::queued(size_t depth)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    total_depth += depth;
+    max_depth = std::max(max_depth, depth);
+}
+
+void mgc::EGLContextExecutor::Stats::ran(std::chrono::steady_clock::duration latency)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    ++jobs;
+    total_latency += latency;
+    max_latency = std::max(max_latency, latency);
+
+    auto const now = std::chrono::steady_clock::now();
+    if (now - last_report >= std::chrono::seconds{1})
     {
-        work();
-    }
-    // …and ensure any functor cleanup happens with the EGL context current, too.
-    me->work_queue.clear();
+        mir::log_debug(
+            "%zu jobs: queue depth avg %.1f, max %zu; latency avg %.3fms, max %.3fms",
+            jobs,
+            static_cast<double>(total_depth) / jobs,
+            max_depth,
+            milliseconds(total_latency) / jobs,
+            milliseconds(max_latency));
 
-    me->ctx->release_current();
+        last_report = now;
+        jobs = 0;
+        total_depth = 0;
+        max_depth = 0;
+        total_latency = std::chrono::steady_clock::duration{0};
+        max_latency = std::chrono::steady_clock::duration{0};
+    }
 }
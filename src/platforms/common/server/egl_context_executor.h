@@ -27,6 +27,8 @@
 #include <condition_variable>
 #include <mutex>
 #include <vector>
+#include <atomic>
+#include <chrono>
 
 namespace mir
 {
@@ -46,22 +48,81 @@ class EGLContextExecutor : public Executor
 {
 public:
     EGLContextExecutor(std::unique_ptr<renderer::gl::Context> context);
+    /**
+     * Run work on a pool of threads, each with its own context
+     *
+     * \param make_context  Creates each worker's context; these must all share
+     *                      GL objects with each other (and with the renderer).
+     * \param threads       The number of worker threads to run
+     */
+    EGLContextExecutor(
+        std::function<std::unique_ptr<renderer::gl::Context>()> const& make_context,
+        unsigned threads);
     ~EGLContextExecutor() noexcept;
 
     /**
      * Run a run a function on a thread with a current EGL context
      */
     void spawn(std::function<void()>&& functor) override;
+
+    /**
+     * Run a function on the thread with a current EGL context that serves affinity
+     *
+     * Work with the same affinity (say, everything from one client) runs in order,
+     * on one thread, so a client queueing lots of work delays only the clients
+     * that happen to share its thread.
+     */
+    void spawn(void const* affinity, std::function<void()>&& functor);
+
+    /**
+     * The number of threads to run by default: one per core, up to a limit.
+     *
+     * This can be overridden by setting MIR_EGL_CONTEXT_EXECUTOR_THREADS.
+     */
+    static auto default_thread_count() -> unsigned;
+
 private:
-    static void process_loop(EGLContextExecutor* const me);
+    struct Work
+    {
+        std::function<void()> functor;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    struct Worker
+    {
+        explicit Worker(std::unique_ptr<renderer::gl::Context> ctx);
+
+        std::unique_ptr<renderer::gl::Context> const ctx;
+        std::mutex mutex;
+        std::condition_variable new_work;
+        std::vector<Work> work_queue;
+        bool shutdown_requested{false};
+
+        std::thread egl_thread;
+    };
+
+    /// Queue depth and latency, logged once a second while there's work
+    class Stats
+    {
+    public:
+        void queued(size_t depth);
+        void ran(std::chrono::steady_clock::duration latency);
+    private:
+        std::mutex mutex;
+        std::chrono::steady_clock::time_point last_report{std::chrono::steady_clock::now()};
+        size_t jobs{0};
+        size_t total_depth{0};
+        size_t max_depth{0};
+        std::chrono::steady_clock::duration total_latency{0};
+        std::chrono::steady_clock::duration max_latency{0};
+    };
 
-    std::unique_ptr<renderer::gl::Context> const ctx;
-    std::mutex mutex;
-    std::condition_variable new_work;
-    std::vector<std::function<void()>> work_queue;
-    bool shutdown_requested{false};
+    void spawn_on(Worker& worker, std::function<void()>&& functor);
+    static void process_loop(EGLContextExecutor* const me, Worker* const worker);
 
-    std::thread egl_thread;
+    Stats stats;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<size_t> next_worker{0};
 };
 
 }
@@ -135,14 +135,17 @@ MirPixelFormat mgc::ShmBuffer::pixel_format() const
     return pixel_format_;
 }
 
-void mgc::ShmBuffer::upload_to_texture(void const* pixels, geom::Stride const& stride)
+void mgc::ShmBuffer::upload_to_texture(
+    void const* pixels,
+    geom::Stride const& stride,
+    std::optional<geom::Rectangles> const& damage)
 {
     GLenum format, type;
 
     if (mg::get_gl_pixel_format(pixel_format_, format, type))
     {
-        auto const stride_in_px =
-            stride.as_int() / MIR_BYTES_PER_PIXEL(pixel_format());
+        auto const bytes_per_pixel = MIR_BYTES_PER_PIXEL(pixel_format());
+        auto const stride_in_px = stride.as_int() / bytes_per_pixel;
         /*
          * We assume (as does Weston, AFAICT) that stride is
          * a multiple of whole pixels, but it need not be.
@@ -155,15 +158,40 @@ void mgc::ShmBuffer::upload_to_texture(void const* pixels, geom::Stride const& s
         glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, stride_in_px);
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            format,
-            size().width.as_int(), size().height.as_int(),
-            0,
-            format,
-            type,
-            pixels);
+        if (damage)
+        {
+            // With GL_UNPACK_ROW_LENGTH_EXT set, each rectangle can be read straight out of the buffer
+            geom::Rectangle const buffer_area{{0, 0}, size()};
+            for (auto const& rect : *damage)
+            {
+                auto const area = intersection_of(rect, buffer_area);
+                if (area.size.width.as_int() <= 0 || area.size.height.as_int() <= 0)
+                    continue;
+
+                glTexSubImage2D(
+                    GL_TEXTURE_2D,
+                    0,
+                    area.left().as_int(), area.top().as_int(),
+                    area.size.width.as_int(), area.size.height.as_int(),
+                    format,
+                    type,
+                    static_cast<unsigned char const*>(pixels) +
+                        area.top().as_int() * stride.as_int() +
+                        area.left().as_int() * bytes_per_pixel);
+            }
+        }
+        else
+        {
+            glTexImage2D(
+                GL_TEXTURE_2D,
+                0,
+                format,
+                size().width.as_int(), size().height.as_int(),
+                0,
+                format,
+                type,
+                pixels);
+        }
 
         // Be nice to other users of the GL context by reverting our changes to shared state
         glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);     // 0 is default, meaning “use width”
@@ -213,6 +241,11 @@ void mgc::MemoryBackedShmBuffer::bind()
     }
 }
 
+void mgc::MemoryBackedShmBuffer::upload_to_bound_texture(std::optional<geom::Rectangles> const& damage)
+{
+    upload_to_texture(pixels.get(), stride_, damage);
+}
+
 template<typename T>
 class mgc::MemoryBackedShmBuffer::Mapping : public mir::renderer::software::Mapping<T>
 {
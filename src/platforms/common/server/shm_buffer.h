@@ -66,8 +66,19 @@ protected:
         MirPixelFormat const& format,
         std::shared_ptr<EGLContextExecutor> egl_delegate);
 
-    /// \note This must be called with a current GL context
-    void upload_to_texture(void const* pixels, geometry::Stride const& stride);
+    /**
+     * Upload pixels into the texture bound to GL_TEXTURE_2D
+     *
+     * \note This must be called with a current GL context
+     *
+     * \param damage   Just the area to update in a texture that already has this
+     *                 buffer's size and format, or an empty optional to
+     *                 (re)allocate the texture and upload everything.
+     */
+    void upload_to_texture(
+        void const* pixels,
+        geometry::Stride const& stride,
+        std::optional<geometry::Rectangles> const& damage = std::nullopt);
 private:
     geometry::Size const size_;
     MirPixelFormat const pixel_format_;
@@ -78,6 +89,7 @@ private:
 
 class MemoryBackedShmBuffer :
     public ShmBuffer,
+    public graphics::gl::UploadableTexture,
     public renderer::software::RWMappableBuffer
 {
 public:
@@ -92,6 +104,7 @@ public:
     auto map_rw() -> std::unique_ptr<renderer::software::Mapping<unsigned char>> override;
 
     void bind() override;
+    void upload_to_bound_texture(std::optional<geometry::Rectangles> const& damage) override;
 
     MemoryBackedShmBuffer(MemoryBackedShmBuffer const&) = delete;
     MemoryBackedShmBuffer& operator=(MemoryBackedShmBuffer const&) = delete;
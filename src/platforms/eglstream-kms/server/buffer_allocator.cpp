@@ -96,7 +96,9 @@ std::unique_ptr<mir::renderer::gl::Context> context_for_output(mg::Display const
 mge::BufferAllocator::BufferAllocator(mg::Display const& output)
     : wayland_ctx{context_for_output(output)},
       egl_delegate{
-          std::make_shared<mgc::EGLContextExecutor>(context_for_output(output))}
+          std::make_shared<mgc::EGLContextExecutor>(
+              [&output]() { return context_for_output(output); },
+              mgc::EGLContextExecutor::default_thread_count())}
 {
 }
 
@@ -512,6 +514,7 @@ private:
 std::shared_ptr<mir::graphics::Buffer>
 mir::graphics::eglstream::BufferAllocator::buffer_from_resource(
     wl_resource* buffer,
+    wl_resource* /*surface*/,
     std::function<void()>&& on_consumed,
     std::function<void()>&& /*on_release*/)
 {
@@ -559,11 +562,13 @@ mir::graphics::eglstream::BufferAllocator::buffer_from_resource(
 auto mge::BufferAllocator::buffer_from_shm(
     wl_resource* buffer,
     std::shared_ptr<Executor> wayland_executor,
+    std::optional<geometry::Rectangles> const& damage,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
 {
     return mg::wayland::buffer_from_wl_shm(
         buffer,
         std::move(wayland_executor),
         egl_delegate,
+        damage,
         std::move(on_consumed));
 }
@@ -32,6 +32,7 @@
 #include "mir/renderer/gl/context_source.h"
 #include "mir/graphics/egl_wayland_allocator.h"
 #include "buffer_from_wl_shm.h"
+#include "kms-utils/drm_mode_resources.h"
 #include "mir/executor.h"
 
 #include <boost/throw_exception.hpp>
@@ -47,8 +48,11 @@
 #include <system_error>
 #include <gbm.h>
 #include <cassert>
+#include <cstring>
 #include <fcntl.h>
 #include <xf86drm.h>
+#include <xf86drmMode.h>
+#include <drm_fourcc.h>
 
 #include <wayland-server.h>
 
@@ -59,6 +63,7 @@
 namespace mg  = mir::graphics;
 namespace mgg = mg::gbm;
 namespace mgc = mg::common;
+namespace mgk = mg::kms;
 namespace geom = mir::geometry;
 
 namespace
@@ -93,11 +98,91 @@ std::unique_ptr<mir::renderer::gl::Context> context_for_output(mg::Display const
 }
 }
 
-mgg::BufferAllocator::BufferAllocator(mg::Display const& output)
+auto mgg::scanout_formats_for(int drm_fd) -> std::vector<DRMFormatModifier>
+{
+    std::vector<mg::DRMFormatModifier> formats;
+    auto const add = [&formats](uint32_t format, uint64_t modifier)
+        {
+            auto const existing = std::find_if(
+                formats.begin(),
+                formats.end(),
+                [&](auto const& candidate) { return candidate.format == format && candidate.modifier == modifier; });
+            if (existing == formats.end())
+            {
+                formats.push_back({format, modifier});
+            }
+        };
+
+    try
+    {
+        if (auto const ret = drmSetClientCap(drm_fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1))
+        {
+            BOOST_THROW_EXCEPTION((std::system_error{-ret, std::system_category(), "Failed to enable universal planes"}));
+        }
+
+        mgk::PlaneResources resources{drm_fd};
+        for (auto const& plane : resources.planes())
+        {
+            mgk::ObjectProperties const props{drm_fd, plane};
+            if (!props.has_property("type") || props["type"] != DRM_PLANE_TYPE_PRIMARY)
+            {
+                continue;
+            }
+
+            std::unique_ptr<drmModePropertyBlobRes, decltype(&drmModeFreePropertyBlob)> blob{
+                props.has_property("IN_FORMATS") ? drmModeGetPropertyBlob(drm_fd, props["IN_FORMATS"]) : nullptr,
+                &drmModeFreePropertyBlob};
+
+            if (!blob)
+            {
+                // Without IN_FORMATS the plane only takes implicitly-modified buffers
+                for (auto i = 0u; i < plane->count_formats; ++i)
+                {
+                    add(plane->formats[i], DRM_FORMAT_MOD_INVALID);
+                }
+                continue;
+            }
+
+            auto const data = static_cast<char const*>(blob->data);
+            auto const header = reinterpret_cast<drm_format_modifier_blob const*>(data);
+            auto const plane_formats = reinterpret_cast<uint32_t const*>(data + header->formats_offset);
+            auto const modifiers = reinterpret_cast<drm_format_modifier const*>(data + header->modifiers_offset);
+
+            for (auto i = 0u; i < header->count_modifiers; ++i)
+            {
+                // Each modifier applies to a 64-format window of the format list, starting at offset
+                for (auto bit = 0u; bit < 64; ++bit)
+                {
+                    auto const format_index = modifiers[i].offset + bit;
+                    if ((modifiers[i].formats & (1ull << bit)) && format_index < header->count_formats)
+                    {
+                        add(plane_formats[format_index], modifiers[i].modifier);
+                    }
+                }
+            }
+        }
+    }
+    catch (std::exception const& error)
+    {
+        mir::log_debug(
+            "Failed to query primary plane formats (%s); not advertising scanout formats",
+            error.what());
+        return {};
+    }
+
+    return formats;
+}
+
+mgg::BufferAllocator::BufferAllocator(
+    mg::Display const& output,
+    std::vector<DRMFormatModifier> scanout_formats)
     : ctx{context_for_output(output)},
       egl_delegate{
-          std::make_shared<mgc::EGLContextExecutor>(context_for_output(output))},
-      egl_extensions(std::make_shared<mg::EGLExtensions>())
+          std::make_shared<mgc::EGLContextExecutor>(
+              [&output]() { return context_for_output(output); },
+              mgc::EGLContextExecutor::default_thread_count())},
+      egl_extensions(std::make_shared<mg::EGLExtensions>()),
+      scanout_formats{std::move(scanout_formats)}
 {
 }
 
@@ -171,6 +256,7 @@ void mgg::BufferAllocator::bind_display(wl_display* display, std::shared_ptr<Exe
                     dpy,
                     egl_extensions,
                     modifier_ext,
+                    scanout_formats,
                 },
                 [wayland_executor](LinuxDmaBufUnstable* global)
                 {
@@ -221,6 +307,7 @@ void mgg::BufferAllocator::unbind_display(wl_display* display)
 
 std::shared_ptr<mg::Buffer> mgg::BufferAllocator::buffer_from_resource(
     wl_resource* buffer,
+    wl_resource* surface,
     std::function<void()>&& on_consumed,
     std::function<void()>&& on_release)
 {
@@ -230,6 +317,7 @@ std::shared_ptr<mg::Buffer> mgg::BufferAllocator::buffer_from_resource(
 
     if (auto dmabuf = dmabuf_extension->buffer_from_resource(
         buffer,
+        surface,
         ctx,
         std::function<void()>{on_consumed},
         std::function<void()>{on_release},
@@ -249,11 +337,13 @@ std::shared_ptr<mg::Buffer> mgg::BufferAllocator::buffer_from_resource(
 auto mgg::BufferAllocator::buffer_from_shm(
     wl_resource* buffer,
     std::shared_ptr<Executor> wayland_executor,
+    std::optional<geometry::Rectangles> const& damage,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
 {
     return mg::wayland::buffer_from_wl_shm(
         buffer,
         std::move(wayland_executor),
         egl_delegate,
+        damage,
         std::move(on_consumed));
 }
@@ -34,6 +34,7 @@
 #include <wayland-server-core.h>
 
 #include <memory>
+#include <vector>
 
 namespace mir
 {
@@ -57,11 +58,26 @@ class EGLContextExecutor;
 namespace gbm
 {
 
+/**
+ * The format/modifier pairs the primary planes of the DRM device drm_fd can scan out
+ *
+ * These are offered to linux-dmabuf clients ahead of the render-only formats so
+ * that their buffers are eligible for bypass. Failing to find them only costs us
+ * that preference, so errors are logged and no formats returned.
+ *
+ * \param drm_fd  The platform's fd for the device, as acquired from the console
+ */
+auto scanout_formats_for(int drm_fd) -> std::vector<DRMFormatModifier>;
+
 class BufferAllocator:
     public graphics::GraphicBufferAllocator
 {
 public:
-    explicit BufferAllocator(Display const& output);
+    /**
+     * \param scanout_formats  What the display rendered to by output can scan out; see
+     *                         scanout_formats_for()
+     */
+    BufferAllocator(Display const& output, std::vector<DRMFormatModifier> scanout_formats);
 
     std::shared_ptr<Buffer> alloc_software_buffer(geometry::Size size, MirPixelFormat) override;
     std::vector<MirPixelFormat> supported_pixel_formats() override;
@@ -70,11 +86,13 @@ public:
     void unbind_display(wl_display* display) override;
     std::shared_ptr<Buffer> buffer_from_resource(
         wl_resource* buffer,
+        wl_resource* surface,
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release) override;
     auto buffer_from_shm(
         wl_resource* buffer,
         std::shared_ptr<Executor> wayland_executor,
+        std::optional<geometry::Rectangles> const& damage,
         std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer> override;
 private:
     std::shared_ptr<renderer::gl::Context> const ctx;
@@ -82,6 +100,7 @@ private:
     std::shared_ptr<Executor> wayland_executor;
     std::unique_ptr<LinuxDmaBufUnstable, std::function<void(LinuxDmaBufUnstable*)>> dmabuf_extension;
     std::shared_ptr<EGLExtensions> const egl_extensions;
+    std::vector<DRMFormatModifier> const scanout_formats;
     bool egl_display_bound{false};
 };
 
@@ -0,0 +1,78 @@
+/*
+ * Copyright © 2021 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "atomic_page_flip.h"
+
+#include <boost/throw_exception.hpp>
+#include <system_error>
+
+namespace mgg = mir::graphics::gbm;
+
+namespace
+{
+auto alloc_request() -> drmModeAtomicReqPtr
+{
+    errno = 0;
+    if (auto request = drmModeAtomicAlloc())
+    {
+        return request;
+    }
+    BOOST_THROW_EXCEPTION((std::system_error{errno ? errno : ENOMEM, std::system_category(), "Failed to allocate atomic KMS request"}));
+}
+}
+
+mgg::AtomicPageFlip::AtomicPageFlip()
+    : request_{alloc_request(), &drmModeAtomicFree}
+{
+}
+
+void mgg::AtomicPageFlip::add_property(uint32_t object_id, uint32_t property_id, uint64_t value)
+{
+    auto const ret = drmModeAtomicAddProperty(request_.get(), object_id, property_id, value);
+    if (ret < 0)
+    {
+        BOOST_THROW_EXCEPTION((std::system_error{-ret, std::system_category(), "Failed to add property to atomic KMS request"}));
+    }
+}
+
+void mgg::AtomicPageFlip::add_flip(uint32_t crtc_id, uint32_t connector_id)
+{
+    flips_.push_back(Flip{crtc_id, connector_id});
+}
+
+void mgg::AtomicPageFlip::on_commit(std::function<void()> const& callback)
+{
+    commit_callbacks.push_back(callback);
+}
+
+auto mgg::AtomicPageFlip::request() const -> drmModeAtomicReq*
+{
+    return request_.get();
+}
+
+auto mgg::AtomicPageFlip::flips() const -> std::vector<Flip> const&
+{
+    return flips_;
+}
+
+void mgg::AtomicPageFlip::committed()
+{
+    for (auto const& callback : commit_callbacks)
+    {
+        callback();
+    }
+    commit_callbacks.clear();
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright © 2021 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_GBM_ATOMIC_PAGE_FLIP_H_
+#define MIR_GRAPHICS_GBM_ATOMIC_PAGE_FLIP_H_
+
+#include "kms-utils/drm_mode_resources.h"
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+namespace mir
+{
+namespace graphics
+{
+namespace gbm
+{
+
+/**
+ * Page flips of several CRTCs on one DRM device, to be committed together
+ *
+ * Each output adds the properties for its next frame (and any other state
+ * that should change with it) and the CRTC it expects a page-flip event on.
+ * The whole set is then committed in a single atomic request by
+ * PageFlipper::schedule_atomic_flip().
+ */
+class AtomicPageFlip
+{
+public:
+    struct Flip
+    {
+        uint32_t crtc_id;
+        uint32_t connector_id;
+    };
+
+    AtomicPageFlip();
+
+    void add_property(uint32_t object_id, uint32_t property_id, uint64_t value);
+    void add_flip(uint32_t crtc_id, uint32_t connector_id);
+
+    /// Register work to do only if the request is successfully committed
+    void on_commit(std::function<void()> const& callback);
+
+    auto request() const -> drmModeAtomicReq*;
+    auto flips() const -> std::vector<Flip> const&;
+
+    /// Called by the PageFlipper once the request has been committed
+    void committed();
+
+private:
+    kms::DRMModeAtomicReqUPtr const request_;
+    std::vector<Flip> flips_;
+    std::vector<std::function<void()>> commit_callbacks;
+};
+
+}
+}
+}
+
+#endif /* MIR_GRAPHICS_GBM_ATOMIC_PAGE_FLIP_H_ */
@@ -20,6 +20,8 @@
 
 #include "mir/graphics/renderable.h"
 
+#include <algorithm>
+
 using namespace mir;
 namespace mgg = mir::graphics::gbm;
 
@@ -46,3 +48,53 @@ bool mgg::BypassMatch::operator()(std::shared_ptr<graphics::Renderable> const& r
     bypass_is_feasible = (is_opaque && fits && is_orthogonal);
     return bypass_is_feasible;
 }
+
+auto mgg::overlay_candidates(RenderableList const& renderables, geometry::Rectangle const& view_area)
+    -> std::vector<OverlayCandidate>
+{
+    glm::mat4 const identity(1);
+    std::vector<OverlayCandidate> candidates;
+
+    for (auto it = renderables.rbegin(); it != renderables.rend(); ++it)
+    {
+        auto const& renderable = *it;
+        auto const position = renderable->screen_position();
+
+        if (!view_area.contains(position) ||
+            position.size.width.as_int() <= 0 ||
+            position.size.height.as_int() <= 0 ||
+            renderable->alpha() != 1.0f ||
+            renderable->shaped() ||
+            renderable->transformation() != identity ||
+            renderable->clip_area() ||
+            !renderable->buffer())
+        {
+            continue;
+        }
+
+        auto const overlapped = std::any_of(
+            renderables.rbegin(), it,
+            [&position](auto const& above)
+            {
+                return above->screen_position().overlaps(position);
+            });
+        if (overlapped)
+            continue;
+
+        candidates.push_back(
+            OverlayCandidate{renderable, {position.top_left - as_displacement(view_area.top_left), position.size}});
+    }
+
+    std::stable_sort(
+        candidates.begin(), candidates.end(),
+        [](auto const& a, auto const& b)
+        {
+            auto const area = [](geometry::Rectangle const& r)
+                {
+                    return static_cast<long>(r.size.width.as_int()) * r.size.height.as_int();
+                };
+            return area(a.destination) > area(b.destination);
+        });
+
+    return candidates;
+}
@@ -39,6 +39,28 @@ private:
     glm::mat4 const identity;
 };
 
+/**
+ * A renderable that could be shown on an overlay plane, above whatever is
+ * composited beneath it.
+ */
+struct OverlayCandidate
+{
+    std::shared_ptr<graphics::Renderable> renderable;
+    /// Where it appears, relative to the top-left of the view area
+    geometry::Rectangle destination;
+};
+
+/**
+ * Find the renderables that could be lifted out of composition onto overlay
+ * planes, most worthwhile (largest) first.
+ *
+ * A candidate must be untransformed, unclipped, opaque, lie within
+ * view_area, and not be overlapped by anything stacked above it (which might
+ * end up composited beneath it).
+ */
+auto overlay_candidates(RenderableList const& renderables, geometry::Rectangle const& view_area)
+    -> std::vector<OverlayCandidate>;
+
 } // namespace gbm-kms
 } // namespace graphics
 } // namespace mir
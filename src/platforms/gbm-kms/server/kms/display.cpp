@@ -265,6 +265,26 @@ void mgg::Display::configure(mg::DisplayConfiguration const& conf)
     if (auto c = cursor.lock()) c->resume();
 }
 
+void mgg::Display::for_each_display_sync_group_preserved_by(
+    mg::DisplayConfiguration const& conf,
+    std::function<void(mg::DisplaySyncGroup&)> const& f)
+{
+    std::lock_guard<decltype(configuration_mutex)> lock{configuration_mutex};
+
+    auto const& kms_conf = dynamic_cast<RealKMSDisplayConfiguration const&>(conf);
+
+    // Everything survives a compatible change; see configure_locked()
+    if (compatible(current_display_configuration, kms_conf))
+    {
+        for (auto& db_ptr : display_buffers)
+            f(*db_ptr);
+        return;
+    }
+
+    for (auto db : preserved_display_buffers(kms_conf, lock))
+        f(*db);
+}
+
 void mgg::Display::register_configuration_change_handler(
     EventHandlerRegister& handlers,
     DisplayConfigurationChangeHandler const& conf_change_handler)
@@ -417,34 +437,17 @@ mg::Frame mgg::Display::last_frame_on(unsigned output_id) const
     return output->last_frame();
 }
 
+auto mgg::Display::render_drm_fd() const -> int
+{
+    return drm.front()->fd;
+}
+
 namespace
 {
 /*
- * Add output to the grouping, maintaining the invariant that each vector of outputs
- * is a single GPU memory domain.
+ * Create a scanout surface of size and an EGL context rendering to it, falling
+ * back to an alpha format if no EGL config matches gbm_format.
  */
-void add_to_drm_device_group(
-    std::vector<std::vector<std::shared_ptr<mgg::KMSOutput>>>& grouping,
-    std::shared_ptr<mgg::KMSOutput>&& output)
-{
-    for (auto &group : grouping)
-    {
-        /*
-         * We could be smarter about this, but being on the same DRM device is guaranteed
-         * to be in the same GPU memory domain :).
-         */
-        if (group.front()->drm_fd() == output->drm_fd())
-        {
-            group.push_back(std::move(output));
-            break;
-        }
-    }
-    if (output)
-    {
-        grouping.push_back(std::vector<std::shared_ptr<mgg::KMSOutput>>{std::move(output)});
-    }
-}
-
 auto make_surface_with_egl_context(
     geom::Size size,
     uint32_t gbm_format,
@@ -489,9 +492,78 @@ auto make_surface_with_egl_context(
 
 }
 
+auto mgg::Display::preserved_display_buffers(
+    mgg::RealKMSDisplayConfiguration const& kms_conf,
+    std::lock_guard<std::mutex> const&) const -> std::vector<DisplayBuffer*>
+{
+    std::vector<DisplayBuffer*> preserved;
+
+    // Before the first configuration there's nothing to preserve
+    if (&kms_conf == &current_display_configuration)
+        return preserved;
+
+    OverlappingOutputGrouping grouping{kms_conf};
+
+    grouping.for_each_group(
+        [&](OverlappingOutputGroup const& group)
+        {
+            /*
+             * A group can only be left alone if none of its outputs change at
+             * all. That also means they were all in use, and (as outputs
+             * joining or leaving the group would have moved or changed state)
+             * that they were grouped the same way.
+             */
+            bool unchanged{true};
+            std::vector<std::shared_ptr<KMSOutput>> group_outputs;
+
+            group.for_each_output(
+                [&](DisplayConfigurationOutput const& conf_output)
+                {
+                    bool found{false};
+                    current_display_configuration.for_each_output(
+                        [&](DisplayConfigurationOutput const& current_output)
+                        {
+                            if (current_output.id == conf_output.id)
+                                found = current_output == conf_output;
+                        });
+
+                    unchanged = unchanged && found;
+                    group_outputs.push_back(current_display_configuration.get_output_for(conf_output.id));
+                });
+
+            if (!unchanged)
+                return;
+
+            std::vector<DisplayBuffer*> group_buffers;
+            size_t outputs_covered{0};
+            for (auto const& db : display_buffers)
+            {
+                auto const& db_outputs = db->kms_outputs();
+                bool const in_group = std::all_of(
+                    db_outputs.begin(), db_outputs.end(),
+                    [&](auto const& output)
+                    {
+                        return std::find(group_outputs.begin(), group_outputs.end(), output) != group_outputs.end();
+                    });
+
+                if (in_group && db->view_area() == group.bounding_rectangle())
+                {
+                    group_buffers.push_back(db.get());
+                    outputs_covered += db_outputs.size();
+                }
+            }
+
+            // All or nothing: we don't mix old and new DisplayBuffers in a group
+            if (outputs_covered == group_outputs.size())
+                preserved.insert(preserved.end(), group_buffers.begin(), group_buffers.end());
+        });
+
+    return preserved;
+}
+
 void mgg::Display::configure_locked(
     mgg::RealKMSDisplayConfiguration const& kms_conf,
-    std::lock_guard<std::mutex> const&)
+    std::lock_guard<std::mutex> const& lock)
 {
     // Treat the current_display_configuration as incompatible with itself,
     // before it's fully constructed, to force proper initialization.
@@ -500,6 +572,27 @@ void mgg::Display::configure_locked(
         compatible(kms_conf, current_display_configuration)};
     std::vector<std::unique_ptr<DisplayBuffer>> display_buffers_new;
 
+    /*
+     * Output groups that are entirely unchanged keep their DisplayBuffers,
+     * which may still be in use by the compositor: we must not touch them or
+     * their outputs.
+     */
+    auto const preserved = comp ? std::vector<DisplayBuffer*>{} : preserved_display_buffers(kms_conf, lock);
+    auto const is_preserved = [&preserved](DisplayBuffer const* db)
+        {
+            return std::find(preserved.begin(), preserved.end(), db) != preserved.end();
+        };
+    auto const is_preserved_output = [&preserved](std::shared_ptr<KMSOutput> const& output)
+        {
+            return std::any_of(
+                preserved.begin(), preserved.end(),
+                [&output](DisplayBuffer const* db)
+                {
+                    auto const& outputs = db->kms_outputs();
+                    return std::find(outputs.begin(), outputs.end(), output) != outputs.end();
+                });
+        };
+
     if (!comp)
     {
         /*
@@ -511,19 +604,25 @@ void mgg::Display::configure_locked(
          * display_buffers_new are created and take control of the outputs.
          */
         for (auto& db : display_buffers)
-            db->wait_for_page_flip();
+        {
+            if (!is_preserved(db.get()))
+                db->wait_for_page_flip();
+        }
 
-        /* Reset the state of all outputs */
+        /* Reset the state of all outputs we're going to reconfigure */
         kms_conf.for_each_output(
             [&](DisplayConfigurationOutput const& conf_output)
             {
                 auto kms_output = current_display_configuration.get_output_for(conf_output.id);
+                if (is_preserved_output(kms_output))
+                    return;
                 kms_output->clear_cursor();
                 kms_output->reset();
             });
     }
 
     /* Set up used outputs */
+    std::vector<DisplayBuffer*> preserved_slots;
     OverlappingOutputGrouping grouping{kms_conf};
     auto group_idx = 0;
 
@@ -531,24 +630,47 @@ void mgg::Display::configure_locked(
         [&](OverlappingOutputGroup const& group)
         {
             auto bounding_rect = group.bounding_rectangle();
-            // Each vector<KMSOutput> is a single GPU memory domain
-            std::vector<std::vector<std::shared_ptr<KMSOutput>>> kms_output_groups;
+            /*
+             * The whole group shares one DisplayBuffer, even if it spans DRM
+             * devices, so that clones are rendered once rather than once each.
+             */
+            std::vector<std::shared_ptr<KMSOutput>> kms_outputs;
             glm::mat2 transformation;
             geom::Size current_mode_resolution;
+            bool group_preserved{false};
 
             group.for_each_output(
                 [&](DisplayConfigurationOutput const& conf_output)
                 {
                     auto kms_output = current_display_configuration.get_output_for(conf_output.id);
 
+                    if (!comp && is_preserved_output(kms_output))
+                    {
+                        group_preserved = true;
+                        for (auto const db : preserved)
+                        {
+                            auto const& outputs = db->kms_outputs();
+                            if (std::find(outputs.begin(), outputs.end(), kms_output) != outputs.end() &&
+                                std::find(preserved_slots.begin(), preserved_slots.end(), db) == preserved_slots.end())
+                            {
+                                // Filled in below, once nothing else can fail
+                                preserved_slots.resize(display_buffers_new.size());
+                                preserved_slots.push_back(db);
+                                display_buffers_new.push_back(nullptr);
+                            }
+                        }
+                        return;
+                    }
+
                     auto const mode_index = kms_conf.get_kms_mode_index(conf_output.id,
                                                                   conf_output.current_mode_index);
                     kms_output->configure(conf_output.top_left - bounding_rect.top_left, mode_index);
+                    kms_output->set_vrr_enabled(conf_output.vrr_enabled);
                     if (!comp)
                     {
                         kms_output->set_power_mode(conf_output.power_mode);
                         kms_output->set_gamma(conf_output.gamma);
-                        add_to_drm_device_group(kms_output_groups, std::move(kms_output));
+                        kms_outputs.push_back(std::move(kms_output));
                     }
 
                     /*
@@ -565,50 +687,56 @@ void mgg::Display::configure_locked(
                 display_buffers[group_idx++]->set_transformation(transformation,
                                                                  bounding_rect);
             }
-            else
+            else if (!group_preserved)
             {
                 uint32_t const width  = current_mode_resolution.width.as_uint32_t();
                 uint32_t const height = current_mode_resolution.height.as_uint32_t();
 
-                for (auto const& group : kms_output_groups)
-                {
-                    // TODO: Pull this out of the configuration
-                    // TODO: Actually query available formats!
-                    uint32_t gbm_format = GBM_FORMAT_XRGB8888;
-                    /*
-                     * In a hybrid setup a scanout surface needs to be allocated differently if it
-                     * needs to be able to be shared across GPUs. This likely reduces performance.
-                     *
-                     * As a first cut, assume every scanout buffer in a hybrid setup might need
-                     * to be shared.
-                     */
-                    auto [surface, egl] = make_surface_with_egl_context(
-                        current_mode_resolution,
-                        gbm_format,
-                        *gbm,
-                        *gl_config,
-                        shared_egl.context(),
-                        drm.size() != 1);
-                    auto db = std::make_unique<DisplayBuffer>(
-                        bypass_option,
-                        listener,
-                        group,
-                        GBMOutputSurface{
-                            group.front()->drm_fd(),
-                            std::move(surface),
-                            width, height,
-                            std::move(egl)
-                        },
-                        bounding_rect,
-                        transformation);
-
-                    display_buffers_new.push_back(std::move(db));
-                }
+                // TODO: Pull this out of the configuration
+                // TODO: Actually query available formats!
+                uint32_t gbm_format = GBM_FORMAT_XRGB8888;
+                /*
+                 * In a hybrid setup a scanout surface needs to be allocated differently if it
+                 * needs to be able to be shared across GPUs. This likely reduces performance.
+                 *
+                 * As a first cut, assume every scanout buffer in a hybrid setup might need
+                 * to be shared.
+                 */
+                auto [surface, egl] = make_surface_with_egl_context(
+                    current_mode_resolution,
+                    gbm_format,
+                    *gbm,
+                    *gl_config,
+                    shared_egl.context(),
+                    drm.size() != 1);
+                auto db = std::make_unique<DisplayBuffer>(
+                    bypass_option,
+                    listener,
+                    kms_outputs,
+                    GBMOutputSurface{
+                        kms_outputs.front()->drm_fd(),
+                        std::move(surface),
+                        width, height,
+                        std::move(egl)
+                    },
+                    bounding_rect,
+                    transformation);
+
+                display_buffers_new.push_back(std::move(db));
             }
         });
 
     if (!comp)
+    {
+        for (auto& db : display_buffers)
+        {
+            auto const slot = std::find(preserved_slots.begin(), preserved_slots.end(), db.get());
+            if (db && slot != preserved_slots.end())
+                display_buffers_new[slot - preserved_slots.begin()] = std::move(db);
+        }
+
         display_buffers = std::move(display_buffers_new);
+    }
 
     /* Store applied configuration */
     current_display_configuration = kms_conf;
@@ -79,6 +79,9 @@ public:
     std::unique_ptr<DisplayConfiguration> configuration() const override;
     bool apply_if_configuration_preserves_display_buffers(DisplayConfiguration const& conf) override;
     void configure(DisplayConfiguration const& conf) override;
+    void for_each_display_sync_group_preserved_by(
+        DisplayConfiguration const& conf,
+        std::function<void(DisplaySyncGroup&)> const& f) override;
 
     void register_configuration_change_handler(
         EventHandlerRegister& handlers,
@@ -99,6 +102,9 @@ public:
 
     Frame last_frame_on(unsigned output_id) const override;
 
+    /// The DRM device we render with, on which the shared GL context is made
+    auto render_drm_fd() const -> int;
+
 private:
     void clear_connected_unused_outputs();
 
@@ -118,6 +124,11 @@ private:
         RealKMSDisplayConfiguration const& conf,
         std::lock_guard<decltype(configuration_mutex)> const&);
 
+    /// The display_buffers that applying conf can leave running untouched
+    auto preserved_display_buffers(
+        RealKMSDisplayConfiguration const& conf,
+        std::lock_guard<decltype(configuration_mutex)> const&) const -> std::vector<DisplayBuffer*>;
+
     BypassOption bypass_option;
     std::weak_ptr<Cursor> cursor;
     std::shared_ptr<GLConfig> const gl_config;
@@ -18,6 +18,7 @@
 
 #include "display_buffer.h"
 #include "kms_output.h"
+#include "atomic_page_flip.h"
 #include "mir/graphics/display_report.h"
 #include "mir/graphics/transformation.h"
 #include "bypass.h"
@@ -351,7 +352,7 @@ public:
         tex_data = nullptr;
     }
 
-    mgg::GBMOutputSurface::FrontBuffer copy_front_buffer_from(mgg::GBMOutputSurface::FrontBuffer&& from)
+    mgg::GBMOutputSurface::FrontBuffer copy_front_buffer_from(gbm_bo* from)
     {
         egl.make_current();
         mir::Fd const dma_buf{gbm_bo_get_fd(from)};
@@ -424,6 +425,42 @@ public:
 };
 }
 
+/*
+ * The outputs sharing a DRM device.
+ *
+ * Those that can scan out of the frame we rendered do so directly; otherwise
+ * (a hybrid GPU setup, or clones spanning several GPUs) the frame is copied
+ * onto a surface of the device's own.
+ */
+struct mgg::DisplayBuffer::DeviceOutputs
+{
+    std::vector<std::shared_ptr<KMSOutput>> outputs;
+
+    /*
+     * Destruction order is important here:
+     *  - The copied GBMFrontBuffers depend on the EGLBufferCopier
+     */
+    std::unique_ptr<EGLBufferCopier> copier;
+    GBMOutputSurface::FrontBuffer visible_copy;
+    GBMOutputSurface::FrontBuffer scheduled_copy;
+
+    std::shared_ptr<FBHandle const> scheduled_fb{nullptr};
+    std::shared_ptr<FBHandle const> visible_fb{nullptr};
+
+    void schedule(gbm_bo* rendered)
+    {
+        if (copier)
+        {
+            scheduled_copy = copier->copy_front_buffer_from(rendered);
+            rendered = scheduled_copy;
+        }
+
+        scheduled_fb = outputs.front()->fb_for(rendered);
+        if (!scheduled_fb)
+            fatal_error("Failed to get front buffer object");
+    }
+};
+
 mgg::DisplayBuffer::DisplayBuffer(
     mgg::BypassOption option,
     std::shared_ptr<DisplayReport> const& listener,
@@ -456,40 +493,70 @@ mgg::DisplayBuffer::DisplayBuffer(
     if (!temporary_front)
         fatal_error("Failed to get frontbuffer");
 
-    if (needs_bounce_buffer(*outputs.front(), temporary_front))
+    for (auto const& output : outputs)
     {
-        mir::log_info("Hybrid GPU setup detected; DisplayBuffer using EGL buffer copies for migration");
-        get_front_buffer = std::bind(
-            std::mem_fn(&EGLBufferCopier::copy_front_buffer_from),
-            std::make_shared<EGLBufferCopier>(
-                mir::Fd{mir::IntOwnedFd{outputs.front()->drm_fd()}},
+        auto const device = std::find_if(
+            devices.begin(), devices.end(),
+            [&output](auto const& device) { return device->outputs.front()->drm_fd() == output->drm_fd(); });
+
+        if (device != devices.end())
+        {
+            (*device)->outputs.push_back(output);
+            continue;
+        }
+
+        devices.push_back(std::make_unique<DeviceOutputs>());
+        devices.back()->outputs.push_back(output);
+
+        if (needs_bounce_buffer(*output, temporary_front))
+        {
+            mir::log_info("Hybrid GPU setup detected; DisplayBuffer using EGL buffer copies for migration");
+            devices.back()->copier = std::make_unique<EGLBufferCopier>(
+                mir::Fd{mir::IntOwnedFd{output->drm_fd()}},
                 surface.size().width.as_int(),
                 surface.size().height.as_int(),
-                GBM_FORMAT_XRGB8888),
-            std::placeholders::_1);
+                GBM_FORMAT_XRGB8888);
+        }
+        else
+        {
+            mir::log_info("Detected single-GPU DisplayBuffer. Rendering will be sent directly to output");
+        }
     }
-    else
+
+    if (devices.size() > 1)
     {
-        mir::log_info("Detected single-GPU DisplayBuffer. Rendering will be sent directly to output");
-        get_front_buffer = [](auto&& fb) { return std::move(fb); };
+        mir::log_info("DisplayBuffer cloned across %zu DRM devices; rendering each frame once", devices.size());
     }
 
-    visible_composite_frame = get_front_buffer(std::move(temporary_front));
-
-    /*
-     * Check that our (possibly bounced) front buffer is usable on *all* the
-     * outputs we've been asked to output on.
-     */
-    for (auto const& output : outputs)
+    for (auto& device : devices)
     {
-        if (output->buffer_requires_migration(visible_composite_frame))
+        device->schedule(temporary_front);
+
+        /*
+         * Check that our (possibly bounced) front buffer is usable on *all* the
+         * outputs of the device.
+         */
+        gbm_bo* const front = device->copier ? device->scheduled_copy : temporary_front;
+        for (auto const& output : device->outputs)
         {
-            BOOST_THROW_EXCEPTION(std::invalid_argument(
-                "Attempted to create a DisplayBuffer spanning multiple GPU memory domains"));
+            if (output->buffer_requires_migration(front))
+            {
+                BOOST_THROW_EXCEPTION(std::invalid_argument(
+                    "Attempted to create a DisplayBuffer spanning multiple GPU memory domains"));
+            }
         }
     }
 
-    set_crtc(*outputs.front()->fb_for(visible_composite_frame));
+    set_crtc();
+
+    for (auto& device : devices)
+    {
+        device->visible_fb = std::move(device->scheduled_fb);
+        device->scheduled_fb = nullptr;
+        device->visible_copy = std::move(device->scheduled_copy);
+        device->scheduled_copy = nullptr;
+    }
+    visible_composite_frame = std::move(temporary_front);
 
     release_current();
 
@@ -525,8 +592,10 @@ void mgg::DisplayBuffer::set_transformation(glm::mat2 const& t, geometry::Rectan
 bool mgg::DisplayBuffer::overlay(RenderableList const& renderable_list)
 {
     glm::mat2 static const no_transformation(1);
+    // A client buffer can only be scanned out on the device it was allocated for
     if (transform == no_transformation &&
-       (bypass_option == mgg::BypassOption::allowed))
+       (bypass_option == mgg::BypassOption::allowed) &&
+       devices.size() == 1)
     {
         mgg::BypassMatch bypass_match(area);
         auto bypass_it = std::find_if(renderable_list.rbegin(), renderable_list.rend(), bypass_match);
@@ -534,21 +603,177 @@ bool mgg::DisplayBuffer::overlay(RenderableList const& renderable_list)
         {
             auto bypass_buffer = (*bypass_it)->buffer();
             auto dmabuf_image = dynamic_cast<mg::DMABufBuffer*>(bypass_buffer->native_buffer_base());
-            if (dmabuf_image &&
-                bypass_buffer->size() == surface.size())
+            char const* rejection{nullptr};
+            if (!dmabuf_image)
             {
+                rejection = "it is not a dmabuf";
+            }
+            else if (bypass_buffer->size() != surface.size())
+            {
+                rejection = "its size differs from the output's";
+            }
+            else
+            {
+                // Even if KMS can't take this buffer, the client could allocate one it can
+                dmabuf_image->mark_scanout_candidate();
+
                 if (auto bufobj = outputs.front()->fb_for(*dmabuf_image))
                 {
                     bypass_buf = bypass_buffer;
                     bypass_bufobj = bufobj;
+                    bypass_allows_tearing = (*bypass_it)->allow_tearing();
+                    bypass_rejection = nullptr;
                     return true;
                 }
+                rejection = "KMS cannot scan out its format/modifier";
+            }
+
+            if (rejection != bypass_rejection)
+            {
+                mir::log_debug("Not bypassing fullscreen buffer: %s", rejection);
+                bypass_rejection = rejection;
             }
         }
     }
 
     bypass_buf = nullptr;
     bypass_bufobj = nullptr;
+    bypass_allows_tearing = false;
+    return false;
+}
+
+bool mgg::DisplayBuffer::overlay_some(RenderableList& renderable_list)
+{
+    overlay_frames.clear();
+
+    if (overlay(renderable_list))
+        return true;
+
+    glm::mat2 static const no_transformation(1);
+    // Overlay planes belong to a single CRTC, so we can't use them for clones
+    if (transform != no_transformation ||
+        bypass_option != mgg::BypassOption::allowed ||
+        outputs.size() != 1 ||
+        devices.front()->copier)
+    {
+        return false;
+    }
+
+    auto const& output = outputs.front();
+
+    struct Candidate
+    {
+        std::shared_ptr<Renderable> renderable;
+        OverlayLayer layer;
+    };
+    std::vector<Candidate> candidates;
+    for (auto const& candidate : overlay_candidates(renderable_list, area))
+    {
+        auto const buffer = candidate.renderable->buffer();
+        if (auto const dmabuf = dynamic_cast<mg::DMABufBuffer*>(buffer->native_buffer_base()))
+        {
+            dmabuf->mark_scanout_candidate();
+            if (auto fb = output->fb_for(*dmabuf))
+                candidates.push_back({candidate.renderable, {std::move(fb), buffer->size(), candidate.destination}});
+        }
+    }
+
+    if (candidates.empty())
+        return false;
+
+    auto const assign = [&output](FBHandle const& primary, std::vector<Candidate> const& wanted)
+        {
+            std::vector<OverlayLayer> layers;
+            for (auto const& candidate : wanted)
+                layers.push_back(candidate.layer);
+
+            auto const accepted = output->assign_overlays(primary, layers);
+
+            std::vector<Candidate> assigned;
+            for (auto i = 0u; i != wanted.size(); ++i)
+            {
+                if (accepted[i])
+                    assigned.push_back(wanted[i]);
+            }
+            return assigned;
+        };
+
+    /*
+     * Best is to scan out the topmost renderable covering the output, with
+     * everything above it on overlay planes, so nothing need be composited.
+     */
+    glm::mat4 const identity(1);
+    auto const covering = std::find_if(
+        renderable_list.rbegin(), renderable_list.rend(),
+        [this, &identity](auto const& renderable)
+        {
+            return renderable->screen_position() == area &&
+                   renderable->alpha() == 1.0f &&
+                   !renderable->shaped() &&
+                   renderable->transformation() == identity;
+        });
+
+    if (covering != renderable_list.rend())
+    {
+        std::vector<Candidate> above;
+        auto const all_overlayable = std::all_of(
+            renderable_list.rbegin(), covering,
+            [this, &candidates, &above](auto const& renderable)
+            {
+                if (!renderable->screen_position().overlaps(area))
+                    return true;
+
+                auto const candidate = std::find_if(
+                    candidates.begin(), candidates.end(),
+                    [&renderable](auto const& candidate) { return candidate.renderable == renderable; });
+                if (candidate == candidates.end())
+                    return false;
+
+                above.push_back(*candidate);
+                return true;
+            });
+
+        auto const buffer = (*covering)->buffer();
+        auto const dmabuf = dynamic_cast<mg::DMABufBuffer*>(buffer->native_buffer_base());
+        if (all_overlayable && dmabuf && buffer->size() == surface.size())
+        {
+            dmabuf->mark_scanout_candidate();
+            if (auto const fb = output->fb_for(*dmabuf))
+            {
+                auto const assigned = assign(*fb, above);
+                if (assigned.size() == above.size())
+                {
+                    for (auto const& candidate : assigned)
+                        overlay_frames.push_back({candidate.renderable->buffer(), candidate.layer.fb});
+
+                    bypass_buf = buffer;
+                    bypass_bufobj = fb;
+                    // Overlay planes are only shown by (vsynced) atomic flips
+                    bypass_allows_tearing = false;
+                    return true;
+                }
+            }
+        }
+    }
+
+    /*
+     * Otherwise lift what we can out of composition. The composited frame
+     * isn't rendered yet, so test against the one on screen; it's the same
+     * size and format.
+     */
+    auto const& primary = devices.front()->visible_fb;
+    if (!primary)
+        return false;
+
+    auto const assigned = assign(*primary, candidates);
+    for (auto const& candidate : assigned)
+    {
+        overlay_frames.push_back({candidate.renderable->buffer(), candidate.layer.fb});
+        renderable_list.erase(
+            std::remove(renderable_list.begin(), renderable_list.end(), candidate.renderable),
+            renderable_list.end());
+    }
+
     return false;
 }
 
@@ -563,23 +788,35 @@ void mgg::DisplayBuffer::swap_buffers()
     surface.swap_buffers();
     bypass_buf = nullptr;
     bypass_bufobj = nullptr;
+    bypass_allows_tearing = false;
 }
 
-void mgg::DisplayBuffer::set_crtc(FBHandle const& forced_frame)
+void mgg::DisplayBuffer::swap_buffers_with_damage(geom::Rectangles const& damage)
 {
-    for (auto& output : outputs)
+    surface.swap_buffers_with_damage(damage);
+    bypass_buf = nullptr;
+    bypass_bufobj = nullptr;
+    bypass_allows_tearing = false;
+}
+
+void mgg::DisplayBuffer::set_crtc()
+{
+    for (auto const& device : devices)
     {
-        /*
-         * Note that failure to set the CRTC is not a fatal error. This can
-         * happen under normal conditions when resizing VirtualBox (which
-         * actually removes and replaces the virtual output each time so
-         * sometimes it's really not there). Xorg often reports similar
-         * errors, and it's not fatal.
-         */
-        if (!output->set_crtc(forced_frame))
-            mir::log_error("Failed to set DRM CRTC. "
-                "Screen contents may be incomplete. "
-                "Try plugging the monitor in again.");
+        for (auto& output : device->outputs)
+        {
+            /*
+             * Note that failure to set the CRTC is not a fatal error. This can
+             * happen under normal conditions when resizing VirtualBox (which
+             * actually removes and replaces the virtual output each time so
+             * sometimes it's really not there). Xorg often reports similar
+             * errors, and it's not fatal.
+             */
+            if (!output->set_crtc(*device->scheduled_fb))
+                mir::log_error("Failed to set DRM CRTC. "
+                    "Screen contents may be incomplete. "
+                    "Try plugging the monitor in again.");
+        }
     }
 }
 
@@ -593,25 +830,44 @@ void mgg::DisplayBuffer::post()
      */
     wait_for_page_flip();
 
-    std::shared_ptr<mgg::FBHandle const> bufobj;
+    scheduled_overlay_frames = std::move(overlay_frames);
+    overlay_frames.clear();
+
     if (bypass_buf)
     {
-        bufobj = bypass_bufobj;
+        devices.front()->scheduled_fb = bypass_bufobj;
     }
     else
     {
-        scheduled_composite_frame = get_front_buffer(surface.lock_front());
-        bufobj = outputs.front()->fb_for(scheduled_composite_frame);
-        if (!bufobj)
-            fatal_error("Failed to get front buffer object");
+        /*
+         * The frame was rendered once for all of our outputs, whichever
+         * devices they are on; only the devices that need a copy make one.
+         */
+        auto rendered = surface.lock_front();
+        bool scanned_out_directly{false};
+        for (auto& device : devices)
+        {
+            device->schedule(rendered);
+            scanned_out_directly |= !device->copier;
+        }
+
+        // Nothing refers to the rendered frame once it's been copied
+        if (scanned_out_directly)
+            scheduled_composite_frame = std::move(rendered);
     }
 
-    scheduled_fb = std::move(bufobj);
+    /*
+     * A bypassed client that accepts tearing may be flipped to without
+     * waiting for vblank. Only with a single output though: clones would
+     * otherwise show its frames at different times.
+     */
+    auto const tearing = bypass_buf && bypass_allows_tearing && outputs.size() == 1;
+
     /*
      * Try to schedule a page flip as first preference to avoid tearing.
      * [will complete in a background thread]
      */
-    if (!needs_set_crtc && !schedule_page_flip(*scheduled_fb))
+    if (!needs_set_crtc && !schedule_page_flip(tearing))
         needs_set_crtc = true;
 
     /*
@@ -620,10 +876,13 @@ void mgg::DisplayBuffer::post()
      */
     if (needs_set_crtc)
     {
-        set_crtc(*scheduled_fb);
+        set_crtc();
         // SetCrtc is immediate, so the FB is now visible and we have nothing pending
-        visible_fb = std::move(scheduled_fb);
-        scheduled_fb = nullptr;
+        for (auto& device : devices)
+        {
+            device->visible_fb = std::move(device->scheduled_fb);
+            device->scheduled_fb = nullptr;
+        }
 
         needs_set_crtc = false;
     }
@@ -650,9 +909,21 @@ void mgg::DisplayBuffer::post()
         // It's very likely the next frame will be bypassed like this one so
         // we only need time for kernel page flip scheduling...
         predicted_render_time = 5ms;
+
+        /*
+         * With adaptive sync the display waits for our flip rather than
+         * refreshing at a fixed rate, so a bypassed client sets the pace:
+         * flip as soon as it commits its next frame. The same goes for a
+         * client that accepts tearing.
+         */
+        flip_on_commit = tearing || std::all_of(
+            outputs.begin(), outputs.end(),
+            [](auto const& output) { return output->vrr_enabled(); });
     }
     else
     {
+        flip_on_commit = false;
+
         /*
          * Not in clone mode? We can afford to wait for the page flip then,
          * making us double-buffered (noticeably less laggy than the triple
@@ -673,9 +944,10 @@ void mgg::DisplayBuffer::post()
     // Buffer lifetimes are managed exclusively by scheduled*/visible* now
     bypass_buf = nullptr;
     bypass_bufobj = nullptr;
+    bypass_allows_tearing = false;
 
     recommend_sleep = 0ms;
-    if (outputs.size() == 1)
+    if (outputs.size() == 1 && !flip_on_commit)
     {
         auto const& output = outputs.front();
         auto const min_frame_interval = 1000ms / output->max_refresh_rate();
@@ -689,21 +961,86 @@ std::chrono::milliseconds mgg::DisplayBuffer::recommended_sleep() const
     return recommend_sleep;
 }
 
-bool mgg::DisplayBuffer::schedule_page_flip(FBHandle const& bufobj)
+auto mgg::DisplayBuffer::vblank_timing() const -> std::optional<VBlankTiming>
+{
+    /*
+     * In clone mode the outputs may have different refresh rates and
+     * unrelated vblanks, so there is no single deadline to aim for.
+     */
+    if (outputs.size() != 1)
+        return std::nullopt;
+
+    // Nor is there while a bypassed client is driving a variable refresh rate
+    if (flip_on_commit)
+        return std::nullopt;
+
+    auto const& output = outputs.front();
+    auto const last_vblank = output->last_frame();
+    auto const refresh_rate = output->max_refresh_rate();
+
+    // No page flip has completed yet (or we're falling back to SetCrtc)
+    if (last_vblank.msc == 0 || refresh_rate <= 0)
+        return std::nullopt;
+
+    return VBlankTiming{last_vblank, std::chrono::nanoseconds{std::chrono::seconds{1}} / refresh_rate};
+}
+
+bool mgg::DisplayBuffer::schedule_page_flip(bool allow_tearing)
 {
     /*
      * Schedule the current front buffer object for display. Note that
-     * the page flip is asynchronous and synchronized with vertical refresh.
+     * the page flip is asynchronous and synchronized with vertical refresh,
+     * unless tearing is allowed and the driver can flip immediately.
      */
-    for (auto& output : outputs)
+    for (auto const& device : devices)
     {
-        if (output->schedule_page_flip(bufobj))
+        if (allow_tearing && device->outputs.size() == 1 &&
+            device->outputs.front()->schedule_async_page_flip(*device->scheduled_fb))
+        {
+            page_flips_pending = true;
+            continue;
+        }
+
+        if (schedule_atomic_page_flip(*device))
+        {
             page_flips_pending = true;
+            continue;
+        }
+
+        for (auto& output : device->outputs)
+        {
+            if (output->schedule_page_flip(*device->scheduled_fb))
+                page_flips_pending = true;
+        }
     }
 
     return page_flips_pending;
 }
 
+bool mgg::DisplayBuffer::schedule_atomic_page_flip(DeviceOutputs const& device)
+{
+    /*
+     * All outputs on a device flip in one atomic commit, so they change
+     * together on the same vblank. If any output can't join in, the whole
+     * device takes the legacy path instead.
+     */
+    try
+    {
+        AtomicPageFlip flip;
+        for (auto& output : device.outputs)
+        {
+            if (!output->add_page_flip(flip, *device.scheduled_fb))
+                return false;
+        }
+        return device.outputs.front()->commit_page_flips(flip);
+    }
+    catch (std::exception const& e)
+    {
+        mir::log_debug("Failed to build atomic page flip: %s", e.what());
+        return false;
+    }
+}
+
 void mgg::DisplayBuffer::wait_for_page_flip()
 {
     if (page_flips_pending)
@@ -711,14 +1048,21 @@ void mgg::DisplayBuffer::wait_for_page_flip()
         for (auto& output : outputs)
             output->wait_for_page_flip();
 
-        // The previously-scheduled FB has been page-flipped, and is now visible
-        visible_fb = std::move(scheduled_fb);
-        scheduled_fb = nullptr;
+        // The previously-scheduled FBs have been page-flipped, and are now visible
+        for (auto& device : devices)
+        {
+            device->visible_fb = std::move(device->scheduled_fb);
+            device->scheduled_fb = nullptr;
+        }
 
         page_flips_pending = false;
     }
 
-    if (scheduled_bypass_frame || scheduled_composite_frame)
+    auto const copy_scheduled = std::any_of(
+        devices.begin(), devices.end(),
+        [](auto const& device) { return static_cast<bool>(device->scheduled_copy); });
+
+    if (scheduled_bypass_frame || scheduled_composite_frame || copy_scheduled)
     {
         // Why are both of these grouped into a single statement?
         // Because in either case both types of frame need releasing each time.
@@ -728,6 +1072,15 @@ void mgg::DisplayBuffer::wait_for_page_flip()
 
         visible_composite_frame = std::move(scheduled_composite_frame);
         scheduled_composite_frame = nullptr;
+
+        visible_overlay_frames = std::move(scheduled_overlay_frames);
+        scheduled_overlay_frames.clear();
+
+        for (auto& device : devices)
+        {
+            device->visible_copy = std::move(device->scheduled_copy);
+            device->scheduled_copy = nullptr;
+        }
     }
 }
 
@@ -746,6 +1099,11 @@ void mgg::DisplayBuffer::release_current()
     surface.release_current();
 }
 
+auto mgg::DisplayBuffer::kms_outputs() const -> std::vector<std::shared_ptr<KMSOutput>> const&
+{
+    return outputs;
+}
+
 void mgg::DisplayBuffer::schedule_set_crtc()
 {
     needs_set_crtc = true;
@@ -799,6 +1157,23 @@ void mgg::GBMOutputSurface::swap_buffers()
         fatal_error("Failed to perform buffer swap");
 }
 
+void mgg::GBMOutputSurface::swap_buffers_with_damage(geom::Rectangles const& damage)
+{
+    // EGL wants damage relative to the bottom-left of the surface
+    std::vector<EGLint> rects;
+    rects.reserve(damage.size() * 4);
+    for (auto const& rect : damage)
+    {
+        rects.push_back(rect.top_left.x.as_int());
+        rects.push_back(static_cast<EGLint>(height) - rect.bottom().as_int());
+        rects.push_back(rect.size.width.as_int());
+        rects.push_back(rect.size.height.as_int());
+    }
+
+    if (!egl.swap_buffers_with_damage(rects))
+        fatal_error("Failed to perform buffer swap");
+}
+
 void mgg::GBMOutputSurface::bind()
 {
 
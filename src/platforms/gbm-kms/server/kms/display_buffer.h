@@ -81,6 +81,7 @@ public:
     void make_current() override;
     void release_current() override;
     void swap_buffers() override;
+    void swap_buffers_with_damage(geometry::Rectangles const& damage) override;
     void bind() override;
 
     FrontBuffer lock_front();
@@ -111,52 +112,71 @@ public:
     void make_current() override;
     void release_current() override;
     void swap_buffers() override;
+    void swap_buffers_with_damage(geometry::Rectangles const& damage) override;
     bool overlay(RenderableList const& renderlist) override;
+    bool overlay_some(RenderableList& renderlist) override;
     void bind() override;
 
     void for_each_display_buffer(
         std::function<void(graphics::DisplayBuffer&)> const& f) override;
     void post() override;
     std::chrono::milliseconds recommended_sleep() const override;
+    auto vblank_timing() const -> std::optional<VBlankTiming> override;
 
     glm::mat2 transformation() const override;
     NativeDisplayBuffer* native_display_buffer() override;
 
     void set_transformation(glm::mat2 const& t, geometry::Rectangle const& a);
+    auto kms_outputs() const -> std::vector<std::shared_ptr<KMSOutput>> const&;
     void schedule_set_crtc();
     void wait_for_page_flip();
 
 private:
-    bool schedule_page_flip(FBHandle const& bufobj);
-    void set_crtc(FBHandle const&);
+    struct DeviceOutputs;
+
+    bool schedule_page_flip(bool allow_tearing);
+    bool schedule_atomic_page_flip(DeviceOutputs const& device);
+    void set_crtc();
 
     std::shared_ptr<graphics::Buffer> visible_bypass_frame, scheduled_bypass_frame;
+    /// A client buffer shown on an overlay plane
+    struct OverlayFrame
+    {
+        std::shared_ptr<graphics::Buffer> buffer;
+        std::shared_ptr<FBHandle const> fb;
+    };
+    std::vector<OverlayFrame> overlay_frames, scheduled_overlay_frames, visible_overlay_frames;
     std::shared_ptr<Buffer> bypass_buf{nullptr};
     std::shared_ptr<FBHandle const> bypass_bufobj{nullptr};
+    /// Whether the client whose buffer we're bypassing accepts tearing
+    bool bypass_allows_tearing{false};
+    /// Why the last bypass candidate couldn't be scanned out, so we only log changes
+    char const* bypass_rejection{nullptr};
     std::shared_ptr<DisplayReport> const listener;
     BypassOption bypass_option;
 
     std::vector<std::shared_ptr<KMSOutput>> outputs;
 
+    /*
+     * The outputs grouped by DRM device. Clones are all shown the same
+     * rendered frame, however many devices they are spread across.
+     */
+    std::vector<std::unique_ptr<DeviceOutputs>> devices;
+
     /*
      * Destruction order is important here:
-     *  - The GBMFrontBuffers depend on *either*:
-     *  i)  The GBMOutputSurface, or
-     *  ii) The EGLBufferCopier hidden inside get_front_buffer
+     *  - The GBMFrontBuffers depend on the GBMOutputSurface
      */
-    std::function<GBMOutputSurface::FrontBuffer(GBMOutputSurface::FrontBuffer&&)> get_front_buffer;
     GBMOutputSurface surface;
 
     GBMOutputSurface::FrontBuffer visible_composite_frame;
     GBMOutputSurface::FrontBuffer scheduled_composite_frame;
 
-    std::shared_ptr<FBHandle const> scheduled_fb{nullptr};
-    std::shared_ptr<FBHandle const> visible_fb{nullptr};
-
     geometry::Rectangle area;
     glm::mat2 transform;
     std::atomic<bool> needs_set_crtc;
     std::chrono::milliseconds recommend_sleep{0};
+    bool flip_on_commit{false};
     bool page_flips_pending;
 };
 
@@ -56,7 +56,8 @@ mgmh::EGLHelper::EGLHelper(EGLHelper&& from)
       egl_config{from.egl_config},
       egl_context{from.egl_context},
       egl_surface{from.egl_surface},
-      should_terminate_egl{from.should_terminate_egl}
+      should_terminate_egl{from.should_terminate_egl},
+      swap_with_damage{from.swap_with_damage}
 {
     from.should_terminate_egl = false;
     from.egl_display = EGL_NO_DISPLAY;
@@ -188,6 +189,15 @@ void mgmh::EGLHelper::setup(
     if(egl_surface == EGL_NO_SURFACE)
         BOOST_THROW_EXCEPTION(mg::egl_error("Failed to create EGL window surface"));
 
+    try
+    {
+        swap_with_damage.emplace(egl_display);
+    }
+    catch (std::runtime_error const&)
+    {
+        // Fine; we'll just swap the whole surface
+    }
+
     egl_context = eglCreateContext(egl_display, egl_config, shared_context, context_attr);
     if (egl_context == EGL_NO_CONTEXT)
         BOOST_THROW_EXCEPTION(mg::egl_error("Failed to create EGL context"));
@@ -216,6 +226,19 @@ bool mgmh::EGLHelper::swap_buffers()
     return (ret == EGL_TRUE);
 }
 
+bool mgmh::EGLHelper::swap_buffers_with_damage(std::vector<EGLint> const& rects)
+{
+    if (!swap_with_damage)
+        return swap_buffers();
+
+    auto ret = swap_with_damage->eglSwapBuffersWithDamage(
+        egl_display,
+        egl_surface,
+        rects.data(),
+        static_cast<EGLint>(rects.size() / 4));
+    return (ret == EGL_TRUE);
+}
+
 bool mgmh::EGLHelper::make_current() const
 {
     auto ret = eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context);
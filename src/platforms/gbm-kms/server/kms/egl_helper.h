@@ -21,7 +21,9 @@
 
 #include "display_helpers.h"
 #include "mir/graphics/egl_extensions.h"
+#include <optional>
 #include <stdexcept>
+#include <vector>
 #include <EGL/egl.h>
 
 namespace mir
@@ -54,6 +56,8 @@ public:
     void setup(GBMHelper const& gbm, gbm_surface* surface_gbm, uint32_t gbm_format, EGLContext shared_context, bool owns_egl);
 
     bool swap_buffers();
+    /// Damage rectangles are {x, y, width, height} with a bottom-left origin
+    bool swap_buffers_with_damage(std::vector<EGLint> const& rects);
     bool make_current() const;
     bool release_current() const;
 
@@ -79,6 +83,7 @@ private:
     EGLSurface egl_surface;
     bool should_terminate_egl;
     EGLExtensions::PlatformBaseEXT platform_base;
+    std::optional<EGLExtensions::SwapBuffersWithDamage> swap_with_damage;
 };
 }
 }
@@ -22,6 +22,7 @@
 #include "mir/geometry/size.h"
 #include "mir/geometry/point.h"
 #include "mir/geometry/displacement.h"
+#include "mir/geometry/rectangle.h"
 #include "mir/graphics/display_configuration.h"
 #include "mir/graphics/frame.h"
 #include "mir/graphics/dmabuf_buffer.h"
@@ -31,6 +32,9 @@
 
 #include <gbm.h>
 
+#include <memory>
+#include <vector>
+
 namespace mir
 {
 namespace graphics
@@ -41,6 +45,18 @@ namespace gbm
 {
 
 class FBHandle;
+class AtomicPageFlip;
+
+/**
+ * A buffer to be shown, unscaled or scaled, on an overlay plane
+ */
+struct OverlayLayer
+{
+    std::shared_ptr<FBHandle const> fb;
+    geometry::Size buffer_size;
+    /// Where on the output (in CRTC coordinates) the whole buffer is shown
+    geometry::Rectangle destination;
+};
 
 class KMSOutput
 {
@@ -68,8 +84,44 @@ public:
     virtual bool set_crtc(FBHandle const& fb) = 0;
     virtual void clear_crtc() = 0;
     virtual bool schedule_page_flip(FBHandle const& fb) = 0;
+    /**
+     * Flip to fb as soon as possible, without waiting for vblank.
+     *
+     * The new frame may tear; only use this for clients that accept that.
+     *
+     * \return  False if the flip couldn't be scheduled asynchronously; the
+     *          caller should fall back to schedule_page_flip().
+     */
+    virtual bool schedule_async_page_flip(FBHandle const& fb) = 0;
     virtual void wait_for_page_flip() = 0;
 
+    /**
+     * Add this output's next frame to an atomic page flip.
+     *
+     * \return  False if this output can't be flipped atomically; the caller
+     *          should then use schedule_page_flip() instead.
+     */
+    virtual bool add_page_flip(AtomicPageFlip& flip, FBHandle const& fb) = 0;
+    /**
+     * Commit an atomic page flip built from the outputs of this output's DRM device.
+     *
+     * \return  False if the commit was rejected; nothing is changed and the
+     *          caller should fall back to schedule_page_flip().
+     */
+    virtual bool commit_page_flips(AtomicPageFlip& flip) = 0;
+    /**
+     * Choose which layers to show on overlay planes, above fb on the primary
+     * plane, in the next atomic page flip.
+     *
+     * Each candidate, in order, is checked with a TEST_ONLY commit together
+     * with those already accepted; candidates must not overlap each other.
+     * The assignment applies to the next add_page_flip() only.
+     *
+     * \return  For each candidate, whether it was accepted
+     */
+    virtual auto assign_overlays(FBHandle const& fb, std::vector<OverlayLayer> const& candidates)
+        -> std::vector<bool> = 0;
+
     virtual bool set_cursor(gbm_bo* buffer) = 0;
     virtual void move_cursor(geometry::Point destination) = 0;
     virtual bool clear_cursor() = 0;
@@ -77,6 +129,14 @@ public:
 
     virtual void set_power_mode(MirPowerMode mode) = 0;
     virtual void set_gamma(GammaCurves const& gamma) = 0;
+    /**
+     * Let the display vary its refresh rate to match the rate we flip at.
+     *
+     * Has no effect if the connector or CRTC doesn't support variable refresh.
+     */
+    virtual void set_vrr_enabled(bool enabled) = 0;
+    /// Whether the CRTC is currently driven with a variable refresh rate
+    virtual bool vrr_enabled() const = 0;
     virtual Frame last_frame() const = 0;
 
     /**
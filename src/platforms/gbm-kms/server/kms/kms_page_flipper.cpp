@@ -17,16 +17,24 @@
  */
 
 #include "kms_page_flipper.h"
+#include "atomic_page_flip.h"
 #include "mir/graphics/display_report.h"
+#include "mir/log.h"
+#include "mir/signal_blocker.h"
+#include "mir/thread_name.h"
 
 #include <stdexcept>
+#include <system_error>
 #include <boost/throw_exception.hpp>
 #include <boost/exception/errinfo_errno.hpp>
 
 #include <xf86drm.h>
 #include <xf86drmMode.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 #include <chrono>
 #include <cstring>
+#include <cstdlib>
 
 namespace mg = mir::graphics;
 namespace mgg = mir::graphics::gbm;
@@ -44,6 +52,39 @@ void page_flip_handler(int /*fd*/, unsigned int seq,
                                               seq, ns);
 }
 
+void page_flip_handler2(int /*fd*/, unsigned int seq,
+                        unsigned int sec, unsigned int usec,
+                        unsigned int crtc_id, void* data)
+{
+    auto page_flip_data = static_cast<mgg::PageFlipEventData*>(data);
+    std::chrono::nanoseconds ns{sec*1000000000LL + usec*1000LL};
+    // An atomic commit's events all carry the same data; only the kernel knows the CRTC
+    page_flip_data->flipper->notify_page_flip(crtc_id ? crtc_id : page_flip_data->crtc_id,
+                                              seq, ns);
+}
+
+bool enable_atomic(int drm_fd)
+{
+    if (getenv("MIR_GBM_KMS_DISABLE_ATOMIC"))
+        return false;
+
+    /*
+     * We can't tell which CRTC an atomic commit's page-flip event is for
+     * unless the kernel tells us.
+     */
+    uint64_t crtc_in_event = 0;
+    if (drmGetCap(drm_fd, DRM_CAP_CRTC_IN_VBLANK_EVENT, &crtc_in_event) || !crtc_in_event)
+        return false;
+
+    return drmSetClientCap(drm_fd, DRM_CLIENT_CAP_ATOMIC, 1) == 0;
+}
+
+bool supports_async_flips(int drm_fd)
+{
+    uint64_t async = 0;
+    return drmGetCap(drm_fd, DRM_CAP_ASYNC_PAGE_FLIP, &async) == 0 && async;
+}
+
 }
 
 mgg::KMSPageFlipper::KMSPageFlipper(
@@ -52,18 +93,63 @@ mgg::KMSPageFlipper::KMSPageFlipper(
     drm_fd{drm_fd},
     report{report},
     pending_page_flips(),
-    worker_tid()
+    atomic{enable_atomic(drm_fd)},
+    async_flips{supports_async_flips(drm_fd)},
+    atomic_event_data{0, 0, this},
+    shutdown_signal{::eventfd(0, EFD_CLOEXEC)}
 {
     uint64_t mono = 0;
     if (drmGetCap(drm_fd, DRM_CAP_TIMESTAMP_MONOTONIC, &mono) || !mono)
         clock_id = CLOCK_REALTIME;
     else
         clock_id = CLOCK_MONOTONIC;
+
+    if (atomic)
+        mir::log_info("Using atomic modesetting for page flips");
+
+    if (shutdown_signal < 0)
+    {
+        BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to create DRM event thread shutdown signal"}));
+    }
+
+    mir::SignalBlocker blocker;
+    event_thread = std::thread{[this] { event_loop(); }};
+}
+
+mgg::KMSPageFlipper::~KMSPageFlipper()
+{
+    {
+        std::lock_guard<std::mutex> lock{pf_mutex};
+        shutdown = true;
+    }
+    flips_scheduled.notify_all();
+    eventfd_write(shutdown_signal, 1);
+
+    if (event_thread.joinable())
+        event_thread.join();
 }
 
 bool mgg::KMSPageFlipper::schedule_flip(uint32_t crtc_id,
                                         uint32_t fb_id,
                                         uint32_t connector_id)
+{
+    return queue_flip(crtc_id, fb_id, connector_id, DRM_MODE_PAGE_FLIP_EVENT);
+}
+
+bool mgg::KMSPageFlipper::schedule_async_flip(uint32_t crtc_id,
+                                              uint32_t fb_id,
+                                              uint32_t connector_id)
+{
+    if (!async_flips)
+        return false;
+
+    return queue_flip(crtc_id, fb_id, connector_id, DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_PAGE_FLIP_ASYNC);
+}
+
+bool mgg::KMSPageFlipper::queue_flip(uint32_t crtc_id,
+                                     uint32_t fb_id,
+                                     uint32_t connector_id,
+                                     uint32_t flags)
 {
     std::unique_lock<std::mutex> lock{pf_mutex};
 
@@ -79,94 +165,133 @@ bool mgg::KMSPageFlipper::schedule_flip(uint32_t crtc_id,
      * apparently valid.
      */
     auto ret = drmModePageFlip(drm_fd, crtc_id, fb_id,
-                               DRM_MODE_PAGE_FLIP_EVENT,
+                               flags,
                                &pending_page_flips[crtc_id]);
 
     if (ret)
         pending_page_flips.erase(crtc_id);
+    else
+        flips_scheduled.notify_all();
 
     return (ret == 0);
 }
 
-mg::Frame mgg::KMSPageFlipper::wait_for_flip(uint32_t crtc_id)
+bool mgg::KMSPageFlipper::schedule_atomic_flip(AtomicPageFlip& flip)
 {
-    drmEventContext evctx;
-    memset(&evctx, 0, sizeof evctx);
-    evctx.version = 2;  // We only support the old v2 page_flip_handler
-    evctx.page_flip_handler = &page_flip_handler;
+    if (!atomic)
+        return false;
 
-    static std::thread::id const invalid_tid;
+    // Every output is powered off, so there's nothing to flip
+    if (flip.flips().empty())
+        return true;
 
+    std::unique_lock<std::mutex> lock{pf_mutex};
+
+    for (auto const& pending : flip.flips())
     {
-        std::unique_lock<std::mutex> lock{pf_mutex};
+        if (pending_page_flips.find(pending.crtc_id) != pending_page_flips.end())
+            BOOST_THROW_EXCEPTION(std::logic_error("Page flip for crtc_id is already scheduled"));
+    }
 
-        /*
-         * While another thread is the worker (it is controlling the
-         * page flip event loop) and our event has not arrived, wait.
-         */
-        while (worker_tid != invalid_tid && !page_flip_is_done(crtc_id))
-            pf_cv.wait(lock);
+    if (auto const ret = drmModeAtomicCommit(drm_fd, flip.request(), DRM_MODE_ATOMIC_TEST_ONLY, nullptr))
+    {
+        mir::log_debug("Atomic page flip failed TEST_ONLY check (%s); using legacy page flip", strerror(-ret));
+        return false;
+    }
+
+    for (auto const& pending : flip.flips())
+        pending_page_flips[pending.crtc_id] = PageFlipEventData{pending.crtc_id, pending.connector_id, this};
 
-        /* If the page flip we are waiting for has arrived we are done. */
-        if (page_flip_is_done(crtc_id))
-            return completed_page_flips[crtc_id];
+    auto const ret = drmModeAtomicCommit(
+        drm_fd,
+        flip.request(),
+        DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT,
+        &atomic_event_data);
+
+    if (ret)
+    {
+        for (auto const& pending : flip.flips())
+            pending_page_flips.erase(pending.crtc_id);
 
-        /* ...otherwise we become the worker */
-        worker_tid = std::this_thread::get_id();
+        mir::log_debug("Atomic page flip failed (%s); using legacy page flip", strerror(-ret));
+        return false;
     }
 
-    /* Only the worker thread reaches this point */
-    bool done{false};
+    flips_scheduled.notify_all();
+    lock.unlock();
+    flip.committed();
+    return true;
+}
 
-    while (!done)
-    {
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(drm_fd, &fds);
+mg::Frame mgg::KMSPageFlipper::wait_for_flip(uint32_t crtc_id)
+{
+    std::unique_lock<std::mutex> lock{pf_mutex};
 
-        /*
-         * Wait for a page flip event. When we get a page flip event,
-         * page_flip_handler(), called through drmHandleEvent(), will update
-         * the pending_page_flips map.
-         */
-        auto ret = select(drm_fd + 1, &fds, nullptr, nullptr, nullptr);
+    flip_done[crtc_id].wait(
+        lock,
+        [this, crtc_id]() { return page_flip_is_done(crtc_id) || event_error; });
 
-        {
-            std::unique_lock<std::mutex> lock{pf_mutex};
-
-            if (ret > 0)
-            {
-                drmHandleEvent(drm_fd, &evctx);
-            }
-            else if (ret < 0 && errno != EINTR)
-            {
-                std::string const msg("Error while waiting for page-flip event");
-                BOOST_THROW_EXCEPTION(
-                    boost::enable_error_info(
-                        std::runtime_error(msg)) << boost::errinfo_errno(errno));
-            }
-
-            done = page_flip_is_done(crtc_id);
-            /* Give up loop control if we are done */
-            if (done)
-                worker_tid = invalid_tid;
-        }
+    if (!page_flip_is_done(crtc_id))
+        std::rethrow_exception(event_error);
 
-        /*
-         * Wake up other (non-worker) threads, so they can check whether
-         * their page-flip events have arrived, or whether they can become
-         * the worker (see pf_cv.wait(lock) above).
-         */
-        pf_cv.notify_all();
-    }
     return completed_page_flips[crtc_id];
 }
 
-std::thread::id mgg::KMSPageFlipper::debug_get_worker_tid()
+void mgg::KMSPageFlipper::event_loop() noexcept
 {
+    mir::set_thread_name("Mir/DRM events");
+
+    drmEventContext evctx;
+    memset(&evctx, 0, sizeof evctx);
+    evctx.version = 3;
+    evctx.page_flip_handler = &page_flip_handler;
+    evctx.page_flip_handler2 = &page_flip_handler2;
+
     std::unique_lock<std::mutex> lock{pf_mutex};
+    while (!shutdown)
+    {
+        // No events are due until a flip is scheduled
+        flips_scheduled.wait(
+            lock,
+            [this]() { return shutdown || !pending_page_flips.empty(); });
+        if (shutdown)
+            break;
 
-    return worker_tid;
+        /*
+         * Drop the lock while we wait, so more flips can be scheduled. When
+         * we get a page flip event, page_flip_handler(), called through
+         * drmHandleEvent(), will update the pending_page_flips map and wake
+         * whoever is waiting for that CRTC.
+         */
+        lock.unlock();
+
+        pollfd fds[] = {
+            {drm_fd, POLLIN, 0},
+            {shutdown_signal, POLLIN, 0}};
+        auto const ret = poll(fds, 2, -1);
+        auto const poll_errno = errno;
+
+        lock.lock();
+        if (shutdown || (ret < 0 && poll_errno == EINTR))
+            continue;
+
+        if (ret < 0 || (fds[0].revents & (POLLERR | POLLNVAL)))
+        {
+            auto const error = ret < 0 ? poll_errno : (fds[0].revents & POLLNVAL) ? EBADF : EIO;
+            std::string const msg("Error while waiting for page-flip event");
+            event_error = std::make_exception_ptr(
+                boost::enable_error_info(
+                    std::runtime_error(msg)) << boost::errinfo_errno(error));
+
+            // No more flips will complete; release everyone waiting for one
+            for (auto& waiting : flip_done)
+                waiting.second.notify_all();
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+            drmHandleEvent(drm_fd, &evctx);
+    }
 }
 
 /* This method should be called with the 'pf_mutex' locked */
@@ -186,5 +311,6 @@ void mgg::KMSPageFlipper::notify_page_flip(uint32_t crtc_id, int64_t msc,
         frame.ust = {clock_id, ust};
         report->report_vsync(pending->second.connector_id, frame);
         pending_page_flips.erase(pending);
+        flip_done[crtc_id].notify_all();
     }
 }
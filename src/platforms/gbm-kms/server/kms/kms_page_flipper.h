@@ -20,12 +20,14 @@
 #define MIR_GRAPHICS_GBM_KMS_PAGE_FLIPPER_H_
 
 #include "page_flipper.h"
+#include "mir/fd.h"
 
 #include <unordered_map>
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <exception>
 #include <ctime>
 #include <sys/time.h>
 
@@ -51,24 +53,41 @@ class KMSPageFlipper : public PageFlipper
 {
 public:
     KMSPageFlipper(int drm_fd, std::shared_ptr<DisplayReport> const& report);
+    ~KMSPageFlipper() override;
 
     bool schedule_flip(uint32_t crtc_id, uint32_t fb_id, uint32_t connector_id) override;
+    bool schedule_async_flip(uint32_t crtc_id, uint32_t fb_id, uint32_t connector_id) override;
     Frame wait_for_flip(uint32_t crtc_id) override;
-
-    std::thread::id debug_get_worker_tid();
+    bool schedule_atomic_flip(AtomicPageFlip& flip) override;
 
     void notify_page_flip(uint32_t crtc_id, int64_t msc, std::chrono::nanoseconds ust);
 private:
     bool page_flip_is_done(uint32_t crtc_id);
+    bool queue_flip(uint32_t crtc_id, uint32_t fb_id, uint32_t connector_id, uint32_t flags);
+    void event_loop() noexcept;
 
     int const drm_fd;
     std::shared_ptr<DisplayReport> const report;
     std::unordered_map<uint32_t,PageFlipEventData> pending_page_flips;
     std::unordered_map<uint32_t,Frame> completed_page_flips;
     std::mutex pf_mutex;
-    std::condition_variable pf_cv;
-    std::thread::id worker_tid;
+    /// Signalled when the pending flip of each CRTC completes, so only its waiter wakes
+    std::unordered_map<uint32_t,std::condition_variable> flip_done;
+    std::condition_variable flips_scheduled;
     clockid_t clock_id;
+    /// Whether we drive this device with atomic commits (where the outputs can)
+    bool const atomic;
+    /// Whether the device can flip without waiting for vblank (DRM_CAP_ASYNC_PAGE_FLIP)
+    bool const async_flips;
+    /// Event data for atomic commits; the kernel tells us which CRTC each event is for
+    PageFlipEventData atomic_event_data;
+
+    /// Why the event thread stopped, for anyone still waiting on a flip
+    std::exception_ptr event_error;
+    bool shutdown{false};
+    mir::Fd const shutdown_signal;
+    /// Reads this device's DRM events as soon as they arrive
+    std::thread event_thread;
 };
 
 }
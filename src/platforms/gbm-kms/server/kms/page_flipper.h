@@ -29,14 +29,36 @@ namespace graphics
 namespace gbm
 {
 
+class AtomicPageFlip;
+
 class PageFlipper
 {
 public:
     virtual ~PageFlipper() {}
 
     virtual bool schedule_flip(uint32_t crtc_id, uint32_t fb_id, uint32_t connector_id) = 0;
+    /**
+     * Flip as soon as possible rather than at the next vblank, accepting tearing
+     *
+     * \return  false, having changed nothing, if the device doesn't support
+     *          asynchronous flips or rejects this one; the caller should fall
+     *          back to schedule_flip().
+     */
+    virtual bool schedule_async_flip(uint32_t crtc_id, uint32_t fb_id, uint32_t connector_id) = 0;
     virtual Frame wait_for_flip(uint32_t crtc_id) = 0;
 
+    /**
+     * Commit the page flips of several CRTCs in a single atomic request
+     *
+     * The request is checked with a TEST_ONLY commit before being committed
+     * without blocking. Wait for each of its flips with wait_for_flip().
+     *
+     * \return  false, having changed nothing, if the device doesn't support
+     *          atomic modesetting or rejects the request; the caller should
+     *          fall back to schedule_flip().
+     */
+    virtual bool schedule_atomic_flip(AtomicPageFlip& flip) = 0;
+
 protected:
     PageFlipper() = default;
     PageFlipper(PageFlipper const&) = delete;
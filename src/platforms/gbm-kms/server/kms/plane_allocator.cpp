@@ -0,0 +1,245 @@
+/*
+ * Copyright © 2021 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "plane_allocator.h"
+#include "atomic_page_flip.h"
+#include "kms-utils/drm_mode_resources.h"
+#include "mir/log.h"
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#include <algorithm>
+#include <cstring>
+
+namespace mgg = mir::graphics::gbm;
+namespace mgk = mir::graphics::kms;
+
+mgg::PlaneAllocator::PlaneAllocator(int drm_fd, uint32_t crtc_id, int crtc_index)
+    : drm_fd{drm_fd},
+      crtc_id{crtc_id}
+{
+    mgk::PlaneResources plane_res{drm_fd};
+
+    for (auto& plane : plane_res.planes())
+    {
+        if (plane->possible_crtcs != (1u << crtc_index))
+            continue;
+
+        try
+        {
+            mgk::ObjectProperties props{drm_fd, plane->plane_id, DRM_MODE_OBJECT_PLANE};
+            if (props["type"] != DRM_PLANE_TYPE_OVERLAY)
+                continue;
+
+            planes.push_back(
+                Plane{
+                    plane->plane_id,
+                    props.id_for("FB_ID"),
+                    props.id_for("CRTC_ID"),
+                    props.id_for("SRC_X"),
+                    props.id_for("SRC_Y"),
+                    props.id_for("SRC_W"),
+                    props.id_for("SRC_H"),
+                    props.id_for("CRTC_X"),
+                    props.id_for("CRTC_Y"),
+                    props.id_for("CRTC_W"),
+                    props.id_for("CRTC_H")});
+        }
+        catch (std::exception const& e)
+        {
+            mir::log_debug("Not using plane %u for overlays: %s", plane->plane_id, e.what());
+        }
+    }
+
+    assigned.resize(planes.size());
+    enabled.resize(planes.size(), false);
+
+    mir::log_debug("Found %zu overlay planes for CRTC %u", planes.size(), crtc_id);
+}
+
+auto mgg::PlaneAllocator::plane_count() const -> size_t
+{
+    return planes.size();
+}
+
+auto mgg::PlaneAllocator::assign(
+    std::function<void(AtomicPageFlip&)> const& add_primary,
+    std::vector<Layer> const& candidates) -> std::vector<bool>
+{
+    std::vector<bool> accepted(candidates.size(), false);
+    Assignment assignment(planes.size());
+
+    auto const same_layout = std::equal(
+        candidates.begin(), candidates.end(),
+        previous.begin(), previous.end(),
+        [](Layer const& layer, Candidate const& candidate)
+        {
+            return layer.buffer_size == candidate.buffer_size && layer.destination == candidate.destination;
+        });
+
+    if (same_layout)
+    {
+        // Nothing has moved since the last frame, so the planes that took these
+        // candidates then will most likely take their new buffers too
+        bool any_reused{false};
+        for (auto i = 0u; i != candidates.size(); ++i)
+        {
+            if (auto const plane = previous[i].plane)
+            {
+                assignment[*plane] = candidates[i];
+                accepted[i] = true;
+                any_reused = true;
+            }
+        }
+
+        if (any_reused && !test(add_primary, assignment))
+        {
+            // Something about the new buffers has changed; start again from scratch
+            assignment = Assignment(planes.size());
+            accepted.assign(candidates.size(), false);
+            for (auto& candidate : previous)
+            {
+                candidate.plane.reset();
+                candidate.rejected_fbs.clear();
+            }
+        }
+    }
+    else
+    {
+        previous.clear();
+        for (auto const& layer : candidates)
+        {
+            previous.push_back(Candidate{layer.buffer_size, layer.destination, std::nullopt, {}});
+        }
+    }
+
+    auto free_planes = std::count(assignment.begin(), assignment.end(), std::nullopt);
+
+    for (auto i = 0u; i != candidates.size() && free_planes; ++i)
+    {
+        auto& candidate = previous[i];
+        auto& rejected = candidate.rejected_fbs;
+
+        if (accepted[i] ||
+            std::find(rejected.begin(), rejected.end(), candidates[i].fb_id) != rejected.end())
+        {
+            continue;
+        }
+
+        for (auto p = 0u; p != planes.size(); ++p)
+        {
+            if (assignment[p])
+                continue;
+
+            auto trial = assignment;
+            trial[p] = candidates[i];
+
+            // Planes differ in the formats and scaling they support, so try the next
+            if (test(add_primary, trial))
+            {
+                assignment = std::move(trial);
+                accepted[i] = true;
+                candidate.plane = p;
+                --free_planes;
+                break;
+            }
+        }
+
+        if (!accepted[i])
+        {
+            // Clients cycle through a handful of buffers; don't keep trying any of them
+            if (rejected.size() == max_rejected_fbs)
+                rejected.clear();
+            rejected.push_back(candidates[i].fb_id);
+        }
+    }
+
+    assigned = std::move(assignment);
+    return accepted;
+}
+
+void mgg::PlaneAllocator::add_to(AtomicPageFlip& flip)
+{
+    add_assignment(flip, assigned);
+
+    std::vector<bool> now_enabled(planes.size());
+    for (auto p = 0u; p != planes.size(); ++p)
+        now_enabled[p] = static_cast<bool>(assigned[p]);
+
+    flip.on_commit([this, now_enabled]() { enabled = now_enabled; });
+
+    assigned = Assignment(planes.size());
+}
+
+void mgg::PlaneAllocator::disable_legacy()
+{
+    for (auto p = 0u; p != planes.size(); ++p)
+    {
+        if (enabled[p])
+        {
+            if (auto const ret = drmModeSetPlane(drm_fd, planes[p].id, crtc_id, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0))
+            {
+                mir::log_warning("Failed to disable overlay plane %u: %s", planes[p].id, strerror(-ret));
+            }
+            enabled[p] = false;
+        }
+    }
+
+    assigned = Assignment(planes.size());
+    previous.clear();
+}
+
+auto mgg::PlaneAllocator::test(
+    std::function<void(AtomicPageFlip&)> const& add_primary,
+    Assignment const& assignment) const -> bool
+{
+    AtomicPageFlip test;
+    add_primary(test);
+    add_assignment(test, assignment);
+
+    return drmModeAtomicCommit(drm_fd, test.request(), DRM_MODE_ATOMIC_TEST_ONLY, nullptr) == 0;
+}
+
+void mgg::PlaneAllocator::add_assignment(AtomicPageFlip& flip, Assignment const& assignment) const
+{
+    for (auto p = 0u; p != planes.size(); ++p)
+    {
+        auto const& plane = planes[p];
+
+        if (auto const& layer = assignment[p])
+        {
+            auto const& dest = layer->destination;
+
+            flip.add_property(plane.id, plane.fb_id, layer->fb_id);
+            flip.add_property(plane.id, plane.crtc_id, crtc_id);
+            // Source coordinates are 16.16 fixed point
+            flip.add_property(plane.id, plane.src_x, 0);
+            flip.add_property(plane.id, plane.src_y, 0);
+            flip.add_property(plane.id, plane.src_w, uint64_t(layer->buffer_size.width.as_int()) << 16);
+            flip.add_property(plane.id, plane.src_h, uint64_t(layer->buffer_size.height.as_int()) << 16);
+            flip.add_property(plane.id, plane.crtc_x, dest.top_left.x.as_int());
+            flip.add_property(plane.id, plane.crtc_y, dest.top_left.y.as_int());
+            flip.add_property(plane.id, plane.crtc_w, dest.size.width.as_int());
+            flip.add_property(plane.id, plane.crtc_h, dest.size.height.as_int());
+        }
+        else if (enabled[p])
+        {
+            flip.add_property(plane.id, plane.fb_id, 0);
+            flip.add_property(plane.id, plane.crtc_id, 0);
+        }
+    }
+}
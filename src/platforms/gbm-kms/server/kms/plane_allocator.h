@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2021 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MIR_GRAPHICS_GBM_PLANE_ALLOCATOR_H_
+#define MIR_GRAPHICS_GBM_PLANE_ALLOCATOR_H_
+
+#include "mir/geometry/rectangle.h"
+
+#include <functional>
+#include <optional>
+#include <vector>
+#include <cstdint>
+
+namespace mir
+{
+namespace graphics
+{
+namespace gbm
+{
+
+class AtomicPageFlip;
+
+/**
+ * Assigns layers to the overlay planes of one CRTC
+ *
+ * Only planes that can't be used by any other CRTC are considered, so
+ * outputs never compete for a plane.
+ */
+class PlaneAllocator
+{
+public:
+    struct Layer
+    {
+        uint32_t fb_id;
+        geometry::Size buffer_size;
+        geometry::Rectangle destination;
+    };
+
+    PlaneAllocator(int drm_fd, uint32_t crtc_id, int crtc_index);
+
+    auto plane_count() const -> size_t;
+
+    /**
+     * Assign as many candidates as possible to planes for the next flip.
+     *
+     * If the candidates have the same sizes and destinations as last time
+     * the planes they had then are re-tested together with a single
+     * TEST_ONLY commit. Otherwise (or if that fails) each candidate is tried
+     * on each free plane in turn, skipping buffers that no plane would take
+     * while the layout was unchanged.
+     *
+     * \param [in] add_primary  Adds the properties for the primary plane's
+     *                          next frame to a flip, so that's tested too
+     * \return  For each candidate, whether it was assigned a plane
+     */
+    auto assign(
+        std::function<void(AtomicPageFlip&)> const& add_primary,
+        std::vector<Layer> const& candidates) -> std::vector<bool>;
+
+    /// Show the assigned layers with flip (disabling planes no longer needed) and forget them
+    void add_to(AtomicPageFlip& flip);
+
+    /// Disable, without an atomic commit, any planes left showing by earlier flips
+    void disable_legacy();
+
+private:
+    struct Plane
+    {
+        uint32_t id;
+        uint32_t fb_id;
+        uint32_t crtc_id;
+        uint32_t src_x, src_y, src_w, src_h;
+        uint32_t crtc_x, crtc_y, crtc_w, crtc_h;
+    };
+    typedef std::vector<std::optional<Layer>> Assignment;
+
+    /// What the last assign() learnt about a candidate
+    struct Candidate
+    {
+        geometry::Size buffer_size;
+        geometry::Rectangle destination;
+        /// The plane it was given, if any
+        std::optional<size_t> plane;
+        /// Framebuffers that no free plane would take
+        std::vector<uint32_t> rejected_fbs;
+    };
+    static size_t const max_rejected_fbs = 8;
+
+    auto test(std::function<void(AtomicPageFlip&)> const& add_primary, Assignment const& assignment) const -> bool;
+    void add_assignment(AtomicPageFlip& flip, Assignment const& assignment) const;
+
+    int const drm_fd;
+    uint32_t const crtc_id;
+    std::vector<Plane> planes;
+    Assignment assigned;
+    std::vector<Candidate> previous;
+    /// Whether each plane was left showing a layer by the last committed flip
+    std::vector<bool> enabled;
+};
+
+}
+}
+}
+
+#endif /* MIR_GRAPHICS_GBM_PLANE_ALLOCATOR_H_ */
@@ -53,7 +53,14 @@ mgg::Platform::Platform(std::shared_ptr<DisplayReport> const& listener,
 mir::UniqueModulePtr<mg::GraphicBufferAllocator> mgg::RenderingPlatform::create_buffer_allocator(
     mg::Display const& output)
 {
-    return make_module_ptr<mgg::BufferAllocator>(output);
+    // Query the planes through the DRM device the display already holds, rather than reopening it
+    std::vector<mg::DRMFormatModifier> scanout_formats;
+    if (auto const display = dynamic_cast<mgg::Display const*>(&output))
+    {
+        scanout_formats = scanout_formats_for(display->render_drm_fd());
+    }
+
+    return make_module_ptr<mgg::BufferAllocator>(output, std::move(scanout_formats));
 }
 
 mir::UniqueModulePtr<mg::Display> mgg::Platform::create_display(
@@ -19,12 +19,15 @@
 #include "real_kms_output.h"
 #include "mir/graphics/display_configuration.h"
 #include "page_flipper.h"
+#include "atomic_page_flip.h"
+#include "plane_allocator.h"
 #include "kms-utils/kms_connector.h"
 #include "mir/fatal.h"
 #include "mir/log.h"
 #include <string.h> // strcmp
 
 #include <boost/throw_exception.hpp>
+#include <algorithm>
 #include <system_error>
 #include <xf86drm.h>
 
@@ -70,7 +73,8 @@ mgg::RealKMSOutput::RealKMSOutput(
       saved_crtc(),
       using_saved_crtc{true},
       has_cursor_{false},
-      power_mode(mir_power_mode_on)
+      power_mode(mir_power_mode_on),
+      flipped_atomically{false}
 {
     reset();
 
@@ -169,6 +173,13 @@ bool mgg::RealKMSOutput::set_crtc(FBHandle const& fb)
         return false;
     }
 
+    if (overlay_planes)
+    {
+        std::lock_guard<std::mutex> lock{atomic_mutex};
+        if (atomic_properties && atomic_properties->crtc_id == current_crtc->crtc_id)
+            overlay_planes->disable_legacy();
+    }
+
     using_saved_crtc = false;
     return true;
 }
@@ -219,6 +230,16 @@ void mgg::RealKMSOutput::clear_crtc()
 }
 
 bool mgg::RealKMSOutput::schedule_page_flip(FBHandle const& fb)
+{
+    return schedule_legacy_flip(fb, false);
+}
+
+bool mgg::RealKMSOutput::schedule_async_page_flip(FBHandle const& fb)
+{
+    return schedule_legacy_flip(fb, true);
+}
+
+bool mgg::RealKMSOutput::schedule_legacy_flip(FBHandle const& fb, bool async)
 {
     std::unique_lock<std::mutex> lg(power_mutex);
     if (power_mode != mir_power_mode_on)
@@ -229,12 +250,298 @@ bool mgg::RealKMSOutput::schedule_page_flip(FBHandle const& fb)
                        mgk::connector_name(connector).c_str());
         return false;
     }
+
+    // Overlays can only be shown by atomic flips; don't leave stale ones on screen
+    if (overlay_planes)
+        overlay_planes->disable_legacy();
+
+    {
+        std::lock_guard<std::mutex> lock{atomic_mutex};
+        flipped_atomically = false;
+        // Gamma staged for an atomic commit that didn't happen
+        if (pending_gamma)
+        {
+            set_legacy_gamma(*pending_gamma);
+            pending_gamma = nullptr;
+        }
+    }
+
+    if (async)
+    {
+        return page_flipper->schedule_async_flip(
+            current_crtc->crtc_id,
+            fb.get_drm_fb_id(),
+            connector->connector_id);
+    }
+
     return page_flipper->schedule_flip(
         current_crtc->crtc_id,
         fb.get_drm_fb_id(),
         connector->connector_id);
 }
 
+namespace
+{
+auto atomic_properties_for_crtc(int drm_fd, uint32_t crtc_id)
+{
+    mgk::DRMModeResources resources{drm_fd};
+
+    int crtc_index{-1};
+    int index{0};
+    for (auto& crtc : resources.crtcs())
+    {
+        if (crtc->crtc_id == crtc_id)
+        {
+            crtc_index = index;
+            break;
+        }
+        ++index;
+    }
+    if (crtc_index < 0)
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error{"Failed to find index of CRTC"});
+    }
+
+    mgk::PlaneResources plane_res{drm_fd};
+
+    auto const is_primary = [drm_fd](auto const& plane)
+        {
+            mgk::ObjectProperties plane_props{drm_fd, plane->plane_id, DRM_MODE_OBJECT_PLANE};
+            return plane_props["type"] == DRM_PLANE_TYPE_PRIMARY;
+        };
+
+    /* Several CRTCs' primary planes may be able to drive this one, so prefer
+     * the plane already bound to it; only if there is none take any that can.
+     */
+    std::optional<uint32_t> primary_plane;
+    for (auto& plane : plane_res.planes())
+    {
+        if (plane->crtc_id == crtc_id && is_primary(plane))
+        {
+            primary_plane = plane->plane_id;
+            break;
+        }
+    }
+    if (!primary_plane)
+    {
+        for (auto& plane : plane_res.planes())
+        {
+            if ((plane->possible_crtcs & (1 << crtc_index)) && is_primary(plane))
+            {
+                primary_plane = plane->plane_id;
+                break;
+            }
+        }
+    }
+    if (!primary_plane)
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error{"Could not find primary plane for CRTC"});
+    }
+
+    mgk::ObjectProperties plane_props{drm_fd, *primary_plane, DRM_MODE_OBJECT_PLANE};
+    mgk::ObjectProperties crtc_props{drm_fd, crtc_id, DRM_MODE_OBJECT_CRTC};
+
+    // The kernel rejects a GAMMA_LUT blob of any size but GAMMA_LUT_SIZE
+    bool const has_gamma_lut{crtc_props.has_property("GAMMA_LUT") && crtc_props.has_property("GAMMA_LUT_SIZE")};
+
+    return std::make_tuple(
+        crtc_index,
+        *primary_plane,
+        plane_props.id_for("FB_ID"),
+        has_gamma_lut ? crtc_props.id_for("GAMMA_LUT") : 0u,
+        has_gamma_lut ? static_cast<uint32_t>(crtc_props["GAMMA_LUT_SIZE"]) : 0u);
+}
+
+/// Linearly interpolate curve to size entries
+auto resample(std::vector<uint16_t> const& curve, size_t size) -> std::vector<uint16_t>
+{
+    if (curve.size() == size || curve.empty())
+        return curve;
+
+    std::vector<uint16_t> resampled(size);
+    for (auto i = 0u; i < size; ++i)
+    {
+        double const pos = size > 1 ? double(i) * (curve.size() - 1) / (size - 1) : 0.0;
+        auto const lower = static_cast<size_t>(pos);
+        auto const upper = std::min(lower + 1, curve.size() - 1);
+        double const frac = pos - lower;
+
+        resampled[i] = static_cast<uint16_t>(curve[lower] + (curve[upper] - curve[lower]) * frac + 0.5);
+    }
+    return resampled;
+}
+
+class GammaLUTBlob
+{
+public:
+    GammaLUTBlob(int drm_fd, mg::GammaCurves const& gamma, size_t lut_size)
+        : drm_fd{drm_fd},
+          id{create_blob(drm_fd, gamma, lut_size)}
+    {
+    }
+
+    ~GammaLUTBlob()
+    {
+        // The kernel holds its own reference to the blob once it's committed
+        drmModeDestroyPropertyBlob(drm_fd, id);
+    }
+
+    GammaLUTBlob(GammaLUTBlob const&) = delete;
+    GammaLUTBlob& operator=(GammaLUTBlob const&) = delete;
+
+    int const drm_fd;
+    uint32_t const id;
+
+private:
+    static auto create_blob(int drm_fd, mg::GammaCurves const& gamma, size_t lut_size) -> uint32_t
+    {
+        // The legacy gamma size the curves were made for needn't match the LUT's
+        auto const red = resample(gamma.red, lut_size);
+        auto const green = resample(gamma.green, lut_size);
+        auto const blue = resample(gamma.blue, lut_size);
+
+        std::vector<drm_color_lut> lut(lut_size);
+        for (auto i = 0u; i < lut.size(); ++i)
+        {
+            lut[i].red = red[i];
+            lut[i].green = green[i];
+            lut[i].blue = blue[i];
+            lut[i].reserved = 0;
+        }
+
+        uint32_t id{0};
+        if (auto const ret = drmModeCreatePropertyBlob(drm_fd, lut.data(), lut.size() * sizeof(lut[0]), &id))
+        {
+            BOOST_THROW_EXCEPTION((std::system_error{-ret, std::system_category(), "Failed to create GAMMA_LUT blob"}));
+        }
+        return id;
+    }
+};
+}
+
+bool mgg::RealKMSOutput::add_page_flip(AtomicPageFlip& flip, FBHandle const& fb)
+{
+    std::unique_lock<std::mutex> lg(power_mutex);
+    if (power_mode != mir_power_mode_on)
+        return true;
+    if (!current_crtc)
+        return false;
+
+    std::lock_guard<std::mutex> lock{atomic_mutex};
+    if (!atomic_properties || atomic_properties->crtc_id != current_crtc->crtc_id)
+    {
+        try
+        {
+            auto const [crtc_index, plane_id, plane_fb_id, crtc_gamma_lut, gamma_lut_size] =
+                atomic_properties_for_crtc(drm_fd_, current_crtc->crtc_id);
+            atomic_properties = AtomicProperties{
+                current_crtc->crtc_id, plane_id, plane_fb_id, crtc_gamma_lut, gamma_lut_size};
+            overlay_planes = std::make_unique<PlaneAllocator>(drm_fd_, current_crtc->crtc_id, crtc_index);
+        }
+        catch (std::exception const& e)
+        {
+            // Remember the failure so we don't repeat the lookup every frame
+            mir::log_debug("Output %s can't be flipped atomically: %s",
+                           mgk::connector_name(connector).c_str(), e.what());
+            atomic_properties = AtomicProperties{current_crtc->crtc_id, 0, 0, 0, 0};
+            overlay_planes = nullptr;
+        }
+    }
+    if (!atomic_properties->plane_id)
+        return false;
+
+    try
+    {
+        flip.add_property(atomic_properties->plane_id, atomic_properties->plane_fb_id, fb.get_drm_fb_id());
+        if (overlay_planes)
+            overlay_planes->add_to(flip);
+
+        std::shared_ptr<GammaLUTBlob> gamma_blob;
+        if (pending_gamma && atomic_properties->crtc_gamma_lut)
+        {
+            gamma_blob = std::make_shared<GammaLUTBlob>(drm_fd_, *pending_gamma, atomic_properties->gamma_lut_size);
+            flip.add_property(atomic_properties->crtc_id, atomic_properties->crtc_gamma_lut, gamma_blob->id);
+        }
+
+        // gamma_blob lives as long as the flip, so it outlasts the commit
+        flip.on_commit(
+            [this, gamma_blob, committed_gamma = gamma_blob ? pending_gamma : nullptr]()
+            {
+                std::lock_guard<std::mutex> lock{atomic_mutex};
+                flipped_atomically = true;
+                // set_gamma() may have staged newer curves since this flip was built
+                if (committed_gamma && pending_gamma == committed_gamma)
+                    pending_gamma = nullptr;
+            });
+    }
+    catch (std::exception const& e)
+    {
+        mir::log_debug("Failed to add output %s to atomic page flip: %s",
+                       mgk::connector_name(connector).c_str(), e.what());
+        return false;
+    }
+
+    flip.add_flip(current_crtc->crtc_id, connector->connector_id);
+    return true;
+}
+
+bool mgg::RealKMSOutput::commit_page_flips(AtomicPageFlip& flip)
+{
+    return page_flipper->schedule_atomic_flip(flip);
+}
+
+auto mgg::RealKMSOutput::assign_overlays(FBHandle const& fb, std::vector<OverlayLayer> const& candidates)
+    -> std::vector<bool>
+{
+    std::lock_guard<std::mutex> lg(power_mutex);
+
+    std::vector<bool> const none(candidates.size(), false);
+    if (power_mode != mir_power_mode_on || !current_crtc)
+        return none;
+
+    std::optional<AtomicProperties> atomic;
+    {
+        // Don't try overlays until atomic page flips are known to work
+        std::lock_guard<std::mutex> lock{atomic_mutex};
+        if (!flipped_atomically)
+            return none;
+        atomic = atomic_properties;
+    }
+
+    if (!overlay_planes || !overlay_planes->plane_count() ||
+        !atomic || atomic->crtc_id != current_crtc->crtc_id)
+    {
+        return none;
+    }
+
+    std::vector<PlaneAllocator::Layer> layers;
+    layers.reserve(candidates.size());
+    for (auto const& candidate : candidates)
+    {
+        layers.push_back(
+            PlaneAllocator::Layer{
+                candidate.fb->get_drm_fb_id(),
+                candidate.buffer_size,
+                candidate.destination});
+    }
+
+    try
+    {
+        return overlay_planes->assign(
+            [&atomic, &fb](AtomicPageFlip& flip)
+            {
+                flip.add_property(atomic->plane_id, atomic->plane_fb_id, fb.get_drm_fb_id());
+            },
+            layers);
+    }
+    catch (std::exception const& e)
+    {
+        mir::log_debug("Failed to assign overlay planes for output %s: %s",
+                       mgk::connector_name(connector).c_str(), e.what());
+        return none;
+    }
+}
+
 void mgg::RealKMSOutput::wait_for_page_flip()
 {
     std::unique_lock<std::mutex> lg(power_mutex);
@@ -254,6 +561,12 @@ mg::Frame mgg::RealKMSOutput::last_frame() const
     return last_frame_.load();
 }
 
+/*
+ * The cursor is still set with the legacy ioctls rather than going out in
+ * the AtomicPageFlip: the kernel applies legacy cursor updates to atomic
+ * CRTCs immediately, and moving it into the commit would tie cursor motion
+ * to the compositor's frame rate. Driving it atomically is left for later.
+ */
 bool mgg::RealKMSOutput::set_cursor(gbm_bo* buffer)
 {
     int result = 0;
@@ -370,6 +683,28 @@ void mgg::RealKMSOutput::set_gamma(mg::GammaCurves const& gamma)
             std::invalid_argument("set_gamma: mismatch gamma LUT sizes"));
     }
 
+    {
+        /*
+         * If we're driving this CRTC with atomic commits, send the gamma with
+         * the next frame rather than blocking on a commit of its own.
+         */
+        std::lock_guard<std::mutex> lock{atomic_mutex};
+        if (flipped_atomically &&
+            atomic_properties &&
+            atomic_properties->crtc_id == current_crtc->crtc_id &&
+            atomic_properties->crtc_gamma_lut &&
+            !gamma.red.empty())
+        {
+            pending_gamma = std::make_shared<GammaCurves const>(gamma);
+            return;
+        }
+    }
+
+    set_legacy_gamma(gamma);
+}
+
+void mgg::RealKMSOutput::set_legacy_gamma(mg::GammaCurves const& gamma)
+{
     int ret = drmModeCrtcSetGamma(
         drm_fd_,
         current_crtc->crtc_id,
@@ -385,6 +720,78 @@ void mgg::RealKMSOutput::set_gamma(mg::GammaCurves const& gamma)
     // TODO: return bool in future? Then do what with it?
 }
 
+namespace
+{
+bool vrr_capable_connector(int drm_fd, uint32_t connector_id)
+{
+    try
+    {
+        mgk::ObjectProperties connector_props{drm_fd, connector_id, DRM_MODE_OBJECT_CONNECTOR};
+        return connector_props.has_property("vrr_capable") && connector_props["vrr_capable"];
+    }
+    catch (std::exception const& e)
+    {
+        // The connector may have gone away under us (eg: mid-hotplug)
+        mir::log_debug("Failed to query variable refresh rate support of connector %u: %s", connector_id, e.what());
+        return false;
+    }
+}
+}
+
+void mgg::RealKMSOutput::set_vrr_enabled(bool enabled)
+{
+    if (!ensure_crtc())
+    {
+        mir::log_warning("Output %s has no associated CRTC to set variable refresh rate on",
+                         mgk::connector_name(connector).c_str());
+        return;
+    }
+
+    mgk::ObjectProperties crtc_props{drm_fd_, current_crtc->crtc_id, DRM_MODE_OBJECT_CRTC};
+
+    bool const supported{
+        vrr_capable_connector(drm_fd_, connector->connector_id) &&
+        crtc_props.has_property("VRR_ENABLED")};
+
+    if (!supported)
+    {
+        if (enabled)
+        {
+            mir::log_info("Output %s does not support variable refresh rate",
+                          mgk::connector_name(connector).c_str());
+        }
+        vrr_enabled_ = false;
+        return;
+    }
+
+    if (static_cast<bool>(crtc_props["VRR_ENABLED"]) != enabled)
+    {
+        auto const ret = drmModeObjectSetProperty(
+            drm_fd_,
+            current_crtc->crtc_id,
+            DRM_MODE_OBJECT_CRTC,
+            crtc_props.id_for("VRR_ENABLED"),
+            enabled);
+
+        if (ret)
+        {
+            mir::log_warning("Failed to %s variable refresh rate on output %s: %s",
+                             enabled ? "enable" : "disable",
+                             mgk::connector_name(connector).c_str(),
+                             strerror(-ret));
+            vrr_enabled_ = static_cast<bool>(crtc_props["VRR_ENABLED"]);
+            return;
+        }
+    }
+
+    vrr_enabled_ = enabled;
+}
+
+bool mgg::RealKMSOutput::vrr_enabled() const
+{
+    return vrr_enabled_;
+}
+
 void mgg::RealKMSOutput::refresh_hardware_state()
 {
     connector = kms::get_connector(drm_fd_, connector->connector_id);
@@ -550,11 +957,14 @@ void mgg::RealKMSOutput::update_from_hardware_state(
                                         mir_pixel_format_xrgb_8888};
 
     std::vector<uint8_t> edid;
+    bool vrr_capable{false};
     if (connected) {
         /* Only ask for the EDID on connected outputs. There's obviously no monitor EDID
          * when there is no monitor connected!
          */
         edid = edid_for_connector(drm_fd_, connector->connector_id);
+        // Likewise, whether refresh can vary depends on the monitor
+        vrr_capable = vrr_capable_connector(drm_fd_, connector->connector_id);
     }
 
     drmModeModeInfo current_mode_info = drmModeModeInfo();
@@ -611,6 +1021,7 @@ void mgg::RealKMSOutput::update_from_hardware_state(
     output.subpixel_arrangement = kms_subpixel_to_mir_subpixel(connector->subpixel);
     output.gamma = gamma;
     output.edid = edid;
+    output.vrr_capable = vrr_capable;
 }
 
 namespace
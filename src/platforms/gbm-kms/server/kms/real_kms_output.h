@@ -23,8 +23,10 @@
 #include "kms_output.h"
 #include "kms-utils/drm_mode_resources.h"
 
+#include <atomic>
 #include <memory>
 #include <mutex>
+#include <optional>
 
 namespace mir
 {
@@ -34,6 +36,7 @@ namespace gbm
 {
 
 class PageFlipper;
+class PlaneAllocator;
 
 class RealKMSOutput : public KMSOutput
 {
@@ -54,7 +57,12 @@ public:
     bool set_crtc(FBHandle const& fb) override;
     void clear_crtc() override;
     bool schedule_page_flip(FBHandle const& fb) override;
+    bool schedule_async_page_flip(FBHandle const& fb) override;
     void wait_for_page_flip() override;
+    bool add_page_flip(AtomicPageFlip& flip, FBHandle const& fb) override;
+    bool commit_page_flips(AtomicPageFlip& flip) override;
+    auto assign_overlays(FBHandle const& fb, std::vector<OverlayLayer> const& candidates)
+        -> std::vector<bool> override;
 
     bool set_cursor(gbm_bo* buffer) override;
     void move_cursor(geometry::Point destination) override;
@@ -63,6 +71,8 @@ public:
 
     void set_power_mode(MirPowerMode mode) override;
     void set_gamma(GammaCurves const& gamma) override;
+    void set_vrr_enabled(bool enabled) override;
+    bool vrr_enabled() const override;
 
     Frame last_frame() const override;
 
@@ -77,7 +87,9 @@ public:
 
 private:
     bool ensure_crtc();
+    bool schedule_legacy_flip(FBHandle const& fb, bool async);
     void restore_saved_crtc();
+    void set_legacy_gamma(GammaCurves const& gamma);
 
     int const drm_fd_;
     std::shared_ptr<PageFlipper> const page_flipper;
@@ -109,6 +121,28 @@ private:
     int dpms_enum_id;
 
     std::mutex power_mutex;
+    std::unique_ptr<PlaneAllocator> overlay_planes;
+
+    /* Guards the atomic commit state below */
+    std::mutex atomic_mutex;
+
+    /* The KMS objects and properties an atomic commit needs to flip current_crtc */
+    struct AtomicProperties
+    {
+        uint32_t crtc_id;
+        uint32_t plane_id;
+        uint32_t plane_fb_id;
+        uint32_t crtc_gamma_lut;    ///< 0 if the CRTC has no GAMMA_LUT
+        uint32_t gamma_lut_size;    ///< Entries the GAMMA_LUT blob must have
+    };
+    /// plane_id is 0 if current_crtc can't be driven atomically
+    std::optional<AtomicProperties> atomic_properties;
+
+    /* Gamma waiting to go out with the next atomic commit */
+    std::shared_ptr<GammaCurves const> pending_gamma;
+    bool flipped_atomically;
+
+    std::atomic<bool> vrr_enabled_{false};
 
     AtomicFrame last_frame_;
 };
@@ -85,7 +85,9 @@ mg::rpi::BufferAllocator::BufferAllocator(mir::graphics::Display const& output)
     : egl_extensions{std::make_shared<mg::EGLExtensions>()},
       ctx{context_for_output(output)},
       egl_executor{
-        std::make_shared<mg::common::EGLContextExecutor>(context_for_output(output))}
+        std::make_shared<mg::common::EGLContextExecutor>(
+            [&output]() { return context_for_output(output); },
+            mg::common::EGLContextExecutor::default_thread_count())}
 {
 }
 
@@ -100,6 +102,7 @@ namespace
 
 class DispmanxShmBuffer
     : public mg::common::ShmBuffer,
+      public mg::gl::UploadableTexture,
       public mir::renderer::software::ReadTransferableBuffer,
       public mir::renderer::software::WriteTransferableBuffer,
       public mg::rpi::DispmanXBuffer
@@ -178,6 +181,14 @@ public:
         upload_to_texture(pixels.get(), stride());
     }
 
+    void upload_to_bound_texture(std::optional<geom::Rectangles> const& damage) override
+    {
+        auto const pixels = std::make_unique<unsigned char[]>(stride().as_uint32_t() * size().height.as_uint32_t());
+        transfer_from_buffer(pixels.get());
+
+        upload_to_texture(pixels.get(), stride(), damage);
+    }
+
     explicit operator DISPMANX_RESOURCE_HANDLE_T() const override
     {
         return handle;
@@ -406,6 +417,7 @@ void mg::rpi::BufferAllocator::unbind_display(wl_display* display)
 
 std::shared_ptr<mg::Buffer> mg::rpi::BufferAllocator::buffer_from_resource(
     wl_resource* buffer,
+    wl_resource* /*surface*/,
     std::function<void()>&& on_consumed,
     std::function<void()>&& on_release)
 {
@@ -483,6 +495,18 @@ public:
         }
     }
 
+    void upload_to_bound_texture(std::optional<geom::Rectangles> const& damage) override
+    {
+        DispmanxShmBuffer::upload_to_bound_texture(damage);
+
+        std::lock_guard<std::mutex> lock{consumption_mutex};
+        if (on_consumed)
+        {
+            on_consumed();
+            on_consumed = nullptr;
+        }
+    }
+
 private:
     std::mutex consumption_mutex;
     std::function<void()> on_consumed;
@@ -492,6 +516,7 @@ private:
 auto mg::rpi::BufferAllocator::buffer_from_shm(
     wl_resource* buffer,
     std::shared_ptr<mir::Executor> /*wayland_executor*/,
+    std::optional<geometry::Rectangles> const& /*damage*/,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
 {
     auto shm_buffer = wl_shm_buffer_get(buffer);
@@ -70,10 +70,12 @@ public:
     void unbind_display(wl_display* display) override;
     std::shared_ptr<Buffer> buffer_from_resource(
         wl_resource* resource,
+        wl_resource* surface,
 	std::function<void()>&& ,
 	std::function<void()>&&) override;
 
     std::shared_ptr<Buffer> buffer_from_shm(wl_resource* buffer, std::shared_ptr<mir::Executor> wayland_executor,
+                                            std::optional<geometry::Rectangles> const& damage,
                                             std::function<void()>&& on_consumed) override;
 
 private:
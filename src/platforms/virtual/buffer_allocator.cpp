@@ -0,0 +1,81 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "buffer_allocator.h"
+#include "shm_buffer.h"
+#include "buffer_from_wl_shm.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <stdexcept>
+
+namespace mg = mir::graphics;
+namespace mgv = mg::virt;
+namespace mgc = mg::common;
+namespace geom = mir::geometry;
+
+/*
+ * The shm buffers below are given no EGLContextExecutor: that's only needed
+ * to upload them to (and clean up) GL textures, which never happens here.
+ */
+
+std::shared_ptr<mg::Buffer> mgv::BufferAllocator::alloc_software_buffer(geom::Size size, MirPixelFormat format)
+{
+    if (!mgc::ShmBuffer::supports(format))
+    {
+        BOOST_THROW_EXCEPTION(
+            std::runtime_error(
+                "Trying to create SHM buffer with unsupported pixel format"));
+    }
+
+    return std::make_shared<mgc::MemoryBackedShmBuffer>(size, format, nullptr);
+}
+
+std::vector<MirPixelFormat> mgv::BufferAllocator::supported_pixel_formats()
+{
+    return {mir_pixel_format_argb_8888, mir_pixel_format_xrgb_8888};
+}
+
+void mgv::BufferAllocator::bind_display(wl_display*, std::shared_ptr<Executor>)
+{
+}
+
+void mgv::BufferAllocator::unbind_display(wl_display*)
+{
+}
+
+std::shared_ptr<mg::Buffer> mgv::BufferAllocator::buffer_from_resource(
+    wl_resource*,
+    wl_resource*,
+    std::function<void()>&&,
+    std::function<void()>&&)
+{
+    BOOST_THROW_EXCEPTION(std::runtime_error("The virtual platform only supports shm buffers"));
+}
+
+auto mgv::BufferAllocator::buffer_from_shm(
+    wl_resource* buffer,
+    std::shared_ptr<Executor> wayland_executor,
+    std::optional<geometry::Rectangles> const& damage,
+    std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
+{
+    return mg::wayland::buffer_from_wl_shm(
+        buffer,
+        std::move(wayland_executor),
+        nullptr,
+        damage,
+        std::move(on_consumed));
+}
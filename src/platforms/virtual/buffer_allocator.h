@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_VIRTUAL_BUFFER_ALLOCATOR_H_
+#define MIR_GRAPHICS_VIRTUAL_BUFFER_ALLOCATOR_H_
+
+#include "mir/graphics/graphic_buffer_allocator.h"
+
+namespace mir
+{
+namespace graphics
+{
+namespace virt
+{
+
+/**
+ * Allocates buffers that live in ordinary memory.
+ *
+ * With no GPU, only shm client buffers are supported, and they're never
+ * uploaded to a texture: the software renderer reads them directly.
+ */
+class BufferAllocator : public GraphicBufferAllocator
+{
+public:
+    std::shared_ptr<Buffer> alloc_software_buffer(geometry::Size size, MirPixelFormat format) override;
+    std::vector<MirPixelFormat> supported_pixel_formats() override;
+
+    void bind_display(wl_display* display, std::shared_ptr<Executor> wayland_executor) override;
+    void unbind_display(wl_display* display) override;
+
+    std::shared_ptr<Buffer> buffer_from_resource(
+        wl_resource* buffer,
+        wl_resource* surface,
+        std::function<void()>&& on_consumed,
+        std::function<void()>&& on_release) override;
+
+    auto buffer_from_shm(
+        wl_resource* buffer,
+        std::shared_ptr<Executor> wayland_executor,
+        std::optional<geometry::Rectangles> const& damage,
+        std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer> override;
+};
+
+}
+}
+}
+
+#endif // MIR_GRAPHICS_VIRTUAL_BUFFER_ALLOCATOR_H_
@@ -0,0 +1,179 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "display.h"
+#include "display_buffer.h"
+#include "display_configuration.h"
+#include "platform.h"
+#include "mir/graphics/atomic_frame.h"
+#include "mir/graphics/display_configuration_policy.h"
+#include "mir/graphics/display_report.h"
+#include "mir/graphics/virtual_output.h"
+#include "mir/renderer/gl/context.h"
+
+#include <boost/throw_exception.hpp>
+
+#define MIR_LOG_COMPONENT "display"
+#include "mir/log.h"
+
+namespace mg = mir::graphics;
+namespace mgv = mg::virt;
+namespace geom = mir::geometry;
+
+namespace
+{
+// There's no real monitor, so pretend to be a typical 96 DPI one
+float const mm_per_pixel = 25.4f / 96;
+}
+
+mgv::Display::Display(
+    std::vector<OutputConfig> const& output_configs,
+    std::shared_ptr<DisplayConfigurationPolicy> const& initial_conf_policy,
+    std::shared_ptr<DisplayReport> const& report)
+    : report{report}
+{
+    geom::Point top_left{0, 0};
+    for (auto const& output_config : output_configs)
+    {
+        auto const size = output_config.size;
+        auto configuration = DisplayConfiguration::build_output(
+            mir_pixel_format_xrgb_8888,
+            size,
+            top_left,
+            geom::Size{int(size.width.as_int() * mm_per_pixel), int(size.height.as_int() * mm_per_pixel)},
+            output_config.refresh_rate);
+        auto last_frame = std::make_shared<AtomicFrame>();
+        auto display_buffer = std::make_unique<DisplayBuffer>(
+            configuration->id,
+            size,
+            configuration->extents(),
+            output_config.refresh_rate,
+            last_frame,
+            report);
+        top_left.x += as_delta(configuration->extents().size.width);
+        outputs.push_back({std::move(configuration), std::move(last_frame), std::move(display_buffer)});
+    }
+
+    auto const display_config = configuration();
+    initial_conf_policy->apply_to(*display_config);
+    configure(*display_config);
+    report->report_successful_display_construction();
+}
+
+mgv::Display::~Display() noexcept
+{
+}
+
+void mgv::Display::for_each_display_sync_group(std::function<void(mg::DisplaySyncGroup&)> const& f)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    for (auto const& output : outputs)
+    {
+        if (output.config->used && output.config->power_mode == mir_power_mode_on)
+            f(*output.display_buffer);
+    }
+}
+
+std::unique_ptr<mg::DisplayConfiguration> mgv::Display::configuration() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    std::vector<DisplayConfigurationOutput> output_configurations;
+    for (auto const& output : outputs)
+    {
+        output_configurations.push_back(*output.config);
+    }
+    return std::make_unique<mgv::DisplayConfiguration>(output_configurations);
+}
+
+void mgv::Display::configure(mg::DisplayConfiguration const& new_configuration)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (!new_configuration.valid())
+    {
+        BOOST_THROW_EXCEPTION(
+            std::logic_error("Invalid or inconsistent display configuration"));
+    }
+
+    new_configuration.for_each_output([&](DisplayConfigurationOutput const& conf_output)
+    {
+        for (auto& output : outputs)
+        {
+            if (output.config->id == conf_output.id)
+            {
+                *output.config = conf_output;
+                output.display_buffer->set_view_area(output.config->extents());
+                output.display_buffer->set_transformation(output.config->transformation());
+                return;
+            }
+        }
+
+        mir::log_error("Could not find info for output %d", conf_output.id.as_value());
+    });
+}
+
+bool mgv::Display::apply_if_configuration_preserves_display_buffers(
+    mg::DisplayConfiguration const& /*conf*/)
+{
+    return false;
+}
+
+void mgv::Display::register_configuration_change_handler(
+    EventHandlerRegister& /*handlers*/,
+    DisplayConfigurationChangeHandler const& /*conf_change_handler*/)
+{
+}
+
+void mgv::Display::register_pause_resume_handlers(
+    EventHandlerRegister& /*handlers*/,
+    DisplayPauseHandler const& /*pause_handler*/,
+    DisplayResumeHandler const& /*resume_handler*/)
+{
+}
+
+void mgv::Display::pause()
+{
+}
+
+void mgv::Display::resume()
+{
+}
+
+auto mgv::Display::create_hardware_cursor() -> std::shared_ptr<Cursor>
+{
+    return nullptr;
+}
+
+std::unique_ptr<mg::VirtualOutput> mgv::Display::create_virtual_output(int /*width*/, int /*height*/)
+{
+    return nullptr;
+}
+
+std::unique_ptr<mir::renderer::gl::Context> mgv::Display::create_gl_context() const
+{
+    BOOST_THROW_EXCEPTION(std::runtime_error("The virtual platform does not support GL"));
+}
+
+mg::Frame mgv::Display::last_frame_on(unsigned output_id) const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    for (auto const& output : outputs)
+    {
+        if (output.config->id.as_value() == static_cast<int>(output_id))
+            return output.last_frame->load();
+    }
+    return {};
+}
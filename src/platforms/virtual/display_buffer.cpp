@@ -0,0 +1,180 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "display_buffer.h"
+#include "mir/graphics/atomic_frame.h"
+#include "mir/graphics/display_report.h"
+
+#include <thread>
+
+namespace mg = mir::graphics;
+namespace mgv = mg::virt;
+namespace mrs = mir::renderer::software;
+namespace geom = mir::geometry;
+
+namespace
+{
+auto interval_for(double refresh_rate) -> std::optional<std::chrono::nanoseconds>
+{
+    if (refresh_rate <= 0)
+        return std::nullopt;
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>{1.0 / refresh_rate});
+}
+}
+
+class mgv::DisplayBuffer::Mapping : public mrs::Mapping<unsigned char>
+{
+public:
+    Mapping(std::vector<uint32_t>& pixels, geom::Size const& size)
+        : pixels{pixels},
+          size_{size}
+    {
+    }
+
+    auto format() const -> MirPixelFormat override
+    {
+        return mir_pixel_format_xrgb_8888;
+    }
+
+    auto stride() const -> geom::Stride override
+    {
+        return geom::Stride{size_.width.as_int() * 4};
+    }
+
+    auto size() const -> geom::Size override
+    {
+        return size_;
+    }
+
+    auto data() -> unsigned char* override
+    {
+        return reinterpret_cast<unsigned char*>(pixels.data());
+    }
+
+    auto len() const -> size_t override
+    {
+        return pixels.size() * sizeof pixels[0];
+    }
+
+private:
+    std::vector<uint32_t>& pixels;
+    geom::Size const size_;
+};
+
+mgv::DisplayBuffer::DisplayBuffer(
+    DisplayConfigurationOutputId output_id,
+    geom::Size const& pixel_size,
+    geom::Rectangle const& view_area,
+    double refresh_rate,
+    std::shared_ptr<AtomicFrame> const& last_frame,
+    std::shared_ptr<DisplayReport> const& report)
+    : output_id{output_id},
+      pixel_size{pixel_size},
+      refresh_interval{interval_for(refresh_rate)},
+      last_frame{last_frame},
+      report{report},
+      area{view_area},
+      transform(1),
+      front(pixel_size.width.as_int() * pixel_size.height.as_int()),
+      back(front.size()),
+      epoch{std::chrono::steady_clock::now()}
+{
+}
+
+geom::Rectangle mgv::DisplayBuffer::view_area() const
+{
+    return area;
+}
+
+bool mgv::DisplayBuffer::overlay(RenderableList const&)
+{
+    return false;
+}
+
+glm::mat2 mgv::DisplayBuffer::transformation() const
+{
+    return transform;
+}
+
+mg::NativeDisplayBuffer* mgv::DisplayBuffer::native_display_buffer()
+{
+    return this;
+}
+
+void mgv::DisplayBuffer::set_view_area(geom::Rectangle const& a)
+{
+    area = a;
+}
+
+void mgv::DisplayBuffer::set_transformation(glm::mat2 const& t)
+{
+    transform = t;
+}
+
+auto mgv::DisplayBuffer::map_back_buffer() -> std::unique_ptr<mrs::Mapping<unsigned char>>
+{
+    return std::make_unique<Mapping>(back, pixel_size);
+}
+
+void mgv::DisplayBuffer::swap_buffers()
+{
+    std::swap(front, back);
+}
+
+void mgv::DisplayBuffer::for_each_display_buffer(std::function<void(graphics::DisplayBuffer&)> const& f)
+{
+    f(*this);
+}
+
+void mgv::DisplayBuffer::post()
+{
+    if (!refresh_interval)
+    {
+        last_frame->increment_now();
+    }
+    else
+    {
+        // Wait for the first vblank after now that we haven't already posted to
+        auto const since_epoch = std::chrono::steady_clock::now() - epoch;
+        auto msc = (since_epoch + refresh_interval.value() - std::chrono::nanoseconds{1}) / refresh_interval.value();
+        msc = std::max<int64_t>(msc, last_frame->load().msc + 1);
+
+        auto const vblank = epoch + msc * refresh_interval.value();
+        std::this_thread::sleep_until(vblank);
+
+        mg::Frame frame;
+        frame.msc = msc;
+        frame.ust = {CLOCK_MONOTONIC, vblank.time_since_epoch()};
+        last_frame->store(frame);
+    }
+
+    report->report_vsync(output_id.as_value(), last_frame->load());
+}
+
+std::chrono::milliseconds mgv::DisplayBuffer::recommended_sleep() const
+{
+    return std::chrono::milliseconds::zero();
+}
+
+auto mgv::DisplayBuffer::vblank_timing() const -> std::optional<VBlankTiming>
+{
+    auto const frame = last_frame->load();
+    if (!refresh_interval || frame.msc == 0)
+        return std::nullopt;
+
+    return VBlankTiming{frame, refresh_interval.value()};
+}
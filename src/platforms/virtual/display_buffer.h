@@ -0,0 +1,97 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_VIRTUAL_DISPLAY_BUFFER_H_
+#define MIR_GRAPHICS_VIRTUAL_DISPLAY_BUFFER_H_
+
+#include "mir/graphics/display_buffer.h"
+#include "mir/graphics/display_configuration.h"
+#include "mir/graphics/display.h"
+#include "mir/renderer/sw/render_target.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace mir
+{
+namespace graphics
+{
+class AtomicFrame;
+class DisplayReport;
+
+namespace virt
+{
+
+/**
+ * A double-buffered output in memory.
+ *
+ * post() "scans out" at the configured refresh rate, by waiting for the
+ * next simulated vblank. With a refresh rate of zero, it doesn't wait at all.
+ */
+class DisplayBuffer : public graphics::DisplayBuffer,
+                      public graphics::DisplaySyncGroup,
+                      public graphics::NativeDisplayBuffer,
+                      public renderer::software::RenderTarget
+{
+public:
+    DisplayBuffer(
+        DisplayConfigurationOutputId output_id,
+        geometry::Size const& pixel_size,
+        geometry::Rectangle const& view_area,
+        double refresh_rate,
+        std::shared_ptr<AtomicFrame> const& last_frame,
+        std::shared_ptr<DisplayReport> const& report);
+
+    geometry::Rectangle view_area() const override;
+    bool overlay(RenderableList const& renderlist) override;
+    glm::mat2 transformation() const override;
+    NativeDisplayBuffer* native_display_buffer() override;
+    void set_view_area(geometry::Rectangle const& a);
+    void set_transformation(glm::mat2 const& t);
+
+    auto map_back_buffer() -> std::unique_ptr<renderer::software::Mapping<unsigned char>> override;
+    void swap_buffers() override;
+
+    void for_each_display_buffer(std::function<void(graphics::DisplayBuffer&)> const& f) override;
+    void post() override;
+    std::chrono::milliseconds recommended_sleep() const override;
+    auto vblank_timing() const -> std::optional<VBlankTiming> override;
+
+private:
+    class Mapping;
+
+    DisplayConfigurationOutputId const output_id;
+    geometry::Size const pixel_size;
+    std::optional<std::chrono::nanoseconds> const refresh_interval;
+    std::shared_ptr<AtomicFrame> const last_frame;
+    std::shared_ptr<DisplayReport> const report;
+
+    geometry::Rectangle area;
+    glm::mat2 transform;
+
+    std::vector<uint32_t> front;
+    std::vector<uint32_t> back;
+
+    /// Simulated vblanks happen at whole refresh intervals from here
+    std::chrono::steady_clock::time_point const epoch;
+};
+
+}
+}
+}
+
+#endif // MIR_GRAPHICS_VIRTUAL_DISPLAY_BUFFER_H_
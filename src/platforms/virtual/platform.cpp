@@ -0,0 +1,126 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "platform.h"
+#include "display.h"
+#include "buffer_allocator.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <stdexcept>
+
+namespace mg = mir::graphics;
+namespace mgv = mg::virt;
+namespace geom = mir::geometry;
+
+namespace
+{
+template<typename Number>
+auto parse_number(std::string const& str, Number (*convert)(std::string const&, size_t*), char const* what) -> Number
+{
+    try
+    {
+        size_t num_end = 0;
+        auto const value = convert(str, &num_end);
+        if (num_end != str.size())
+            BOOST_THROW_EXCEPTION(std::runtime_error(std::string{what} + " \"" + str + "\" is not a valid number"));
+        return value;
+    }
+    catch (std::invalid_argument const&)
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string{what} + " \"" + str + "\" is not a valid number"));
+    }
+    catch (std::out_of_range const&)
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string{what} + " \"" + str + "\" is out of range"));
+    }
+}
+
+auto parse_dimension(std::string const& str) -> int
+{
+    auto const value = parse_number<int>(
+        str, [](std::string const& s, size_t* end) { return std::stoi(s, end); }, "Output dimension");
+    if (value <= 0)
+        BOOST_THROW_EXCEPTION(std::runtime_error("Output dimensions must be greater than zero"));
+    return value;
+}
+
+auto parse_refresh_rate(std::string const& str) -> double
+{
+    auto const value = parse_number<double>(
+        str, [](std::string const& s, size_t* end) { return std::stod(s, end); }, "Refresh rate");
+    if (value < 0)
+        BOOST_THROW_EXCEPTION(std::runtime_error("Refresh rate must not be negative"));
+    return value;
+}
+
+auto parse_output(std::string const& str) -> mgv::OutputConfig
+{
+    auto const x = str.find('x'); // "x" between width and height
+    if (x == std::string::npos || x == 0 || x >= str.size() - 1)
+        BOOST_THROW_EXCEPTION(std::runtime_error("Output size \"" + str + "\" does not have two dimensions"));
+
+    auto const at = str.find('@'); // start of refresh rate
+    double refresh_rate = 60.0;
+    if (at != std::string::npos)
+    {
+        if (at >= str.size() - 1)
+            BOOST_THROW_EXCEPTION(std::runtime_error("In \"" + str + "\", '@' is not followed by a refresh rate"));
+        refresh_rate = parse_refresh_rate(str.substr(at + 1));
+    }
+
+    return mgv::OutputConfig{
+        geom::Size{
+            parse_dimension(str.substr(0, x)),
+            parse_dimension(str.substr(x + 1, at == std::string::npos ? std::string::npos : at - x - 1))},
+        refresh_rate};
+}
+}
+
+auto mgv::Platform::parse_output_configs(std::string const& outputs) -> std::vector<OutputConfig>
+{
+    std::vector<OutputConfig> configs;
+    for (size_t start = 0; start <= outputs.size();)
+    {
+        auto end = outputs.find(':', start);
+        if (end == std::string::npos)
+            end = outputs.size();
+        configs.push_back(parse_output(outputs.substr(start, end - start)));
+        start = end + 1;
+    }
+    return configs;
+}
+
+mgv::Platform::Platform(std::vector<OutputConfig> outputs, std::shared_ptr<DisplayReport> const& report)
+    : outputs{std::move(outputs)},
+      report{report}
+{
+    if (this->outputs.empty())
+        BOOST_THROW_EXCEPTION(std::runtime_error("Need at least one virtual output"));
+}
+
+mir::UniqueModulePtr<mg::Display> mgv::Platform::create_display(
+    std::shared_ptr<DisplayConfigurationPolicy> const& initial_conf_policy,
+    std::shared_ptr<GLConfig> const&)
+{
+    return make_module_ptr<mgv::Display>(outputs, initial_conf_policy, report);
+}
+
+auto mgv::RenderingPlatform::create_buffer_allocator(mg::Display const&)
+    -> UniqueModulePtr<mg::GraphicBufferAllocator>
+{
+    return make_module_ptr<mgv::BufferAllocator>();
+}
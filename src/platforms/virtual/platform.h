@@ -0,0 +1,73 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_VIRTUAL_PLATFORM_H_
+#define MIR_GRAPHICS_VIRTUAL_PLATFORM_H_
+
+#include "mir/graphics/platform.h"
+#include "mir/geometry/size.h"
+
+#include <string>
+#include <vector>
+
+namespace mir
+{
+namespace graphics
+{
+class DisplayReport;
+
+namespace virt
+{
+struct OutputConfig
+{
+    geometry::Size size;
+    double refresh_rate;    ///< In Hz; zero to post frames as fast as they're rendered
+};
+
+/**
+ * Outputs that exist only in memory, composited by the software renderer.
+ *
+ * This needs no display hardware or GPU, so is useful for running Mir on
+ * headless hosts and for benchmarking the compositor in isolation.
+ */
+class Platform : public graphics::DisplayPlatform
+{
+public:
+    /// Parses colon separated list of outputs in the form WIDTHxHEIGHT[@RATE]
+    static auto parse_output_configs(std::string const& outputs) -> std::vector<OutputConfig>;
+
+    Platform(std::vector<OutputConfig> outputs, std::shared_ptr<DisplayReport> const& report);
+
+    UniqueModulePtr<graphics::Display> create_display(
+        std::shared_ptr<DisplayConfigurationPolicy> const& initial_conf_policy,
+        std::shared_ptr<GLConfig> const& gl_config) override;
+
+private:
+    std::vector<OutputConfig> const outputs;
+    std::shared_ptr<DisplayReport> const report;
+};
+
+class RenderingPlatform : public graphics::RenderingPlatform
+{
+public:
+    auto create_buffer_allocator(graphics::Display const& output)
+        -> UniqueModulePtr<graphics::GraphicBufferAllocator> override;
+};
+}
+}
+}
+
+#endif // MIR_GRAPHICS_VIRTUAL_PLATFORM_H_
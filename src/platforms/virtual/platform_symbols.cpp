@@ -0,0 +1,103 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "platform.h"
+
+#include "mir/assert_module_entry_point.h"
+#include "mir/libname.h"
+#include "mir/module_deleter.h"
+#include "mir/options/option.h"
+#include "mir/options/program_option.h"
+
+namespace mo = mir::options;
+namespace mg = mir::graphics;
+namespace mgv = mg::virt;
+
+namespace
+{
+char const* virtual_outputs_option_name{"virtual-output"};
+
+mir::ModuleProperties const description = {
+    "mir:virtual",
+    MIR_VERSION_MAJOR,
+    MIR_VERSION_MINOR,
+    MIR_VERSION_MICRO,
+    mir::libname()
+};
+}
+
+mir::UniqueModulePtr<mg::DisplayPlatform> create_display_platform(
+    std::shared_ptr<mo::Option> const& options,
+    std::shared_ptr<mir::EmergencyCleanupRegistry> const&,
+    std::shared_ptr<mir::ConsoleServices> const&,
+    std::shared_ptr<mg::DisplayReport> const& report)
+{
+    mir::assert_entry_point_signature<mg::CreateDisplayPlatform>(&create_display_platform);
+
+    auto outputs = mgv::Platform::parse_output_configs(options->get<std::string>(virtual_outputs_option_name));
+    return mir::make_module_ptr<mgv::Platform>(std::move(outputs), report);
+}
+
+auto create_rendering_platform(
+    mo::Option const&,
+    mir::EmergencyCleanupRegistry&) -> mir::UniqueModulePtr<mg::RenderingPlatform>
+{
+    mir::assert_entry_point_signature<mg::CreateRenderPlatform>(&create_rendering_platform);
+    return mir::make_module_ptr<mgv::RenderingPlatform>();
+}
+
+void add_graphics_platform_options(boost::program_options::options_description& config)
+{
+    mir::assert_entry_point_signature<mg::AddPlatformOptions>(&add_graphics_platform_options);
+    config.add_options()
+        (virtual_outputs_option_name,
+         boost::program_options::value<std::string>(),
+         "[mir-on-virtual specific] Colon separated list of WIDTHxHEIGHT[@RATE] outputs to composite"
+         " into memory, without a GPU. A RATE of 0 posts frames as fast as they are rendered.");
+}
+
+namespace
+{
+// Only used when asked for: a real display is always preferable
+mg::PlatformPriority probe_graphics_platform(mo::ProgramOption const& options)
+{
+    return options.is_set(virtual_outputs_option_name) ?
+        mg::PlatformPriority::best :
+        mg::PlatformPriority::unsupported;
+}
+}
+
+auto probe_display_platform(
+    std::shared_ptr<mir::ConsoleServices> const&,
+    mo::ProgramOption const& options) -> mg::PlatformPriority
+{
+    mir::assert_entry_point_signature<mg::PlatformProbe>(&probe_display_platform);
+    return probe_graphics_platform(options);
+}
+
+auto probe_rendering_platform(
+    std::shared_ptr<mir::ConsoleServices> const&,
+    mo::ProgramOption const& options) -> mg::PlatformPriority
+{
+    mir::assert_entry_point_signature<mg::PlatformProbe>(&probe_rendering_platform);
+    return probe_graphics_platform(options);
+}
+
+mir::ModuleProperties const* describe_graphics_module()
+{
+    mir::assert_entry_point_signature<mg::DescribeModule>(&describe_graphics_module);
+    return &description;
+}
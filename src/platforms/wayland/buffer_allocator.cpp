@@ -75,7 +75,9 @@ std::unique_ptr<mir::renderer::gl::Context> context_for_output(mg::Display const
 mgw::BufferAllocator::BufferAllocator(graphics::Display const& output) :
     egl_extensions(std::make_shared<mg::EGLExtensions>()),
     ctx{context_for_output(output)},
-    egl_delegate{std::make_shared<mgc::EGLContextExecutor>(context_for_output(output))}
+    egl_delegate{std::make_shared<mgc::EGLContextExecutor>(
+        [&output]() { return context_for_output(output); },
+        mgc::EGLContextExecutor::default_thread_count())}
 {
 }
 
@@ -172,6 +174,7 @@ void mgw::BufferAllocator::unbind_display(wl_display* display)
 
 auto mgw::BufferAllocator::buffer_from_resource(
     wl_resource* buffer,
+    wl_resource* surface,
     std::function<void()>&& on_consumed,
     std::function<void()>&& on_release) -> std::shared_ptr<Buffer>
 {
@@ -181,6 +184,7 @@ auto mgw::BufferAllocator::buffer_from_resource(
 
     if (auto dmabuf = dmabuf_extension->buffer_from_resource(
         buffer,
+        surface,
         ctx,
         std::function<void()>{on_consumed},
         std::function<void()>{on_release},
@@ -200,11 +204,13 @@ auto mgw::BufferAllocator::buffer_from_resource(
 auto mgw::BufferAllocator::buffer_from_shm(
     wl_resource* buffer,
     std::shared_ptr<Executor> wayland_executor,
+    std::optional<geometry::Rectangles> const& damage,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
 {
     return mg::wayland::buffer_from_wl_shm(
         buffer,
         std::move(wayland_executor),
         egl_delegate,
+        damage,
         std::move(on_consumed));
 }
@@ -51,12 +51,14 @@ public:
 
     auto buffer_from_resource(
         wl_resource* buffer,
+        wl_resource* surface,
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release) -> std::shared_ptr<Buffer> override;
 
     auto buffer_from_shm(
         wl_resource* buffer,
         std::shared_ptr<Executor> wayland_executor,
+        std::optional<geometry::Rectangles> const& damage,
         std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer> override;
 
     std::vector<MirPixelFormat> supported_pixel_formats() override;
@@ -89,7 +89,9 @@ std::unique_ptr<mir::renderer::gl::Context> context_for_output(mg::Display const
 mgx::BufferAllocator::BufferAllocator(mg::Display const& output)
     : ctx{context_for_output(output)},
       egl_delegate{
-          std::make_shared<mgc::EGLContextExecutor>(context_for_output(output))},
+          std::make_shared<mgc::EGLContextExecutor>(
+              [&output]() { return context_for_output(output); },
+              mgc::EGLContextExecutor::default_thread_count())},
       egl_extensions(std::make_shared<mg::EGLExtensions>())
 {
 }
@@ -208,6 +210,7 @@ void mgx::BufferAllocator::unbind_display(wl_display* display)
 
 std::shared_ptr<mg::Buffer> mgx::BufferAllocator::buffer_from_resource(
     wl_resource* buffer,
+    wl_resource* surface,
     std::function<void()>&& on_consumed,
     std::function<void()>&& on_release)
 {
@@ -217,6 +220,7 @@ std::shared_ptr<mg::Buffer> mgx::BufferAllocator::buffer_from_resource(
 
     if (auto dmabuf = dmabuf_extension->buffer_from_resource(
         buffer,
+        surface,
         ctx,
         std::function<void()>{on_consumed},
         std::function<void()>{on_release},
@@ -236,11 +240,13 @@ std::shared_ptr<mg::Buffer> mgx::BufferAllocator::buffer_from_resource(
 auto mgx::BufferAllocator::buffer_from_shm(
     wl_resource* buffer,
     std::shared_ptr<Executor> wayland_executor,
+    std::optional<geometry::Rectangles> const& damage,
     std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer>
 {
     return mg::wayland::buffer_from_wl_shm(
         buffer,
         std::move(wayland_executor),
         egl_delegate,
+        damage,
         std::move(on_consumed));
 }
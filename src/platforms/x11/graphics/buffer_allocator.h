@@ -65,11 +65,13 @@ public:
     void unbind_display(wl_display* display) override;
     std::shared_ptr<Buffer> buffer_from_resource(
         wl_resource* buffer,
+        wl_resource* surface,
         std::function<void()>&& on_consumed,
         std::function<void()>&& on_release) override;
     auto buffer_from_shm(
         wl_resource* buffer,
         std::shared_ptr<Executor> wayland_executor,
+        std::optional<geometry::Rectangles> const& damage,
         std::function<void()>&& on_consumed) -> std::shared_ptr<Buffer> override;
 private:
     std::shared_ptr<renderer::gl::Context> const ctx;
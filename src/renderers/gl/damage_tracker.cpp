@@ -0,0 +1,170 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "damage_tracker.h"
+#include "mir/graphics/buffer.h"
+
+#include <cmath>
+
+namespace mg = mir::graphics;
+namespace mrg = mir::renderer::gl;
+namespace geom = mir::geometry;
+
+namespace
+{
+auto extent_of(mg::Renderable const& renderable, geom::Rectangle const& viewport) -> geom::Rectangle
+{
+    static glm::mat4 const identity(1);
+
+    // We can't cheaply bound an arbitrarily transformed renderable
+    if (renderable.transformation() != identity)
+        return viewport;
+
+    auto extent = renderable.screen_position().intersection_with(viewport);
+    if (auto const clip = renderable.clip_area())
+        extent = extent.intersection_with(clip.value());
+
+    return extent;
+}
+
+void add_damage(geom::Rectangles& damage, geom::Rectangle const& rect)
+{
+    if (rect.size.width > geom::Width{0} && rect.size.height > geom::Height{0})
+        damage.add(rect);
+}
+
+/// Map damage in buffer coordinates onto the screen, rounding outwards
+void add_buffer_damage(
+    geom::Rectangles& damage,
+    geom::Rectangles const& buffer_damage,
+    geom::Size const& buffer_size,
+    geom::Rectangle const& screen_position,
+    geom::Rectangle const& extent)
+{
+    auto const scale_x = double(screen_position.size.width.as_int()) / buffer_size.width.as_int();
+    auto const scale_y = double(screen_position.size.height.as_int()) / buffer_size.height.as_int();
+
+    for (auto const& rect : buffer_damage)
+    {
+        auto const left = static_cast<int>(std::floor(rect.left().as_int() * scale_x));
+        auto const top = static_cast<int>(std::floor(rect.top().as_int() * scale_y));
+        auto const right = static_cast<int>(std::ceil(rect.right().as_int() * scale_x));
+        auto const bottom = static_cast<int>(std::ceil(rect.bottom().as_int() * scale_y));
+
+        geom::Rectangle const on_screen{
+            screen_position.top_left + geom::Displacement{left, top},
+            geom::Size{right - left, bottom - top}};
+
+        add_damage(damage, on_screen.intersection_with(extent));
+    }
+}
+}
+
+void mrg::DamageTracker::add_frame(geom::Rectangle const& viewport, mg::RenderableList const& renderables)
+{
+    if (viewport != this->viewport)
+    {
+        reset();
+        this->viewport = viewport;
+    }
+
+    geom::Rectangles damage;
+    if (history.empty())
+        add_damage(damage, viewport);
+
+    std::unordered_map<mg::Renderable::ID, Snapshot> current;
+    mg::Renderable::ID below = nullptr;
+
+    for (auto const& renderable : renderables)
+    {
+        auto const buffer = renderable->buffer();
+        Snapshot const snapshot{
+            extent_of(*renderable, viewport),
+            buffer ? buffer->id() : mg::BufferID{},
+            renderable->alpha(),
+            renderable->transformation(),
+            below};
+
+        auto const id = renderable->id();
+        auto const prev = previous.find(id);
+        if (prev == previous.end())
+        {
+            add_damage(damage, snapshot.extent);
+        }
+        else
+        {
+            auto const& was = prev->second;
+            if (was.extent != snapshot.extent ||
+                was.alpha != snapshot.alpha ||
+                was.transformation != snapshot.transformation ||
+                was.below != snapshot.below)
+            {
+                add_damage(damage, was.extent);
+                add_damage(damage, snapshot.extent);
+            }
+            else if (was.buffer != snapshot.buffer)
+            {
+                // Only the content changed; the client may have told us which part
+                auto const buffer_damage = renderable->damage_since(was.buffer);
+                if (buffer_damage && buffer && snapshot.transformation == glm::mat4(1) &&
+                    buffer->size().width > geom::Width{0} && buffer->size().height > geom::Height{0})
+                {
+                    add_buffer_damage(
+                        damage, *buffer_damage, buffer->size(), renderable->screen_position(), snapshot.extent);
+                }
+                else
+                {
+                    add_damage(damage, snapshot.extent);
+                }
+            }
+            previous.erase(prev);
+        }
+
+        current.emplace(id, snapshot);
+        below = id;
+    }
+
+    // Whatever is left has gone away since the last frame
+    for (auto const& gone : previous)
+        add_damage(damage, gone.second.extent);
+
+    previous = std::move(current);
+
+    history.push_front(std::move(damage));
+    if (history.size() > static_cast<size_t>(max_buffer_age))
+        history.pop_back();
+}
+
+auto mrg::DamageTracker::damage_for_buffer_age(int age) const -> std::optional<geom::Rectangles>
+{
+    if (age <= 0 || static_cast<size_t>(age) > history.size())
+        return std::nullopt;
+
+    geom::Rectangles damage;
+    for (auto i = 0; i != age; ++i)
+    {
+        for (auto const& rect : history[i])
+            damage.add(rect);
+    }
+
+    return damage;
+}
+
+void mrg::DamageTracker::reset()
+{
+    previous.clear();
+    history.clear();
+}
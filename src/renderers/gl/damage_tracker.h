@@ -0,0 +1,94 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_GL_DAMAGE_TRACKER_H_
+#define MIR_RENDERER_GL_DAMAGE_TRACKER_H_
+
+#include <mir/geometry/rectangle.h>
+#include <mir/geometry/rectangles.h>
+#include <mir/graphics/buffer_id.h>
+#include <mir/graphics/renderable.h>
+
+#include <glm/glm.hpp>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+
+namespace mir
+{
+namespace renderer
+{
+namespace gl
+{
+
+/**
+ * Accumulates, per output, the screen regions that changed between
+ * successive frames so that only those need to be redrawn.
+ *
+ * Damage is derived by comparing each frame's renderables against the
+ * previous frame: anything that appeared, disappeared, moved, restacked or
+ * changed buffer damages both its old and its new on-screen extent.
+ * Where only the buffer content changed, the damage the client reported for
+ * the new buffer is used instead, if available.
+ */
+class DamageTracker
+{
+public:
+    /// The oldest back buffer (in frames) whose contents can be repaired.
+    static int const max_buffer_age = 4;
+
+    /**
+     * Record a new frame.
+     *
+     * \param [in] viewport     The output area being rendered.
+     * \param [in] renderables  The renderables of the new frame, bottom first.
+     */
+    void add_frame(geometry::Rectangle const& viewport, graphics::RenderableList const& renderables);
+
+    /**
+     * The region that must be repainted in a back buffer of the given age
+     * (as reported by EGL_EXT_buffer_age) to bring it up to date with the
+     * latest frame.
+     *
+     * \return The damaged region, or an empty optional if the buffer contents
+     *         are unknown and everything must be repainted.
+     */
+    auto damage_for_buffer_age(int age) const -> std::optional<geometry::Rectangles>;
+
+    /// Forget all history; the next frame will be treated as fully damaged.
+    void reset();
+
+private:
+    struct Snapshot
+    {
+        geometry::Rectangle extent;
+        graphics::BufferID buffer;
+        float alpha;
+        glm::mat4 transformation;
+        graphics::Renderable::ID below;
+    };
+
+    geometry::Rectangle viewport;
+    std::unordered_map<graphics::Renderable::ID, Snapshot> previous;
+    /// Damage of the most recent frames, newest first.
+    std::deque<geometry::Rectangles> history;
+};
+
+}
+}
+}
+
+#endif // MIR_RENDERER_GL_DAMAGE_TRACKER_H_
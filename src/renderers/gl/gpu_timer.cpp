@@ -0,0 +1,262 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define MIR_LOG_COMPONENT "GLRenderer"
+
+#include "gpu_timer.h"
+#include "mir/log.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#include <cstring>
+#include <deque>
+#include <vector>
+
+namespace mrg = mir::renderer::gl;
+
+namespace
+{
+bool has_extension(char const* extensions, char const* extension)
+{
+    return extensions && strstr(extensions, extension);
+}
+
+/// GL_EXT_disjoint_timer_query: the GPU's own measure of each frame
+class TimerQueryGPUTimer : public mrg::GPUTimer
+{
+public:
+    TimerQueryGPUTimer()
+        : glGenQueriesEXT{
+            reinterpret_cast<PFNGLGENQUERIESEXTPROC>(eglGetProcAddress("glGenQueriesEXT"))},
+          glDeleteQueriesEXT{
+            reinterpret_cast<PFNGLDELETEQUERIESEXTPROC>(eglGetProcAddress("glDeleteQueriesEXT"))},
+          glBeginQueryEXT{
+            reinterpret_cast<PFNGLBEGINQUERYEXTPROC>(eglGetProcAddress("glBeginQueryEXT"))},
+          glEndQueryEXT{
+            reinterpret_cast<PFNGLENDQUERYEXTPROC>(eglGetProcAddress("glEndQueryEXT"))},
+          glGetQueryObjectuivEXT{
+            reinterpret_cast<PFNGLGETQUERYOBJECTUIVEXTPROC>(eglGetProcAddress("glGetQueryObjectuivEXT"))},
+          glGetQueryObjectui64vEXT{
+            reinterpret_cast<PFNGLGETQUERYOBJECTUI64VEXTPROC>(eglGetProcAddress("glGetQueryObjectui64vEXT"))}
+    {
+    }
+
+    ~TimerQueryGPUTimer()
+    {
+        free_queries.insert(free_queries.end(), pending_queries.begin(), pending_queries.end());
+        if (!free_queries.empty())
+            glDeleteQueriesEXT(free_queries.size(), free_queries.data());
+    }
+
+    bool usable() const
+    {
+        return glGenQueriesEXT && glDeleteQueriesEXT && glBeginQueryEXT && glEndQueryEXT &&
+               glGetQueryObjectuivEXT && glGetQueryObjectui64vEXT;
+    }
+
+    void begin_frame() override
+    {
+        // If results aren't being collected, don't let queries pile up
+        if (pending_queries.size() >= max_pending_queries)
+            return;
+
+        if (free_queries.empty())
+        {
+            GLuint query{0};
+            glGenQueriesEXT(1, &query);
+            free_queries.push_back(query);
+        }
+
+        active_query = free_queries.back();
+        free_queries.pop_back();
+        glBeginQueryEXT(GL_TIME_ELAPSED_EXT, active_query.value());
+    }
+
+    void end_frame() override
+    {
+        if (active_query)
+        {
+            glEndQueryEXT(GL_TIME_ELAPSED_EXT);
+            pending_queries.push_back(active_query.value());
+            active_query = std::nullopt;
+        }
+    }
+
+    auto completed_frame() -> std::optional<std::chrono::nanoseconds> override
+    {
+        if (pending_queries.empty())
+            return std::nullopt;
+
+        // Something (such as a GPU reset or power state change) made the timings meaningless
+        GLint disjoint{GL_FALSE};
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (disjoint)
+        {
+            free_queries.insert(free_queries.end(), pending_queries.begin(), pending_queries.end());
+            pending_queries.clear();
+            return std::nullopt;
+        }
+
+        auto const query = pending_queries.front();
+        GLuint available{GL_FALSE};
+        glGetQueryObjectuivEXT(query, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+        if (!available)
+            return std::nullopt;
+
+        GLuint64 elapsed{0};
+        glGetQueryObjectui64vEXT(query, GL_QUERY_RESULT_EXT, &elapsed);
+        pending_queries.pop_front();
+        free_queries.push_back(query);
+
+        return std::chrono::nanoseconds{elapsed};
+    }
+
+private:
+    static size_t const max_pending_queries = 8;
+
+    PFNGLGENQUERIESEXTPROC const glGenQueriesEXT;
+    PFNGLDELETEQUERIESEXTPROC const glDeleteQueriesEXT;
+    PFNGLBEGINQUERYEXTPROC const glBeginQueryEXT;
+    PFNGLENDQUERYEXTPROC const glEndQueryEXT;
+    PFNGLGETQUERYOBJECTUIVEXTPROC const glGetQueryObjectuivEXT;
+    PFNGLGETQUERYOBJECTUI64VEXTPROC const glGetQueryObjectui64vEXT;
+
+    std::optional<GLuint> active_query;
+    std::deque<GLuint> pending_queries;
+    std::vector<GLuint> free_queries;
+};
+
+/**
+ * EGL_KHR_fence_sync: time from flushing the frame until a fence after it
+ * is seen to have signalled. The fence is only polled, never waited on, so
+ * this includes any time the frame spends queued behind other GPU work and
+ * is only as precise as the polling; hence it's only used if timer queries
+ * are unavailable.
+ */
+class FenceGPUTimer : public mrg::GPUTimer
+{
+public:
+    explicit FenceGPUTimer(EGLDisplay display)
+        : display{display},
+          eglCreateSyncKHR{
+            reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"))},
+          eglDestroySyncKHR{
+            reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"))},
+          eglClientWaitSyncKHR{
+            reinterpret_cast<PFNEGLCLIENTWAITSYNCKHRPROC>(eglGetProcAddress("eglClientWaitSyncKHR"))}
+    {
+    }
+
+    ~FenceGPUTimer()
+    {
+        if (fence != EGL_NO_SYNC_KHR)
+            eglDestroySyncKHR(display, fence);
+    }
+
+    bool usable() const
+    {
+        return eglCreateSyncKHR && eglDestroySyncKHR && eglClientWaitSyncKHR;
+    }
+
+    void begin_frame() override
+    {
+    }
+
+    void end_frame() override
+    {
+        if (fence != EGL_NO_SYNC_KHR)
+            return;
+
+        glFlush();
+        flushed = std::chrono::steady_clock::now();
+        fence = eglCreateSyncKHR(display, EGL_SYNC_FENCE_KHR, nullptr);
+    }
+
+    auto completed_frame() -> std::optional<std::chrono::nanoseconds> override
+    {
+        if (fence == EGL_NO_SYNC_KHR)
+            return std::nullopt;
+
+        // Don't hold up the compositor just for the sake of a measurement: check, and try again next frame
+        auto const status = eglClientWaitSyncKHR(display, fence, 0, 0);
+        if (status == EGL_TIMEOUT_EXPIRED_KHR)
+            return std::nullopt;
+
+        auto const signalled = std::chrono::steady_clock::now();
+        eglDestroySyncKHR(display, fence);
+        fence = EGL_NO_SYNC_KHR;
+
+        if (status != EGL_CONDITION_SATISFIED_KHR)
+            return std::nullopt;
+
+        return signalled - flushed;
+    }
+
+private:
+    EGLDisplay const display;
+    PFNEGLCREATESYNCKHRPROC const eglCreateSyncKHR;
+    PFNEGLDESTROYSYNCKHRPROC const eglDestroySyncKHR;
+    PFNEGLCLIENTWAITSYNCKHRPROC const eglClientWaitSyncKHR;
+
+    EGLSyncKHR fence{EGL_NO_SYNC_KHR};
+    std::chrono::steady_clock::time_point flushed;
+};
+
+class NullGPUTimer : public mrg::GPUTimer
+{
+public:
+    void begin_frame() override
+    {
+    }
+
+    void end_frame() override
+    {
+    }
+
+    auto completed_frame() -> std::optional<std::chrono::nanoseconds> override
+    {
+        return std::nullopt;
+    }
+};
+}
+
+auto mrg::GPUTimer::create() -> std::unique_ptr<GPUTimer>
+{
+    auto const gl_extensions = reinterpret_cast<char const*>(glGetString(GL_EXTENSIONS));
+    if (has_extension(gl_extensions, "GL_EXT_disjoint_timer_query"))
+    {
+        auto timer = std::make_unique<TimerQueryGPUTimer>();
+        if (timer->usable())
+            return timer;
+    }
+
+    auto const display = eglGetCurrentDisplay();
+    if (display != EGL_NO_DISPLAY && has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_fence_sync"))
+    {
+        auto timer = std::make_unique<FenceGPUTimer>(display);
+        if (timer->usable())
+        {
+            mir::log_info("GL_EXT_disjoint_timer_query unavailable: GPU times will be estimated using fences");
+            return timer;
+        }
+    }
+
+    mir::log_info("Neither GL_EXT_disjoint_timer_query nor EGL_KHR_fence_sync available: GPU times unknown");
+    return std::make_unique<NullGPUTimer>();
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_GL_GPU_TIMER_H_
+#define MIR_RENDERER_GL_GPU_TIMER_H_
+
+#include <chrono>
+#include <memory>
+#include <optional>
+
+namespace mir
+{
+namespace renderer
+{
+namespace gl
+{
+
+/**
+ * Measures how long the GPU takes to execute the GL commands of each frame.
+ *
+ * Uses GL_EXT_disjoint_timer_query where available. Otherwise, with
+ * EGL_KHR_fence_sync, it approximates the GPU time by waiting for a fence
+ * inserted at the end of the frame. If neither is available, no times are
+ * ever reported.
+ */
+class GPUTimer
+{
+public:
+    virtual ~GPUTimer() = default;
+
+    /// Start timing the GL commands that follow. Needs a current GL context.
+    virtual void begin_frame() = 0;
+
+    /// Stop timing the frame. Needs a current GL context.
+    virtual void end_frame() = 0;
+
+    /// The GPU time of the oldest timed frame that has finished since the last call, if any
+    virtual auto completed_frame() -> std::optional<std::chrono::nanoseconds> = 0;
+
+    /// The most precise timer the current GL context supports
+    static auto create() -> std::unique_ptr<GPUTimer>;
+
+protected:
+    GPUTimer() = default;
+    GPUTimer(GPUTimer const&) = delete;
+    GPUTimer& operator=(GPUTimer const&) = delete;
+};
+
+}
+}
+}
+
+#endif // MIR_RENDERER_GL_GPU_TIMER_H_
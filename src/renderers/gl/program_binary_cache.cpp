@@ -0,0 +1,319 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define MIR_LOG_COMPONENT "GLRenderer"
+
+#include "program_binary_cache.h"
+#include "mir/fd.h"
+#include "mir/log.h"
+
+#include <EGL/egl.h>
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mrg = mir::renderer::gl;
+
+namespace
+{
+// Bump this if the file layout changes
+char const magic[] = "MIR-GL-PROGRAM-BINARY-1\n";
+
+// Far bigger than any real program binary; anything larger is a corrupt file
+uint64_t const max_binary_size{64 * 1024 * 1024};
+
+auto gl_string(GLenum name) -> std::string
+{
+    auto const value = reinterpret_cast<char const*>(glGetString(name));
+    return value ? value : "";
+}
+
+/// FNV-1a: cheap, and (unlike std::hash) stable between builds
+auto fnv1a(std::string const& data) -> uint64_t
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (unsigned char const c : data)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+/// Create directory and any missing parents
+bool make_directories(std::string const& directory)
+{
+    for (auto end = directory.find('/', 1); ; end = directory.find('/', end + 1))
+    {
+        auto const parent = directory.substr(0, end);
+        if (mkdir(parent.c_str(), 0700) != 0 && errno != EEXIST)
+            return false;
+
+        if (end == std::string::npos)
+            return true;
+    }
+}
+
+template<typename T>
+void write_value(std::ostream& out, T value)
+{
+    out.write(reinterpret_cast<char const*>(&value), sizeof value);
+}
+
+template<typename T>
+auto read_value(std::istream& in) -> T
+{
+    T value{};
+    in.read(reinterpret_cast<char*>(&value), sizeof value);
+    return value;
+}
+
+struct CachedBinary
+{
+    uint32_t format;
+    std::vector<char> binary;
+};
+
+/// Read the binary stored for key at path, if the file is intact and really is for key
+auto read_cached_binary(std::string const& path, std::string const& key) -> std::optional<CachedBinary>
+{
+    std::ifstream in{path, std::ios::binary | std::ios::ate};
+    if (!in)
+        return std::nullopt;
+
+    auto const file_size = static_cast<uint64_t>(std::max<std::streamoff>(in.tellg(), 0));
+    in.seekg(0);
+
+    // Lengths come from the file, so check them against what's left of it before allocating anything
+    auto remaining = [&in, file_size]
+        {
+            auto const position = static_cast<uint64_t>(std::max<std::streamoff>(in.tellg(), 0));
+            return position < file_size ? file_size - position : 0;
+        };
+
+    std::string header(sizeof magic - 1, '\0');
+    in.read(header.data(), header.size());
+    if (!in || header != magic)
+        return std::nullopt;
+
+    // The hash only names the file; make sure it's really for these sources
+    auto const key_size = read_value<uint64_t>(in);
+    if (!in || key_size != key.size() || key_size > remaining())
+        return std::nullopt;
+    std::string stored_key(key_size, '\0');
+    in.read(stored_key.data(), stored_key.size());
+    if (!in || stored_key != key)
+        return std::nullopt;
+
+    auto const format = read_value<uint32_t>(in);
+    auto const binary_size = read_value<uint64_t>(in);
+    if (!in || binary_size == 0 || binary_size > max_binary_size || binary_size > remaining())
+        return std::nullopt;
+    std::vector<char> binary(binary_size);
+    in.read(binary.data(), binary.size());
+    if (!in)
+        return std::nullopt;
+
+    return CachedBinary{format, std::move(binary)};
+}
+}
+
+mrg::ProgramBinaryCache::ProgramBinaryOES::ProgramBinaryOES()
+    : glGetProgramBinaryOES{
+        reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(eglGetProcAddress("glGetProgramBinaryOES"))},
+      glProgramBinaryOES{
+        reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(eglGetProcAddress("glProgramBinaryOES"))}
+{
+    if (!glGetProgramBinaryOES || !glProgramBinaryOES)
+    {
+        BOOST_THROW_EXCEPTION((std::runtime_error{"GL implementation doesn't support GL_OES_get_program_binary"}));
+    }
+}
+
+auto mrg::ProgramBinaryCache::maybe_program_binary() -> std::optional<ProgramBinaryOES>
+{
+    auto const extensions = gl_string(GL_EXTENSIONS);
+    if (extensions.find("GL_OES_get_program_binary") == std::string::npos)
+        return std::nullopt;
+
+    // Drivers may advertise the extension while supporting no formats at all
+    GLint formats{0};
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+    if (formats <= 0)
+        return std::nullopt;
+
+    try
+    {
+        return ProgramBinaryOES{};
+    }
+    catch (std::runtime_error const&)
+    {
+        return std::nullopt;
+    }
+}
+
+mrg::ProgramBinaryCache::ProgramBinaryCache(std::string const& directory)
+    : program_binary{directory.empty() ? std::nullopt : maybe_program_binary()},
+      directory{directory},
+      driver{gl_string(GL_VENDOR) + "\n" + gl_string(GL_RENDERER) + "\n" + gl_string(GL_VERSION)}
+{
+    if (!directory.empty() && !program_binary)
+        mir::log_debug("Not caching shader programs: GL_OES_get_program_binary is unavailable");
+}
+
+auto mrg::ProgramBinaryCache::default_directory() -> std::string
+{
+    if (auto const cache_home = getenv("XDG_CACHE_HOME"))
+        return std::string{cache_home} + "/mir/shaders";
+    else if (auto const home = getenv("HOME"))
+        return std::string{home} + "/.cache/mir/shaders";
+    else
+        return {};
+}
+
+auto mrg::ProgramBinaryCache::key_for(
+    std::string const& vertex_source,
+    std::string const& fragment_source) const -> std::string
+{
+    return driver + '\0' + vertex_source + '\0' + fragment_source;
+}
+
+auto mrg::ProgramBinaryCache::path_for(std::string const& key) const -> std::string
+{
+    char name[32];
+    snprintf(name, sizeof name, "/%016llx.bin", static_cast<unsigned long long>(fnv1a(key)));
+    return directory + name;
+}
+
+auto mrg::ProgramBinaryCache::load(
+    std::string const& vertex_source,
+    std::string const& fragment_source) const -> GLuint
+{
+    if (!program_binary)
+        return 0;
+
+    auto const key = key_for(vertex_source, fragment_source);
+
+    std::optional<CachedBinary> cached;
+    try
+    {
+        cached = read_cached_binary(path_for(key), key);
+    }
+    catch (std::exception const& error)
+    {
+        mir::log_debug("Failed to read cached shader program binary: %s", error.what());
+    }
+
+    if (!cached)
+        return 0;
+
+    auto const program = glCreateProgram();
+    program_binary->glProgramBinaryOES(program, cached->format, cached->binary.data(), cached->binary.size());
+
+    // Drivers are free to reject binaries, even ones they produced
+    GLint ok{GL_FALSE};
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok)
+    {
+        mir::log_debug("GL driver rejected cached shader program binary; recompiling");
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+void mrg::ProgramBinaryCache::store(
+    GLuint program,
+    std::string const& vertex_source,
+    std::string const& fragment_source) const
+{
+    if (!program_binary)
+        return;
+
+    GLint length{0};
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLsizei written{0};
+    GLenum format{0};
+    program_binary->glGetProgramBinaryOES(program, length, &written, &format, binary.data());
+    if (written <= 0)
+        return;
+
+    if (!make_directories(directory))
+    {
+        mir::log_warning("Failed to create shader cache directory %s: %s", directory.c_str(), strerror(errno));
+        return;
+    }
+
+    auto const key = key_for(vertex_source, fragment_source);
+    auto const path = path_for(key);
+
+    std::ostringstream out;
+    out.write(magic, sizeof magic - 1);
+    write_value<uint64_t>(out, key.size());
+    out.write(key.data(), key.size());
+    write_value<uint32_t>(out, format);
+    write_value<uint64_t>(out, written);
+    out.write(binary.data(), written);
+    auto const contents = out.str();
+
+    // Write to a temporary file first, so that no-one ever sees a partial binary.
+    // Each writer gets its own, as other threads and processes may be saving the same program.
+    std::string temporary = path + ".XXXXXX";
+    mir::Fd const fd{mkstemp(temporary.data())};
+    if (fd < 0)
+    {
+        mir::log_warning("Failed to create shader cache file in %s: %s", directory.c_str(), strerror(errno));
+        return;
+    }
+
+    for (auto remaining = contents.data(), end = remaining + contents.size(); remaining != end;)
+    {
+        auto const result = write(fd, remaining, end - remaining);
+        if (result < 0 && errno == EINTR)
+            continue;
+
+        if (result <= 0)
+        {
+            mir::log_warning("Failed to write shader cache file %s: %s", temporary.c_str(), strerror(errno));
+            unlink(temporary.c_str());
+            return;
+        }
+
+        remaining += result;
+    }
+
+    if (rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        mir::log_warning("Failed to write shader cache file %s: %s", path.c_str(), strerror(errno));
+        unlink(temporary.c_str());
+    }
+}
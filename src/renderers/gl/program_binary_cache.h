@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_GL_PROGRAM_BINARY_CACHE_H_
+#define MIR_RENDERER_GL_PROGRAM_BINARY_CACHE_H_
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#include <optional>
+#include <string>
+
+namespace mir
+{
+namespace renderer
+{
+namespace gl
+{
+
+/**
+ * Keeps linked shader programs on disk (via GL_OES_get_program_binary), so
+ * they needn't be compiled from source again the next time the server starts.
+ *
+ * Binaries are keyed by the GL vendor, renderer and version strings as well as
+ * the shader sources, so a driver update or a change to the shaders just
+ * misses the cache. Caching is best-effort: if the extension is unavailable,
+ * or the cache can't be read or written, load() misses and store() does
+ * nothing, and callers fall back to compiling from source.
+ *
+ * NOTE: This must be constructed and used with a current GL context.
+ */
+class ProgramBinaryCache
+{
+public:
+    /// \param [in] directory  Where to keep binaries; created on demand. If empty, nothing is cached.
+    explicit ProgramBinaryCache(std::string const& directory);
+
+    /// $XDG_CACHE_HOME/mir/shaders, falling back to $HOME/.cache/mir/shaders (or empty if neither is set)
+    static auto default_directory() -> std::string;
+
+    /**
+     * Look up a previously stored program.
+     *
+     * \return The id of a newly created and linked program, or 0 if there is
+     *         no usable binary for these sources.
+     */
+    auto load(std::string const& vertex_source, std::string const& fragment_source) const -> GLuint;
+
+    /// Save a linked program built from these sources for future load()s
+    void store(GLuint program, std::string const& vertex_source, std::string const& fragment_source) const;
+
+private:
+    struct ProgramBinaryOES
+    {
+        ProgramBinaryOES();
+
+        PFNGLGETPROGRAMBINARYOESPROC const glGetProgramBinaryOES;
+        PFNGLPROGRAMBINARYOESPROC const glProgramBinaryOES;
+    };
+
+    static auto maybe_program_binary() -> std::optional<ProgramBinaryOES>;
+    auto key_for(std::string const& vertex_source, std::string const& fragment_source) const -> std::string;
+    auto path_for(std::string const& key) const -> std::string;
+
+    std::optional<ProgramBinaryOES> const program_binary;
+    std::string const directory;
+    std::string const driver;
+};
+
+}
+}
+}
+
+#endif // MIR_RENDERER_GL_PROGRAM_BINARY_CACHE_H_
@@ -19,6 +19,8 @@
 #define MIR_LOG_COMPONENT "GLRenderer"
 
 #include "renderer.h"
+#include "program_binary_cache.h"
+#include "gpu_timer.h"
 #include "mir/compositor/buffer_stream.h"
 #include "mir/graphics/renderable.h"
 #include "mir/graphics/buffer.h"
@@ -35,12 +37,17 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 
 #include <boost/throw_exception.hpp>
 #include <stdexcept>
 #include <cmath>
 #include <sstream>
 #include <mutex>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
 
 namespace mg = mir::graphics;
 namespace mgl = mir::gl;
@@ -78,6 +85,11 @@ void mrg::CurrentRenderTarget::swap_buffers()
     render_target->swap_buffers();
 }
 
+void mrg::CurrentRenderTarget::swap_buffers_with_damage(geom::Rectangles const& damage)
+{
+    render_target->swap_buffers_with_damage(damage);
+}
+
 namespace
 {
 template<void (* deleter)(GLuint)>
@@ -148,6 +160,56 @@ const GLchar* const vertex_shader_src =
     "   v_texcoord = texcoord;\n"
     "}\n"
 };
+
+// GL textures have (0,0) at bottom-left rather than top-left
+glm::mat4 const invert_top_row_first{
+    1.0, 0.0, 0.0, 0.0,
+    0.0, -1.0, 0.0, 0.0,
+    0.0, 0.0, 1.0, 0.0,
+    -1.0, 1.0, 0.0, 1.0
+};
+
+// How many earlier batches a renderable may be merged into
+size_t const max_batch_lookback = 16;
+
+bool is_affine(glm::mat4 const& transform)
+{
+    return transform[0][3] == 0.0f && transform[1][3] == 0.0f && transform[2][3] == 0.0f &&
+           transform[3][3] == 1.0f;
+}
+
+auto bounding_box(geom::Rectangle const& a, geom::Rectangle const& b) -> geom::Rectangle
+{
+    geom::Rectangles both;
+    both.add(a);
+    both.add(b);
+    return both.bounding_rectangle();
+}
+
+/// Append the primitive's triangles to vertices, or return false if it has none
+bool append_triangles(std::vector<mgl::Vertex>& vertices, mgl::Primitive const& primitive)
+{
+    auto const& v = primitive.vertices;
+    switch (primitive.type)
+    {
+    case GL_TRIANGLES:
+        vertices.insert(vertices.end(), v, v + primitive.nvertices - primitive.nvertices % 3);
+        return true;
+
+    case GL_TRIANGLE_STRIP:
+        for (auto i = 2; i < primitive.nvertices; ++i)
+            vertices.insert(vertices.end(), {v[i - 2], v[i - 1], v[i]});
+        return true;
+
+    case GL_TRIANGLE_FAN:
+        for (auto i = 2; i < primitive.nvertices; ++i)
+            vertices.insert(vertices.end(), {v[0], v[i - 1], v[i]});
+        return true;
+
+    default:
+        return false;
+    }
+}
 }
 
 class mrg::Renderer::ProgramFactory : public mir::graphics::gl::ProgramFactory
@@ -155,7 +217,7 @@ class mrg::Renderer::ProgramFactory : public mir::graphics::gl::ProgramFactory
 public:
     // NOTE: This must be called with a current GL context
     ProgramFactory()
-        : vertex_shader{compile_shader(GL_VERTEX_SHADER, vertex_shader_src)}
+        : cache{ProgramBinaryCache::default_directory()}
     {
     }
 
@@ -215,22 +277,43 @@ public:
         // GL shader compilation is *not* threadsafe, and requires external synchronisation
         std::lock_guard<std::mutex> lock{compilation_mutex};
 
-        ShaderHandle const opaque_shader{
-            compile_shader(GL_FRAGMENT_SHADER, opaque_fragment.str().c_str())};
-        ShaderHandle const alpha_shader{
-            compile_shader(GL_FRAGMENT_SHADER, alpha_fragment.str().c_str())};
+        auto opaque_program = cached_or_linked(opaque_fragment.str());
+        auto alpha_program = cached_or_linked(alpha_fragment.str());
 
         programs.emplace_back(id, std::make_unique<::Program>(
-            link_shader(vertex_shader, opaque_shader),
-            link_shader(vertex_shader, alpha_shader)));
+            std::move(opaque_program),
+            std::move(alpha_program)));
 
         return *programs.back().second;
-
-        // We delete opaque_shader and alpha_shader here. This is fine; it only marks them
-        // for deletion. GL will only delete them once the GL Program they're linked in is destroyed.
     }
 
 private:
+    auto cached_or_linked(std::string const& fragment_src) -> ProgramHandle
+    {
+        if (auto const cached = cache.load(vertex_shader_src, fragment_src))
+        {
+            return ProgramHandle{cached};
+        }
+
+        ShaderHandle const fragment_shader{compile_shader(GL_FRAGMENT_SHADER, fragment_src.c_str())};
+        auto program = link_shader(vertex_shader(), fragment_shader);
+        cache.store(program, vertex_shader_src, fragment_src);
+        return program;
+
+        // We delete fragment_shader here. This is fine; it only marks it for deletion.
+        // GL will only delete it once the GL Program it's linked in is destroyed.
+    }
+
+    // The vertex shader is only needed if some program isn't in the cache
+    auto vertex_shader() -> ShaderHandle const&
+    {
+        if (!vertex_shader_handle)
+        {
+            vertex_shader_handle.emplace(compile_shader(GL_VERTEX_SHADER, vertex_shader_src));
+        }
+        return *vertex_shader_handle;
+    }
+
     static GLuint compile_shader(GLenum type, GLchar const* src)
     {
         GLuint id = glCreateShader(type);
@@ -278,7 +361,8 @@ private:
         return program;
     }
 
-    ShaderHandle const vertex_shader;
+    ProgramBinaryCache const cache;
+    std::optional<ShaderHandle> vertex_shader_handle;
     std::vector<std::pair<void const*, std::unique_ptr<::Program>>> programs;
     // GL requires us to synchronise multi-threaded access to the shader APIs.
     std::mutex compilation_mutex;
@@ -310,6 +394,8 @@ mrg::Renderer::Renderer(graphics::DisplayBuffer& display_buffer)
       program_factory{std::make_unique<ProgramFactory>()},
       display_transform(1)
 {
+    glGenBuffers(1, &vertex_buffer);
+
     eglBindAPI(EGL_OPENGL_ES_API);
     EGLDisplay disp = eglGetCurrentDisplay();
     if (disp != EGL_NO_DISPLAY)
@@ -326,6 +412,9 @@ mrg::Renderer::Renderer(graphics::DisplayBuffer& display_buffer)
             auto val = eglQueryString(disp, s.id);
             mir::log_info(std::string(s.label) + ": " + (val ? val : ""));
         }
+
+        auto const extensions = eglQueryString(disp, EGL_EXTENSIONS);
+        has_buffer_age = extensions && strstr(extensions, "EGL_EXT_buffer_age");
     }
 
     struct {GLenum id; char const* label;} const glstrings[] =
@@ -365,6 +454,9 @@ mrg::Renderer::Renderer(graphics::DisplayBuffer& display_buffer)
 mrg::Renderer::~Renderer()
 {
     render_target.ensure_current();
+    glDeleteBuffers(1, &vertex_buffer);
+    for (auto const& uploaded : uploaded_textures)
+        glDeleteTextures(1, &uploaded.second.id);
 }
 
 void mrg::Renderer::tessellate(std::vector<mgl::Primitive>& primitives,
@@ -378,6 +470,27 @@ void mrg::Renderer::render(mg::RenderableList const& renderables) const
 {
     render_target.bind();
 
+    damage_tracker.add_frame(viewport, renderables);
+
+    std::optional<geom::Rectangles> damage;
+    if (has_buffer_age && unscaled_viewport)
+        damage = damage_tracker.damage_for_buffer_age(buffer_age());
+
+    if (damage)
+    {
+        // Only the damaged area of the back buffer needs bringing up to date
+        damage_scissor = damage->bounding_rectangle();
+        glEnable(GL_SCISSOR_TEST);
+        scissor_to(damage_scissor.value());
+    }
+    else
+    {
+        damage_scissor = std::nullopt;
+    }
+
+    if (gpu_timer)
+        gpu_timer->begin_frame();
+
     glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -385,31 +498,94 @@ void mrg::Renderer::render(mg::RenderableList const& renderables) const
     ++frameno;
     for (auto const& r : renderables)
     {
-        draw(*r);
+        // Renderables outside the damage are still showing, so keep their textures. Marking them all
+        // up front also means no renderable takes over a texture that another still needs this frame.
+        if (auto const buffer = r->buffer())
+        {
+            auto const uploaded = uploaded_textures.find(buffer->id());
+            if (uploaded != uploaded_textures.end())
+                uploaded->second.last_used_frameno = frameno;
+        }
+
+        auto const shown = shown_buffers.find(r->id());
+        if (shown != shown_buffers.end())
+            shown->second.last_used_frameno = frameno;
     }
 
-    render_target.swap_buffers();
+    for (auto const& r : renderables)
+    {
+        static glm::mat4 const identity(1);
+        if (damage_scissor &&
+            r->transformation() == identity &&
+            !r->screen_position().overlaps(damage_scissor.value()))
+        {
+            continue;
+        }
+
+        if (!batch_renderables || !batch(*r))
+        {
+            // Anything batched so far belongs underneath
+            draw_batches();
+            draw(*r);
+        }
+    }
+    draw_batches();
+    release_unused_textures();
+
+    if (gpu_timer)
+        gpu_timer->end_frame();
+
+    if (damage)
+    {
+        glDisable(GL_SCISSOR_TEST);
+
+        geom::Rectangles target_damage;
+        for (auto const& rect : *damage)
+            target_damage.add({rect.top_left - as_displacement(viewport.top_left), rect.size});
+
+        render_target.swap_buffers_with_damage(target_damage);
+    }
+    else
+    {
+        render_target.swap_buffers();
+    }
 
     while (auto const gl_error = glGetError())
         mir::log_debug("GL error: %d", gl_error);
 }
 
+int mrg::Renderer::buffer_age() const
+{
+    EGLint age = 0;
+    if (!eglQuerySurface(eglGetCurrentDisplay(), eglGetCurrentSurface(EGL_DRAW), EGL_BUFFER_AGE_EXT, &age))
+        return 0;
+
+    return age;
+}
+
+void mrg::Renderer::scissor_to(geom::Rectangle const& area) const
+{
+    glScissor(
+        area.top_left.x.as_int() -
+            viewport.top_left.x.as_int(),
+        viewport.top_left.y.as_int() +
+            viewport.size.height.as_int() -
+            area.top_left.y.as_int() -
+            area.size.height.as_int(),
+        area.size.width.as_int(),
+        area.size.height.as_int()
+    );
+}
+
 void mrg::Renderer::draw(mg::Renderable const& renderable) const
 {
     auto const clip_area = renderable.clip_area();
     if (clip_area)
     {
         glEnable(GL_SCISSOR_TEST);
-        glScissor(
-            clip_area.value().top_left.x.as_int() -
-                viewport.top_left.x.as_int(),
-            viewport.top_left.y.as_int() +
-                viewport.size.height.as_int() -
-                clip_area.value().top_left.y.as_int() -
-                clip_area.value().size.height.as_int(),
-            clip_area.value().size.width.as_int(), 
-            clip_area.value().size.height.as_int()
-        );
+        scissor_to(damage_scissor ?
+            clip_area.value().intersection_with(damage_scissor.value()) :
+            clip_area.value());
     }
 
     auto const texture = std::dynamic_pointer_cast<mg::gl::Texture>(renderable.buffer());
@@ -419,34 +595,10 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
         return;
     }
 
-    auto const& prog =
-        [this, &texture](bool alpha) -> Program const&
-        {
-                auto const& family = static_cast<::Program const&>(texture->shader(*program_factory));
-                if (alpha)
-                {
-                    return family.alpha;
-                }
-                return family.opaque;
-        }(renderable.alpha() < 1.0f);
+    auto const& family = static_cast<::Program const&>(texture->shader(*program_factory));
+    auto const& prog = renderable.alpha() < 1.0f ? family.alpha : family.opaque;
 
-    glUseProgram(prog.id);
-    if (prog.last_used_frameno != frameno)
-    {   // Avoid reloading the screen-global uniforms on every renderable
-        // TODO: We actually only need to bind these *once*, right? Not once per frame?
-        prog.last_used_frameno = frameno;
-        for (auto i = 0u; i < prog.tex_uniforms.size(); ++i)
-        {
-            if (prog.tex_uniforms[i] != -1)
-            {
-                glUniform1i(prog.tex_uniforms[i], i);
-            }
-        }
-        glUniformMatrix4fv(prog.display_transform_uniform, 1, GL_FALSE,
-                           glm::value_ptr(display_transform));
-        glUniformMatrix4fv(prog.screen_to_gl_coords_uniform, 1, GL_FALSE,
-                           glm::value_ptr(screen_to_gl_coords));
-    }
+    use_program(prog);
 
     glActiveTexture(GL_TEXTURE0);
 
@@ -460,14 +612,8 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
     glm::mat4 transform = renderable.transformation();
     if (texture->layout() == mg::gl::Texture::Layout::TopRowFirst)
     {
-        // GL textures have (0,0) at bottom-left rather than top-left
         // We have to invert this texture to get it the way up GL expects.
-        transform *= glm::mat4{
-            1.0, 0.0, 0.0, 0.0,
-            0.0, -1.0, 0.0, 0.0,
-            0.0, 0.0, 1.0, 0.0,
-            -1.0, 1.0, 0.0, 1.0
-        };
+        transform *= invert_top_row_first;
     }
 
     glUniformMatrix4fv(prog.transform_uniform, 1, GL_FALSE,
@@ -485,74 +631,442 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
     // if we fail to load the texture, we need to carry on (part of lp:1629275)
     try
     {
-        typedef struct  // Represents parameters of glBlendFuncSeparate()
+        auto const blend = blend_for(renderable);
+        auto const uploaded_texture = upload_texture_for(renderable, *renderable.buffer());
+
+        for (auto const& p : primitives)
         {
-            GLenum src_rgb, dst_rgb, src_alpha, dst_alpha;
-        } BlendSeparate;
+            if (uploaded_texture)
+                glBindTexture(GL_TEXTURE_2D, uploaded_texture);
+            else
+                texture->bind();
 
-        BlendSeparate client_blend;
+            glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT,
+                                  GL_FALSE, sizeof(mgl::Vertex),
+                                  &p.vertices[0].position);
+            glVertexAttribPointer(prog.texcoord_attr, 2, GL_FLOAT,
+                                  GL_FALSE, sizeof(mgl::Vertex),
+                                  &p.vertices[0].texcoord);
 
-        // These renderable method names could be better (see LP: #1236224)
-        if (renderable.shaped())  // Client is RGBA:
-        {
-            client_blend = {GL_ONE, GL_ONE_MINUS_SRC_ALPHA,
-                            GL_ONE, GL_ONE_MINUS_SRC_ALPHA};
+            set_blend(blend, renderable.alpha());
+
+            glDrawArrays(p.type, 0, p.nvertices);
+
+            // We're done with the texture for now
+            texture->add_syncpoint();
         }
-        else if (renderable.alpha() == 1.0f)  // RGBX and no window translucency:
+    }
+    catch (std::exception const& ex)
+    {
+        report_exception();
+    }
+
+    glDisableVertexAttribArray(prog.texcoord_attr);
+    glDisableVertexAttribArray(prog.position_attr);
+    if (clip_area)
+    {
+        if (damage_scissor)
+            scissor_to(damage_scissor.value());
+        else
+            glDisable(GL_SCISSOR_TEST);
+    }
+}
+
+void mrg::Renderer::use_program(Program const& prog) const
+{
+    glUseProgram(prog.id);
+    if (prog.last_used_frameno != frameno)
+    {   // Avoid reloading the screen-global uniforms on every renderable
+        // TODO: We actually only need to bind these *once*, right? Not once per frame?
+        prog.last_used_frameno = frameno;
+        for (auto i = 0u; i < prog.tex_uniforms.size(); ++i)
         {
-            client_blend = {GL_ONE,  GL_ZERO,
-                            GL_ZERO, GL_ONE};  // Avoid using src_alpha!
+            if (prog.tex_uniforms[i] != -1)
+            {
+                glUniform1i(prog.tex_uniforms[i], i);
+            }
         }
-        else
-        {   // Client is RGBX but we also have window translucency.
-            // The texture alpha channel is possibly uninitialized so we must be
-            // careful and avoid using SRC_ALPHA (LP: #1423462).
-            client_blend = {GL_ONE,  GL_ONE_MINUS_CONSTANT_ALPHA,
-                            GL_ZERO, GL_ONE};
-            glBlendColor(0.0f, 0.0f, 0.0f, renderable.alpha());
+        glUniformMatrix4fv(prog.display_transform_uniform, 1, GL_FALSE,
+                           glm::value_ptr(display_transform));
+        glUniformMatrix4fv(prog.screen_to_gl_coords_uniform, 1, GL_FALSE,
+                           glm::value_ptr(screen_to_gl_coords));
+    }
+}
+
+auto mrg::Renderer::blend_for(mg::Renderable const& renderable) const -> Blend
+{
+    // These renderable method names could be better (see LP: #1236224)
+    if (renderable.shaped())  // Client is RGBA:
+        return Blend::premultiplied_alpha;
+    else if (renderable.alpha() == 1.0f)  // RGBX and no window translucency:
+        return Blend::none;
+    else
+        return Blend::constant_alpha;
+}
+
+void mrg::Renderer::set_blend(Blend blend, float alpha) const
+{
+    switch (blend)
+    {
+    case Blend::none:
+        glDisable(GL_BLEND);
+        break;
+
+    case Blend::premultiplied_alpha:
+        glEnable(GL_BLEND);
+        glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA,
+                            GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+
+    case Blend::constant_alpha:
+        // Client is RGBX but we also have window translucency.
+        // The texture alpha channel is possibly uninitialized so we must be
+        // careful and avoid using SRC_ALPHA (LP: #1423462).
+        glEnable(GL_BLEND);
+        glBlendFuncSeparate(GL_ONE,  GL_ONE_MINUS_CONSTANT_ALPHA,
+                            GL_ZERO, GL_ONE);
+        glBlendColor(0.0f, 0.0f, 0.0f, alpha);
+        break;
+    }
+}
+
+bool mrg::Renderer::batch(mg::Renderable const& renderable) const
+{
+
+    auto buffer = renderable.buffer();
+    auto const texture = dynamic_cast<mg::gl::Texture*>(buffer.get());
+    if (!texture)
+    {
+        mir::log_error("Buffer does not support GL rendering!");
+        return true;
+    }
+
+    /*
+     * Transform the vertices here rather than in the vertex shader, so that
+     * renderables can share a draw call. That's only possible for affine
+     * transformations: anything else has to go through draw().
+     */
+    glm::mat4 transform = renderable.transformation();
+    if (texture->layout() == mg::gl::Texture::Layout::TopRowFirst)
+        transform *= invert_top_row_first;
+
+    if (!is_affine(transform))
+        return false;
+
+    primitives.clear();
+    tessellate(primitives, renderable);
+
+    auto const first_new_batch = batch_count;
+    if (batch_count == batches.size())
+        batches.emplace_back();
+    auto& next = batches[batch_count];
+    next.vertices.clear();
+
+    for (auto const& p : primitives)
+    {
+        if (!append_triangles(next.vertices, p))
+            return false;
+    }
+
+    auto const& rect = renderable.screen_position();
+    glm::vec4 const centre{
+        rect.top_left.x.as_int() + rect.size.width.as_int() / 2.0f,
+        rect.top_left.y.as_int() + rect.size.height.as_int() / 2.0f,
+        0.0f,
+        0.0f};
+
+    GLfloat left{INFINITY}, top{INFINITY}, right{-INFINITY}, bottom{-INFINITY};
+    bool flat{true};
+    for (auto& vertex : next.vertices)
+    {
+        auto const& p = vertex.position;
+        auto const transformed = transform * (glm::vec4{p[0], p[1], p[2], 1.0f} - centre) + centre;
+        vertex.position[0] = transformed.x;
+        vertex.position[1] = transformed.y;
+        vertex.position[2] = transformed.z;
+
+        left = std::min(left, transformed.x);
+        top = std::min(top, transformed.y);
+        right = std::max(right, transformed.x);
+        bottom = std::max(bottom, transformed.y);
+        flat = flat && transformed.z == 0.0f;
+    }
+
+    auto const& family = static_cast<::Program const&>(texture->shader(*program_factory));
+    auto const alpha = renderable.alpha();
+    next.program = alpha < 1.0f ? &family.alpha : &family.opaque;
+    next.texture = texture;
+    next.uploaded_texture = upload_texture_for(renderable, *buffer);
+    next.blend = blend_for(renderable);
+    next.alpha = alpha;
+    if (auto const clip_area = renderable.clip_area())
+        next.clip_area = clip_area.value();
+    else
+        next.clip_area = std::nullopt;
+
+    // Only renderables at depth zero have a predictable on-screen extent
+    if (flat && left <= right && top <= bottom)
+    {
+        auto const x = static_cast<int>(std::floor(left));
+        auto const y = static_cast<int>(std::floor(top));
+        next.extent = geom::Rectangle{
+            {x, y},
+            {static_cast<int>(std::ceil(right)) - x, static_cast<int>(std::ceil(bottom)) - y}};
+    }
+    else
+    {
+        next.extent = std::nullopt;
+    }
+
+    /*
+     * If an earlier batch uses the same state, and nothing drawn since
+     * overlaps this renderable, we can draw it with that batch without
+     * changing what ends up on screen. Only look a short way back, so
+     * frames of many distinct textures don't cost O(n²) here.
+     */
+    auto const oldest = first_new_batch > max_batch_lookback ? first_new_batch - max_batch_lookback : 0;
+    for (auto i = first_new_batch; i-- != oldest;)
+    {
+        auto& earlier = batches[i];
+
+        if (earlier.program == next.program &&
+            earlier.texture == next.texture &&
+            earlier.uploaded_texture == next.uploaded_texture &&
+            earlier.blend == next.blend &&
+            earlier.alpha == next.alpha &&
+            earlier.clip_area == next.clip_area)
+        {
+            earlier.vertices.insert(earlier.vertices.end(), next.vertices.begin(), next.vertices.end());
+            if (earlier.extent && next.extent)
+                earlier.extent = bounding_box(*earlier.extent, *next.extent);
+            else
+                earlier.extent = std::nullopt;
+            return true;
         }
 
-        for (auto const& p : primitives)
+        if (!next.extent || !earlier.extent || earlier.extent->overlaps(*next.extent))
+            break;
+    }
+
+    next.buffer = std::move(buffer);
+    ++batch_count;
+    return true;
+}
+
+void mrg::Renderer::draw_batches() const
+{
+    if (batch_count == 0)
+        return;
+
+    vertex_data.clear();
+    for (auto i = 0u; i != batch_count; ++i)
+        vertex_data.insert(vertex_data.end(), batches[i].vertices.begin(), batches[i].vertices.end());
+
+    // The whole frame's vertices go to the GPU in one upload
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, vertex_data.size() * sizeof(mgl::Vertex), vertex_data.data(), GL_STREAM_DRAW);
+
+    glActiveTexture(GL_TEXTURE0);
+
+    static glm::mat4 const identity(1);
+    Program const* current_program = nullptr;
+    std::optional<std::pair<Blend, float>> current_blend;
+    std::optional<geom::Rectangle> current_clip;
+    GLint first = 0;
+
+    for (auto i = 0u; i != batch_count; ++i)
+    {
+        auto& batch = batches[i];
+        auto const count = static_cast<GLsizei>(batch.vertices.size());
+
+        if (batch.program != current_program)
         {
-            BlendSeparate blend;
+            if (current_program)
+            {
+                glDisableVertexAttribArray(current_program->texcoord_attr);
+                glDisableVertexAttribArray(current_program->position_attr);
+            }
 
-            blend = client_blend;
-            texture->bind();
+            current_program = batch.program;
+            use_program(*current_program);
 
-            glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT,
-                                  GL_FALSE, sizeof(mgl::Vertex),
-                                  &p.vertices[0].position);
-            glVertexAttribPointer(prog.texcoord_attr, 2, GL_FLOAT,
-                                  GL_FALSE, sizeof(mgl::Vertex),
-                                  &p.vertices[0].texcoord);
+            // The vertices are already transformed
+            glUniformMatrix4fv(current_program->transform_uniform, 1, GL_FALSE, glm::value_ptr(identity));
+            glUniform2f(current_program->centre_uniform, 0.0f, 0.0f);
 
-            if (blend.dst_rgb == GL_ZERO)
+            glEnableVertexAttribArray(current_program->position_attr);
+            glEnableVertexAttribArray(current_program->texcoord_attr);
+            glVertexAttribPointer(current_program->position_attr, 3, GL_FLOAT, GL_FALSE, sizeof(mgl::Vertex),
+                                  reinterpret_cast<GLvoid const*>(offsetof(mgl::Vertex, position)));
+            glVertexAttribPointer(current_program->texcoord_attr, 2, GL_FLOAT, GL_FALSE, sizeof(mgl::Vertex),
+                                  reinterpret_cast<GLvoid const*>(offsetof(mgl::Vertex, texcoord)));
+
+            // Force the alpha uniform to be set for the new program
+            current_blend = std::nullopt;
+        }
+
+        if (current_blend != std::make_pair(batch.blend, batch.alpha))
+        {
+            if (current_program->alpha_uniform >= 0)
+                glUniform1f(current_program->alpha_uniform, batch.alpha);
+
+            set_blend(batch.blend, batch.alpha);
+            current_blend = std::make_pair(batch.blend, batch.alpha);
+        }
+
+        if (batch.clip_area != current_clip)
+        {
+            if (batch.clip_area)
             {
-                glDisable(GL_BLEND);
+                glEnable(GL_SCISSOR_TEST);
+                scissor_to(damage_scissor ?
+                    batch.clip_area.value().intersection_with(damage_scissor.value()) :
+                    batch.clip_area.value());
+            }
+            else if (damage_scissor)
+            {
+                scissor_to(damage_scissor.value());
             }
             else
             {
-                glEnable(GL_BLEND);
-                glBlendFuncSeparate(blend.src_rgb,   blend.dst_rgb,
-                                    blend.src_alpha, blend.dst_alpha);
+                glDisable(GL_SCISSOR_TEST);
             }
+            current_clip = batch.clip_area;
+        }
 
-            glDrawArrays(p.type, 0, p.nvertices);
+        // if we fail to load the texture, we need to carry on (part of lp:1629275)
+        try
+        {
+            if (batch.uploaded_texture)
+                glBindTexture(GL_TEXTURE_2D, batch.uploaded_texture);
+            else
+                batch.texture->bind();
+            glDrawArrays(GL_TRIANGLES, first, count);
 
             // We're done with the texture for now
-            texture->add_syncpoint();
+            batch.texture->add_syncpoint();
+        }
+        catch (std::exception const& ex)
+        {
+            report_exception();
         }
+
+        first += count;
+        batch.buffer = nullptr;
+    }
+
+    glDisableVertexAttribArray(current_program->texcoord_attr);
+    glDisableVertexAttribArray(current_program->position_attr);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (current_clip)
+    {
+        if (damage_scissor)
+            scissor_to(damage_scissor.value());
+        else
+            glDisable(GL_SCISSOR_TEST);
+    }
+
+    batch_count = 0;
+}
+
+GLuint mrg::Renderer::upload_texture_for(mg::Renderable const& renderable, mg::Buffer& buffer) const
+{
+    auto const uploadable = dynamic_cast<mg::gl::UploadableTexture*>(&buffer);
+    if (!uploadable)
+        return 0;
+
+    auto& shown = shown_buffers[renderable.id()];
+    auto const previous = std::exchange(shown.buffer, buffer.id());
+    shown.last_used_frameno = frameno;
+
+    auto existing = uploaded_textures.find(buffer.id());
+    if (existing != uploaded_textures.end() && existing->second.complete)
+    {
+        existing->second.last_used_frameno = frameno;
+        return existing->second.id;
+    }
+
+    std::optional<geom::Rectangles> damage;
+    if (existing == uploaded_textures.end())
+    {
+        UploadedTexture uploaded;
+
+        // If nothing is still showing the renderable's old buffer, patch up its texture with what changed
+        auto const reusable = uploaded_textures.find(previous);
+        if (previous != buffer.id() &&
+            reusable != uploaded_textures.end() &&
+            reusable->second.last_used_frameno != frameno)
+        {
+            uploaded = reusable->second;
+            uploaded_textures.erase(reusable);
+
+            // Only a texture of the same geometry can be patched up with the damage
+            if (uploaded.complete &&
+                uploaded.size == buffer.size() &&
+                uploaded.format == buffer.pixel_format())
+            {
+                damage = renderable.damage_since(previous);
+            }
+        }
+        else
+        {
+            glGenTextures(1, &uploaded.id);
+            glBindTexture(GL_TEXTURE_2D, uploaded.id);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+
+        existing = uploaded_textures.emplace(buffer.id(), uploaded).first;
+    }
+
+    auto& uploaded = existing->second;
+    uploaded.last_used_frameno = frameno;
+    glBindTexture(GL_TEXTURE_2D, uploaded.id);
+
+    // if we fail to load the texture, we need to carry on (part of lp:1629275)
+    try
+    {
+        uploadable->upload_to_bound_texture(damage);
     }
     catch (std::exception const& ex)
     {
         report_exception();
+        // The content is unknown until the next full upload
+        uploaded.complete = false;
+        return uploaded.id;
     }
 
-    glDisableVertexAttribArray(prog.texcoord_attr);
-    glDisableVertexAttribArray(prog.position_attr);
-    if (renderable.clip_area())
+    uploaded.complete = true;
+    uploaded.size = buffer.size();
+    uploaded.format = buffer.pixel_format();
+
+    return uploaded.id;
+}
+
+void mrg::Renderer::release_unused_textures() const
+{
+    for (auto i = uploaded_textures.begin(); i != uploaded_textures.end();)
     {
-        glDisable(GL_SCISSOR_TEST);
+        if (i->second.last_used_frameno != frameno)
+        {
+            glDeleteTextures(1, &i->second.id);
+            i = uploaded_textures.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    for (auto i = shown_buffers.begin(); i != shown_buffers.end();)
+    {
+        if (i->second.last_used_frameno != frameno)
+            i = shown_buffers.erase(i);
+        else
+            ++i;
     }
 }
 
@@ -632,6 +1146,15 @@ void mrg::Renderer::update_gl_viewport()
         GLint offset_y = (buf_height - reduced_height) / 2;
 
         glViewport(offset_x, offset_y, reduced_width, reduced_height);
+
+        unscaled_viewport =
+            display_transform == glm::mat4(1) &&
+            buf_width == viewport.size.width.as_int() &&
+            buf_height == viewport.size.height.as_int();
+    }
+    else
+    {
+        unscaled_viewport = false;
     }
 }
 
@@ -647,5 +1170,20 @@ void mrg::Renderer::set_output_transform(glm::mat2 const& t)
 
 void mrg::Renderer::suspend()
 {
+    // What is on screen is no longer what we last rendered
+    damage_tracker.reset();
+}
+
+auto mrg::Renderer::completed_gpu_time() -> std::optional<std::chrono::nanoseconds>
+{
+    // Any timer queries belong to our context
+    render_target.ensure_current();
+    if (!gpu_timer)
+    {
+        gpu_timer = GPUTimer::create();
+        return std::nullopt;
+    }
+
+    return gpu_timer->completed_frame();
 }
 
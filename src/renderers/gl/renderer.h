@@ -24,20 +24,29 @@
 #include <mir/graphics/buffer_id.h>
 #include <mir/graphics/renderable.h>
 #include <mir/gl/primitive.h>
+#include <mir_toolkit/common.h>
 #include "mir/renderer/gl/render_target.h"
+#include "damage_tracker.h"
 
 #include <GLES2/gl2.h>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace mir
 {
-namespace graphics { class DisplayBuffer; }
+namespace graphics
+{
+class Buffer;
+class DisplayBuffer;
+namespace gl { class Texture; }
+}
 namespace renderer
 {
 namespace gl
 {
+class GPUTimer;
 
 class CurrentRenderTarget
 {
@@ -48,6 +57,7 @@ public:
     void ensure_current();
     void bind();
     void swap_buffers();
+    void swap_buffers_with_damage(geometry::Rectangles const& damage);
 
 private:
     renderer::gl::RenderTarget* const render_target;
@@ -67,6 +77,9 @@ public:
     // This is called _without_ a GL context:
     void suspend() override;
 
+    // This is called after render():
+    auto completed_gpu_time() -> std::optional<std::chrono::nanoseconds> override;
+
     struct Program
     {
         GLuint id = 0;
@@ -113,17 +126,110 @@ protected:
 
     mutable long long frameno = 0;
 
+    /**
+     * Whether renderables are gathered into batches sharing one vertex buffer
+     * and drawn with as few GL calls as possible. Otherwise (and for anything
+     * that can't be batched) each renderable is drawn individually by draw().
+     *
+     * Subclasses overriding draw() will want to clear this.
+     */
+    bool batch_renderables = true;
+
     virtual void draw(graphics::Renderable const& renderable) const;
 
 private:
+    enum class Blend
+    {
+        none,
+        premultiplied_alpha,
+        constant_alpha
+    };
+
+    /// Consecutive triangles drawn with the same GL state
+    struct Batch
+    {
+        Program const* program;
+        std::shared_ptr<graphics::Buffer> buffer;
+        graphics::gl::Texture* texture;
+        /// The texture the buffer was uploaded into, if it's not bound with texture->bind()
+        GLuint uploaded_texture;
+        Blend blend;
+        float alpha;
+        std::optional<geometry::Rectangle> clip_area;
+        /// The screen area covered, for deciding whether a later batch can be merged in
+        std::optional<geometry::Rectangle> extent;
+        std::vector<mir::gl::Vertex> vertices;
+    };
+
     void update_gl_viewport();
+    int buffer_age() const;
+    void scissor_to(geometry::Rectangle const& area) const;
+    void use_program(Program const& prog) const;
+    auto blend_for(graphics::Renderable const& renderable) const -> Blend;
+    void set_blend(Blend blend, float alpha) const;
+
+    /**
+     * Add the renderable to the pending batches.
+     *
+     * \return false if it can't be batched and must be drawn on its own.
+     */
+    bool batch(graphics::Renderable const& renderable) const;
+    void draw_batches() const;
+
+    /// A texture holding the content of a buffer that must be uploaded from CPU memory
+    struct UploadedTexture
+    {
+        GLuint id = 0;
+        /// False if the upload failed, so the content is unknown
+        bool complete = false;
+        geometry::Size size;
+        MirPixelFormat format = mir_pixel_format_invalid;
+        long long last_used_frameno = 0;
+    };
+
+    /// The buffer a renderable showed when last drawn
+    struct ShownBuffer
+    {
+        graphics::BufferID buffer;
+        long long last_used_frameno = 0;
+    };
+
+    /**
+     * Find or make the UploadedTexture for the buffer. Renderables showing
+     * the same buffer share its texture. A new buffer takes over the texture
+     * of the one the renderable showed before, if nothing else still shows
+     * that, and only what changed since is uploaded.
+     *
+     * \return The texture to draw with, or 0 if the buffer isn't a
+     *         graphics::gl::UploadableTexture and must bind() its own.
+     */
+    GLuint upload_texture_for(graphics::Renderable const& renderable, graphics::Buffer& buffer) const;
+    /// Free the textures of buffers that weren't in the latest frame
+    void release_unused_textures() const;
 
     class ProgramFactory;
     std::unique_ptr<ProgramFactory> const program_factory;
+    /// Only created once completed_gpu_time() is called
+    std::unique_ptr<GPUTimer> gpu_timer;
     geometry::Rectangle viewport;
     glm::mat4 screen_to_gl_coords;
     glm::mat4 display_transform;
     std::vector<mir::gl::Primitive> mutable primitives;
+
+    std::vector<Batch> mutable batches;
+    /// How many of batches are in use this frame; the rest keep their allocations for reuse
+    size_t mutable batch_count = 0;
+    std::vector<mir::gl::Vertex> mutable vertex_data;
+    GLuint vertex_buffer = 0;
+    std::unordered_map<graphics::BufferID, UploadedTexture> mutable uploaded_textures;
+    std::unordered_map<graphics::Renderable::ID, ShownBuffer> mutable shown_buffers;
+
+    bool has_buffer_age = false;
+    /// Whether view area pixels map 1:1 onto render target pixels
+    bool unscaled_viewport = false;
+    DamageTracker mutable damage_tracker;
+    /// The area being repainted this frame, if not the whole viewport
+    std::optional<geometry::Rectangle> mutable damage_scissor;
 };
 
 }
@@ -0,0 +1,299 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "blend.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIR_SOFTWARE_BLEND_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace mrs = mir::renderer::software;
+
+/*
+ * All the implementations compute exactly the same result:
+ *
+ *   src' = src × alpha
+ *   dst  = src' + dst × (1 - src'.alpha)
+ *
+ * with each channel an 8-bit fraction of 255, rounded to nearest and the sum
+ * saturated. They're tested against each other, so keep them in step.
+ */
+
+namespace
+{
+uint32_t const alpha_mask = 0xff000000;
+
+/// x / 255, rounded to nearest; exact for x ≤ 255 × 255
+inline uint32_t div255(uint32_t x)
+{
+    auto const t = x + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+/// Every channel of pixel × factor / 255
+inline uint32_t scale(uint32_t pixel, uint32_t factor)
+{
+    // Two channels at a time, each in its own 16-bit lane
+    auto rb = (pixel & 0x00ff00ff) * factor + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+    auto ag = ((pixel >> 8) & 0x00ff00ff) * factor + 0x00800080;
+    ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+    return rb | ag;
+}
+
+/// Channel-wise a + b, saturating
+inline uint32_t add_saturate(uint32_t a, uint32_t b)
+{
+    uint32_t result{0};
+    for (auto shift = 0; shift != 32; shift += 8)
+    {
+        auto const sum = ((a >> shift) & 0xff) + ((b >> shift) & 0xff);
+        result |= (sum > 0xff ? 0xff : sum) << shift;
+    }
+    return result;
+}
+
+inline uint32_t blend_pixel(uint32_t dst, uint32_t src, uint8_t alpha, bool opaque)
+{
+    if (opaque)
+        src |= alpha_mask;
+    if (alpha != 0xff)
+        src = scale(src, alpha);
+
+    auto const inverse = 0xff - (src >> 24);
+    if (inverse == 0)
+        return src;
+    if (src == 0)
+        return dst;
+
+    return add_saturate(src, scale(dst, inverse));
+}
+
+void blend_row_scalar(uint32_t* dst, uint32_t const* src, size_t count, uint8_t alpha, bool opaque)
+{
+    for (size_t i = 0; i != count; ++i)
+        dst[i] = blend_pixel(dst[i], src[i], alpha, opaque);
+}
+
+#ifdef MIR_SOFTWARE_BLEND_X86
+__attribute__((target("sse2")))
+inline __m128i div255_sse2(__m128i x)
+{
+    auto const t = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+/// Each 16-bit lane of the pixel's alpha, repeated across its channels
+__attribute__((target("sse2")))
+inline __m128i spread_alpha_sse2(__m128i pixels16)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+__attribute__((target("sse2")))
+void blend_row_sse2(uint32_t* dst, uint32_t const* src, size_t count, uint8_t alpha, bool opaque)
+{
+    auto const zero = _mm_setzero_si128();
+    auto const all_alpha = _mm_set1_epi32(alpha_mask);
+    auto const max = _mm_set1_epi16(0xff);
+    auto const global_alpha = _mm_set1_epi16(alpha);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        auto s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+        if (opaque)
+            s = _mm_or_si128(s, all_alpha);
+        if (alpha != 0xff)
+        {
+            auto const lo = div255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), global_alpha));
+            auto const hi = div255_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), global_alpha));
+            s = _mm_packus_epi16(lo, hi);
+        }
+
+        // Fully opaque pixels simply replace what's underneath
+        auto const opaque_pixels = _mm_cmpeq_epi32(_mm_and_si128(s, all_alpha), all_alpha);
+        if (_mm_movemask_epi8(opaque_pixels) == 0xffff)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+            continue;
+        }
+
+        auto const d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dst + i));
+        auto const s_lo = _mm_unpacklo_epi8(s, zero);
+        auto const s_hi = _mm_unpackhi_epi8(s, zero);
+        auto const d_lo = div255_sse2(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(max, spread_alpha_sse2(s_lo))));
+        auto const d_hi = div255_sse2(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(max, spread_alpha_sse2(s_hi))));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epu8(s, _mm_packus_epi16(d_lo, d_hi)));
+    }
+
+    blend_row_scalar(dst + i, src + i, count - i, alpha, opaque);
+}
+
+__attribute__((target("avx2")))
+inline __m256i div255_avx2(__m256i x)
+{
+    auto const t = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+inline __m256i spread_alpha_avx2(__m256i pixels16)
+{
+    return _mm256_shufflehi_epi16(
+        _mm256_shufflelo_epi16(pixels16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+/// As blend_row_sse2(), eight pixels at a time. (Unpacking and packing both
+/// work within 128-bit lanes, so the pixels come back out in order.)
+__attribute__((target("avx2")))
+void blend_row_avx2(uint32_t* dst, uint32_t const* src, size_t count, uint8_t alpha, bool opaque)
+{
+    auto const zero = _mm256_setzero_si256();
+    auto const all_alpha = _mm256_set1_epi32(alpha_mask);
+    auto const max = _mm256_set1_epi16(0xff);
+    auto const global_alpha = _mm256_set1_epi16(alpha);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        auto s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+        if (opaque)
+            s = _mm256_or_si256(s, all_alpha);
+        if (alpha != 0xff)
+        {
+            auto const lo = div255_avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), global_alpha));
+            auto const hi = div255_avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), global_alpha));
+            s = _mm256_packus_epi16(lo, hi);
+        }
+
+        auto const opaque_pixels = _mm256_cmpeq_epi32(_mm256_and_si256(s, all_alpha), all_alpha);
+        if (_mm256_movemask_epi8(opaque_pixels) == -1)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), s);
+            continue;
+        }
+
+        auto const d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst + i));
+        auto const s_lo = _mm256_unpacklo_epi8(s, zero);
+        auto const s_hi = _mm256_unpackhi_epi8(s, zero);
+        auto const d_lo = div255_avx2(
+            _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_sub_epi16(max, spread_alpha_avx2(s_lo))));
+        auto const d_hi = div255_avx2(
+            _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_sub_epi16(max, spread_alpha_avx2(s_hi))));
+
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(dst + i), _mm256_adds_epu8(s, _mm256_packus_epi16(d_lo, d_hi)));
+    }
+
+    blend_row_sse2(dst + i, src + i, count - i, alpha, opaque);
+}
+#endif
+
+#ifdef __ARM_NEON
+inline uint8x8_t div255_neon(uint16x8_t x)
+{
+    auto const t = vaddq_u16(x, vdupq_n_u16(128));
+    return vmovn_u16(vshrq_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8));
+}
+
+/// Eight pixels at a time, de-interleaved so that each vector holds one channel
+void blend_row_neon(uint32_t* dst, uint32_t const* src, size_t count, uint8_t alpha, bool opaque)
+{
+    auto const global_alpha = vdup_n_u8(alpha);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        auto s = vld4_u8(reinterpret_cast<uint8_t const*>(src + i));
+        if (opaque)
+            s.val[3] = vdup_n_u8(0xff);
+        if (alpha != 0xff)
+        {
+            for (auto c = 0; c != 4; ++c)
+                s.val[c] = div255_neon(vmull_u8(s.val[c], global_alpha));
+        }
+
+        auto d = vld4_u8(reinterpret_cast<uint8_t const*>(dst + i));
+        auto const inverse = vmvn_u8(s.val[3]);
+        for (auto c = 0; c != 4; ++c)
+            d.val[c] = vqadd_u8(s.val[c], div255_neon(vmull_u8(d.val[c], inverse)));
+
+        vst4_u8(reinterpret_cast<uint8_t*>(dst + i), d);
+    }
+
+    blend_row_scalar(dst + i, src + i, count - i, alpha, opaque);
+}
+#endif
+}
+
+auto mrs::available_blend_implementations() -> std::vector<BlendImplementation>
+{
+    std::vector<BlendImplementation> implementations{BlendImplementation::scalar};
+
+#ifdef MIR_SOFTWARE_BLEND_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        implementations.push_back(BlendImplementation::sse2);
+    if (__builtin_cpu_supports("avx2"))
+        implementations.push_back(BlendImplementation::avx2);
+#endif
+
+#ifdef __ARM_NEON
+    implementations.push_back(BlendImplementation::neon);
+#endif
+
+    return implementations;
+}
+
+auto mrs::blend_row_for(BlendImplementation implementation) -> BlendRow
+{
+    switch (implementation)
+    {
+    case BlendImplementation::scalar:
+        return &blend_row_scalar;
+#ifdef MIR_SOFTWARE_BLEND_X86
+    case BlendImplementation::sse2:
+        return &blend_row_sse2;
+    case BlendImplementation::avx2:
+        return &blend_row_avx2;
+#endif
+#ifdef __ARM_NEON
+    case BlendImplementation::neon:
+        return &blend_row_neon;
+#endif
+    default:
+        BOOST_THROW_EXCEPTION((std::logic_error{"Blend implementation not available in this build"}));
+    }
+}
+
+auto mrs::blend_row() -> BlendRow
+{
+    static BlendRow const fastest = blend_row_for(available_blend_implementations().back());
+    return fastest;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_SOFTWARE_BLEND_H_
+#define MIR_RENDERER_SOFTWARE_BLEND_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mir
+{
+namespace renderer
+{
+namespace software
+{
+
+/**
+ * Composites a row of pixels "over" the destination row.
+ *
+ * Pixels are 32 bits with alpha in the top byte (as in the _8888 formats of
+ * MirPixelFormat) and premultiplied alpha, as Wayland clients provide. The
+ * order of the colour channels doesn't matter, so long as src and dst agree.
+ *
+ * \param dst     [in,out]  The row to blend onto
+ * \param src     [in]      The row to blend; src and dst must not overlap
+ * \param count   [in]      The number of pixels in each row
+ * \param alpha   [in]      Opacity applied to the whole of src (255 = as is)
+ * \param opaque  [in]      Treat src as having no alpha channel
+ */
+using BlendRow = void (*)(uint32_t* dst, uint32_t const* src, size_t count, uint8_t alpha, bool opaque);
+
+enum class BlendImplementation
+{
+    scalar,
+    sse2,
+    avx2,
+    neon
+};
+
+/// The implementations that this build can use on this CPU, fastest last
+auto available_blend_implementations() -> std::vector<BlendImplementation>;
+
+/// The given implementation, which must be one of the available ones
+auto blend_row_for(BlendImplementation implementation) -> BlendRow;
+
+/// The fastest implementation for this CPU
+auto blend_row() -> BlendRow;
+
+}
+}
+}
+
+#endif // MIR_RENDERER_SOFTWARE_BLEND_H_
@@ -0,0 +1,225 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define MIR_LOG_COMPONENT "SoftwareRenderer"
+
+#include "renderer.h"
+#include "mir/renderer/sw/render_target.h"
+#include "mir/renderer/sw/pixel_source.h"
+#include "mir/graphics/display_buffer.h"
+#include "mir/graphics/buffer.h"
+#include "mir/log.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace mg = mir::graphics;
+namespace mrs = mir::renderer::software;
+
+namespace
+{
+/// The 32-bit formats blend() understands, by where they keep red
+enum class ChannelOrder
+{
+    unsupported,
+    rgb,    // red in bits 16-23
+    bgr     // red in bits 0-7
+};
+
+auto channel_order(MirPixelFormat format) -> ChannelOrder
+{
+    switch (format)
+    {
+    case mir_pixel_format_argb_8888:
+    case mir_pixel_format_xrgb_8888:
+        return ChannelOrder::rgb;
+    case mir_pixel_format_abgr_8888:
+    case mir_pixel_format_xbgr_8888:
+        return ChannelOrder::bgr;
+    default:
+        return ChannelOrder::unsupported;
+    }
+}
+
+bool has_alpha(MirPixelFormat format)
+{
+    return format == mir_pixel_format_argb_8888 || format == mir_pixel_format_abgr_8888;
+}
+
+inline uint32_t swap_red_and_blue(uint32_t pixel)
+{
+    return (pixel & 0xff00ff00) | ((pixel >> 16) & 0xff) | ((pixel & 0xff) << 16);
+}
+
+auto render_target_for(mg::DisplayBuffer& display_buffer) -> mrs::RenderTarget&
+{
+    auto const render_target = dynamic_cast<mrs::RenderTarget*>(display_buffer.native_display_buffer());
+    if (!render_target)
+        BOOST_THROW_EXCEPTION(std::logic_error("DisplayBuffer does not support software rendering"));
+
+    return *render_target;
+}
+
+auto row_of(mrs::Mapping<unsigned char>& mapping, int y) -> uint32_t*
+{
+    return reinterpret_cast<uint32_t*>(mapping.data() + y * mapping.stride().as_int());
+}
+
+auto row_of(mrs::Mapping<unsigned char const>& mapping, int y) -> uint32_t const*
+{
+    return reinterpret_cast<uint32_t const*>(mapping.data() + y * mapping.stride().as_int());
+}
+}
+
+mrs::Renderer::Renderer(graphics::DisplayBuffer& display_buffer)
+    : render_target{render_target_for(display_buffer)},
+      blend{blend_row()},
+      viewport{display_buffer.view_area()}
+{
+}
+
+void mrs::Renderer::set_viewport(geometry::Rectangle const& rect)
+{
+    viewport = rect;
+}
+
+void mrs::Renderer::set_output_transform(glm::mat2 const&)
+{
+}
+
+void mrs::Renderer::suspend()
+{
+}
+
+auto mrs::Renderer::completed_gpu_time() -> std::optional<std::chrono::nanoseconds>
+{
+    return std::nullopt;
+}
+
+void mrs::Renderer::render(mg::RenderableList const& renderables) const
+{
+    {
+        auto const target = render_target.map_back_buffer();
+        if (channel_order(target->format()) == ChannelOrder::unsupported)
+            BOOST_THROW_EXCEPTION(std::logic_error("Software render target has an unsupported pixel format"));
+
+        auto const width = target->size().width.as_int();
+        for (auto y = 0; y != target->size().height.as_int(); ++y)
+        {
+            auto const row = row_of(*target, y);
+            std::fill(row, row + width, 0xff000000);
+        }
+
+        for (auto const& renderable : renderables)
+            draw(*renderable, *target);
+    }
+
+    render_target.swap_buffers();
+}
+
+void mrs::Renderer::draw(mg::Renderable const& renderable, Mapping<unsigned char>& target) const
+{
+    std::shared_ptr<ReadMappableBuffer> buffer;
+    try
+    {
+        buffer = as_read_mappable_buffer(renderable.buffer());
+    }
+    catch (std::runtime_error const&)
+    {
+        mir::log_debug("Skipping renderable: buffer does not support CPU access");
+        return;
+    }
+
+    auto const source = buffer->map_readable();
+    auto const source_order = channel_order(source->format());
+    if (source_order == ChannelOrder::unsupported)
+    {
+        mir::log_debug("Skipping renderable: unsupported pixel format %d", source->format());
+        return;
+    }
+    if (source->size().width.as_int() <= 0 || source->size().height.as_int() <= 0)
+        return;
+
+    auto const position = renderable.screen_position();
+    auto visible = intersection_of(position, viewport);
+    if (auto const clip = renderable.clip_area())
+        visible = intersection_of(visible, clip.value());
+    if (visible.size.width.as_int() <= 0 || visible.size.height.as_int() <= 0)
+        return;
+
+    // Map target pixels to screen coordinates (for scaled outputs) and then to buffer texels
+    auto const target_size = target.size();
+    double const screen_per_pixel_x = double(viewport.size.width.as_int()) / target_size.width.as_int();
+    double const screen_per_pixel_y = double(viewport.size.height.as_int()) / target_size.height.as_int();
+    double const texel_per_screen_x = double(source->size().width.as_int()) / position.size.width.as_int();
+    double const texel_per_screen_y = double(source->size().height.as_int()) / position.size.height.as_int();
+
+    auto const first_pixel = [](int screen, int origin, double screen_per_pixel, int limit)
+        {
+            return std::clamp(int(std::ceil((screen - origin) / screen_per_pixel - 0.5)), 0, limit);
+        };
+    auto const x0 = first_pixel(visible.left().as_int(), viewport.left().as_int(), screen_per_pixel_x, target_size.width.as_int());
+    auto const x1 = first_pixel(visible.right().as_int(), viewport.left().as_int(), screen_per_pixel_x, target_size.width.as_int());
+    auto const y0 = first_pixel(visible.top().as_int(), viewport.top().as_int(), screen_per_pixel_y, target_size.height.as_int());
+    auto const y1 = first_pixel(visible.bottom().as_int(), viewport.top().as_int(), screen_per_pixel_y, target_size.height.as_int());
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    // Nearest texel to the centre of a target pixel
+    auto const texel = [](int pixel, int origin, int position, double screen_per_pixel, double texel_per_screen, int limit)
+        {
+            auto const screen = origin + (pixel + 0.5) * screen_per_pixel;
+            return std::clamp(int((screen - position) * texel_per_screen), 0, limit - 1);
+        };
+
+    auto const count = x1 - x0;
+    std::vector<int> columns(count);
+    for (auto i = 0; i != count; ++i)
+    {
+        columns[i] = texel(
+            x0 + i, viewport.left().as_int(), position.left().as_int(),
+            screen_per_pixel_x, texel_per_screen_x, source->size().width.as_int());
+    }
+
+    // Rows of consecutive texels in the right channel order can be blended in place
+    auto const swap_channels = source_order != channel_order(target.format());
+    auto const contiguous = !swap_channels &&
+        std::adjacent_find(columns.begin(), columns.end(), [](int a, int b) { return b != a + 1; }) == columns.end();
+    row.resize(count);
+
+    auto const opaque = !has_alpha(source->format()) || !renderable.shaped();
+    auto const alpha = static_cast<uint8_t>(std::lround(std::clamp(renderable.alpha(), 0.0f, 1.0f) * 255));
+
+    for (auto y = y0; y != y1; ++y)
+    {
+        auto const source_row = row_of(*source, texel(
+            y, viewport.top().as_int(), position.top().as_int(),
+            screen_per_pixel_y, texel_per_screen_y, source->size().height.as_int()));
+
+        uint32_t const* pixels = source_row + columns.front();
+        if (!contiguous)
+        {
+            for (auto i = 0; i != count; ++i)
+                row[i] = swap_channels ? swap_red_and_blue(source_row[columns[i]]) : source_row[columns[i]];
+            pixels = row.data();
+        }
+
+        blend(row_of(target, y) + x0, pixels, count, alpha, opaque);
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_SOFTWARE_RENDERER_H_
+#define MIR_RENDERER_SOFTWARE_RENDERER_H_
+
+#include "mir/renderer/renderer.h"
+#include "blend.h"
+
+#include <vector>
+
+namespace mir
+{
+namespace graphics
+{
+class DisplayBuffer;
+}
+namespace renderer
+{
+namespace software
+{
+class RenderTarget;
+template<typename T> class Mapping;
+
+/**
+ * Composites shm (and other CPU-mappable) buffers into a
+ * software::RenderTarget, with no need for a GPU.
+ *
+ * Renderables are drawn at their screen position, scaled (nearest
+ * neighbour) to fit. Renderable and output transformations other than
+ * scaling aren't supported, and are ignored. Buffers that can't be mapped
+ * by the CPU, or aren't in a 32-bit RGB format, are skipped.
+ */
+class Renderer : public renderer::Renderer
+{
+public:
+    Renderer(graphics::DisplayBuffer& display_buffer);
+
+    void set_viewport(geometry::Rectangle const& rect) override;
+    void set_output_transform(glm::mat2 const&) override;
+    void render(graphics::RenderableList const&) const override;
+    void suspend() override;
+
+    /// There's no GPU time to report: rendering is all in render()
+    auto completed_gpu_time() -> std::optional<std::chrono::nanoseconds> override;
+
+private:
+    void draw(
+        graphics::Renderable const& renderable,
+        Mapping<unsigned char>& target) const;
+
+    RenderTarget& render_target;
+    BlendRow const blend;
+    geometry::Rectangle viewport;
+
+    /// Scratch space for source rows that need converting before blending
+    std::vector<uint32_t> mutable row;
+};
+
+}
+}
+}
+
+#endif // MIR_RENDERER_SOFTWARE_RENDERER_H_
@@ -0,0 +1,81 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "deadline_frame_scheduler.h"
+#include "mir/graphics/display.h"
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+// 250µs bins up to 50ms, over roughly the last two seconds at 60Hz
+auto const bin_width = 250us;
+size_t const bins = 200;
+size_t const window = 128;
+
+// Don't trust the histogram until it has seen a few frames
+size_t const min_samples = 8;
+
+// Aim to have this fraction of frames ready in time...
+double const percentile = 0.99;
+
+// ...allowing for the GPU finishing and the kernel scheduling the flip
+auto const safety_margin = 2ms;
+}
+
+mc::DeadlineFrameScheduler::DeadlineFrameScheduler() :
+    render_times{bin_width, bins, window}
+{
+}
+
+auto mc::DeadlineFrameScheduler::delay_after_post(
+    mg::DisplaySyncGroup const& group,
+    std::chrono::nanoseconds render_time) -> std::chrono::nanoseconds
+{
+    render_times.record(render_time);
+
+    auto const timing = group.vblank_timing();
+    if (!timing || timing->refresh_interval <= 0ns || render_times.samples() < min_samples)
+        return group.recommended_sleep();
+
+    auto const interval = timing->refresh_interval;
+    auto const budget = render_times.percentile(percentile) + safety_margin;
+
+    // Rendering takes (nearly) a whole frame; any delay would cost a frame
+    if (budget >= interval)
+        return 0ns;
+
+    auto const& last_vblank = timing->last_vblank.ust;
+    auto const now = mir::time::PosixTimestamp::now(last_vblank.clock_id);
+    auto const since_vblank = now - last_vblank;
+    auto const until_vblank = interval - (since_vblank > 0ns ? since_vblank % interval : 0ns);
+
+    /*
+     * If there isn't time to render for the next vblank starting now, the
+     * frame won't be seen before the one after, so we may as well sample the
+     * scene as late as possible for that one.
+     */
+    return until_vblank > budget ? until_vblank - budget : until_vblank + interval - budget;
+}
+
+auto mc::DeadlineFrameSchedulerFactory::create_scheduler_for(mg::DisplaySyncGroup const& /*group*/)
+    -> std::unique_ptr<FrameScheduler>
+{
+    return std::make_unique<DeadlineFrameScheduler>();
+}
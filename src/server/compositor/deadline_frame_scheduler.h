@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_DEADLINE_FRAME_SCHEDULER_H_
+#define MIR_COMPOSITOR_DEADLINE_FRAME_SCHEDULER_H_
+
+#include "mir/compositor/frame_scheduler.h"
+#include "render_time_histogram.h"
+
+namespace mir
+{
+namespace compositor
+{
+
+/**
+ * Starts each frame as late as it safely can before the next vblank.
+ *
+ * The next vblank is predicted from the timing of the last one reported by
+ * the platform, and the time needed to render is taken from a high percentile
+ * of recent render times plus a safety margin. If the platform does not report
+ * vblank timing, or too few frames have been seen to predict render times,
+ * the group's recommended_sleep() is used instead.
+ */
+class DeadlineFrameScheduler : public FrameScheduler
+{
+public:
+    DeadlineFrameScheduler();
+
+    auto delay_after_post(
+        graphics::DisplaySyncGroup const& group,
+        std::chrono::nanoseconds render_time) -> std::chrono::nanoseconds override;
+
+private:
+    RenderTimeHistogram render_times;
+};
+
+class DeadlineFrameSchedulerFactory : public FrameSchedulerFactory
+{
+public:
+    auto create_scheduler_for(graphics::DisplaySyncGroup const& group) -> std::unique_ptr<FrameScheduler> override;
+};
+
+}
+}
+
+#endif /* MIR_COMPOSITOR_DEADLINE_FRAME_SCHEDULER_H_ */
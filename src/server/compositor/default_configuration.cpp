@@ -22,7 +22,13 @@
 #include "buffer_stream_factory.h"
 #include "default_display_buffer_compositor_factory.h"
 #include "multi_threaded_compositor.h"
+#include "fixed_delay_frame_scheduler.h"
+#include "deadline_frame_scheduler.h"
 #include "gl/renderer_factory.h"
+#include "software/renderer_factory.h"
+#include "mir/renderer/renderer.h"
+#include "mir/renderer/sw/render_target.h"
+#include "mir/graphics/display_buffer.h"
 #include "mir/main_loop.h"
 
 #include "mir/options/configuration.h"
@@ -30,6 +36,28 @@
 namespace mc = mir::compositor;
 namespace ms = mir::scene;
 namespace mf = mir::frontend;
+namespace mg = mir::graphics;
+
+namespace
+{
+/// Renders each display buffer with the renderer its platform supports
+class NativeRendererFactory : public mir::renderer::RendererFactory
+{
+public:
+    std::unique_ptr<mir::renderer::Renderer> create_renderer_for(
+        mg::DisplayBuffer& display_buffer) override
+    {
+        if (dynamic_cast<mir::renderer::software::RenderTarget*>(display_buffer.native_display_buffer()))
+            return software.create_renderer_for(display_buffer);
+
+        return gl.create_renderer_for(display_buffer);
+    }
+
+private:
+    mir::renderer::gl::RendererFactory gl;
+    mir::renderer::software::RendererFactory software;
+};
+}
 
 std::shared_ptr<ms::BufferStreamFactory>
 mir::DefaultServerConfiguration::the_buffer_stream_factory()
@@ -65,25 +93,38 @@ mir::DefaultServerConfiguration::the_compositor()
     return compositor(
         [this]()
         {
-            std::chrono::milliseconds const composite_delay(
-                the_options()->get<int>(options::composite_delay_opt));
-
             return std::make_shared<mc::MultiThreadedCompositor>(
                 the_display(),
                 the_scene(),
                 the_display_buffer_compositor_factory(),
                 the_shell(),
                 the_compositor_report(),
-                composite_delay,
+                the_frame_scheduler_factory(),
                 true);
         });
 }
 
+std::shared_ptr<mc::FrameSchedulerFactory>
+mir::DefaultServerConfiguration::the_frame_scheduler_factory()
+{
+    return frame_scheduler_factory(
+        [this]() -> std::shared_ptr<mc::FrameSchedulerFactory>
+        {
+            std::chrono::milliseconds const composite_delay(
+                the_options()->get<int>(options::composite_delay_opt));
+
+            if (composite_delay >= std::chrono::milliseconds::zero())
+                return std::make_shared<mc::FixedDelayFrameSchedulerFactory>(composite_delay);
+
+            return std::make_shared<mc::DeadlineFrameSchedulerFactory>();
+        });
+}
+
 std::shared_ptr<mir::renderer::RendererFactory> mir::DefaultServerConfiguration::the_renderer_factory()
 {
     return renderer_factory(
         []()
         {
-            return std::make_shared<mir::renderer::gl::RendererFactory>();
+            return std::make_shared<NativeRendererFactory>();
         });
 }
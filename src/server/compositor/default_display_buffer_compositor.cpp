@@ -27,6 +27,8 @@
 #include "mir/renderer/renderer.h"
 #include "occlusion.h"
 
+#include <chrono>
+
 namespace mc = mir::compositor;
 namespace mg = mir::graphics;
 
@@ -36,13 +38,15 @@ mc::DefaultDisplayBufferCompositor::DefaultDisplayBufferCompositor(
     std::shared_ptr<mc::CompositorReport> const& report) :
     display_buffer(display_buffer),
     renderer(renderer),
-    report(report)
+    report(report),
+    time_gpu{report->wants_gpu_times()}
 {
 }
 
 void mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& scene_elements)
 {
     report->began_frame(this);
+    auto const start = std::chrono::steady_clock::now();
 
     auto const& view_area = display_buffer.view_area();
     auto const& occlusions = mc::filter_occlusions_from(scene_elements, view_area);
@@ -68,8 +72,11 @@ void mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
      */
     scene_elements.clear();  // Those in use are still in renderable_list
 
-    if (display_buffer.overlay(renderable_list))
+    // Renderables the display shows on hardware planes are held by the display buffer
+    auto to_render = renderable_list;
+    if (display_buffer.overlay_some(to_render))
     {
+        report->frame_cpu_time(this, std::chrono::steady_clock::now() - start);
         report->renderables_in_frame(this, renderable_list);
         renderer->suspend();
     }
@@ -77,11 +84,19 @@ void mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
     {
         renderer->set_output_transform(display_buffer.transformation());
         renderer->set_viewport(view_area);
-        renderer->render(renderable_list);
+        renderer->render(to_render);
+        report->frame_cpu_time(this, std::chrono::steady_clock::now() - start);
 
         report->renderables_in_frame(this, renderable_list);
         report->rendered_frame(this);
 
+        // This is usually for an earlier frame: the GPU is likely still busy with this one
+        if (time_gpu)
+        {
+            if (auto const gpu_time = renderer->completed_gpu_time())
+                report->frame_gpu_time(this, *gpu_time);
+        }
+
         /*
          * This is used for the 'early release' optimization to release buffers
          * we did use back to clients before starting on the potentially slow
@@ -94,6 +109,7 @@ void mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
          *        acquisition calls when we composite the next frame.
          */
         renderable_list.clear();
+        to_render.clear();
     }
 
     report->finished_frame(this);
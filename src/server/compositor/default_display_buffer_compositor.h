@@ -52,6 +52,7 @@ private:
     graphics::DisplayBuffer& display_buffer;
     std::shared_ptr<renderer::Renderer> const renderer;
     std::shared_ptr<CompositorReport> const report;
+    bool const time_gpu;
 };
 
 }
@@ -19,8 +19,8 @@
 #ifndef MIR_COMPOSITOR_DROPPING_SCHEDULE_H_
 #define MIR_COMPOSITOR_DROPPING_SCHEDULE_H_
 #include "schedule.h"
+#include <atomic>
 #include <memory>
-#include <mutex>
 
 namespace mir
 {
@@ -31,13 +31,14 @@ class DroppingSchedule : public Schedule
 {
 public:
     DroppingSchedule();
+    ~DroppingSchedule();
     void schedule(std::shared_ptr<graphics::Buffer> const& buffer) override;
     unsigned int num_scheduled() override;
     std::shared_ptr<graphics::Buffer> next_buffer() override;
 
 private:
-    std::mutex mutable mutex;
-    std::shared_ptr<graphics::Buffer> the_only_buffer;
+    /// Boxed, so that it can be handed over with a single atomic exchange
+    std::atomic<std::shared_ptr<graphics::Buffer>*> the_only_buffer{nullptr};
 };
 }
 }
@@ -0,0 +1,43 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fixed_delay_frame_scheduler.h"
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+
+mc::FixedDelayFrameScheduler::FixedDelayFrameScheduler(std::chrono::milliseconds delay) :
+    delay{delay}
+{
+}
+
+auto mc::FixedDelayFrameScheduler::delay_after_post(
+    mg::DisplaySyncGroup const& /*group*/,
+    std::chrono::nanoseconds /*render_time*/) -> std::chrono::nanoseconds
+{
+    return delay;
+}
+
+mc::FixedDelayFrameSchedulerFactory::FixedDelayFrameSchedulerFactory(std::chrono::milliseconds delay) :
+    delay{delay}
+{
+}
+
+auto mc::FixedDelayFrameSchedulerFactory::create_scheduler_for(mg::DisplaySyncGroup const& /*group*/)
+    -> std::unique_ptr<FrameScheduler>
+{
+    return std::make_unique<FixedDelayFrameScheduler>(delay);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_FIXED_DELAY_FRAME_SCHEDULER_H_
+#define MIR_COMPOSITOR_FIXED_DELAY_FRAME_SCHEDULER_H_
+
+#include "mir/compositor/frame_scheduler.h"
+
+namespace mir
+{
+namespace compositor
+{
+
+/// Waits the same time after every frame (as set by --composite-delay)
+class FixedDelayFrameScheduler : public FrameScheduler
+{
+public:
+    explicit FixedDelayFrameScheduler(std::chrono::milliseconds delay);
+
+    auto delay_after_post(
+        graphics::DisplaySyncGroup const& group,
+        std::chrono::nanoseconds render_time) -> std::chrono::nanoseconds override;
+
+private:
+    std::chrono::milliseconds const delay;
+};
+
+class FixedDelayFrameSchedulerFactory : public FrameSchedulerFactory
+{
+public:
+    explicit FixedDelayFrameSchedulerFactory(std::chrono::milliseconds delay);
+
+    auto create_scheduler_for(graphics::DisplaySyncGroup const& group) -> std::unique_ptr<FrameScheduler> override;
+
+private:
+    std::chrono::milliseconds const delay;
+};
+
+}
+}
+
+#endif /* MIR_COMPOSITOR_FIXED_DELAY_FRAME_SCHEDULER_H_ */
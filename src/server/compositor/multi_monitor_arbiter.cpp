@@ -22,16 +22,183 @@
 #include "schedule.h"
 #include <boost/throw_exception.hpp>
 
+#include <algorithm>
+#include <thread>
+#include <utility>
+
 namespace mg = mir::graphics;
 namespace mc = mir::compositor;
 namespace mf = mir::frontend;
 
+namespace
+{
+/*
+ * Frame::state holds the sequence number of the frame's buffer (0 if it has
+ * none) above the number of threads that have the frame pinned. A frame is
+ * only written by a thread that has first swapped its state from "unpinned" to
+ * busy_seq, and readers only pin a frame whose sequence number matches the
+ * current one, so nobody reads a frame while it's being rewritten.
+ *
+ * Sequence numbers are never reused, so there's no ABA problem.
+ */
+int const pin_bits{16};
+uint64_t const pin_mask{(uint64_t{1} << pin_bits) - 1};
+uint64_t const busy_seq{~uint64_t{0} >> pin_bits};
+
+auto seq_of_state(uint64_t state) -> uint64_t { return state >> pin_bits; }
+auto pins_of(uint64_t state) -> uint64_t { return state & pin_mask; }
+auto make_state(uint64_t seq) -> uint64_t { return seq << pin_bits; }
+
+/// MultiMonitorArbiter::current holds the current frame's sequence number above its index
+int const index_bits{2};
+auto seq_of_current(uint64_t current) -> uint64_t { return current >> index_bits; }
+auto index_of(uint64_t current) -> size_t { return current & ((1u << index_bits) - 1); }
+auto make_current(uint64_t seq, size_t index) -> uint64_t { return seq << index_bits | index; }
+}
+
+bool mc::MultiMonitorArbiter::Frame::has_user(CompositorID id)
+{
+    if (std::any_of(users.begin(), users.end(), [id](auto const& user) { return user.load() == id; }))
+        return true;
+
+    if (!overflowed.load())
+        return false;
+
+    std::lock_guard<decltype(overflow_mutex)> lock{overflow_mutex};
+    return std::find(overflow_users.begin(), overflow_users.end(), id) != overflow_users.end();
+}
+
+void mc::MultiMonitorArbiter::Frame::add_user(CompositorID id)
+{
+    // Users fill the slots in order, and are only cleared all at once
+    for (auto& user : users)
+    {
+        CompositorID expected{nullptr};
+        if (user.compare_exchange_strong(expected, id) || expected == id)
+            return;
+    }
+
+    // More compositors than slots is rare enough that it can take a lock
+    std::lock_guard<decltype(overflow_mutex)> lock{overflow_mutex};
+    if (std::find(overflow_users.begin(), overflow_users.end(), id) == overflow_users.end())
+        overflow_users.push_back(id);
+    overflowed = true;
+}
+
+void mc::MultiMonitorArbiter::Frame::clear_users()
+{
+    for (auto& user : users)
+        user = nullptr;
+
+    if (overflowed.exchange(false))
+    {
+        std::lock_guard<decltype(overflow_mutex)> lock{overflow_mutex};
+        overflow_users.clear();
+    }
+}
+
+/// Keeps a frame from being rewritten while we look at it
+class mc::MultiMonitorArbiter::PinnedFrame
+{
+public:
+    PinnedFrame() = default;
+
+    PinnedFrame(MultiMonitorArbiter* arbiter, Frame* frame, uint64_t pinned_as) :
+        arbiter{arbiter},
+        frame{frame},
+        pinned_as{pinned_as}
+    {
+    }
+
+    PinnedFrame(PinnedFrame&& that) noexcept :
+        arbiter{that.arbiter},
+        frame{std::exchange(that.frame, nullptr)},
+        pinned_as{that.pinned_as}
+    {
+    }
+
+    auto operator=(PinnedFrame&& that) noexcept -> PinnedFrame&
+    {
+        if (frame)
+            arbiter->unpin(*frame);
+        arbiter = that.arbiter;
+        frame = std::exchange(that.frame, nullptr);
+        pinned_as = that.pinned_as;
+        return *this;
+    }
+
+    ~PinnedFrame()
+    {
+        if (frame)
+            arbiter->unpin(*frame);
+    }
+
+    explicit operator bool() const
+    {
+        return frame;
+    }
+
+    /// The value of MultiMonitorArbiter::current when we pinned the frame
+    auto current() const -> uint64_t
+    {
+        return frame ? pinned_as : 0;
+    }
+
+    auto buffer() const -> std::shared_ptr<mg::Buffer> const&
+    {
+        return frame->buffer;
+    }
+
+    bool has_user(CompositorID id) const
+    {
+        return frame->has_user(id);
+    }
+
+    void add_user(CompositorID id)
+    {
+        frame->add_user(id);
+    }
+
+private:
+    MultiMonitorArbiter* arbiter{nullptr};
+    Frame* frame{nullptr};
+    uint64_t pinned_as{0};
+};
+
+/// Exclusive use of the schedule
+class mc::MultiMonitorArbiter::Advancing
+{
+public:
+    /// If wait is false and another thread is advancing, we don't get exclusive use
+    Advancing(std::atomic<bool>& flag, bool wait) :
+        flag{flag}
+    {
+        while (!(owned = !flag.exchange(true)) && wait)
+            std::this_thread::yield();
+    }
+
+    ~Advancing()
+    {
+        if (owned)
+            flag = false;
+    }
+
+    explicit operator bool() const
+    {
+        return owned;
+    }
+
+private:
+    std::atomic<bool>& flag;
+    bool owned;
+};
+
 mc::MultiMonitorArbiter::MultiMonitorArbiter(
     std::shared_ptr<Schedule> const& schedule) :
-    schedule(schedule)
+    schedule{schedule.get()},
+    schedules{schedule}
 {
-    // We're highly unlikely to have more than 6 outputs
-    current_buffer_users.reserve(6);
+    static_assert(std::tuple_size<decltype(frames)>::value <= (1u << index_bits));
 }
 
 mc::MultiMonitorArbiter::~MultiMonitorArbiter()
@@ -40,115 +207,241 @@ mc::MultiMonitorArbiter::~MultiMonitorArbiter()
 
 std::shared_ptr<mg::Buffer> mc::MultiMonitorArbiter::compositor_acquire(compositor::CompositorID id)
 {
-    std::lock_guard<decltype(mutex)> lk(mutex);
+    auto frame = pin_current();
 
     // If there is no current buffer or there is, but this compositor is already using it...
-    if (!current_buffer || is_user_of_current_buffer(id))
+    if ((!frame || frame.has_user(id)) && num_scheduled() > 0)
     {
-        // And if there is a scheduled buffer
-        if (schedule->num_scheduled() > 0)
-        {
-            // Advance the current buffer
-            current_buffer = schedule->next_buffer();
-            clear_current_users();
-        }
-        // Otherwise leave the current buffer alone
+        // ...try to advance the current buffer (letting go of the old one, so it can be released)
+        auto const seen = frame.current();
+        frame = PinnedFrame{};
+        advance_unless_current_changed(seen);
+        frame = pin_current();
     }
 
     // If there was no current buffer and we weren't able to set one, throw and exception
-    if (!current_buffer)
+    if (!frame)
         BOOST_THROW_EXCEPTION(std::logic_error("no buffer to give to compositor"));
 
     // The compositor is now a user of the current buffer
     // This means we will try to give it a new buffer next time it asks
-    add_current_buffer_user(id);
-    return current_buffer;
+    frame.add_user(id);
+    return frame.buffer();
 }
 
 std::shared_ptr<mg::Buffer> mc::MultiMonitorArbiter::snapshot_acquire()
 {
-    std::lock_guard<decltype(mutex)> lk(mutex);
+    auto frame = pin_current();
 
-    if (!current_buffer)
+    if (!frame && num_scheduled() > 0)
     {
-        if (schedule->num_scheduled() > 0)
-        {
-            current_buffer = schedule->next_buffer();
-            clear_current_users();
-        }
-        else
-        {
-            BOOST_THROW_EXCEPTION(std::logic_error("no buffer to give to snapshotter"));
-        }
+        advance_unless_current_changed(0);
+        frame = pin_current();
     }
 
-    return current_buffer;
+    if (!frame)
+        BOOST_THROW_EXCEPTION(std::logic_error("no buffer to give to snapshotter"));
+
+    return frame.buffer();
 }
 
 void mc::MultiMonitorArbiter::set_schedule(std::shared_ptr<Schedule> const& new_schedule)
 {
-    std::lock_guard<decltype(mutex)> lk(mutex);
-    schedule = new_schedule;
+    Advancing const exclusive{advancing, true};
+
+    if (std::find(schedules.begin(), schedules.end(), new_schedule) == schedules.end())
+        schedules.push_back(new_schedule);
+    schedule = new_schedule.get();
+    prune_schedules();
 }
 
 bool mc::MultiMonitorArbiter::buffer_ready_for(mc::CompositorID id)
 {
-    std::lock_guard<decltype(mutex)> lk(mutex);
     // If there are scheduled buffers then there is one ready for any compositor
-    if (schedule->num_scheduled() > 0)
+    if (num_scheduled() > 0)
         return true;
+
     // If we have a current buffer that the compositor isn't yet using, it is ready
-    else if (current_buffer && !is_user_of_current_buffer(id))
-        return true;
-    // There are no scheduled buffers and either no current buffer, or a current buffer already used by this compositor
-    else
-        return false;
+    for (;;)
+    {
+        auto const seen = current.load();
+        if (!seen)
+            return false;
+
+        // We don't need to pin the frame just to look: if it isn't rewritten meanwhile, the answer stands
+        auto& frame = frames[index_of(seen)];
+        if (seq_of_state(frame.state.load()) != seq_of_current(seen))
+            continue;
+
+        bool const used = frame.has_user(id);
+
+        if (seq_of_state(frame.state.load()) == seq_of_current(seen))
+            return !used;
+    }
 }
 
 void mc::MultiMonitorArbiter::advance_schedule()
 {
-    std::lock_guard<decltype(mutex)> lk(mutex);
+    Advancing const exclusive{advancing, true};
+
+    auto const schedule = this->schedule.load();
     if (schedule->num_scheduled() > 0)
-    {
-        current_buffer = schedule->next_buffer();
-        clear_current_users();
-    } 
+        advance(schedule->next_buffer());
 }
 
-void mc::MultiMonitorArbiter::add_current_buffer_user(mc::CompositorID id)
+void mc::MultiMonitorArbiter::transfer_schedule(std::shared_ptr<Schedule> const& new_schedule)
 {
-    // First try and find an empty slot in our vector…
-    for (auto& slot : current_buffer_users)
+    Advancing const exclusive{advancing, true};
+
+    auto const old_schedule = schedule.load();
+    std::vector<std::shared_ptr<mg::Buffer>> transferred_buffers;
+    while (old_schedule->num_scheduled())
+        transferred_buffers.emplace_back(old_schedule->next_buffer());
+    for (auto& buffer : transferred_buffers)
+        new_schedule->schedule(buffer);
+
+    if (std::find(schedules.begin(), schedules.end(), new_schedule) == schedules.end())
+        schedules.push_back(new_schedule);
+    schedule = new_schedule.get();
+    prune_schedules();
+}
+
+void mc::MultiMonitorArbiter::advance_to_newest()
+{
+    Advancing const exclusive{advancing, true};
+
+    auto const schedule = this->schedule.load();
+    std::shared_ptr<mg::Buffer> newest;
+    while (schedule->num_scheduled())
+        newest = schedule->next_buffer();
+
+    if (newest)
+        advance(std::move(newest));
+}
+
+auto mc::MultiMonitorArbiter::pin_current() -> PinnedFrame
+{
+    for (;;)
     {
-        if (!slot)
+        auto const pinned_as = current.load();
+        if (!pinned_as)
+            return {};
+
+        auto& frame = frames[index_of(pinned_as)];
+        auto state = frame.state.load();
+        while (seq_of_state(state) == seq_of_current(pinned_as))
         {
-            slot = id;
-            return;
+            if (frame.state.compare_exchange_weak(state, state + 1))
+                return {this, &frame, pinned_as};
         }
+
+        // The frame was retired as we looked at it, so there's a newer current frame
     }
-    //…no empty slot, so we'll need to grow the vector.
-    current_buffer_users.push_back({id});
 }
 
-bool mc::MultiMonitorArbiter::is_user_of_current_buffer(mir::compositor::CompositorID id)
+void mc::MultiMonitorArbiter::unpin(Frame& frame)
 {
-    return std::any_of(
-        current_buffer_users.begin(),
-        current_buffer_users.end(),
-        [id](auto const& slot)
+    auto const state = frame.state.fetch_sub(1) - 1;
+
+    // If the frame stopped being current while we were reading it, it's up to us to release its buffer
+    if (pins_of(state) == 0 && seq_of_state(state) != seq_of_current(current.load()))
+        try_retire(frame, state);
+}
+
+bool mc::MultiMonitorArbiter::try_retire(Frame& frame, uint64_t seen_state)
+{
+    auto const seq = seq_of_state(seen_state);
+    if (pins_of(seen_state) != 0 || seq == 0 || seq == busy_seq ||
+        !frame.state.compare_exchange_strong(seen_state, make_state(busy_seq)))
+        return false;
+
+    auto const released = std::move(frame.buffer);
+    frame.clear_users();
+    frame.state = make_state(0);
+    return true;
+}
+
+void mc::MultiMonitorArbiter::advance(std::shared_ptr<mg::Buffer>&& buffer)
+{
+    // Catch up on pruning that readers held off
+    prune_schedules();
+
+    auto const previous = current.load();
+    auto const seq = ++last_seq;
+
+    for (;;)
+    {
+        for (auto i = 0u; i != frames.size(); ++i)
         {
-            if (slot)
+            if (previous && i == index_of(previous))
+                continue;
+
+            auto& frame = frames[i];
+            auto state = frame.state.load();
+            if (pins_of(state) != 0 || seq_of_state(state) == busy_seq ||
+                !frame.state.compare_exchange_strong(state, make_state(busy_seq)))
+                continue;
+
+            auto const stale = std::exchange(frame.buffer, std::move(buffer));
+            frame.clear_users();
+            frame.state = make_state(seq);
+            current = make_current(seq, i);
+
+            if (previous)
             {
-                return *slot == id;
+                auto& previous_frame = frames[index_of(previous)];
+                try_retire(previous_frame, previous_frame.state.load());
             }
-            return false;
-        });
+            return;
+        }
+
+        // Every spare frame is pinned by a reader that's about to let go of it
+        std::this_thread::yield();
+    }
 }
 
-void mc::MultiMonitorArbiter::clear_current_users()
+bool mc::MultiMonitorArbiter::advance_unless_current_changed(uint64_t seen_current)
 {
-    for (auto& slot : current_buffer_users)
+    // With no buffer at all to fall back on, we have to wait for anyone else advancing
+    Advancing const exclusive{advancing, !seen_current};
+
+    // If someone else is advancing, or has since advanced, there's a newer buffer already
+    if (!exclusive || current.load() != seen_current)
+        return false;
+
+    auto const schedule = this->schedule.load();
+    if (schedule->num_scheduled() == 0)
+        return false;
+
+    advance(schedule->next_buffer());
+    return true;
+}
+
+auto mc::MultiMonitorArbiter::num_scheduled() -> unsigned int
+{
+    struct Reading
     {
-        slot = {};
-    }
+        explicit Reading(std::atomic<int>& readers) : readers{readers} { ++readers; }
+        ~Reading() { --readers; }
+        std::atomic<int>& readers;
+    } const reading{schedule_readers};
+
+    return schedule.load()->num_scheduled();
+}
+
+void mc::MultiMonitorArbiter::prune_schedules()
+{
+    if (schedules.size() < 2)
+        return;
+
+    // schedule has already been replaced, so any reader that arrives after this check gets the new one
+    if (schedule_readers.load() != 0)
+        return;
+
+    auto const current_schedule = schedule.load();
+    schedules.erase(
+        std::remove_if(
+            schedules.begin(), schedules.end(),
+            [current_schedule](auto const& s) { return s.get() != current_schedule; }),
+        schedules.end());
 }
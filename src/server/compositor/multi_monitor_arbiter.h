@@ -21,10 +21,12 @@
 #include "mir/compositor/compositor_id.h"
 #include "mir/graphics/buffer_id.h"
 #include "buffer_acquisition.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <vector>
-#include <experimental/optional>
 
 namespace mir
 {
@@ -33,6 +35,18 @@ namespace compositor
 {
 class Schedule;
 
+/**
+ * Hands the buffers a client schedules out to (possibly many) compositors.
+ *
+ * Compositors never wait on each other or on the client: the current buffer
+ * is published through a small pool of frames that readers pin with an atomic
+ * reference count, and only one thread at a time advances the schedule.
+ * A compositor that finds another thread advancing simply uses whatever
+ * buffer is current.
+ *
+ * The schedule itself is expected to be thread-safe, and num_scheduled() to be
+ * cheap, as it is queried for every compositor on every frame.
+ */
 class MultiMonitorArbiter : public BufferAcquisition 
 {
 public:
@@ -46,15 +60,57 @@ public:
     bool buffer_ready_for(compositor::CompositorID id);
     void advance_schedule();
 
+    /// Reschedule anything pending on the current schedule onto new_schedule, and use that from now on
+    void transfer_schedule(std::shared_ptr<Schedule> const& new_schedule);
+    /// Drop all but the most recently scheduled buffer, and make that one current
+    void advance_to_newest();
+
 private:
-    void add_current_buffer_user(compositor::CompositorID id);
-    bool is_user_of_current_buffer(compositor::CompositorID id);
-    void clear_current_users();
-
-    std::mutex mutable mutex;
-    std::shared_ptr<graphics::Buffer> current_buffer;
-    std::vector<std::experimental::optional<compositor::CompositorID>> current_buffer_users;
-    std::shared_ptr<Schedule> schedule;
+    /// The most compositors we track per buffer without locking; any more go on a locked overflow list
+    static size_t const max_users{8};
+
+    struct Frame
+    {
+        /// The frame's sequence number and the number of threads reading it
+        std::atomic<uint64_t> state{0};
+        std::shared_ptr<graphics::Buffer> buffer;
+        std::array<std::atomic<CompositorID>, max_users> users{};
+        /// Set once every slot in users is taken
+        std::atomic<bool> overflowed{false};
+        std::mutex overflow_mutex;
+        std::vector<CompositorID> overflow_users;
+
+        bool has_user(CompositorID id);
+        void add_user(CompositorID id);
+        /// Only called by the thread rewriting the frame
+        void clear_users();
+    };
+    class PinnedFrame;
+    class Advancing;
+
+    auto pin_current() -> PinnedFrame;
+    void unpin(Frame& frame);
+    bool try_retire(Frame& frame, uint64_t seen_state);
+    void advance(std::shared_ptr<graphics::Buffer>&& buffer);
+    bool advance_unless_current_changed(uint64_t seen_current);
+    /// Query the schedule without exclusive use of it
+    auto num_scheduled() -> unsigned int;
+    /// Drop schedules we've replaced, if nobody can still be querying them; needs exclusive use
+    void prune_schedules();
+
+    /// Enough for the current frame, the one being written, and readers lagging behind
+    std::array<Frame, 4> frames;
+    /// The sequence number and index of the current frame, or 0 if there is none
+    std::atomic<uint64_t> current{0};
+    /// Set while a thread has exclusive use of the schedule
+    std::atomic<bool> advancing{false};
+    /// Guarded by advancing
+    uint64_t last_seq{0};
+    std::atomic<Schedule*> schedule;
+    /// The number of threads in num_scheduled()
+    std::atomic<int> schedule_readers{0};
+    /// The schedules we've been given that readers may still be querying; guarded by advancing
+    std::vector<std::shared_ptr<Schedule>> schedules;
 };
 
 }
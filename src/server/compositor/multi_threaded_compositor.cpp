@@ -22,6 +22,7 @@
 #include "mir/compositor/display_buffer_compositor.h"
 #include "mir/compositor/display_buffer_compositor_factory.h"
 #include "mir/compositor/display_listener.h"
+#include "mir/compositor/frame_scheduler.h"
 #include "mir/compositor/scene.h"
 #include "mir/compositor/compositor_report.h"
 #include "mir/scene/legacy_scene_change_notification.h"
@@ -36,6 +37,8 @@
 #include <thread>
 #include <chrono>
 #include <condition_variable>
+#include <algorithm>
+#include <iterator>
 #include <boost/throw_exception.hpp>
 
 using namespace std::literals::chrono_literals;
@@ -57,14 +60,14 @@ public:
         mg::DisplaySyncGroup& group,
         std::shared_ptr<mc::Scene> const& scene,
         std::shared_ptr<DisplayListener> const& display_listener,
-        std::chrono::milliseconds fixed_composite_delay,
+        FrameSchedulerFactory& frame_scheduler_factory,
         std::shared_ptr<CompositorReport> const& report) :
         compositor_factory{db_compositor_factory},
         group(group),
         scene(scene),
         running{true},
         frames_scheduled{0},
-        force_sleep{fixed_composite_delay},
+        frame_scheduler{frame_scheduler_factory.create_scheduler_for(group)},
         display_listener{display_listener},
         report{report},
         started_future{started.get_future()},
@@ -143,12 +146,19 @@ public:
                     not_posted_yet = false;
                     lock.unlock();
 
+                    auto const render_start = std::chrono::steady_clock::now();
                     for (auto& tuple : compositors)
                     {
                         auto& compositor = std::get<1>(tuple);
                         compositor->composite(scene->scene_elements_for(compositor.get()));
                     }
+                    auto const render_time = std::chrono::steady_clock::now() - render_start;
                     group.post();
+                    auto const post_wait = std::chrono::steady_clock::now() - render_start - render_time;
+
+                    // The outputs of a group are posted together, so share the wait
+                    for (auto& tuple : compositors)
+                        report->frame_post_wait(std::get<1>(tuple).get(), post_wait);
 
                     /*
                      * "Predictive bypass" optimization: If the last frame was
@@ -157,9 +167,7 @@ public:
                      * the latency between snapshotting the scene and post()
                      * completing by almost a whole frame.
                      */
-                    auto delay = force_sleep >= std::chrono::milliseconds::zero() ?
-                                 force_sleep : group.recommended_sleep();
-                    std::this_thread::sleep_for(delay);
+                    std::this_thread::sleep_for(frame_scheduler->delay_after_post(group, render_time));
 
                     lock.lock();
 
@@ -238,6 +246,11 @@ public:
         started_future.get();
     }
 
+    auto sync_group() const -> mg::DisplaySyncGroup const&
+    {
+        return group;
+    }
+
     void wait_until_stopped()
     {
         stop();
@@ -253,7 +266,7 @@ private:
     std::shared_ptr<mc::Scene> const scene;
     bool running;
     int frames_scheduled;
-    std::chrono::milliseconds force_sleep{-1};
+    std::unique_ptr<FrameScheduler> const frame_scheduler;
     std::mutex run_mutex;
     std::condition_variable run_cv;
     std::shared_ptr<DisplayListener> const display_listener;
@@ -274,7 +287,7 @@ mc::MultiThreadedCompositor::MultiThreadedCompositor(
     std::shared_ptr<DisplayBufferCompositorFactory> const& db_compositor_factory,
     std::shared_ptr<DisplayListener> const& display_listener,
     std::shared_ptr<CompositorReport> const& compositor_report,
-    std::chrono::milliseconds fixed_composite_delay,
+    std::shared_ptr<FrameSchedulerFactory> const& frame_scheduler_factory,
     bool compose_on_start)
     : display{display},
       scene{scene},
@@ -282,7 +295,7 @@ mc::MultiThreadedCompositor::MultiThreadedCompositor(
       display_listener{display_listener},
       report{compositor_report},
       state{CompositorState::stopped},
-      fixed_composite_delay{fixed_composite_delay},
+      frame_scheduler_factory{frame_scheduler_factory},
       compose_on_start{compose_on_start}
 {
     observer = std::make_shared<ms::LegacySceneChangeNotification>(
@@ -304,6 +317,7 @@ mc::MultiThreadedCompositor::~MultiThreadedCompositor()
 void mc::MultiThreadedCompositor::schedule_compositing(int num)
 {
     report->scheduled();
+    std::lock_guard<std::mutex> lock{thread_functors_mutex};
     for (auto& f : thread_functors)
         f->schedule_compositing(num);
 }
@@ -311,6 +325,7 @@ void mc::MultiThreadedCompositor::schedule_compositing(int num)
 void mc::MultiThreadedCompositor::schedule_compositing(int num, geometry::Rectangle const& damage) const
 {
     report->scheduled();
+    std::lock_guard<std::mutex> lock{thread_functors_mutex};
     for (auto& f : thread_functors)
         f->schedule_compositing(num, damage);
 }
@@ -370,16 +385,106 @@ void mc::MultiThreadedCompositor::stop()
     state = CompositorState::stopped;
 }
 
+void mc::MultiThreadedCompositor::reconfigure(
+    std::function<bool(mg::DisplaySyncGroup const&)> const& preserved,
+    std::function<void()> const& change)
+{
+    auto started = CompositorState::started;
+
+    // If we're not running there's nothing to keep running
+    if (!state.compare_exchange_strong(started, CompositorState::stopping))
+    {
+        Compositor::reconfigure(preserved, change);
+        return;
+    }
+
+    auto const restore_state = mir::raii::paired_calls(
+        []{},
+        [this] { state = CompositorState::started; });
+
+    /* Stop compositing to the groups that the change will destroy... */
+    std::vector<std::unique_ptr<CompositingFunctor>> retired;
+    {
+        std::lock_guard<std::mutex> lock{thread_functors_mutex};
+        auto const retiring = std::stable_partition(
+            thread_functors.begin(), thread_functors.end(),
+            [&preserved](auto const& f) { return preserved(f->sync_group()); });
+
+        std::move(retiring, thread_functors.end(), std::back_inserter(retired));
+        thread_functors.erase(retiring, thread_functors.end());
+    }
+
+    for (auto& f : retired)
+        f->stop();
+
+    for (auto& f : retired)
+        f->wait_until_stopped();
+
+    retired.clear();
+
+    /*
+     * ...and, whether or not the change succeeds, start compositing to any
+     * groups we're not already compositing to.
+     */
+    try
+    {
+        change();
+    }
+    catch (...)
+    {
+        create_compositing_threads_for_new_groups();
+        throw;
+    }
+
+    create_compositing_threads_for_new_groups();
+}
+
+void mc::MultiThreadedCompositor::create_compositing_threads_for_new_groups()
+{
+    std::vector<std::unique_ptr<CompositingFunctor>> added;
+    display->for_each_display_sync_group([this, &added](mg::DisplaySyncGroup& group)
+    {
+        auto const existing = std::find_if(
+            thread_functors.begin(), thread_functors.end(),
+            [&group](auto const& f) { return &f->sync_group() == &group; });
+
+        if (existing == thread_functors.end())
+            added.push_back(start_compositing_thread(group));
+    });
+
+    {
+        std::lock_guard<std::mutex> lock{thread_functors_mutex};
+        for (auto& functor : added)
+            thread_functors.push_back(std::move(functor));
+    }
+
+    auto const first_added = thread_functors.end() - added.size();
+    for (auto f = first_added; f != thread_functors.end(); ++f)
+        (*f)->wait_until_started();
+
+    for (auto f = first_added; f != thread_functors.end(); ++f)
+        (*f)->schedule_compositing(1);
+}
+
+auto mc::MultiThreadedCompositor::start_compositing_thread(mg::DisplaySyncGroup& group)
+    -> std::unique_ptr<CompositingFunctor>
+{
+    auto thread_functor = std::make_unique<mc::CompositingFunctor>(
+        display_buffer_compositor_factory, group, scene, display_listener,
+        *frame_scheduler_factory, report);
+
+    mir::system_executor.spawn(std::ref(*thread_functor));
+    return thread_functor;
+}
+
 void mc::MultiThreadedCompositor::create_compositing_threads()
 {
     /* Start the display buffer compositing threads */
     display->for_each_display_sync_group([this](mg::DisplaySyncGroup& group)
     {
-        auto thread_functor = std::make_unique<mc::CompositingFunctor>(
-            display_buffer_compositor_factory, group, scene, display_listener,
-            fixed_composite_delay, report);
+        auto thread_functor = start_compositing_thread(group);
 
-        mir::system_executor.spawn(std::ref(*thread_functor));
+        std::lock_guard<std::mutex> lock{thread_functors_mutex};
         thread_functors.push_back(std::move(thread_functor));
     });
 
@@ -389,11 +494,16 @@ void mc::MultiThreadedCompositor::create_compositing_threads()
 
 void mc::MultiThreadedCompositor::destroy_compositing_threads()
 {
-    for (auto& f : thread_functors)
+    std::vector<std::unique_ptr<CompositingFunctor>> destroyed;
+    {
+        std::lock_guard<std::mutex> lock{thread_functors_mutex};
+        destroyed = std::move(thread_functors);
+        thread_functors.clear();
+    }
+
+    for (auto& f : destroyed)
         f->stop();
 
-    for (auto& f : thread_functors)
+    for (auto& f : destroyed)
         f->wait_until_stopped();
-
-    thread_functors.clear();
 }
@@ -25,7 +25,6 @@
 #include <memory>
 #include <vector>
 #include <future>
-#include <chrono>
 #include <atomic>
 
 namespace mir
@@ -34,6 +33,7 @@ namespace geometry { struct Rectangle; }
 namespace graphics
 {
 class Display;
+class DisplaySyncGroup;
 }
 namespace scene
 {
@@ -48,6 +48,7 @@ class DisplayListener;
 class CompositingFunctor;
 class Scene;
 class CompositorReport;
+class FrameSchedulerFactory;
 
 enum class CompositorState
 {
@@ -66,16 +67,21 @@ public:
         std::shared_ptr<DisplayBufferCompositorFactory> const& db_compositor_factory,
         std::shared_ptr<DisplayListener> const& display_listener,
         std::shared_ptr<CompositorReport> const& compositor_report,
-        std::chrono::milliseconds fixed_composite_delay,  // -1 = automatic
+        std::shared_ptr<FrameSchedulerFactory> const& frame_scheduler_factory,
         bool compose_on_start);
     ~MultiThreadedCompositor();
 
     void start();
     void stop();
+    void reconfigure(
+        std::function<bool(graphics::DisplaySyncGroup const&)> const& preserved,
+        std::function<void()> const& change) override;
 
 private:
     void create_compositing_threads();
     void destroy_compositing_threads();
+    void create_compositing_threads_for_new_groups();
+    auto start_compositing_thread(graphics::DisplaySyncGroup& group) -> std::unique_ptr<CompositingFunctor>;
 
     std::shared_ptr<graphics::Display> const display;
     std::shared_ptr<Scene> const scene;
@@ -83,10 +89,12 @@ private:
     std::shared_ptr<DisplayListener> const display_listener;
     std::shared_ptr<CompositorReport> const report;
 
+    /// Guards thread_functors against scene changes while they're reconfigured
+    std::mutex mutable thread_functors_mutex;
     std::vector<std::unique_ptr<CompositingFunctor>> thread_functors;
 
     std::atomic<CompositorState> state;
-    std::chrono::milliseconds fixed_composite_delay;
+    std::shared_ptr<FrameSchedulerFactory> const frame_scheduler_factory;
     bool compose_on_start;
 
     void schedule_compositing(int number_composites);
@@ -17,22 +17,101 @@
  */
 
 #include "mir/geometry/rectangle.h"
+#include "mir/geometry/region.h"
 #include "mir/compositor/scene_element.h"
 #include "mir/graphics/renderable.h"
 #include "occlusion.h"
 
-#include <vector>
-
 using namespace mir::geometry;
 using namespace mir::graphics;
 using namespace mir::compositor;
 
 namespace
 {
+/// A renderable drawn only within a reduced clip area, because the rest is covered
+class ClippedRenderable : public Renderable
+{
+public:
+    ClippedRenderable(std::shared_ptr<Renderable> const& renderable, Rectangle const& clip) :
+        renderable{renderable},
+        clip{clip}
+    {
+    }
+
+    ID id() const override { return renderable->id(); }
+    std::shared_ptr<Buffer> buffer() const override { return renderable->buffer(); }
+    Rectangle screen_position() const override { return renderable->screen_position(); }
+    std::experimental::optional<Rectangle> clip_area() const override { return clip; }
+    float alpha() const override { return renderable->alpha(); }
+    glm::mat4 transformation() const override { return renderable->transformation(); }
+    bool shaped() const override { return renderable->shaped(); }
+    std::optional<Rectangles> damage_since(BufferID previous) const override
+        { return renderable->damage_since(previous); }
+    std::optional<std::vector<Rectangle>> opaque_region() const override { return renderable->opaque_region(); }
+    bool allow_tearing() const override { return renderable->allow_tearing(); }
+
+private:
+    std::shared_ptr<Renderable> const renderable;
+    Rectangle const clip;
+};
+
+class ClippedSceneElement : public SceneElement
+{
+public:
+    ClippedSceneElement(std::shared_ptr<SceneElement> const& element, Rectangle const& clip) :
+        element{element},
+        renderable_{std::make_shared<ClippedRenderable>(element->renderable(), clip)}
+    {
+    }
+
+    std::shared_ptr<Renderable> renderable() const override { return renderable_; }
+    void rendered() override { element->rendered(); }
+    void occluded() override { element->occluded(); }
+
+private:
+    std::shared_ptr<SceneElement> const element;
+    std::shared_ptr<Renderable> const renderable_;
+};
+
+/// The opaque area of the renderables considered so far
+class Coverage
+{
+public:
+    auto visible_extent_of(Rectangle const& rect) const -> Rectangle
+    {
+        return region.bounding_rectangle_outside(rect);
+    }
+
+    void add(Rectangle const& rect)
+    {
+        // Deep stacks of overlapping windows (cascades, say) fragment the
+        // region, making it slower to test against than culling saves. Once
+        // we have that many occluders we stop adding more: the remaining
+        // renderables are still tested, just against less coverage.
+        if (occluders < max_occluders)
+        {
+            region.add(rect);
+            ++occluders;
+        }
+    }
+
+private:
+    static int const max_occluders = 64;
+
+    Region region;
+    int occluders{0};
+};
+
+/**
+ * \param [in,out] coverage      The opaque area of the renderables above;
+ *                               the renderable's own opaque area is added
+ * \param [out]    reduced_clip  Set if only part of the renderable is visible
+ */
 bool renderable_is_occluded(
-    Renderable const& renderable, 
+    Renderable const& renderable,
     Rectangle const& area,
-    std::vector<Rectangle>& coverage)
+    Coverage& coverage,
+    std::optional<Rectangle>& reduced_clip)
 {
     static glm::mat4 const identity(1);
     static Rectangle const empty{};
@@ -40,26 +119,38 @@ bool renderable_is_occluded(
     if (renderable.transformation() != identity)
         return false;  // Weirdly transformed. Assume never occluded.
 
+    auto visible_area = area;
+    if (auto const clip = renderable.clip_area())
+        visible_area = visible_area.intersection_with(clip.value());
+
     auto const& window = renderable.screen_position();
-    auto const& clipped_window = window.intersection_with(area);
+    auto const& clipped_window = window.intersection_with(visible_area);
 
     if (clipped_window == empty)
         return true;  // Not in the area; definitely occluded.
 
-    bool occluded = false;
-    for (auto const& r : coverage)
+    auto const visible_extent = coverage.visible_extent_of(clipped_window);
+
+    if (visible_extent == empty)
+        return true;
+
+    if (visible_extent != clipped_window)
+        reduced_clip = visible_extent;
+
+    if (renderable.alpha() == 1.0f)
     {
-        if (r.contains(clipped_window))
+        if (!renderable.shaped())
         {
-            occluded = true;
-            break;
+            coverage.add(clipped_window);
+        }
+        else if (auto const opaque_region = renderable.opaque_region())
+        {
+            for (auto const& opaque : opaque_region.value())
+                coverage.add(opaque.intersection_with(clipped_window));
         }
     }
 
-    if (!occluded && renderable.alpha() == 1.0f && !renderable.shaped())
-        coverage.push_back(clipped_window);
-
-    return occluded;
+    return false;
 }
 }
 
@@ -68,19 +159,22 @@ SceneElementSequence mir::compositor::filter_occlusions_from(
     Rectangle const& area)
 {
     SceneElementSequence occluded;
-    std::vector<Rectangle> coverage;
+    Coverage coverage;
 
     auto it = elements.rbegin();
     while (it != elements.rend())
     {
         auto const renderable = (*it)->renderable();
-        if (renderable_is_occluded(*renderable, area, coverage))
+        std::optional<Rectangle> reduced_clip;
+        if (renderable_is_occluded(*renderable, area, coverage, reduced_clip))
         {
             occluded.insert(occluded.begin(), *it);
             it = SceneElementSequence::reverse_iterator(elements.erase(std::prev(it.base())));
         }
         else
         {
+            if (reduced_clip)
+                *it = std::make_shared<ClippedSceneElement>(*it, reduced_clip.value());
             it++;
         }
     }
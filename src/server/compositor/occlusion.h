@@ -26,6 +26,11 @@ namespace mir
 namespace compositor
 {
 
+/**
+ * Remove the elements that are completely hidden within \a area from \a list,
+ * returning them. Elements that are only partly visible are replaced by ones
+ * whose renderable is clipped to the visible part.
+ */
 SceneElementSequence filter_occlusions_from(SceneElementSequence& list, geometry::Rectangle const& area);
 
 } // namespace compositor
@@ -30,12 +30,12 @@ void mc::QueueingSchedule::schedule(std::shared_ptr<graphics::Buffer> const& buf
     if (it != queue.end())
         queue.erase(it);
     queue.emplace_back(buffer);
+    queued = queue.size();
 }
 
 unsigned int mc::QueueingSchedule::num_scheduled()
 {
-    std::lock_guard<decltype(mutex)> lk(mutex);
-    return queue.size();
+    return queued;
 }
 
 std::shared_ptr<mg::Buffer> mc::QueueingSchedule::next_buffer()
@@ -45,5 +45,6 @@ std::shared_ptr<mg::Buffer> mc::QueueingSchedule::next_buffer()
         BOOST_THROW_EXCEPTION(std::logic_error("no buffer scheduled"));
     auto buffer = queue.front();
     queue.pop_front();
+    queued = queue.size();
     return buffer;
 }
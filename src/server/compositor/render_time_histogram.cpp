@@ -0,0 +1,72 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "render_time_histogram.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace mc = mir::compositor;
+
+mc::RenderTimeHistogram::RenderTimeHistogram(std::chrono::nanoseconds bin_width, size_t bins, size_t window) :
+    bin_width{bin_width},
+    counts(bins, 0),
+    history(window, 0)
+{
+    if (bin_width <= std::chrono::nanoseconds::zero() || bins == 0 || window == 0)
+        BOOST_THROW_EXCEPTION(std::invalid_argument("RenderTimeHistogram needs a positive bin width, bins and window"));
+}
+
+void mc::RenderTimeHistogram::record(std::chrono::nanoseconds render_time)
+{
+    auto const bin = render_time > std::chrono::nanoseconds::zero() ?
+        std::min(static_cast<size_t>(render_time / bin_width), counts.size() - 1) : 0;
+
+    if (filled == history.size())
+        --counts[history[next]];
+    else
+        ++filled;
+
+    history[next] = bin;
+    ++counts[bin];
+    next = (next + 1) % history.size();
+}
+
+auto mc::RenderTimeHistogram::samples() const -> size_t
+{
+    return filled;
+}
+
+auto mc::RenderTimeHistogram::percentile(double fraction) const -> std::chrono::nanoseconds
+{
+    if (filled == 0)
+        return std::chrono::nanoseconds::zero();
+
+    auto const wanted = std::max<size_t>(1, static_cast<size_t>(std::ceil(fraction * filled)));
+
+    size_t seen = 0;
+    for (size_t bin = 0; bin != counts.size(); ++bin)
+    {
+        seen += counts[bin];
+        if (seen >= wanted)
+            return bin_width * (bin + 1);
+    }
+
+    return bin_width * counts.size();
+}
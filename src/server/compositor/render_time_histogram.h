@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_RENDER_TIME_HISTOGRAM_H_
+#define MIR_COMPOSITOR_RENDER_TIME_HISTOGRAM_H_
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace mir
+{
+namespace compositor
+{
+
+/**
+ * A histogram of the most recent render times.
+ *
+ * Samples are counted in fixed width bins; anything beyond the last bin is
+ * counted in it. Only the latest \c window samples are kept, so the
+ * histogram follows changes in workload (e.g. switching between bypass and
+ * composited frames) within a fraction of a second.
+ */
+class RenderTimeHistogram
+{
+public:
+    RenderTimeHistogram(std::chrono::nanoseconds bin_width, size_t bins, size_t window);
+
+    void record(std::chrono::nanoseconds render_time);
+
+    /// The number of samples currently held (at most \c window).
+    auto samples() const -> size_t;
+
+    /**
+     * An upper bound for the given fraction of recent render times.
+     *
+     * \param [in] fraction  Between 0 and 1, e.g. 0.99 for the 99th percentile.
+     * \return     The upper edge of the bin containing that percentile, or
+     *             zero if there are no samples.
+     */
+    auto percentile(double fraction) const -> std::chrono::nanoseconds;
+
+private:
+    std::chrono::nanoseconds const bin_width;
+    std::vector<size_t> counts;
+    /// The bin of each sample in the window, as a ring buffer.
+    std::vector<size_t> history;
+    size_t next{0};
+    size_t filled{0};
+};
+
+}
+}
+
+#endif /* MIR_COMPOSITOR_RENDER_TIME_HISTOGRAM_H_ */
@@ -23,12 +23,20 @@
 #include "mir/graphics/buffer.h"
 #include <boost/throw_exception.hpp>
 
+#include <algorithm>
+
 namespace mc = mir::compositor;
 namespace geom = mir::geometry;
 namespace mg = mir::graphics;
 namespace ms = mir::scene;
 namespace geom = mir::geometry;
 
+namespace
+{
+// Enough to cover buffers dropped between compositor frames
+size_t const max_tracked_submissions{8};
+}
+
 enum class mc::Stream::ScheduleMode {
     Queueing,
     Dropping
@@ -37,7 +45,9 @@ enum class mc::Stream::ScheduleMode {
 mc::Stream::Stream(
     geom::Size size, MirPixelFormat pf) :
     schedule_mode(ScheduleMode::Queueing),
-    schedule(std::make_shared<mc::QueueingSchedule>()),
+    queueing_schedule(std::make_shared<mc::QueueingSchedule>()),
+    dropping_schedule(std::make_shared<mc::DroppingSchedule>()),
+    schedule(queueing_schedule),
     arbiter(std::make_shared<mc::MultiMonitorArbiter>(schedule)),
     latest_buffer_size(size),
     pf(pf),
@@ -49,6 +59,16 @@ mc::Stream::Stream(
 mc::Stream::~Stream() = default;
 
 void mc::Stream::submit_buffer(std::shared_ptr<mg::Buffer> const& buffer)
+{
+    submit(buffer, std::nullopt);
+}
+
+void mc::Stream::submit_buffer(std::shared_ptr<mg::Buffer> const& buffer, geom::Rectangles const& damage)
+{
+    submit(buffer, damage);
+}
+
+void mc::Stream::submit(std::shared_ptr<mg::Buffer> const& buffer, std::optional<geom::Rectangles> damage)
 {
     if (!buffer)
         BOOST_THROW_EXCEPTION(std::invalid_argument("cannot submit null buffer"));
@@ -56,7 +76,15 @@ void mc::Stream::submit_buffer(std::shared_ptr<mg::Buffer> const& buffer)
     {
         std::lock_guard<decltype(mutex)> lk(mutex);
         pf = buffer->pixel_format();
+        if (buffer->size() != latest_buffer_size)
+        {
+            // Damage relative to a buffer of a different size is meaningless
+            damage = std::nullopt;
+        }
         latest_buffer_size = buffer->size();
+        submissions.push_front(Submission{buffer->id(), std::move(damage)});
+        if (submissions.size() > max_tracked_submissions)
+            submissions.pop_back();
         schedule->schedule(buffer);
         first_frame_posted = true;
     }
@@ -68,7 +96,6 @@ void mc::Stream::submit_buffer(std::shared_ptr<mg::Buffer> const& buffer)
 
 void mc::Stream::with_most_recent_buffer_do(std::function<void(mg::Buffer&)> const& fn)
 {
-    std::lock_guard<decltype(mutex)> lk(mutex);
     fn(*arbiter->snapshot_acquire());
 }
 
@@ -103,12 +130,12 @@ void mc::Stream::allow_framedropping(bool dropping)
     std::lock_guard<decltype(mutex)> lk(mutex);
     if (dropping && schedule_mode == ScheduleMode::Queueing)
     {
-        transition_schedule(std::make_shared<mc::DroppingSchedule>(), lk);
+        transition_schedule(dropping_schedule, lk);
         schedule_mode = ScheduleMode::Dropping;
     }
     else if (!dropping && schedule_mode == ScheduleMode::Dropping)
     {
-        transition_schedule(std::make_shared<mc::QueueingSchedule>(), lk);
+        transition_schedule(queueing_schedule, lk);
         schedule_mode = ScheduleMode::Queueing;
     }
 }
@@ -119,20 +146,16 @@ bool mc::Stream::framedropping() const
 }
 
 void mc::Stream::transition_schedule(
-    std::shared_ptr<mc::Schedule>&& new_schedule, std::lock_guard<std::mutex> const&)
+    std::shared_ptr<mc::Schedule> const& new_schedule, std::lock_guard<std::mutex> const&)
 {
-    std::vector<std::shared_ptr<mg::Buffer>> transferred_buffers;
-    while(schedule->num_scheduled())
-        transferred_buffers.emplace_back(schedule->next_buffer());
-    for(auto& buffer : transferred_buffers)
-        new_schedule->schedule(buffer);
+    // The arbiter moves the buffers across, as compositors may be taking them from the schedule
+    arbiter->transfer_schedule(new_schedule);
     schedule = new_schedule;
-    arbiter->set_schedule(schedule);
 }
 
 int mc::Stream::buffers_ready_for_compositor(void const* id) const
 {
-    std::lock_guard<decltype(mutex)> lk(mutex);
+    // Called for every compositor on every frame, so we leave it to the (lock-free) arbiter
     if (arbiter->buffer_ready_for(id))
         return 1;
     return 0;
@@ -141,17 +164,7 @@ int mc::Stream::buffers_ready_for_compositor(void const* id) const
 void mc::Stream::drop_old_buffers()
 {
     std::lock_guard<decltype(mutex)> lk(mutex);
-    std::vector<std::shared_ptr<mg::Buffer>> transferred_buffers;
-    while(schedule->num_scheduled())
-        transferred_buffers.emplace_back(schedule->next_buffer());
-
-    if (!transferred_buffers.empty())
-    {
-        schedule->schedule(transferred_buffers.back());
-        transferred_buffers.pop_back();
-    }
-
-    arbiter->advance_schedule();
+    arbiter->advance_to_newest();
 }
 
 bool mc::Stream::has_submitted_buffer() const
@@ -165,3 +178,28 @@ void mc::Stream::set_scale(float scale)
     std::lock_guard<decltype(mutex)> lk(mutex);
     scale_ = scale;
 }
+
+auto mc::Stream::damage_between(mg::BufferID previous, mg::BufferID current) const
+    -> std::optional<geom::Rectangles>
+{
+    std::lock_guard<decltype(mutex)> lk(mutex);
+
+    auto submission = std::find_if(
+        begin(submissions), end(submissions),
+        [current](auto const& s) { return s.buffer == current; });
+
+    geom::Rectangles damage;
+    for (; submission != end(submissions); ++submission)
+    {
+        if (submission->buffer == previous)
+            return damage;
+
+        if (!submission->damage)
+            return std::nullopt;
+
+        for (auto const& rect : *submission->damage)
+            damage.add(rect);
+    }
+
+    return std::nullopt;
+}
@@ -26,8 +26,10 @@
 #include "mir/lockable_callback.h"
 #include "mir/geometry/size.h"
 #include "multi_monitor_arbiter.h"
+#include <deque>
 #include <mutex>
 #include <memory>
+#include <optional>
 #include <set>
 
 namespace mir
@@ -42,6 +44,9 @@ public:
     ~Stream();
 
     void submit_buffer(std::shared_ptr<graphics::Buffer> const& buffer) override;
+    void submit_buffer(
+        std::shared_ptr<graphics::Buffer> const& buffer,
+        geometry::Rectangles const& damage) override;
     void with_most_recent_buffer_do(std::function<void(graphics::Buffer&)> const& exec) override;
     MirPixelFormat pixel_format() const override;
     void set_frame_posted_callback(
@@ -55,19 +60,33 @@ public:
     void drop_old_buffers() override;
     bool has_submitted_buffer() const override;
     void set_scale(float scale) override;
+    auto damage_between(graphics::BufferID previous, graphics::BufferID current) const
+        -> std::optional<geometry::Rectangles> override;
 
 private:
     enum class ScheduleMode;
-    void transition_schedule(std::shared_ptr<Schedule>&& new_schedule, std::lock_guard<std::mutex> const&);
+    void transition_schedule(std::shared_ptr<Schedule> const& new_schedule, std::lock_guard<std::mutex> const&);
+    void submit(std::shared_ptr<graphics::Buffer> const& buffer, std::optional<geometry::Rectangles> damage);
+
+    struct Submission
+    {
+        graphics::BufferID buffer;
+        /// Damage relative to the preceding submission, if known
+        std::optional<geometry::Rectangles> damage;
+    };
 
     std::mutex mutable mutex;
     ScheduleMode schedule_mode;
+    std::shared_ptr<Schedule> const queueing_schedule;
+    std::shared_ptr<Schedule> const dropping_schedule;
     std::shared_ptr<Schedule> schedule;
     std::shared_ptr<MultiMonitorArbiter> const arbiter;
     geometry::Size latest_buffer_size;
     float scale_{1.0f};
     MirPixelFormat pf;
     std::atomic<bool> first_frame_posted;
+    /// Most recent submissions, newest first
+    std::deque<Submission> submissions;
 
     std::mutex callback_mutex;
     std::function<void(geometry::Size const&)> frame_callback;
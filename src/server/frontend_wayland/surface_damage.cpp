@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "surface_damage.h"
+
+#include <algorithm>
+
+namespace mf = mir::frontend;
+namespace geom = mir::geometry;
+
+void mf::SurfaceDamage::add_surface_damage(int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    if (width > 0 && height > 0)
+        surface_damage.push_back({x, y, width, height});
+}
+
+void mf::SurfaceDamage::add_buffer_damage(int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    if (width > 0 && height > 0)
+        buffer_damage.push_back({x, y, width, height});
+}
+
+void mf::SurfaceDamage::add(SurfaceDamage const& other)
+{
+    surface_damage.insert(end(surface_damage), begin(other.surface_damage), end(other.surface_damage));
+    buffer_damage.insert(end(buffer_damage), begin(other.buffer_damage), end(other.buffer_damage));
+}
+
+auto mf::SurfaceDamage::empty() const -> bool
+{
+    return surface_damage.empty() && buffer_damage.empty();
+}
+
+auto mf::SurfaceDamage::in_buffer_coordinates(geom::Size const& buffer_size, int scale) const
+    -> std::optional<geom::Rectangles>
+{
+    // Clients commonly damage {0, 0, INT32_MAX, INT32_MAX}, so we have to be careful not to overflow
+    int64_t const buffer_width = buffer_size.width.as_int();
+    int64_t const buffer_height = buffer_size.height.as_int();
+
+    if (empty())
+        return std::nullopt;
+
+    geom::Rectangles damage;
+    auto const add_clipped = [&](int64_t left, int64_t top, int64_t right, int64_t bottom)
+        {
+            left = std::clamp<int64_t>(left, 0, buffer_width);
+            right = std::clamp<int64_t>(right, 0, buffer_width);
+            top = std::clamp<int64_t>(top, 0, buffer_height);
+            bottom = std::clamp<int64_t>(bottom, 0, buffer_height);
+
+            if (left < right && top < bottom)
+            {
+                damage.add({
+                    {static_cast<int>(left), static_cast<int>(top)},
+                    {static_cast<int>(right - left), static_cast<int>(bottom - top)}});
+            }
+        };
+
+    for (auto const& area : buffer_damage)
+    {
+        add_clipped(area.x, area.y, area.x + area.width, area.y + area.height);
+    }
+
+    for (auto const& area : surface_damage)
+    {
+        add_clipped(
+            area.x * scale,
+            area.y * scale,
+            (area.x + area.width) * scale,
+            (area.y + area.height) * scale);
+    }
+
+    return damage;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_FRONTEND_SURFACE_DAMAGE_H_
+#define MIR_FRONTEND_SURFACE_DAMAGE_H_
+
+#include "mir/geometry/rectangle.h"
+#include "mir/geometry/rectangles.h"
+#include "mir/geometry/size.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace mir
+{
+namespace frontend
+{
+/// The damage a client has posted against a wl_surface since its last commit
+class SurfaceDamage
+{
+public:
+    /// From wl_surface.damage, in surface-local coordinates
+    void add_surface_damage(int32_t x, int32_t y, int32_t width, int32_t height);
+    /// From wl_surface.damage_buffer, in buffer coordinates
+    void add_buffer_damage(int32_t x, int32_t y, int32_t width, int32_t height);
+    /// Accumulate damage from another (for example, cached) state
+    void add(SurfaceDamage const& other);
+
+    auto empty() const -> bool;
+
+    /**
+     * The accumulated damage in buffer coordinates, clipped to the buffer.
+     *
+     * \return  The damage, or an empty optional if the client didn't tell us
+     *          what changed and the whole buffer has to be assumed damaged.
+     */
+    auto in_buffer_coordinates(geometry::Size const& buffer_size, int scale) const
+        -> std::optional<geometry::Rectangles>;
+
+private:
+    struct Area
+    {
+        int64_t x, y, width, height;
+    };
+
+    std::vector<Area> surface_damage;
+    std::vector<Area> buffer_damage;
+};
+}
+}
+
+#endif // MIR_FRONTEND_SURFACE_DAMAGE_H_
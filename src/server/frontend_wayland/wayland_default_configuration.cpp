@@ -30,6 +30,7 @@
 #include "foreign_toplevel_manager_v1.h"
 #include "pointer_constraints_unstable_v1.h"
 #include "relative_pointer_unstable_v1.h"
+#include "tearing_control_v1.h"
 #include "virtual_keyboard_v1.h"
 #include "text_input_v3.h"
 #include "text_input_v2.h"
@@ -118,6 +119,10 @@ std::vector<ExtensionBuilder> const internal_extension_builders = {
         {
             return mf::create_relative_pointer_unstable_v1(ctx.display, ctx.shell);
         }),
+    make_extension_builder<mw::TearingControlManagerV1>([](auto const& ctx)
+        {
+            return mf::create_tearing_control_manager_v1(ctx.display);
+        }),
     make_extension_builder<mw::PointerConstraintsV1>([](auto const& ctx)
         {
             return mf::create_pointer_constraints_unstable_v1(ctx.display, *ctx.wayland_executor, ctx.shell);
@@ -238,7 +243,8 @@ auto mf::get_standard_extensions() -> std::vector<std::string>
         mw::XdgShellV6::interface_name,
         mw::XdgOutputManagerV1::interface_name,
         mw::TextInputManagerV2::interface_name,
-        mw::TextInputManagerV3::interface_name};
+        mw::TextInputManagerV3::interface_name,
+        mw::TearingControlManagerV1::interface_name};
 }
 
 auto mf::get_supported_extensions() -> std::vector<std::string>
@@ -346,6 +346,11 @@ void mf::WindowWlSurfaceRole::commit(WlSurfaceState const& state)
     surface.value().commit(state);
     handle_commit();
 
+    if (state.allow_tearing)
+    {
+        spec().allow_tearing = state.allow_tearing.value();
+    }
+
     auto size = pending_size();
     observer->latest_client_size(size);
 
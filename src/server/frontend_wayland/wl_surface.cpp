@@ -66,10 +66,18 @@ void mf::WlSurfaceState::update_from(WlSurfaceState const& source)
     if (source.input_shape)
         input_shape = source.input_shape;
 
+    if (source.opaque_region)
+        opaque_region = source.opaque_region;
+
+    if (source.allow_tearing)
+        allow_tearing = source.allow_tearing;
+
     frame_callbacks.insert(end(frame_callbacks),
                            begin(source.frame_callbacks),
                            end(source.frame_callbacks));
 
+    damage.add(source.damage);
+
     if (source.surface_data_invalidated)
         surface_data_invalidated = true;
 }
@@ -78,6 +86,7 @@ bool mf::WlSurfaceState::surface_data_needs_refresh() const
 {
     return offset ||
            input_shape ||
+           opaque_region ||
            surface_data_invalidated;
 }
 
@@ -166,6 +175,11 @@ void mf::WlSurface::set_pending_offset(std::optional<geom::Displacement> const&
     pending.offset = offset;
 }
 
+void mf::WlSurface::set_pending_allow_tearing(bool allow)
+{
+    pending.allow_tearing = allow;
+}
+
 void mf::WlSurface::add_subsurface(WlSubsurface* child)
 {
     if (std::find(children.begin(), children.end(), child) != children.end())
@@ -198,7 +212,17 @@ void mf::WlSurface::populate_surface_data(std::vector<shell::StreamSpecification
 {
     geometry::Displacement offset = parent_offset + offset_;
 
-    buffer_streams.push_back(msh::StreamSpecification{stream, offset, {}});
+    std::optional<std::vector<geom::Rectangle>> clipped_opaque_region;
+    if (opaque_region)
+    {
+        // The opaque region is relative to the stream, so only needs clipping
+        geom::Rectangle const local_rect{{}, buffer_size_.value_or(geom::Size{})};
+        clipped_opaque_region.emplace();
+        for (auto const& rect : opaque_region.value())
+            clipped_opaque_region.value().push_back(rect.intersection_with(local_rect));
+    }
+
+    buffer_streams.push_back(msh::StreamSpecification{stream, offset, {}, clipped_opaque_region});
     geom::Rectangle surface_rect = {geom::Point{} + offset, buffer_size_.value_or(geom::Size{})};
     if (input_shape)
     {
@@ -262,20 +286,12 @@ void mf::WlSurface::attach(std::optional<wl_resource*> const& buffer, int32_t x,
 
 void mf::WlSurface::damage(int32_t x, int32_t y, int32_t width, int32_t height)
 {
-    (void)x;
-    (void)y;
-    (void)width;
-    (void)height;
-    // This isn't essential, but could enable optimizations
+    pending.damage.add_surface_damage(x, y, width, height);
 }
 
 void mf::WlSurface::damage_buffer(int32_t x, int32_t y, int32_t width, int32_t height)
 {
-    (void)x;
-    (void)y;
-    (void)width;
-    (void)height;
-    // This isn't essential, but could enable optimizations
+    pending.damage.add_buffer_damage(x, y, width, height);
 }
 
 void mf::WlSurface::frame(wl_resource* new_callback)
@@ -286,8 +302,16 @@ void mf::WlSurface::frame(wl_resource* new_callback)
 
 void mf::WlSurface::set_opaque_region(std::optional<wl_resource*> const& region)
 {
-    (void)region;
-    // This isn't essential, but could enable optimizations
+    if (region)
+    {
+        auto shape = WlRegion::from(region.value())->rectangle_vector();
+        pending.opaque_region = decltype(pending.opaque_region)::value_type{move(shape)};
+    }
+    else
+    {
+        // A null region means nothing is known to be opaque
+        pending.opaque_region = decltype(pending.opaque_region)::value_type{};
+    }
 }
 
 void mf::WlSurface::set_input_region(std::optional<wl_resource*> const& region)
@@ -348,8 +372,14 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
     if (state.input_shape)
         input_shape = state.input_shape.value();
 
+    if (state.opaque_region)
+        opaque_region = state.opaque_region.value();
+
     if (state.scale)
-        stream->set_scale(state.scale.value());
+    {
+        buffer_scale = state.scale.value();
+        stream->set_scale(buffer_scale);
+    }
 
     auto const executor_send_frame_callbacks = [executor = wayland_executor, weak_self = mw::make_weak(this)]()
         {
@@ -370,16 +400,19 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
         {
             // TODO: unmap surface, and unmap all subsurfaces
             buffer_size_ = std::nullopt;
+            last_shm_buffer = nullptr;
             send_frame_callbacks();
         }
         else
         {
             std::shared_ptr<graphics::Buffer> mir_buffer;
+            std::optional<geometry::Rectangles> damage;
 
             if (auto const shm_buffer = wl_shm_buffer_get(buffer))
             {
                 auto const stride = wl_shm_buffer_get_stride(shm_buffer);
                 auto const width = wl_shm_buffer_get_width(shm_buffer);
+                auto const height = wl_shm_buffer_get_height(shm_buffer);
                 auto const format = wl_format_to_mir_format(wl_shm_buffer_get_format(shm_buffer));
                 if (stride < width * MIR_BYTES_PER_PIXEL(format)) {
                     wl_resource_post_error(
@@ -392,10 +425,22 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
                     BOOST_THROW_EXCEPTION((
                                               std::runtime_error{"Buffer has invalid stride"}));
                 }
+                damage = state.damage.in_buffer_coordinates(geometry::Size{width, height}, buffer_scale);
+
+                /* The damage is relative to what this surface showed last, so it only
+                 * describes what changed in the wl_buffer if that's what was shown
+                 */
+                bool const recommitted =
+                    buffer == last_shm_buffer && last_shm_buffer_deleted && !*last_shm_buffer_deleted;
+
                 mir_buffer = allocator->buffer_from_shm(
                     buffer,
                     wayland_executor,
+                    recommitted ? damage : std::nullopt,
                     std::move(executor_send_frame_callbacks));
+
+                last_shm_buffer = buffer;
+                last_shm_buffer_deleted = deleted_flag_for_resource(buffer);
                 tracepoint(
                     mir_server_wayland,
                     sw_buffer_committed,
@@ -404,6 +449,7 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
             }
             else
             {
+                last_shm_buffer = nullptr;
                 std::shared_ptr<bool> buffer_destroyed = deleted_flag_for_resource(buffer);
 
                 auto release_buffer = [executor = wayland_executor, buffer = buffer, destroyed = buffer_destroyed]()
@@ -415,6 +461,7 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
 
                 mir_buffer = allocator->buffer_from_resource(
                     buffer,
+                    resource,
                     std::move(executor_send_frame_callbacks),
                     std::move(release_buffer));
                 tracepoint(
@@ -422,9 +469,18 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
                     hw_buffer_committed,
                     wl_resource_get_client(resource),
                     mir_buffer->id().as_value());
+
+                damage = state.damage.in_buffer_coordinates(mir_buffer->size(), buffer_scale);
             }
 
-            stream->submit_buffer(mir_buffer);
+            if (damage)
+            {
+                stream->submit_buffer(mir_buffer, damage.value());
+            }
+            else
+            {
+                stream->submit_buffer(mir_buffer);
+            }
             auto const new_buffer_size = stream->stream_size();
 
             if (!input_shape && std::make_optional(new_buffer_size) != buffer_size_)
@@ -457,6 +513,9 @@ void mf::WlSurface::commit()
     if (pending.input_shape && *pending.input_shape == input_shape)
         pending.input_shape = std::nullopt;
 
+    if (pending.opaque_region && *pending.opaque_region == opaque_region)
+        pending.opaque_region = std::nullopt;
+
     // order is important
     auto const state = std::move(pending);
     pending = WlSurfaceState();
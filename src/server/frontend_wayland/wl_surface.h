@@ -22,6 +22,7 @@
 #include "wayland_wrapper.h"
 
 #include "wl_surface_role.h"
+#include "surface_damage.h"
 
 #include "mir/geometry/displacement.h"
 #include "mir/geometry/size.h"
@@ -82,7 +83,10 @@ struct WlSurfaceState
     std::optional<int> scale;
     std::optional<geometry::Displacement> offset;
     std::optional<std::optional<std::vector<geometry::Rectangle>>> input_shape;
+    std::optional<std::optional<std::vector<geometry::Rectangle>>> opaque_region;
+    std::optional<bool> allow_tearing;
     std::vector<wayland::Weak<Callback>> frame_callbacks;
+    SurfaceDamage damage;
 
 private:
     // only set to true if invalidate_surface_data() is called
@@ -126,6 +130,7 @@ public:
     void set_role(WlSurfaceRole* role_);
     void clear_role();
     void set_pending_offset(std::optional<geometry::Displacement> const& offset);
+    void set_pending_allow_tearing(bool allow);
     void add_subsurface(WlSubsurface* child);
     void remove_subsurface(WlSubsurface* child);
     void refresh_surface_data_now();
@@ -139,6 +144,9 @@ public:
     std::shared_ptr<scene::Session> const session;
     std::shared_ptr<compositor::BufferStream> const stream;
 
+    /// The wp_tearing_control_v1 extending this surface; there may only be one at a time
+    wayland::Weak<wayland::Resource> tearing_control;
+
     static WlSurface* from(wl_resource* resource);
 
 private:
@@ -152,9 +160,14 @@ private:
 
     WlSurfaceState pending;
     geometry::Displacement offset_;
+    int buffer_scale{1};
     std::optional<geometry::Size> buffer_size_;
     std::vector<wayland::Weak<WlSurfaceState::Callback>> frame_callbacks;
     std::optional<std::vector<mir::geometry::Rectangle>> input_shape;
+    std::optional<std::vector<mir::geometry::Rectangle>> opaque_region;
+    /// The wl_shm buffer this surface shows, so we know when the damage applies to the wl_buffer itself
+    wl_resource* last_shm_buffer{nullptr};
+    std::shared_ptr<bool> last_shm_buffer_deleted;
 
     void send_frame_callbacks();
 
@@ -32,6 +32,14 @@ void mf::ScaledBufferStream::submit_buffer(std::shared_ptr<graphics::Buffer> con
     inner->submit_buffer(buffer);
 }
 
+void mf::ScaledBufferStream::submit_buffer(
+    std::shared_ptr<graphics::Buffer> const& buffer,
+    geometry::Rectangles const& damage)
+{
+    // Damage is in buffer coordinates, so is unaffected by our scale
+    inner->submit_buffer(buffer, damage);
+}
+
 void mf::ScaledBufferStream::set_frame_posted_callback(std::function<void(geometry::Size const&)> const& callback)
 {
     // Does this need to be scaled? I don't ? think ? so? compositor::Stream seems to leave it unscaled.
@@ -90,4 +98,8 @@ auto mf::ScaledBufferStream::framedropping() const -> bool
     return inner->framedropping();
 }
 
-
+auto mf::ScaledBufferStream::damage_between(graphics::BufferID previous, graphics::BufferID current) const
+    -> std::optional<geometry::Rectangles>
+{
+    return inner->damage_between(previous, current);
+}
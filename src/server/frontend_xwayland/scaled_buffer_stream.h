@@ -38,6 +38,7 @@ public:
     /// Overrides from frontend::BufferStream
     /// @{
     void submit_buffer(std::shared_ptr<graphics::Buffer> const& buffer);
+    void submit_buffer(std::shared_ptr<graphics::Buffer> const& buffer, geometry::Rectangles const& damage);
     void set_frame_posted_callback(std::function<void(geometry::Size const&)> const& callback);
     void with_most_recent_buffer_do(std::function<void(graphics::Buffer&)> const& exec);
     MirPixelFormat pixel_format() const;
@@ -53,6 +54,8 @@ public:
     void drop_old_buffers();
     auto has_submitted_buffer() const -> bool;
     auto framedropping() const -> bool;
+    auto damage_between(graphics::BufferID previous, graphics::BufferID current) const
+        -> std::optional<geometry::Rectangles>;
     /// @}
 
 private:
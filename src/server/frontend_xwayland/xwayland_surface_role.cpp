@@ -87,6 +87,14 @@ void mf::XWaylandSurfaceRole::populate_surface_data_scaled(
                 stream.size = stream.size.value() * inv_scale;
             }
             stream.displacement = stream.displacement * inv_scale;
+            if (stream.opaque_region)
+            {
+                for (auto& rect : stream.opaque_region.value())
+                {
+                    rect.top_left = as_point(as_displacement(rect.top_left) * inv_scale);
+                    rect.size = rect.size * inv_scale;
+                }
+            }
         }
 
         for (auto& rect : spec.input_shape.value())
@@ -103,12 +103,21 @@ void mrl::CompositorReport::Instance::log(ml::Logger& logger, SubCompositorId id
         long avg_latency_usec = dn ? dl / dn : 0;
         long dt_msec = dt / 1000L;
 
-        char msg[128];
-        snprintf(msg, sizeof msg, "Display %p averaged %ld.%03ld FPS, "
+        auto const average_usec = [](std::chrono::nanoseconds sum, long n)
+            {
+                return n ? std::chrono::duration_cast<std::chrono::microseconds>(sum).count() / n : 0L;
+            };
+        long avg_cpu_time_usec = average_usec(cpu_time_sum - last_reported_cpu_time_sum, dn);
+        long avg_post_wait_usec = average_usec(post_wait_sum - last_reported_post_wait_sum, dn);
+
+        char msg[256];
+        int len = snprintf(msg, sizeof msg, "Display %p averaged %ld.%03ld FPS, "
                  "%ld.%03ld ms/frame, "
                  "latency %ld.%03ld ms, "
                  "%ld frames over %ld.%03ld sec, "
-                 "%ld%% bypassed",
+                 "%ld%% bypassed, "
+                 "cpu %ld.%03ld ms, "
+                 "post wait %ld.%03ld ms",
                  id,
                  frames_per_1000sec / 1000,
                  frames_per_1000sec % 1000,
@@ -119,16 +128,33 @@ void mrl::CompositorReport::Instance::log(ml::Logger& logger, SubCompositorId id
                  dn,
                  dt_msec / 1000,
                  dt_msec % 1000,
-                 bypass_percent
+                 bypass_percent,
+                 avg_cpu_time_usec / 1000,
+                 avg_cpu_time_usec % 1000,
+                 avg_post_wait_usec / 1000,
+                 avg_post_wait_usec % 1000
                  );
 
+        // GPU times are only known if the renderer can measure them
+        if (auto dg = ngpu_times - last_reported_ngpu_times; dg && len > 0 && len < int(sizeof msg))
+        {
+            long avg_gpu_time_usec = average_usec(gpu_time_sum - last_reported_gpu_time_sum, dg);
+            snprintf(msg + len, sizeof msg - len, ", gpu %ld.%03ld ms",
+                     avg_gpu_time_usec / 1000,
+                     avg_gpu_time_usec % 1000);
+        }
+
         logger.log(ml::Severity::informational, msg, component);
     }
 
     last_reported_total_time_sum = total_time_sum;
     last_reported_render_time_sum = render_time_sum;
     last_reported_latency_sum = latency_sum;
+    last_reported_cpu_time_sum = cpu_time_sum;
+    last_reported_gpu_time_sum = gpu_time_sum;
+    last_reported_post_wait_sum = post_wait_sum;
     last_reported_nframes = nframes;
+    last_reported_ngpu_times = ngpu_times;
     last_reported_bypassed = nbypassed;
 }
 
@@ -166,6 +192,31 @@ void mrl::CompositorReport::finished_frame(SubCompositorId id)
     inst.prev_bypassed = inst.bypassed;
 }
 
+void mrl::CompositorReport::frame_cpu_time(SubCompositorId id, std::chrono::nanoseconds time)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    instance[id].cpu_time_sum += time;
+}
+
+void mrl::CompositorReport::frame_gpu_time(SubCompositorId id, std::chrono::nanoseconds time)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& inst = instance[id];
+    inst.gpu_time_sum += time;
+    inst.ngpu_times++;
+}
+
+bool mrl::CompositorReport::wants_gpu_times() const
+{
+    return true;
+}
+
+void mrl::CompositorReport::frame_post_wait(SubCompositorId id, std::chrono::nanoseconds time)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    instance[id].post_wait_sum += time;
+}
+
 void mrl::CompositorReport::started()
 {
     logger->log(ml::Severity::informational, "Started", component);
@@ -47,6 +47,10 @@ public:
     void renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables) override;
     void rendered_frame(SubCompositorId id) override;
     void finished_frame(SubCompositorId id) override;
+    void frame_cpu_time(SubCompositorId id, std::chrono::nanoseconds time) override;
+    void frame_gpu_time(SubCompositorId id, std::chrono::nanoseconds time) override;
+    bool wants_gpu_times() const override;
+    void frame_post_wait(SubCompositorId id, std::chrono::nanoseconds time) override;
     void started() override;
     void stopped() override;
     void scheduled() override;
@@ -65,7 +69,11 @@ private:
         TimePoint total_time_sum;
         TimePoint render_time_sum;
         TimePoint latency_sum;
+        std::chrono::nanoseconds cpu_time_sum{0};
+        std::chrono::nanoseconds gpu_time_sum{0};
+        std::chrono::nanoseconds post_wait_sum{0};
         long nframes = 0;
+        long ngpu_times = 0;
         long nbypassed = 0;
         bool bypassed = true;
         bool prev_bypassed = false;
@@ -73,7 +81,11 @@ private:
         TimePoint last_reported_total_time_sum;
         TimePoint last_reported_render_time_sum;
         TimePoint last_reported_latency_sum;
+        std::chrono::nanoseconds last_reported_cpu_time_sum{0};
+        std::chrono::nanoseconds last_reported_gpu_time_sum{0};
+        std::chrono::nanoseconds last_reported_post_wait_sum{0};
         long last_reported_nframes = 0;
+        long last_reported_ngpu_times = 0;
         long last_reported_bypassed = 0;
 
         void log(mir::logging::Logger& logger, SubCompositorId id);
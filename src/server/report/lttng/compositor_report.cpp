@@ -62,3 +62,23 @@ void mir::report::lttng::CompositorReport::finished_frame(SubCompositorId id)
 {
     mir_tracepoint(mir_server_compositor, finished_frame, id);
 }
+
+void mir::report::lttng::CompositorReport::frame_cpu_time(SubCompositorId id, std::chrono::nanoseconds time)
+{
+    mir_tracepoint(mir_server_compositor, frame_cpu_time, id, time.count());
+}
+
+void mir::report::lttng::CompositorReport::frame_gpu_time(SubCompositorId id, std::chrono::nanoseconds time)
+{
+    mir_tracepoint(mir_server_compositor, frame_gpu_time, id, time.count());
+}
+
+bool mir::report::lttng::CompositorReport::wants_gpu_times() const
+{
+    return true;
+}
+
+void mir::report::lttng::CompositorReport::frame_post_wait(SubCompositorId id, std::chrono::nanoseconds time)
+{
+    mir_tracepoint(mir_server_compositor, frame_post_wait, id, time.count());
+}
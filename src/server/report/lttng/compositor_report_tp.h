@@ -80,6 +80,37 @@ TRACEPOINT_EVENT_INSTANCE(
     TP_ARGS(void const*, id)
 )
 
+TRACEPOINT_EVENT_CLASS(
+    mir_server_compositor,
+    subcompositor_duration,
+    TP_ARGS(void const*, id, int64_t, nanoseconds),
+    TP_FIELDS(
+        ctf_integer_hex(uintptr_t, id, (uintptr_t)(id))
+        ctf_integer(int64_t, nanoseconds, nanoseconds)
+    )
+)
+
+TRACEPOINT_EVENT_INSTANCE(
+    mir_server_compositor,
+    subcompositor_duration,
+    frame_cpu_time,
+    TP_ARGS(void const*, id, int64_t, nanoseconds)
+)
+
+TRACEPOINT_EVENT_INSTANCE(
+    mir_server_compositor,
+    subcompositor_duration,
+    frame_gpu_time,
+    TP_ARGS(void const*, id, int64_t, nanoseconds)
+)
+
+TRACEPOINT_EVENT_INSTANCE(
+    mir_server_compositor,
+    subcompositor_duration,
+    frame_post_wait,
+    TP_ARGS(void const*, id, int64_t, nanoseconds)
+)
+
 TRACEPOINT_EVENT(
     mir_server_compositor,
     buffers_in_frame,
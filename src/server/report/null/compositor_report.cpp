@@ -40,6 +40,23 @@ void mrn::CompositorReport::finished_frame(SubCompositorId)
 {
 }
 
+void mrn::CompositorReport::frame_cpu_time(SubCompositorId, std::chrono::nanoseconds)
+{
+}
+
+void mrn::CompositorReport::frame_gpu_time(SubCompositorId, std::chrono::nanoseconds)
+{
+}
+
+bool mrn::CompositorReport::wants_gpu_times() const
+{
+    return false;
+}
+
+void mrn::CompositorReport::frame_post_wait(SubCompositorId, std::chrono::nanoseconds)
+{
+}
+
 void mrn::CompositorReport::started()
 {
 }
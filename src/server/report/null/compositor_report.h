@@ -36,6 +36,10 @@ public:
     void renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables) override;
     void rendered_frame(SubCompositorId id) override;
     void finished_frame(SubCompositorId id) override;
+    void frame_cpu_time(SubCompositorId id, std::chrono::nanoseconds time) override;
+    void frame_gpu_time(SubCompositorId id, std::chrono::nanoseconds time) override;
+    bool wants_gpu_times() const override;
+    void frame_post_wait(SubCompositorId id, std::chrono::nanoseconds time) override;
     void started() override;
     void stopped() override;
     void scheduled() override;
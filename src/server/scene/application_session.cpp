@@ -102,7 +102,11 @@ auto ms::ApplicationSession::create_surface(
     std::list<StreamInfo> streams;
     for (auto& stream : params.streams.value())
     {
-        streams.push_back({std::dynamic_pointer_cast<mc::BufferStream>(stream.stream.lock()), stream.displacement, stream.size});
+        streams.push_back({
+            std::dynamic_pointer_cast<mc::BufferStream>(stream.stream.lock()),
+            stream.displacement,
+            stream.size,
+            stream.opaque_region});
     }
 
     auto surface = surface_factory->create_surface(session, streams, params);
@@ -138,6 +142,8 @@ auto ms::ApplicationSession::create_surface(
         surface->set_application_id(params.application_id.value());
     if (params.focus_mode.is_set())
         surface->set_focus_mode(params.focus_mode.value());
+    if (params.allow_tearing.is_set())
+        surface->set_allow_tearing(params.allow_tearing.value());
 
     return surface;
 }
@@ -310,7 +316,7 @@ void ms::ApplicationSession::configure_streams(
     for (auto& stream : streams)
     {
         if (auto const s = std::dynamic_pointer_cast<mc::BufferStream>(stream.stream.lock()))
-            list.emplace_back(ms::StreamInfo{s, stream.displacement, stream.size});
+            list.emplace_back(ms::StreamInfo{s, stream.displacement, stream.size, stream.opaque_region});
     }
     surface.set_streams(list); 
 }
@@ -242,6 +242,33 @@ auto weak(std::shared_ptr<ms::SurfaceObservers>& observers) -> std::weak_ptr<ms:
 }
 }
 
+namespace
+{
+struct SnapshotState;
+}
+
+/**
+ * What generate_renderables() last worked out for each of the surface's streams.
+ *
+ * Compositors ask for the renderables of every surface every frame, but most
+ * surfaces look the same as they did last frame. So the renderables share a
+ * SnapshotState that is only rebuilt when something changes, and each frame
+ * just takes a fresh buffer from the stream.
+ *
+ * Positions are checked every frame, as streams can resize without telling us.
+ * Anything else affecting the renderables clears the cache.
+ */
+struct ms::BasicSurface::RenderableCache
+{
+    /// Indexed like layers; null where nothing is cached
+    std::vector<std::shared_ptr<SnapshotState const>> states;
+
+    void clear()
+    {
+        states.clear();
+    }
+};
+
 ms::BasicSurface::BasicSurface(
     std::shared_ptr<Session> const& session,
     std::string const& name,
@@ -265,7 +292,8 @@ ms::BasicSurface::BasicSurface(
     layers(layers),
     confine_pointer_state_(state),
     cursor_stream_adapter{std::make_unique<ms::CursorStreamImageAdapter>(*this)},
-    session_{session}
+    session_{session},
+    renderable_cache{std::make_unique<RenderableCache>()}
 {
     auto callback = [this, observers=weak(observers)](auto const& size)
         {
@@ -421,6 +449,7 @@ void ms::BasicSurface::set_alpha(float alpha)
     {
         std::lock_guard<std::mutex> lock(guard);
         surface_alpha = alpha;
+        renderable_cache->clear();
     }
     observers->alpha_set_to(this, alpha);
 }
@@ -435,6 +464,7 @@ void ms::BasicSurface::set_transformation(glm::mat4 const& t)
     {
         std::lock_guard<std::mutex> lock(guard);
         transformation_matrix = t;
+        renderable_cache->clear();
     }
     observers->transformation_set_to(this, t);
 }
@@ -787,6 +817,52 @@ std::shared_ptr<ms::Surface> ms::BasicSurface::parent() const
 
 namespace
 {
+/// How a stream of the surface is to be drawn. This only changes when the surface does.
+struct SnapshotState
+{
+    SnapshotState(
+        geom::Rectangle const& position,
+        std::experimental::optional<geom::Rectangle> const& clip_area,
+        glm::mat4 const& transform,
+        float alpha,
+        std::optional<std::vector<geom::Rectangle>> const& opaque_region,
+        bool allow_tearing)
+    : alpha{alpha},
+      screen_position(position),
+      clip_area(clip_area),
+      transformation(transform),
+      opaque_region{to_screen(opaque_region, position)},
+      allow_tearing{allow_tearing}
+    {
+    }
+
+    float const alpha;
+    geom::Rectangle const screen_position;
+    std::experimental::optional<geom::Rectangle> const clip_area;
+    glm::mat4 const transformation;
+    std::optional<std::vector<geom::Rectangle>> const opaque_region;
+    bool const allow_tearing;
+
+private:
+    static auto to_screen(
+        std::optional<std::vector<geom::Rectangle>> const& region,
+        geom::Rectangle const& position) -> std::optional<std::vector<geom::Rectangle>>
+    {
+        if (!region)
+            return std::nullopt;
+
+        std::vector<geom::Rectangle> result;
+        for (auto rect : region.value())
+        {
+            rect.top_left = rect.top_left + as_displacement(position.top_left);
+            rect = rect.intersection_with(position);
+            if (rect.size.width > geom::Width{} && rect.size.height > geom::Height{})
+                result.push_back(rect);
+        }
+        return result;
+    }
+};
+
 //This class avoids locking for long periods of time by copying (or lazy-copying)
 class SurfaceSnapshot : public mg::Renderable
 {
@@ -794,17 +870,11 @@ public:
     SurfaceSnapshot(
         std::shared_ptr<mc::BufferStream> const& stream,
         void const* compositor_id,
-        geom::Rectangle const& position,
-        std::experimental::optional<geom::Rectangle> const& clip_area,
-        glm::mat4 const& transform,
-        float alpha,
+        std::shared_ptr<SnapshotState const> const& state,
         mg::Renderable::ID id)
     : underlying_buffer_stream{stream},
       compositor_id{compositor_id},
-      alpha_{alpha},
-      screen_position_(position),
-      clip_area_(clip_area),
-      transformation_(transform),
+      state{state},
       id_(id)
     {
     }
@@ -821,30 +891,36 @@ public:
     }
 
     geom::Rectangle screen_position() const override
-    { return screen_position_; }
+    { return state->screen_position; }
 
     std::experimental::optional<geom::Rectangle> clip_area() const override
-    { return clip_area_; }
+    { return state->clip_area; }
 
     float alpha() const override
-    { return alpha_; }
+    { return state->alpha; }
 
     glm::mat4 transformation() const override
-    { return transformation_; }
+    { return state->transformation; }
 
     bool shaped() const override
     { return mg::contains_alpha(underlying_buffer_stream->pixel_format()); }
 
     mg::Renderable::ID id() const override
     { return id_; }
+
+    std::optional<geom::Rectangles> damage_since(mg::BufferID previous) const override
+    { return underlying_buffer_stream->damage_between(previous, buffer()->id()); }
+
+    std::optional<std::vector<geom::Rectangle>> opaque_region() const override
+    { return state->opaque_region; }
+
+    bool allow_tearing() const override
+    { return state->allow_tearing; }
 private:
     std::shared_ptr<mc::BufferStream> const underlying_buffer_stream;
     std::shared_ptr<mg::Buffer> mutable compositor_buffer;
     void const*const compositor_id;
-    float const alpha_;
-    geom::Rectangle const screen_position_;
-    std::experimental::optional<geom::Rectangle> const clip_area_;
-    glm::mat4 const transformation_;
+    std::shared_ptr<SnapshotState const> const state;
     mg::Renderable::ID const id_;
 };
 }
@@ -884,6 +960,7 @@ void ms::BasicSurface::set_streams(std::list<scene::StreamInfo> const& s)
             layer.stream->set_frame_posted_callback([](auto){});
 
         layers = s;
+        renderable_cache->clear();
 
         for(auto& layer : layers)
             layer.stream->set_frame_posted_callback(
@@ -910,6 +987,10 @@ mg::RenderableList ms::BasicSurface::generate_renderables(mc::CompositorID id) c
 
     auto const content_top_left_ = content_top_left(lock);
 
+    auto& cached_states = renderable_cache->states;
+    cached_states.resize(layers.size());
+    auto cached_state = cached_states.begin();
+
     for (auto const& info : layers)
     {
         if (info.stream->has_submitted_buffer())
@@ -920,12 +1001,18 @@ mg::RenderableList ms::BasicSurface::generate_renderables(mc::CompositorID id) c
             else
                 size = info.stream->stream_size();
 
+            geom::Rectangle const position{content_top_left_ + info.displacement, std::move(size)};
+
+            if (!*cached_state || (*cached_state)->screen_position != position)
+            {
+                *cached_state = std::make_shared<SnapshotState>(
+                    position, clip_area_, transformation_matrix, surface_alpha, info.opaque_region, allow_tearing_);
+            }
+
             list.emplace_back(std::make_shared<SurfaceSnapshot>(
-                info.stream, id,
-                geom::Rectangle{content_top_left_ + info.displacement, std::move(size)},
-                clip_area_,
-                transformation_matrix, surface_alpha, info.stream.get()));
+                info.stream, id, *cached_state, info.stream.get()));
         }
+        ++cached_state;
     }
     return list;
 }
@@ -977,6 +1064,7 @@ void mir::scene::BasicSurface::set_clip_area(std::experimental::optional<geom::R
 {
     std::lock_guard<std::mutex> lock(guard);
     clip_area_ = area;
+    renderable_cache->clear();
 }
 
 auto mir::scene::BasicSurface::focus_state() const -> MirWindowFocusState
@@ -1069,6 +1157,22 @@ void mir::scene::BasicSurface::set_focus_mode(MirFocusMode focus_mode)
     focus_mode_ = focus_mode;
 }
 
+auto mir::scene::BasicSurface::allow_tearing() const -> bool
+{
+    std::lock_guard<std::mutex> lock(guard);
+    return allow_tearing_;
+}
+
+void mir::scene::BasicSurface::set_allow_tearing(bool allow)
+{
+    std::lock_guard<std::mutex> lock(guard);
+    if (allow_tearing_ != allow)
+    {
+        allow_tearing_ = allow;
+        renderable_cache->clear();
+    }
+}
+
 auto mir::scene::BasicSurface::content_size(ProofOfMutexLock const&) const -> geometry::Size
 {
     return geom::Size{
@@ -168,6 +168,9 @@ public:
     auto focus_mode() const -> MirFocusMode override;
     void set_focus_mode(MirFocusMode focus_mode) override;
 
+    auto allow_tearing() const -> bool override;
+    void set_allow_tearing(bool allow) override;
+
 private:
     bool visible(ProofOfMutexLock const&) const;
     MirWindowType set_type(MirWindowType t);  // Use configure() to make public changes
@@ -221,6 +224,10 @@ private:
     } margins;
 
     MirFocusMode focus_mode_ = mir_focus_mode_focusable;
+    bool allow_tearing_ = false;
+
+    struct RenderableCache;
+    std::unique_ptr<RenderableCache> const renderable_cache;
 };
 
 }
@@ -19,6 +19,7 @@
 #include <condition_variable>
 #include <boost/throw_exception.hpp>
 #include <unordered_set>
+#include <algorithm>
 #include "mediating_display_changer.h"
 #include "mir/scene/session_container.h"
 #include "mir/scene/session.h"
@@ -82,27 +83,6 @@ public:
     }
 };
 
-class ApplyNowAndRevertOnScopeExit
-{
-public:
-    ApplyNowAndRevertOnScopeExit(std::function<void()> const& apply,
-                                 std::function<void()> const& revert)
-        : revert{revert}
-    {
-        apply();
-    }
-
-    ~ApplyNowAndRevertOnScopeExit()
-    {
-        revert();
-    }
-
-private:
-    ApplyNowAndRevertOnScopeExit(ApplyNowAndRevertOnScopeExit const&) = delete;
-    ApplyNowAndRevertOnScopeExit& operator=(ApplyNowAndRevertOnScopeExit const&) = delete;
-
-    std::function<void()> const revert;
-};
 }
 
 struct ms::MediatingDisplayChanger::SessionObserver : ms::SessionEventSink
@@ -384,6 +364,25 @@ bool configuration_has_new_outputs_enabled(
 }
 }
 
+void ms::MediatingDisplayChanger::configure_display(mg::DisplayConfiguration const& conf)
+{
+    /*
+     * Only the compositing for outputs that change needs to stop: everything
+     * else can carry on rendering while the display is reconfigured.
+     */
+    std::vector<mg::DisplaySyncGroup const*> preserved;
+    display->for_each_display_sync_group_preserved_by(
+        conf,
+        [&preserved](mg::DisplaySyncGroup& group) { preserved.push_back(&group); });
+
+    compositor->reconfigure(
+        [&preserved](mg::DisplaySyncGroup const& group)
+        {
+            return std::find(preserved.begin(), preserved.end(), &group) != preserved.end();
+        },
+        [this, &conf] { display->configure(conf); });
+}
+
 void ms::MediatingDisplayChanger::apply_config(
     std::shared_ptr<graphics::DisplayConfiguration> const& conf)
 {
@@ -393,10 +392,7 @@ void ms::MediatingDisplayChanger::apply_config(
         if (configuration_has_new_outputs_enabled(*display->configuration(), *conf) ||
             !display->apply_if_configuration_preserves_display_buffers(*conf))
         {
-            ApplyNowAndRevertOnScopeExit comp{
-                [this] { compositor->stop(); },
-                [this] { compositor->start(); }};
-            display->configure(*conf);
+            configure_display(*conf);
         }
 
         observer->configuration_applied(conf);
@@ -413,10 +409,7 @@ void ms::MediatingDisplayChanger::apply_config(
              * was one that has been successfully display->configure()d, or it was the
              * configuration that existed at Mir startup. Which presumably worked!
              */
-            ApplyNowAndRevertOnScopeExit comp{
-                [this] { compositor->stop(); },
-                [this] { compositor->start(); }};
-            display->configure(*existing_configuration);
+            configure_display(*existing_configuration);
         }
         catch (std::exception const& e)
         {
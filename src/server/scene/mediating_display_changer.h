@@ -96,6 +96,7 @@ private:
     void no_focus_handler();
     void session_stopping_handler(std::shared_ptr<Session> const& session);
 
+    void configure_display(graphics::DisplayConfiguration const& conf);
     void apply_config(std::shared_ptr<graphics::DisplayConfiguration> const& conf);
     void apply_base_config();
     void send_config_to_all_sessions(
@@ -47,16 +47,20 @@ namespace
 class SurfaceSceneElement : public mc::SceneElement
 {
 public:
-    SurfaceSceneElement(
-        std::string name,
+    void assign(
         std::shared_ptr<mg::Renderable> const& renderable,
         std::shared_ptr<ms::RenderingTracker> const& tracker,
         mc::CompositorID id)
-        : renderable_{renderable},
-          tracker{tracker},
-          cid{id},
-          surface_name(name)
     {
+        renderable_ = renderable;
+        this->tracker = tracker;
+        cid = id;
+    }
+
+    void reset()
+    {
+        renderable_.reset();
+        tracker.reset();
     }
 
     std::shared_ptr<mg::Renderable> renderable() const override
@@ -66,29 +70,34 @@ public:
 
     void rendered() override
     {
-        tracker->rendered_in(cid);
+        if (tracker)
+            tracker->rendered_in(cid);
     }
 
     void occluded() override
     {
-        tracker->occluded_in(cid);
+        if (tracker)
+            tracker->occluded_in(cid);
     }
 
 private:
-    std::shared_ptr<mg::Renderable> const renderable_;
-    std::shared_ptr<ms::RenderingTracker> const tracker;
-    mc::CompositorID cid;
-    std::string const surface_name;
+    std::shared_ptr<mg::Renderable> renderable_;
+    std::shared_ptr<ms::RenderingTracker> tracker;
+    mc::CompositorID cid{nullptr};
 };
 
 //note: something different than a 2D/HWC overlay
 class OverlaySceneElement : public mc::SceneElement
 {
 public:
-    OverlaySceneElement(
-        std::shared_ptr<mg::Renderable> renderable)
-        : renderable_{renderable}
+    void assign(std::shared_ptr<mg::Renderable> const& renderable)
+    {
+        renderable_ = renderable;
+    }
+
+    void reset()
     {
+        renderable_.reset();
     }
 
     std::shared_ptr<mg::Renderable> renderable() const override
@@ -105,7 +114,45 @@ public:
     }
 
 private:
-    std::shared_ptr<mg::Renderable> const renderable_;
+    std::shared_ptr<mg::Renderable> renderable_;
+};
+
+/// Elements that, once allocated, are kept for reuse
+template<typename Element>
+class RecycledElements
+{
+public:
+    template<typename... Args>
+    auto emplace_back(Args&&... args) -> Element&
+    {
+        if (used == elements.size())
+            elements.push_back(std::make_unique<Element>());
+
+        auto& element = *elements[used++];
+        element.assign(std::forward<Args>(args)...);
+        return element;
+    }
+
+    void clear()
+    {
+        for (auto i = 0u; i != used; ++i)
+            elements[i]->reset();
+        used = 0;
+    }
+
+    auto size() const -> size_t
+    {
+        return used;
+    }
+
+    auto operator[](size_t i) -> Element&
+    {
+        return *elements[i];
+    }
+
+private:
+    std::vector<std::unique_ptr<Element>> elements;
+    size_t used{0};
 };
 
 /**
@@ -128,10 +175,69 @@ private:
     ms::SurfaceStack* stack;
 };
 
+
+void insert_surface_at_top_of_depth_layer(
+    std::vector<std::vector<std::shared_ptr<ms::Surface>>>& surface_layers,
+    std::shared_ptr<ms::Surface> const& surface)
+{
+    unsigned int depth_index = mir::mir_depth_layer_get_index(surface->depth_layer());
+    if (surface_layers.size() <= depth_index)
+        surface_layers.resize(depth_index + 1);
+    surface_layers[depth_index].push_back(surface);
 }
+}
+
+/**
+ * Storage for the scene elements of a compositor's frames.
+ *
+ * Compositors ask for the scene every frame, so rather than allocating each
+ * element separately we keep the elements of a frame together and hand out
+ * shared_ptrs that alias their Frame. Once the compositor lets go of them all,
+ * the Frame's elements drop their renderables (so we don't keep buffers alive)
+ * and are ready to be reused.
+ */
+struct ms::SurfaceStack::ElementPool : std::enable_shared_from_this<ElementPool>
+{
+    struct Frame
+    {
+        RecycledElements<SurfaceSceneElement> surface_elements;
+        RecycledElements<OverlaySceneElement> overlay_elements;
+        std::atomic<bool> in_use{false};
+    };
+
+    auto acquire() -> std::shared_ptr<Frame>
+    {
+        std::lock_guard<decltype(mutex)> lock{mutex};
+
+        auto frame = std::find_if(
+            frames.begin(), frames.end(),
+            [](auto const& frame) { return !frame->in_use; });
+
+        if (frame == frames.end())
+        {
+            // The compositor is still holding on to all our frames
+            frames.push_back(std::make_unique<Frame>());
+            frame = frames.end() - 1;
+        }
+
+        (*frame)->in_use = true;
+        return {
+            frame->get(),
+            [pool = shared_from_this()](Frame* frame)
+            {
+                frame->surface_elements.clear();
+                frame->overlay_elements.clear();
+                frame->in_use = false;
+            }};
+    }
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Frame>> frames;
+};
 
 ms::SurfaceStack::SurfaceStack(
     std::shared_ptr<SceneReport> const& report) :
+    state{std::make_shared<State const>()},
     report{report},
     scene_changed{false},
     surface_observer{std::make_shared<SurfaceDepthLayerObserver>(this)}
@@ -140,8 +246,8 @@ ms::SurfaceStack::SurfaceStack(
 
 ms::SurfaceStack::~SurfaceStack() noexcept(true)
 {
-    RecursiveWriteLock lg(guard);
-    for (auto const& layer : surface_layers)
+    std::lock_guard<decltype(update_mutex)> lock{update_mutex};
+    for (auto const& layer : current_state()->surface_layers)
     {
         for (auto const& surface : layer)
         {
@@ -152,48 +258,63 @@ ms::SurfaceStack::~SurfaceStack() noexcept(true)
 
 mc::SceneElementSequence ms::SurfaceStack::scene_elements_for(mc::CompositorID id)
 {
-    RecursiveReadLock lg(guard);
-
     scene_changed = false;
-    mc::SceneElementSequence elements;
-    for (auto const& layer : surface_layers)
+
+    auto const current = current_state();
+
+    auto const pool = current->element_pools.find(id);
+    auto const frame = pool != current->element_pools.end() ?
+        pool->second->acquire() :
+        std::make_shared<ElementPool>()->acquire();
+
+    for (auto const& layer : current->surface_layers)
     {
         for (auto const& surface : layer)
         {
             if (surface->visible())
             {
+                auto const tracker = current->rendering_trackers.find(surface.get());
                 for (auto& renderable : surface->generate_renderables(id))
                 {
-                    elements.emplace_back(
-                        std::make_shared<SurfaceSceneElement>(
-                            surface->name(),
-                            renderable,
-                            rendering_trackers[surface.get()],
-                            id));
+                    frame->surface_elements.emplace_back(
+                        renderable,
+                        tracker != current->rendering_trackers.end() ? tracker->second : nullptr,
+                        id);
                 }
             }
         }
     }
-    for (auto const& renderable : overlays)
+    for (auto const& renderable : current->overlays)
+    {
+        frame->overlay_elements.emplace_back(renderable);
+    }
+
+    mc::SceneElementSequence elements;
+    elements.reserve(frame->surface_elements.size() + frame->overlay_elements.size());
+    for (auto i = 0u; i != frame->surface_elements.size(); ++i)
+    {
+        elements.emplace_back(frame, &frame->surface_elements[i]);
+    }
+    for (auto i = 0u; i != frame->overlay_elements.size(); ++i)
     {
-        elements.emplace_back(std::make_shared<OverlaySceneElement>(renderable));
+        elements.emplace_back(frame, &frame->overlay_elements[i]);
     }
     return elements;
 }
 
 int ms::SurfaceStack::frames_pending(mc::CompositorID id) const
 {
-    RecursiveReadLock lg(guard);
-
     int result = scene_changed ? 1 : 0;
-    for (auto const& layer : surface_layers)
+
+    auto const current = current_state();
+    for (auto const& layer : current->surface_layers)
     {
         for (auto const& surface : layer)
         {
             if (surface->visible())
             {
-                auto const tracker = rendering_trackers.find(surface.get());
-                if (tracker != rendering_trackers.end() && tracker->second->is_exposed_in(id))
+                auto const tracker = current->rendering_trackers.find(surface.get());
+                if (tracker != current->rendering_trackers.end() && tracker->second->is_exposed_in(id))
                 {
                     // Note that we ask the surface and not a Renderable.
                     // This is because we don't want to waste time and resources
@@ -210,28 +331,36 @@ int ms::SurfaceStack::frames_pending(mc::CompositorID id) const
 
 void ms::SurfaceStack::register_compositor(mc::CompositorID cid)
 {
-    RecursiveWriteLock lg(guard);
+    std::lock_guard<decltype(update_mutex)> lock{update_mutex};
 
     registered_compositors.insert(cid);
 
-    update_rendering_tracker_compositors();
+    auto const next = copy_state();
+    next->element_pools.emplace(cid, std::make_shared<ElementPool>());
+    update_rendering_tracker_compositors(*next);
+    publish(next);
 }
 
 void ms::SurfaceStack::unregister_compositor(mc::CompositorID cid)
 {
-    RecursiveWriteLock lg(guard);
+    std::lock_guard<decltype(update_mutex)> lock{update_mutex};
 
     registered_compositors.erase(cid);
 
-    update_rendering_tracker_compositors();
+    auto const next = copy_state();
+    next->element_pools.erase(cid);
+    update_rendering_tracker_compositors(*next);
+    publish(next);
 }
 
 void ms::SurfaceStack::add_input_visualization(
     std::shared_ptr<mg::Renderable> const& overlay)
 {
     {
-        RecursiveWriteLock lg(guard);
-        overlays.push_back(overlay);
+        std::lock_guard<decltype(update_mutex)> lock{update_mutex};
+        auto const next = copy_state();
+        next->overlays.push_back(overlay);
+        publish(next);
     }
     emit_scene_changed();
 }
@@ -241,13 +370,15 @@ void ms::SurfaceStack::remove_input_visualization(
 {
     auto overlay = weak_overlay.lock();
     {
-        RecursiveWriteLock lg(guard);
-        auto const p = std::find(overlays.begin(), overlays.end(), overlay);
-        if (p == overlays.end())
+        std::lock_guard<decltype(update_mutex)> lock{update_mutex};
+        auto const next = copy_state();
+        auto const p = std::find(next->overlays.begin(), next->overlays.end(), overlay);
+        if (p == next->overlays.end())
         {
             BOOST_THROW_EXCEPTION(std::runtime_error("Attempt to remove an overlay which was never added or which has been previously removed"));
         }
-        overlays.erase(p);
+        next->overlays.erase(p);
+        publish(next);
     }
     
     emit_scene_changed();
@@ -255,10 +386,7 @@ void ms::SurfaceStack::remove_input_visualization(
 
 void ms::SurfaceStack::emit_scene_changed()
 {
-    {
-        RecursiveWriteLock lg(guard);
-        scene_changed = true;
-    }
+    scene_changed = true;
     observers.scene_changed();
 }
 
@@ -267,10 +395,12 @@ void ms::SurfaceStack::add_surface(
     mi::InputReceptionMode input_mode)
 {
     {
-        RecursiveWriteLock lg(guard);
-        insert_surface_at_top_of_depth_layer(surface);
-        create_rendering_tracker_for(surface);
+        std::lock_guard<decltype(update_mutex)> lock{update_mutex};
+        auto const next = copy_state();
+        insert_surface_at_top_of_depth_layer(next->surface_layers, surface);
+        create_rendering_tracker_for(*next, surface);
         surface->add_observer(surface_observer);
+        publish(next);
     }
     surface->set_reception_mode(input_mode);
     observers.surface_added(surface);
@@ -284,21 +414,25 @@ void ms::SurfaceStack::remove_surface(std::weak_ptr<Surface> const& surface)
 
     bool found_surface = false;
     {
-        RecursiveWriteLock lg(guard);
+        std::lock_guard<decltype(update_mutex)> lock{update_mutex};
+        auto const next = copy_state();
 
-        for (auto& layer : surface_layers)
+        for (auto& layer : next->surface_layers)
         {
             auto const surface = std::find(layer.begin(), layer.end(), keep_alive);
 
             if (surface != layer.end())
             {
                 layer.erase(surface);
-                rendering_trackers.erase(keep_alive.get());
+                next->rendering_trackers.erase(keep_alive.get());
                 keep_alive->remove_observer(surface_observer);
                 found_surface = true;
                 break;
             }
         }
+
+        if (found_surface)
+            publish(next);
     }
 
     if (found_surface)
@@ -325,8 +459,8 @@ InReverse<Container> in_reverse(Container& container) { return InReverse<Contain
 auto ms::SurfaceStack::surface_at(geometry::Point cursor) const
 -> std::shared_ptr<Surface>
 {
-    RecursiveReadLock lg(guard);
-    for (auto const& layer : in_reverse(surface_layers))
+    auto const current = current_state();
+    for (auto const& layer : in_reverse(current->surface_layers))
     {
         for (auto const& surface : in_reverse(layer))
         {
@@ -344,8 +478,8 @@ auto ms::SurfaceStack::surface_at(geometry::Point cursor) const
 
 void ms::SurfaceStack::for_each(std::function<void(std::shared_ptr<mi::Surface> const&)> const& callback)
 {
-    RecursiveReadLock lg(guard);
-    for (auto const& layer : surface_layers)
+    auto const current = current_state();
+    for (auto const& layer : current->surface_layers)
     {
         for (auto const& surface : layer)
         {
@@ -359,8 +493,10 @@ void ms::SurfaceStack::raise(Surface const* surface)
     SurfaceSet affected_surfaces;
 
     {
-        RecursiveWriteLock ul(guard);
-        for (auto& layer : surface_layers)
+        std::lock_guard<decltype(update_mutex)> lock{update_mutex};
+        auto const next = copy_state();
+
+        for (auto& layer : next->surface_layers)
         {
             auto const p = std::find_if(
                 layer.begin(),
@@ -374,11 +510,14 @@ void ms::SurfaceStack::raise(Surface const* surface)
             {
                 std::shared_ptr<Surface> surface_shared = *p;
                 layer.erase(p);
-                insert_surface_at_top_of_depth_layer(surface_shared);
+                insert_surface_at_top_of_depth_layer(next->surface_layers, surface_shared);
                 affected_surfaces.insert(surface_shared);
                 break;
             }
         }
+
+        if (!affected_surfaces.empty())
+            publish(next);
     }
 
     if (affected_surfaces.empty())
@@ -401,8 +540,10 @@ void ms::SurfaceStack::raise(SurfaceSet const& ss)
 {
     bool surfaces_reordered{false};
     {
-        RecursiveWriteLock ul(guard);
-        for (auto& layer : surface_layers)
+        std::lock_guard<decltype(update_mutex)> lock{update_mutex};
+        auto const next = copy_state();
+
+        for (auto& layer : next->surface_layers)
         {
             auto const old_layer = layer;
 
@@ -420,12 +561,15 @@ void ms::SurfaceStack::raise(SurfaceSet const& ss)
             // One by one insert to_raise surfaces into the surfaces vector at the correct position
             // It is important that to_raise is still in the original order
             for (auto const& surface : to_raise)
-                insert_surface_at_top_of_depth_layer(surface);
+                insert_surface_at_top_of_depth_layer(next->surface_layers, surface);
 
             // Only set surfaces_reordered if the end result is different than before
             if (old_layer != layer)
                 surfaces_reordered = true;
         }
+
+        if (surfaces_reordered)
+            publish(next);
     }
 
     if (surfaces_reordered)
@@ -434,29 +578,36 @@ void ms::SurfaceStack::raise(SurfaceSet const& ss)
     }
 }
 
-void ms::SurfaceStack::create_rendering_tracker_for(std::shared_ptr<Surface> const& surface)
+auto ms::SurfaceStack::current_state() const -> std::shared_ptr<State const>
 {
-    auto const tracker = std::make_shared<RenderingTracker>(surface);
+    std::lock_guard<decltype(state_mutex)> lock{state_mutex};
+    return state;
+}
 
-    RecursiveWriteLock ul(guard);
-    tracker->active_compositors(registered_compositors);
-    rendering_trackers[surface.get()] = tracker;
+auto ms::SurfaceStack::copy_state() const -> std::shared_ptr<State>
+{
+    return std::make_shared<State>(*current_state());
 }
 
-void ms::SurfaceStack::update_rendering_tracker_compositors()
+void ms::SurfaceStack::publish(std::shared_ptr<State const> next)
 {
-    RecursiveReadLock ul(guard);
+    std::lock_guard<decltype(state_mutex)> lock{state_mutex};
+    // The old state is released outside the lock, by whoever holds it last
+    std::swap(state, next);
+}
 
-    for (auto const& pair : rendering_trackers)
-        pair.second->active_compositors(registered_compositors);
+void ms::SurfaceStack::create_rendering_tracker_for(State& next, std::shared_ptr<Surface> const& surface)
+{
+    auto const tracker = std::make_shared<RenderingTracker>(surface);
+
+    tracker->active_compositors(registered_compositors);
+    next.rendering_trackers[surface.get()] = tracker;
 }
 
-void ms::SurfaceStack::insert_surface_at_top_of_depth_layer(std::shared_ptr<Surface> const& surface)
+void ms::SurfaceStack::update_rendering_tracker_compositors(State const& next)
 {
-    unsigned int depth_index = mir_depth_layer_get_index(surface->depth_layer());
-    if (surface_layers.size() <= depth_index)
-        surface_layers.resize(depth_index + 1);
-    surface_layers[depth_index].push_back(surface);
+    for (auto const& pair : next.rendering_trackers)
+        pair.second->active_compositors(registered_compositors);
 }
 
 void ms::SurfaceStack::add_observer(std::shared_ptr<ms::Observer> const& observer)
@@ -464,8 +615,8 @@ void ms::SurfaceStack::add_observer(std::shared_ptr<ms::Observer> const& observe
     observers.add(observer);
 
     // Notify observer of existing surfaces
-    RecursiveReadLock lk(guard);
-    for (auto const& layer : surface_layers)
+    auto const current = current_state();
+    for (auto const& layer : current->surface_layers)
     {
         for (auto const& surface : layer)
         {
@@ -489,8 +640,8 @@ auto ms::SurfaceStack::stacking_order_of(SurfaceSet const& surfaces) const -> Su
 {
     SurfaceList result;
 
-    RecursiveReadLock lk(guard);
-    for (auto const& layer : surface_layers)
+    auto const current = current_state();
+    for (auto const& layer : current->surface_layers)
     {
         for (auto const& surface : layer)
         {
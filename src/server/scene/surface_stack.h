@@ -25,7 +25,6 @@
 #include "mir/compositor/scene.h"
 #include "mir/scene/observer.h"
 #include "mir/input/scene.h"
-#include "mir/recursive_read_write_mutex.h"
 
 #include "mir/basic_observers.h"
 #include "mir/scene/surface_observer.h"
@@ -112,26 +111,54 @@ public:
 private:
     SurfaceStack(const SurfaceStack&) = delete;
     SurfaceStack& operator=(const SurfaceStack&) = delete;
-    void create_rendering_tracker_for(std::shared_ptr<Surface> const&);
-    void update_rendering_tracker_compositors();
-    void insert_surface_at_top_of_depth_layer(std::shared_ptr<Surface> const& surface);
-
-    RecursiveReadWriteMutex mutable guard;
-
-    std::shared_ptr<SceneReport> const report;
+    struct ElementPool;
+
+    /// The contents of the stack at some instant
+    struct State
+    {
+        /**
+         * All surfaces managed by this class
+         *
+         * Each depth layer is mapped to an index of the outer vector by mir_depth_layer_to_index()
+         * The outer vector starts out empty, and is expanded as needed to contain the highest layer encountered
+         * The inner vectors contain the list of surfaces on each layer (bottom to top)
+         */
+        std::vector<std::vector<std::shared_ptr<Surface>>> surface_layers;
+        std::map<Surface*,std::shared_ptr<RenderingTracker>> rendering_trackers;
+        /// Recycled scene elements for each registered compositor
+        std::map<compositor::CompositorID, std::shared_ptr<ElementPool>> element_pools;
+
+        std::vector<std::shared_ptr<graphics::Renderable>> overlays;
+    };
+
+    /// The published state. Readers may keep it as long as they like: it won't change.
+    auto current_state() const -> std::shared_ptr<State const>;
+    /// A copy of the published state for a writer to modify. Requires update_mutex to be held.
+    auto copy_state() const -> std::shared_ptr<State>;
+    /// Replace the published state. Requires update_mutex to be held.
+    void publish(std::shared_ptr<State const> next);
+
+    void create_rendering_tracker_for(State& next, std::shared_ptr<Surface> const&);
+    void update_rendering_tracker_compositors(State const& next);
+
+    /// Serialises changes to the stack. Readers don't need it.
+    std::mutex mutable update_mutex;
 
     /**
-     * All surfaces managed by this class
+     * A published State is never modified: writers copy it, make their changes to
+     * the copy and publish that in its place. Readers (the compositors, input
+     * dispatch, the shell...) just take a reference to the current State and work
+     * on that snapshot without holding anything up.
      *
-     * Each depth layer is mapped to an index of the outer vector by mir_depth_layer_to_index()
-     * The outer vector starts out empty, and is expanded as needed to contain the highest layer encountered
-     * The inner vectors contain the list of surfaces on each layer (bottom to top)
+     * state_mutex is only ever held to copy or replace the pointer.
+     * (std::atomic<std::shared_ptr> would do, but libstdc++ 12's load() is racy.)
      */
-    std::vector<std::vector<std::shared_ptr<Surface>>> surface_layers;
-    std::map<Surface*,std::shared_ptr<RenderingTracker>> rendering_trackers;
+    std::mutex mutable state_mutex;
+    std::shared_ptr<State const> state;
+
+    std::shared_ptr<SceneReport> const report;
+
     std::set<compositor::CompositorID> registered_compositors;
-    
-    std::vector<std::shared_ptr<graphics::Renderable>> overlays;
 
     Observers observers;
     std::atomic<bool> scene_changed;
@@ -32,7 +32,8 @@ auto msh::operator==(StreamSpecification const& lhs, StreamSpecification const&
     return
         lhs.stream.lock() == rhs.stream.lock() &&
         lhs.displacement == rhs.displacement &&
-        lhs.size == rhs.size;
+        lhs.size == rhs.size &&
+        lhs.opaque_region == rhs.opaque_region;
 }
 
 auto msh::operator==(StreamCursor const& lhs, StreamCursor const& rhs) -> bool
@@ -77,7 +78,8 @@ bool msh::SurfaceSpecification::is_empty() const
         !exclusive_rect.is_set() &&
         !application_id.is_set() &&
         !server_side_decorated.is_set() &&
-        !focus_mode.is_set();
+        !focus_mode.is_set() &&
+        !allow_tearing.is_set();
 }
 
 void msh::SurfaceSpecification::update_from(SurfaceSpecification const& that)
@@ -162,6 +164,8 @@ void msh::SurfaceSpecification::update_from(SurfaceSpecification const& that)
         server_side_decorated = that.server_side_decorated;
     if (that.focus_mode.is_set())
         focus_mode = that.focus_mode;
+    if (that.allow_tearing.is_set())
+        allow_tearing = that.allow_tearing;
 }
 
 bool msh::operator==(
@@ -211,7 +215,8 @@ bool msh::operator==(
         lhs.exclusive_rect == rhs.exclusive_rect &&
         lhs.application_id == rhs.application_id &&
         lhs.server_side_decorated == rhs.server_side_decorated &&
-        lhs.focus_mode == rhs.focus_mode;
+        lhs.focus_mode == rhs.focus_mode &&
+        lhs.allow_tearing == rhs.allow_tearing;
 }
 
 bool msh::operator!=(
@@ -100,11 +100,33 @@ public:
         return std::experimental::optional<geometry::Rectangle>();
     }
 
+    void set_opaque_region(std::optional<std::vector<geometry::Rectangle>> const& region)
+    {
+        opaque = region;
+    }
+
+    std::optional<std::vector<geometry::Rectangle>> opaque_region() const override
+    {
+        return opaque;
+    }
+
+    void set_allow_tearing(bool allow)
+    {
+        tearing = allow;
+    }
+
+    bool allow_tearing() const override
+    {
+        return tearing;
+    }
+
 private:
     std::shared_ptr<graphics::Buffer> buf;
     mir::geometry::Rectangle rect;
     float opacity;
     bool rectangular;
+    std::optional<std::vector<geometry::Rectangle>> opaque;
+    bool tearing{false};
 };
 
 } // namespace doubles
@@ -53,6 +53,8 @@ struct MockBufferStream : public compositor::BufferStream
             .WillByDefault(testing::Return(mir_pixel_format_abgr_8888));
         ON_CALL(*this, stream_size())
             .WillByDefault(testing::Return(geometry::Size{0,0}));
+        ON_CALL(*this, damage_between(testing::_, testing::_))
+            .WillByDefault(testing::Return(std::nullopt));
     }
     std::shared_ptr<StubBuffer> buffer { std::make_shared<StubBuffer>() };
     MOCK_METHOD1(acquire_client_buffer, void(std::function<void(graphics::Buffer* buffer)>));
@@ -72,6 +74,9 @@ struct MockBufferStream : public compositor::BufferStream
     MOCK_METHOD0(drop_client_requests, void());
 
     MOCK_METHOD1(submit_buffer, void(std::shared_ptr<graphics::Buffer> const&));
+    MOCK_METHOD2(submit_buffer, void(std::shared_ptr<graphics::Buffer> const&, geometry::Rectangles const&));
+    MOCK_CONST_METHOD2(damage_between,
+                       std::optional<geometry::Rectangles>(graphics::BufferID, graphics::BufferID));
     MOCK_METHOD1(with_most_recent_buffer_do, void(std::function<void(graphics::Buffer&)> const&));
     MOCK_CONST_METHOD0(pixel_format, MirPixelFormat());
     MOCK_CONST_METHOD0(has_submitted_buffer, bool());
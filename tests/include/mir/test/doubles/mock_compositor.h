@@ -33,8 +33,21 @@ namespace doubles
 class MockCompositor : public compositor::Compositor
 {
 public:
+    MockCompositor()
+    {
+        ON_CALL(*this, reconfigure(testing::_, testing::_))
+            .WillByDefault(testing::Invoke(
+                [this](auto const& preserved, auto const& change)
+                {
+                    compositor::Compositor::reconfigure(preserved, change);
+                }));
+    }
+
     MOCK_METHOD0(start, void());
     MOCK_METHOD0(stop, void());
+    MOCK_METHOD2(reconfigure, void(
+        std::function<bool(graphics::DisplaySyncGroup const&)> const&,
+        std::function<void()> const&));
 };
 
 }
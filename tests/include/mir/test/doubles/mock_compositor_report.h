@@ -43,6 +43,13 @@ public:
                  void(compositor::CompositorReport::SubCompositorId));
     MOCK_METHOD1(finished_frame,
                  void(compositor::CompositorReport::SubCompositorId));
+    MOCK_METHOD2(frame_cpu_time,
+                 void(compositor::CompositorReport::SubCompositorId, std::chrono::nanoseconds));
+    MOCK_METHOD2(frame_gpu_time,
+                 void(compositor::CompositorReport::SubCompositorId, std::chrono::nanoseconds));
+    MOCK_CONST_METHOD0(wants_gpu_times, bool());
+    MOCK_METHOD2(frame_post_wait,
+                 void(compositor::CompositorReport::SubCompositorId, std::chrono::nanoseconds));
     MOCK_METHOD0(started, void());
     MOCK_METHOD0(stopped, void());
     MOCK_METHOD0(scheduled, void());
@@ -132,11 +132,25 @@ public:
                                                   uint32_t flags, void *user_data));
     MOCK_METHOD2(drmHandleEvent, int(int fd, drmEventContextPtr evctx));
 
+    MOCK_METHOD0(drmModeAtomicAlloc, drmModeAtomicReqPtr());
+    MOCK_METHOD1(drmModeAtomicFree, void(drmModeAtomicReqPtr req));
+    MOCK_METHOD4(drmModeAtomicAddProperty, int(drmModeAtomicReqPtr req, uint32_t object_id,
+                                               uint32_t property_id, uint64_t value));
+    MOCK_METHOD4(drmModeAtomicCommit, int(int fd, drmModeAtomicReqPtr req, uint32_t flags, void* user_data));
+    MOCK_METHOD4(drmModeCreatePropertyBlob, int(int fd, void const* data, size_t size, uint32_t* id));
+    MOCK_METHOD2(drmModeDestroyPropertyBlob, int(int fd, uint32_t id));
+    MOCK_METHOD(int, drmModeSetPlane, (int fd, uint32_t plane_id, uint32_t crtc_id, uint32_t fb_id,
+                                       uint32_t flags, int32_t crtc_x, int32_t crtc_y,
+                                       uint32_t crtc_w, uint32_t crtc_h, uint32_t src_x, uint32_t src_y,
+                                       uint32_t src_w, uint32_t src_h), ());
+
     MOCK_METHOD3(drmGetCap, int(int fd, uint64_t capability, uint64_t *value));
     MOCK_METHOD3(drmSetClientCap, int(int fd, uint64_t capability, uint64_t value));
     MOCK_METHOD2(drmModeGetProperty, drmModePropertyPtr(int fd, uint32_t propertyId));
     MOCK_METHOD1(drmModeFreeProperty, void(drmModePropertyPtr));
     MOCK_METHOD4(drmModeConnectorSetProperty, int(int fd, uint32_t connector_id, uint32_t property_id, uint64_t value));
+    MOCK_METHOD5(drmModeObjectSetProperty, int(int fd, uint32_t object_id, uint32_t object_type,
+                                               uint32_t property_id, uint64_t value));
 
     MOCK_METHOD2(drmGetMagic, int(int fd, drm_magic_t *magic));
     MOCK_METHOD2(drmAuthMagic, int(int fd, drm_magic_t magic));
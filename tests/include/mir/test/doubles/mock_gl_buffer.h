@@ -42,6 +42,15 @@ public:
     MOCK_METHOD(void, bind, (), (override));
     MOCK_METHOD(void, add_syncpoint, (), (override));
 };
+
+struct MockUploadableTextureBuffer : public MockTextureBuffer,
+                                     public graphics::gl::UploadableTexture
+{
+public:
+    using MockTextureBuffer::MockTextureBuffer;
+
+    MOCK_METHOD(void, upload_to_bound_texture, (std::optional<geometry::Rectangles> const&), (override));
+};
 }
 }
 }
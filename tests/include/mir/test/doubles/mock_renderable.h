@@ -45,6 +45,8 @@ struct MockRenderable : public graphics::Renderable
             .WillByDefault(testing::Return(glm::mat4{}));
         ON_CALL(*this, visible())
             .WillByDefault(testing::Return(true));
+        ON_CALL(*this, damage_since(testing::_))
+            .WillByDefault(testing::Return(std::nullopt));
     }
 
     MOCK_CONST_METHOD0(id, ID());
@@ -55,6 +57,7 @@ struct MockRenderable : public graphics::Renderable
     MOCK_CONST_METHOD0(transformation, glm::mat4());
     MOCK_CONST_METHOD0(visible, bool());
     MOCK_CONST_METHOD0(shaped, bool());
+    MOCK_CONST_METHOD1(damage_since, std::optional<geometry::Rectangles>(graphics::BufferID));
 };
 }
 }
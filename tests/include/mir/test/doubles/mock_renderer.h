@@ -35,6 +35,7 @@ struct MockRenderer : public renderer::Renderer
     MOCK_METHOD1(set_output_transform, void(glm::mat2 const&));
     MOCK_CONST_METHOD1(render, void(graphics::RenderableList const&));
     MOCK_METHOD0(suspend, void());
+    MOCK_METHOD0(completed_gpu_time, std::optional<std::chrono::nanoseconds>());
 
     ~MockRenderer() noexcept {}
 };
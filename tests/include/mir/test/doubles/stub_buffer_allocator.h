@@ -74,7 +74,7 @@ struct StubBufferAllocator : public graphics::GraphicBufferAllocator
     {
     }
 
-    auto buffer_from_resource(wl_resource*, std::function<void()>&&, std::function<void()>&&)
+    auto buffer_from_resource(wl_resource*, wl_resource*, std::function<void()>&&, std::function<void()>&&)
         -> std::shared_ptr<graphics::Buffer> override
     {
         BOOST_THROW_EXCEPTION((std::runtime_error{"StubBufferAllocator doesn't do HW Wayland buffers"}));
@@ -83,6 +83,7 @@ struct StubBufferAllocator : public graphics::GraphicBufferAllocator
     auto buffer_from_shm(
         wl_resource* resource,
         std::shared_ptr<mir::Executor> executor,
+        std::optional<geometry::Rectangles> const& damage,
         std::function<void()>&& on_consumed) -> std::shared_ptr<graphics::Buffer> override
     {
         // Temporary(?!) hack to actually use the buffer, for WLCS test
@@ -94,6 +95,7 @@ struct StubBufferAllocator : public graphics::GraphicBufferAllocator
             resource,
             std::move(executor),
             std::make_shared<graphics::common::EGLContextExecutor>(std::make_unique<test::doubles::NullGLContext>()),
+            damage,
             std::move(on_consumed));
     }
 };
@@ -36,6 +36,7 @@ public:
     void set_viewport(geometry::Rectangle const&) override {}
     void set_output_transform(glm::mat2 const&) override {}
     void suspend() override {}
+    auto completed_gpu_time() -> std::optional<std::chrono::nanoseconds> override { return std::nullopt; }
 
     void render(graphics::RenderableList const& renderables) const override
     {
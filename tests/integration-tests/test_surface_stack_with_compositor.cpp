@@ -23,6 +23,7 @@
 #include "src/server/scene/basic_surface.h"
 #include "src/server/compositor/default_display_buffer_compositor_factory.h"
 #include "src/server/compositor/multi_threaded_compositor.h"
+#include "src/server/compositor/deadline_frame_scheduler.h"
 #include "src/server/compositor/stream.h"
 #include "mir/test/fake_shared.h"
 #include "mir/test/doubles/mock_buffer_stream.h"
@@ -158,7 +159,7 @@ struct SurfaceStackCompositor : public Test
         null_comp_report};
 };
 
-std::chrono::milliseconds const default_delay{-1};
+auto const default_scheduling = std::make_shared<mc::DeadlineFrameSchedulerFactory>();
 
 }
 
@@ -169,7 +170,7 @@ TEST_F(SurfaceStackCompositor, composes_on_start_if_told_to_in_constructor)
         mt::fake_shared(stack),
         mt::fake_shared(dbc_factory),
         mt::fake_shared(stub_display_listener),
-        null_comp_report, default_delay, true);
+        null_comp_report, default_scheduling, true);
     mt_compositor.start();
 
     EXPECT_TRUE(stub_primary_db.has_posted_at_least(1, timeout));
@@ -183,7 +184,7 @@ TEST_F(SurfaceStackCompositor, does_not_composes_on_start_if_told_not_to_in_cons
         mt::fake_shared(stack),
         mt::fake_shared(dbc_factory),
         mt::fake_shared(stub_display_listener),
-        null_comp_report, default_delay, false);
+        null_comp_report, default_scheduling, false);
     mt_compositor.start();
 
     EXPECT_TRUE(stub_primary_db.has_posted_at_least(0, timeout));
@@ -197,7 +198,7 @@ TEST_F(SurfaceStackCompositor, swapping_a_surface_that_has_been_added_triggers_a
         mt::fake_shared(stack),
         mt::fake_shared(dbc_factory),
         mt::fake_shared(stub_display_listener),
-        null_comp_report, default_delay, false);
+        null_comp_report, default_scheduling, false);
     mt_compositor.start();
 
     stack.add_surface(stub_surface, mi::InputReceptionMode::normal);
@@ -223,7 +224,7 @@ TEST_F(SurfaceStackCompositor, compositor_runs_until_all_surfaces_buffers_are_co
         mt::fake_shared(stack),
         mt::fake_shared(dbc_factory),
         mt::fake_shared(stub_display_listener),
-        null_comp_report, default_delay, false);
+        null_comp_report, default_scheduling, false);
     mt_compositor.start();
 
     stack.add_surface(stub_surface, mi::InputReceptionMode::normal);
@@ -253,7 +254,7 @@ TEST_F(SurfaceStackCompositor, bypassed_compositor_runs_until_all_surfaces_buffe
         mt::fake_shared(stack),
         mt::fake_shared(dbc_factory),
         mt::fake_shared(stub_display_listener),
-        null_comp_report, default_delay, false);
+        null_comp_report, default_scheduling, false);
     mt_compositor.start();
 
     stack.add_surface(stub_surface, mi::InputReceptionMode::normal);
@@ -271,7 +272,7 @@ TEST_F(SurfaceStackCompositor, an_empty_scene_retriggers)
         mt::fake_shared(stack),
         mt::fake_shared(dbc_factory),
         mt::fake_shared(stub_display_listener),
-        null_comp_report, default_delay, false);
+        null_comp_report, default_scheduling, false);
     mt_compositor.start();
 
     stack.add_surface(stub_surface, mi::InputReceptionMode::normal);
@@ -296,7 +297,7 @@ TEST_F(SurfaceStackCompositor, moving_a_surface_triggers_composition)
         mt::fake_shared(stack),
         mt::fake_shared(dbc_factory),
         mt::fake_shared(stub_display_listener),
-        null_comp_report, default_delay, false);
+        null_comp_report, default_scheduling, false);
 
     mt_compositor.start();
     stub_surface->move_to(geom::Point{1,1});
@@ -315,7 +316,7 @@ TEST_F(SurfaceStackCompositor, removing_a_surface_triggers_composition)
         mt::fake_shared(stack),
         mt::fake_shared(dbc_factory),
         mt::fake_shared(stub_display_listener),
-        null_comp_report, default_delay, false);
+        null_comp_report, default_scheduling, false);
 
     mt_compositor.start();
     stack.remove_surface(stub_surface);
@@ -334,7 +335,7 @@ TEST_F(SurfaceStackCompositor, buffer_updates_trigger_composition)
         mt::fake_shared(stack),
         mt::fake_shared(dbc_factory),
         mt::fake_shared(stub_display_listener),
-        null_comp_report, default_delay, false);
+        null_comp_report, default_scheduling, false);
 
     mt_compositor.start();
     streams.front().stream->submit_buffer(stub_buffer);
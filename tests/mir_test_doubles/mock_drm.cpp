@@ -309,6 +309,23 @@ mtd::MockDRM::MockDRM()
     ON_CALL(*this, drmModeObjectGetProperties(_, _, _))
         .WillByDefault(Return(&empty_object_props));
 
+    ON_CALL(*this, drmModeAtomicAlloc())
+        .WillByDefault(
+            Invoke(
+                []()
+                {
+                    // The request is opaque; all we need is something unique to free
+                    return reinterpret_cast<drmModeAtomicReqPtr>(new char);
+                }));
+
+    ON_CALL(*this, drmModeAtomicFree(_))
+        .WillByDefault(
+            Invoke(
+                [](drmModeAtomicReqPtr req)
+                {
+                    delete reinterpret_cast<char*>(req);
+                }));
+
     ON_CALL(*this, drmSetInterfaceVersion(_, _))
         .WillByDefault(
             Invoke(
@@ -567,6 +584,46 @@ void drmModeFreeProperty(drmModePropertyPtr ptr)
     global_mock->drmModeFreeProperty(ptr);
 }
 
+drmModeAtomicReqPtr drmModeAtomicAlloc()
+{
+    return global_mock->drmModeAtomicAlloc();
+}
+
+void drmModeAtomicFree(drmModeAtomicReqPtr req)
+{
+    global_mock->drmModeAtomicFree(req);
+}
+
+int drmModeAtomicAddProperty(drmModeAtomicReqPtr req, uint32_t object_id,
+                             uint32_t property_id, uint64_t value)
+{
+    return global_mock->drmModeAtomicAddProperty(req, object_id, property_id, value);
+}
+
+int drmModeAtomicCommit(int fd, drmModeAtomicReqPtr req, uint32_t flags, void* user_data)
+{
+    return global_mock->drmModeAtomicCommit(fd, req, flags, user_data);
+}
+
+int drmModeCreatePropertyBlob(int fd, void const* data, size_t size, uint32_t* id)
+{
+    return global_mock->drmModeCreatePropertyBlob(fd, data, size, id);
+}
+
+int drmModeDestroyPropertyBlob(int fd, uint32_t id)
+{
+    return global_mock->drmModeDestroyPropertyBlob(fd, id);
+}
+
+int drmModeSetPlane(int fd, uint32_t plane_id, uint32_t crtc_id, uint32_t fb_id,
+                    uint32_t flags, int32_t crtc_x, int32_t crtc_y,
+                    uint32_t crtc_w, uint32_t crtc_h, uint32_t src_x, uint32_t src_y,
+                    uint32_t src_w, uint32_t src_h)
+{
+    return global_mock->drmModeSetPlane(
+        fd, plane_id, crtc_id, fb_id, flags, crtc_x, crtc_y, crtc_w, crtc_h, src_x, src_y, src_w, src_h);
+}
+
 int drmGetCap(int fd, uint64_t capability, uint64_t *value)
 {
     return global_mock->drmGetCap(fd, capability, value);
@@ -597,6 +654,12 @@ int drmModeConnectorSetProperty(int fd, uint32_t connector_id, uint32_t property
     return global_mock->drmModeConnectorSetProperty(fd, connector_id, property_id, value);
 }
 
+int drmModeObjectSetProperty(int fd, uint32_t object_id, uint32_t object_type,
+                             uint32_t property_id, uint64_t value)
+{
+    return global_mock->drmModeObjectSetProperty(fd, object_id, object_type, property_id, value);
+}
+
 void drmModeFreeConnector(drmModeConnectorPtr ptr)
 {
     global_mock->drmModeFreeConnector(ptr);
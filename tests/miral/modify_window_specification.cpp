@@ -80,3 +80,16 @@ TEST_F(ModifyWindowState, can_divorce_parent)
 
     basic_window_manager.modify_surface(session, child, modifications);
 }
+
+TEST_F(ModifyWindowState, can_allow_tearing)
+{
+    auto const window = create_window_of_type(mir_window_type_normal);
+    std::shared_ptr<mir::scene::Surface> const surface{window};
+    ASSERT_FALSE(surface->allow_tearing());
+
+    WindowSpecification modifications;
+    modifications.allow_tearing() = true;
+    window_manager_tools.modify_window(window_manager_tools.info_for(window), modifications);
+
+    EXPECT_TRUE(surface->allow_tearing());
+}
@@ -409,3 +409,47 @@ TEST_F(StaticDisplayConfig, group_can_be_set)
 
     EXPECT_THAT(hdmi1.logical_group_id, Eq(mg::DisplayConfigurationLogicalGroupId{2}));
 }
+
+TEST_F(StaticDisplayConfig, adaptive_sync_can_be_enabled)
+{
+    hdmi1.vrr_capable = true;
+
+    std::istringstream stream{
+        "layouts:\n"
+        "  default:\n"
+        "    cards:\n"
+        "    - HDMI-A-1:\n"
+        "        adaptive-sync: enabled\n"};
+
+    sdc.load_config(stream, "");
+    sdc.apply_to(dc);
+
+    EXPECT_THAT(hdmi1.vrr_enabled, Eq(true));
+}
+
+TEST_F(StaticDisplayConfig, adaptive_sync_is_not_enabled_on_incapable_output)
+{
+    std::istringstream stream{
+        "layouts:\n"
+        "  default:\n"
+        "    cards:\n"
+        "    - HDMI-A-1:\n"
+        "        adaptive-sync: enabled\n"};
+
+    sdc.load_config(stream, "");
+    sdc.apply_to(dc);
+
+    EXPECT_THAT(hdmi1.vrr_enabled, Eq(false));
+}
+
+TEST_F(StaticDisplayConfig, ill_formed_adaptive_sync_causes_AbnormalExit)
+{
+    std::istringstream ill_formed{
+        "layouts:\n"
+        "  default:\n"
+        "    cards:\n"
+        "    - HDMI-A-1:\n"
+        "        adaptive-sync: sometimes\n"};
+
+    EXPECT_THROW((sdc.load_config(ill_formed, "")), mir::AbnormalExit);
+}
@@ -136,6 +136,8 @@ struct StubSurface : mir::test::doubles::StubSurface
 
     auto focus_mode() const -> MirFocusMode override { return focus_mode_; }
     void set_focus_mode(MirFocusMode mode) override { focus_mode_ = mode; }
+    auto allow_tearing() const -> bool override { return allow_tearing_; }
+    void set_allow_tearing(bool allow) override { allow_tearing_ = allow; }
 
     std::string name_;
     MirWindowType type_;
@@ -146,6 +148,7 @@ struct StubSurface : mir::test::doubles::StubSurface
     mir::geometry::Displacement content_offset_;
     mir::geometry::Displacement content_size_offset;
     MirFocusMode focus_mode_;
+    bool allow_tearing_{false};
 };
 
 struct StubStubSession : mir::test::doubles::StubSession
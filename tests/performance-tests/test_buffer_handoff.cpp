@@ -0,0 +1,136 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/stream.h"
+#include "mir/test/doubles/stub_buffer.h"
+#include "mir/test/auto_unblock_thread.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+namespace mt = mir::test;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+namespace
+{
+/*
+ * Mimics the buffer traffic of a busy desktop: a client thread submitting to
+ * every surface as fast as it can, while each output's compositor polls every
+ * surface for new buffers (as frames_pending() does) and takes those that are
+ * ready.
+ */
+struct BufferHandoffPerformance : testing::Test
+{
+    geom::Size const size{64, 64};
+    int const frames{500};
+    int const buffers_per_stream{3};
+
+    std::vector<std::unique_ptr<mc::Stream>> streams;
+    std::vector<std::vector<std::shared_ptr<mg::Buffer>>> buffers;
+
+    void add_surfaces(int count)
+    {
+        for (auto i = 0; i != count; ++i)
+        {
+            streams.push_back(std::make_unique<mc::Stream>(size, mir_pixel_format_argb_8888));
+            streams.back()->allow_framedropping(true);
+
+            buffers.emplace_back();
+            for (auto b = 0; b != buffers_per_stream; ++b)
+                buffers.back().push_back(std::make_shared<mtd::StubBuffer>(size));
+
+            streams.back()->submit_buffer(buffers.back().front());
+        }
+    }
+
+    /// \return The mean time each output took to poll and acquire a frame, in microseconds
+    auto time_compositing(int outputs) -> double
+    {
+        std::atomic<bool> done{false};
+        std::atomic<int> finished{0};
+        std::atomic<long long> total_ns{0};
+
+        std::vector<mt::AutoJoinThread> compositors;
+        std::vector<int> output_ids(outputs);
+        for (auto& id : output_ids)
+        {
+            compositors.emplace_back(
+                [&, id = &id]
+                {
+                    auto const start = std::chrono::steady_clock::now();
+                    for (auto frame = 0; frame != frames; ++frame)
+                    {
+                        for (auto const& stream : streams)
+                        {
+                            if (stream->buffers_ready_for_compositor(id))
+                                stream->lock_compositor_buffer(id);
+                        }
+                    }
+                    auto const duration = std::chrono::steady_clock::now() - start;
+                    total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+                    if (++finished == static_cast<int>(output_ids.size()))
+                        done = true;
+                });
+        }
+
+        mt::AutoJoinThread client{
+            [&]
+            {
+                for (auto n = 1; !done; ++n)
+                {
+                    for (auto i = 0u; i != streams.size(); ++i)
+                        streams[i]->submit_buffer(buffers[i][n % buffers_per_stream]);
+                }
+            }};
+
+        compositors.clear();
+        client.stop();
+
+        return total_ns / 1000.0 / (outputs * frames);
+    }
+
+    void record(std::string const& name, int outputs, double microseconds)
+    {
+        RecordProperty(name, std::to_string(microseconds));
+        std::cout << name << ": " << streams.size() << " surfaces on " << outputs << " outputs in "
+                  << microseconds << "us per frame" << std::endl;
+    }
+};
+}
+
+TEST_F(BufferHandoffPerformance, single_output)
+{
+    add_surfaces(200);
+    record("handoff_1_output_us", 1, time_compositing(1));
+}
+
+TEST_F(BufferHandoffPerformance, four_outputs)
+{
+    add_surfaces(200);
+    record("handoff_4_outputs_us", 4, time_compositing(4));
+}
+
+TEST_F(BufferHandoffPerformance, eight_outputs_many_surfaces)
+{
+    add_surfaces(1000);
+    record("handoff_8_outputs_us", 8, time_compositing(8));
+}
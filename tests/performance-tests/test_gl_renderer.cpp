@@ -0,0 +1,275 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/renderers/gl/renderer.h"
+#include "mir/graphics/buffer_basic.h"
+#include "mir/graphics/display_buffer.h"
+#include "mir/graphics/texture.h"
+#include "mir/graphics/program_factory.h"
+#include "mir/renderer/gl/render_target.h"
+#include "mir/test/doubles/fake_renderable.h"
+
+#include <gtest/gtest.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+
+#include <chrono>
+#include <iostream>
+
+namespace mg = mir::graphics;
+namespace mrg = mir::renderer::gl;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+namespace
+{
+/// Renders offscreen with Mesa's surfaceless platform (llvmpipe, in the absence of a GPU)
+class OffscreenDisplayBuffer :
+    public mg::DisplayBuffer,
+    public mg::NativeDisplayBuffer,
+    public mrg::RenderTarget
+{
+public:
+    explicit OffscreenDisplayBuffer(geom::Rectangle const& area)
+        : area{area}
+    {
+        display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+            return;
+
+        EGLint const config_attr[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+            EGL_NONE};
+        EGLConfig config;
+        EGLint num_configs{0};
+        if (!eglChooseConfig(display, config_attr, &config, 1, &num_configs) || num_configs != 1)
+            return;
+
+        EGLint const surface_attr[] = {
+            EGL_WIDTH, area.size.width.as_int(),
+            EGL_HEIGHT, area.size.height.as_int(),
+            EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, surface_attr);
+
+        eglBindAPI(EGL_OPENGL_ES_API);
+        EGLint const context_attr[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attr);
+    }
+
+    ~OffscreenDisplayBuffer()
+    {
+        if (display == EGL_NO_DISPLAY)
+            return;
+
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+        eglTerminate(display);
+    }
+
+    bool usable() const
+    {
+        return context != EGL_NO_CONTEXT && surface != EGL_NO_SURFACE;
+    }
+
+    geom::Rectangle view_area() const override { return area; }
+    bool overlay(mg::RenderableList const&) override { return false; }
+    glm::mat2 transformation() const override { return glm::mat2(1); }
+    NativeDisplayBuffer* native_display_buffer() override { return this; }
+
+    void make_current() override { eglMakeCurrent(display, surface, surface, context); }
+    void release_current() override { eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT); }
+    void bind() override { }
+
+    void swap_buffers() override
+    {
+        // Wait for rendering to complete, so each frame is timed in full
+        glFinish();
+    }
+
+private:
+    geom::Rectangle const area;
+    EGLDisplay display{EGL_NO_DISPLAY};
+    EGLSurface surface{EGL_NO_SURFACE};
+    EGLContext context{EGL_NO_CONTEXT};
+};
+
+class TextureBuffer : public mg::BufferBasic, public mg::NativeBufferBase, public mg::gl::Texture
+{
+public:
+    TextureBuffer(geom::Size size, uint32_t colour)
+        : size_{size}
+    {
+        std::vector<uint32_t> const pixels(size.width.as_int() * size.height.as_int(), colour);
+
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(
+            GL_TEXTURE_2D, 0, GL_RGBA, size.width.as_int(), size.height.as_int(), 0,
+            GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    }
+
+    ~TextureBuffer()
+    {
+        glDeleteTextures(1, &tex);
+    }
+
+    geom::Size size() const override { return size_; }
+    MirPixelFormat pixel_format() const override { return mir_pixel_format_abgr_8888; }
+    NativeBufferBase* native_buffer_base() override { return this; }
+
+    mg::gl::Program const& shader(mg::gl::ProgramFactory& factory) const override
+    {
+        static int rgba_shader;
+        return factory.compile_fragment_shader(
+            &rgba_shader,
+            "",
+            "uniform sampler2D tex;\n"
+            "vec4 sample_to_rgba(in vec2 texcoord)\n"
+            "{\n"
+            "    return texture2D(tex, texcoord);\n"
+            "}\n");
+    }
+
+    Layout layout() const override { return Layout::GL; }
+    void bind() override { glBindTexture(GL_TEXTURE_2D, tex); }
+    void add_syncpoint() override { }
+
+private:
+    geom::Size const size_;
+    GLuint tex;
+};
+
+/// The renderer as it was before renderables were batched
+class UnbatchedRenderer : public mrg::Renderer
+{
+public:
+    UnbatchedRenderer(mg::DisplayBuffer& display_buffer)
+        : Renderer{display_buffer}
+    {
+        batch_renderables = false;
+    }
+};
+
+/*
+ * A desktop of many small windows, rendered with real GL. Without a GPU
+ * this exercises llvmpipe, where the cost of each draw call (and each
+ * client-side vertex array upload) is most apparent.
+ */
+struct GLRendererPerformance : testing::Test
+{
+    geom::Rectangle const output{{0, 0}, {1920, 1080}};
+    geom::Size const window_size{40, 30};
+    int const frames{100};
+
+    OffscreenDisplayBuffer display_buffer{output};
+    std::vector<std::shared_ptr<mg::Buffer>> buffers;
+    mg::RenderableList renderables;
+
+    void SetUp() override
+    {
+        if (!display_buffer.usable())
+            GTEST_SKIP() << "No EGL surfaceless platform available";
+
+        display_buffer.make_current();
+    }
+
+    void TearDown() override
+    {
+        renderables.clear();
+        buffers.clear();
+    }
+
+    /// Tile the output with windows, cycling through the given number of textures
+    void add_windows(int count, int textures)
+    {
+        for (auto i = 0; i != textures; ++i)
+            buffers.push_back(std::make_shared<TextureBuffer>(window_size, 0xff000000 | (0x10101 * i)));
+
+        auto const columns = output.size.width.as_int() / window_size.width.as_int();
+        for (auto i = 0; i != count; ++i)
+        {
+            geom::Point const top_left{
+                (i % columns) * window_size.width.as_int(),
+                (i / columns) * window_size.height.as_int() % output.size.height.as_int()};
+
+            auto const renderable = std::make_shared<mtd::FakeRenderable>(geom::Rectangle{top_left, window_size});
+            renderable->set_buffer(buffers[i % textures]);
+            renderables.push_back(renderable);
+        }
+    }
+
+    /// \return The mean time taken to render a frame, in milliseconds
+    auto time_rendering(mrg::Renderer& renderer) -> double
+    {
+        // Compile the shaders and settle any lazy allocations before timing
+        renderer.render(renderables);
+
+        auto const start = std::chrono::steady_clock::now();
+        for (auto frame = 0; frame != frames; ++frame)
+            renderer.render(renderables);
+        auto const duration = std::chrono::steady_clock::now() - start;
+
+        return std::chrono::duration<double, std::milli>(duration).count() / frames;
+    }
+
+    void compare(std::string const& name)
+    {
+        auto const unbatched = [this]
+            {
+                UnbatchedRenderer renderer{display_buffer};
+                return time_rendering(renderer);
+            }();
+
+        auto const batched = [this]
+            {
+                mrg::Renderer renderer{display_buffer};
+                return time_rendering(renderer);
+            }();
+
+        RecordProperty(name + "_unbatched_ms", std::to_string(unbatched));
+        RecordProperty(name + "_batched_ms", std::to_string(batched));
+        std::cout << name << ": " << renderables.size() << " windows, "
+                  << unbatched << "ms per frame drawn individually, "
+                  << batched << "ms per frame batched" << std::endl;
+    }
+};
+}
+
+TEST_F(GLRendererPerformance, many_windows_each_with_its_own_buffer)
+{
+    add_windows(1000, 1000);
+    compare("gl_renderer_1000_buffers");
+}
+
+TEST_F(GLRendererPerformance, many_windows_sharing_few_buffers)
+{
+    add_windows(1000, 8);
+    compare("gl_renderer_8_buffers");
+}
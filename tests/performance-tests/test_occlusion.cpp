@@ -0,0 +1,120 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/occlusion.h"
+#include "mir/test/doubles/fake_renderable.h"
+#include "mir/test/doubles/stub_scene_element.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace mir::geometry;
+using namespace mir::compositor;
+namespace mg = mir::graphics;
+namespace mtd = mir::test::doubles;
+
+namespace
+{
+struct OcclusionPerformance : testing::Test
+{
+    Rectangle const monitor_rect{{0, 0}, {3840, 2160}};
+    int const iterations{200};
+    SceneElementSequence scene;
+
+    void add_window(Rectangle const& rect)
+    {
+        scene.push_back(std::make_shared<mtd::StubSceneElement>(std::make_shared<mtd::FakeRenderable>(rect)));
+    }
+
+    /// \return The mean time taken to filter the scene, in microseconds
+    auto time_filtering(size_t& visible) -> double
+    {
+        std::vector<SceneElementSequence> scenes(iterations, scene);
+
+        auto const start = std::chrono::steady_clock::now();
+        for (auto& elements : scenes)
+            filter_occlusions_from(elements, monitor_rect);
+        auto const duration = std::chrono::steady_clock::now() - start;
+
+        visible = scenes.back().size();
+        return std::chrono::duration<double, std::micro>(duration).count() / iterations;
+    }
+
+    void record(std::string const& name, double microseconds)
+    {
+        RecordProperty(name, std::to_string(microseconds));
+        std::cout << name << ": " << scene.size() << " windows in " << microseconds << "us" << std::endl;
+    }
+};
+}
+
+TEST_F(OcclusionPerformance, tiled_windows_under_fullscreen_window)
+{
+    for (auto y = 0; y != 20; ++y)
+        for (auto x = 0; x != 20; ++x)
+            add_window({{x * 192, y * 108}, {192, 108}});
+    add_window(monitor_rect);
+
+    size_t visible;
+    record("tiled_under_fullscreen_us", time_filtering(visible));
+
+    EXPECT_EQ(visible, 1u);
+}
+
+TEST_F(OcclusionPerformance, tiled_windows_under_side_by_side_windows)
+{
+    for (auto y = 0; y != 20; ++y)
+        for (auto x = 0; x != 20; ++x)
+            add_window({{x * 192, y * 108}, {192, 108}});
+    add_window({{0, 0}, {1920, 2160}});
+    add_window({{1920, 0}, {1920, 2160}});
+
+    size_t visible;
+    record("tiled_under_side_by_side_us", time_filtering(visible));
+
+    EXPECT_EQ(visible, 2u);
+}
+
+TEST_F(OcclusionPerformance, cascaded_windows)
+{
+    for (auto i = 0; i != 500; ++i)
+        add_window({{i * 5, i * 3}, {800, 600}});
+
+    size_t visible;
+    record("cascaded_us", time_filtering(visible));
+
+    EXPECT_EQ(visible, scene.size());
+}
+
+TEST_F(OcclusionPerformance, randomly_placed_windows)
+{
+    std::mt19937 random{42};
+    std::uniform_int_distribution<int> x{-200, 3800};
+    std::uniform_int_distribution<int> y{-200, 2100};
+    std::uniform_int_distribution<int> width{50, 1600};
+    std::uniform_int_distribution<int> height{50, 1200};
+
+    for (auto i = 0; i != 300; ++i)
+        add_window({{x(random), y(random)}, {width(random), height(random)}});
+
+    size_t visible;
+    record("random_us", time_filtering(visible));
+
+    EXPECT_LE(visible, scene.size());
+}
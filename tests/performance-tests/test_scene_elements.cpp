@@ -0,0 +1,206 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/scene/surface_stack.h"
+#include "src/server/scene/basic_surface.h"
+#include "src/server/report/null/scene_report.h"
+#include "mir/compositor/scene_element.h"
+#include "mir/graphics/renderable.h"
+#include "mir/test/doubles/stub_surface.h"
+#include "mir/test/doubles/fake_renderable.h"
+#include "mir/test/doubles/stub_buffer_stream.h"
+#include "mir/test/auto_unblock_thread.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+namespace ms = mir::scene;
+namespace mr = mir::report;
+namespace mt = mir::test;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+namespace
+{
+struct VisibleSurface : mtd::StubSurface
+{
+    explicit VisibleSurface(geom::Rectangle const& rect)
+        : renderables{std::make_shared<mtd::FakeRenderable>(rect)}
+    {
+    }
+
+    bool visible() const override { return true; }
+    mg::RenderableList generate_renderables(mc::CompositorID) const override { return renderables; }
+
+    mg::RenderableList const renderables;
+};
+
+/*
+ * Measures the cost of building the scene for each output, as every
+ * compositor does once per frame.
+ */
+struct SceneElementPerformance : testing::Test
+{
+    int const frames{2000};
+    ms::SurfaceStack stack{std::make_shared<mr::null::SceneReport>()};
+    std::vector<std::shared_ptr<ms::Surface>> surfaces;
+
+    void add_surfaces(int count)
+    {
+        for (auto i = 0; i != count; ++i)
+        {
+            surfaces.push_back(
+                std::make_shared<VisibleSurface>(geom::Rectangle{{i % 40 * 48, i / 40 * 27}, {640, 480}}));
+            stack.add_surface(surfaces.back(), mir::input::InputReceptionMode::normal);
+        }
+    }
+
+    void add_basic_surfaces(int count)
+    {
+        geom::Size const size{640, 480};
+        for (auto i = 0; i != count; ++i)
+        {
+            // Like most clients, these say they're opaque
+            std::vector<geom::Rectangle> const opaque_region{{{0, 0}, size}};
+            surfaces.push_back(std::make_shared<ms::BasicSurface>(
+                nullptr /* session */,
+                "surface",
+                geom::Rectangle{{i % 40 * 48, i / 40 * 27}, size},
+                mir_pointer_unconfined,
+                std::list<ms::StreamInfo>{{std::make_shared<mtd::StubBufferStream>(), {}, {}, opaque_region}},
+                nullptr /* cursor image */,
+                std::make_shared<mr::null::SceneReport>()));
+            stack.add_surface(surfaces.back(), mir::input::InputReceptionMode::normal);
+        }
+    }
+
+    /// \return The mean time taken to build and release one output's scene, in microseconds
+    auto time_scene_elements(int outputs) -> double
+    {
+        std::vector<int> output_ids(outputs);
+        for (auto& id : output_ids)
+            stack.register_compositor(&id);
+
+        auto const start = std::chrono::steady_clock::now();
+        for (auto frame = 0; frame != frames; ++frame)
+        {
+            for (auto& id : output_ids)
+            {
+                auto const elements = stack.scene_elements_for(&id);
+                for (auto const& element : elements)
+                {
+                    element->renderable()->buffer();
+                    element->rendered();
+                }
+            }
+        }
+        auto const duration = std::chrono::steady_clock::now() - start;
+
+        for (auto& id : output_ids)
+            stack.unregister_compositor(&id);
+
+        return std::chrono::duration<double, std::micro>(duration).count() / (frames * outputs);
+    }
+
+    /// \return As time_scene_elements(), but with each output composited on its own thread
+    ///         while the input thread looks up the surface under the cursor and the shell
+    ///         raises surfaces
+    auto time_concurrent_scene_elements(int outputs) -> double
+    {
+        std::atomic<bool> done{false};
+        std::atomic<int> finished{0};
+        std::atomic<long long> total_ns{0};
+
+        mt::AutoJoinThread input{
+            [&]
+            {
+                for (auto x = 0; !done; x = (x + 1) % 1920)
+                {
+                    stack.surface_at({x, 540});
+                    if (x % 64 == 0)
+                        stack.raise(surfaces[x % surfaces.size()]);
+                }
+            }};
+
+        std::vector<int> output_ids(outputs);
+        for (auto& id : output_ids)
+            stack.register_compositor(&id);
+
+        std::vector<mt::AutoJoinThread> compositors;
+        for (auto& id : output_ids)
+        {
+            compositors.emplace_back(
+                [&, id = &id]
+                {
+                    auto const start = std::chrono::steady_clock::now();
+                    for (auto frame = 0; frame != frames; ++frame)
+                    {
+                        auto const elements = stack.scene_elements_for(id);
+                        for (auto const& element : elements)
+                            element->rendered();
+                    }
+                    auto const duration = std::chrono::steady_clock::now() - start;
+                    total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+                    if (++finished == static_cast<int>(output_ids.size()))
+                        done = true;
+                });
+        }
+
+        compositors.clear();
+        input.stop();
+
+        for (auto& id : output_ids)
+            stack.unregister_compositor(&id);
+
+        return total_ns / 1000.0 / (frames * outputs);
+    }
+
+    void record(std::string const& name, int surfaces, double microseconds)
+    {
+        RecordProperty(name, std::to_string(microseconds));
+        std::cout << name << ": " << surfaces << " surfaces in " << microseconds << "us per output frame" << std::endl;
+    }
+};
+}
+
+TEST_F(SceneElementPerformance, few_surfaces_one_output)
+{
+    add_surfaces(10);
+    record("scene_elements_10_surfaces_us", 10, time_scene_elements(1));
+}
+
+TEST_F(SceneElementPerformance, many_surfaces_three_outputs)
+{
+    add_surfaces(200);
+    record("scene_elements_200_surfaces_us", 200, time_scene_elements(3));
+}
+
+TEST_F(SceneElementPerformance, static_desktop_three_outputs)
+{
+    add_basic_surfaces(200);
+    record("scene_elements_200_static_surfaces_us", 200, time_scene_elements(3));
+}
+
+TEST_F(SceneElementPerformance, many_surfaces_three_outputs_with_input)
+{
+    add_surfaces(200);
+    record("scene_elements_200_surfaces_concurrent_us", 200, time_concurrent_scene_elements(3));
+}
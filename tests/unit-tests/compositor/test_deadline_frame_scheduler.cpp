@@ -0,0 +1,165 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/deadline_frame_scheduler.h"
+#include "src/server/compositor/fixed_delay_frame_scheduler.h"
+#include "mir/graphics/display.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+using namespace std::chrono_literals;
+using namespace testing;
+
+namespace
+{
+struct StubSyncGroup : mg::DisplaySyncGroup
+{
+    void for_each_display_buffer(std::function<void(mg::DisplayBuffer&)> const&) override {}
+    void post() override {}
+
+    std::chrono::milliseconds recommended_sleep() const override
+    {
+        return recommendation;
+    }
+
+    auto vblank_timing() const -> std::optional<mg::VBlankTiming> override
+    {
+        return timing;
+    }
+
+    void vblank_was(std::chrono::nanoseconds ago)
+    {
+        mg::Frame frame;
+        frame.msc = 42;
+        frame.ust = mir::time::PosixTimestamp::now(CLOCK_MONOTONIC) - ago;
+        timing = mg::VBlankTiming{frame, refresh_interval};
+    }
+
+    std::chrono::milliseconds recommendation{3};
+    std::chrono::nanoseconds refresh_interval{16'666'667};
+    std::optional<mg::VBlankTiming> timing;
+};
+
+struct DeadlineFrameScheduler : Test
+{
+    void render_frames(std::chrono::nanoseconds render_time)
+    {
+        for (auto i = 0; i != 64; ++i)
+            scheduler.delay_after_post(group, render_time);
+    }
+
+    // Allow for time passing while the test runs
+    std::chrono::nanoseconds const tolerance = 2ms;
+
+    StubSyncGroup group;
+    mc::DeadlineFrameScheduler scheduler;
+};
+}
+
+TEST_F(DeadlineFrameScheduler, uses_recommended_sleep_without_vblank_timing)
+{
+    render_frames(4ms);
+
+    EXPECT_THAT(scheduler.delay_after_post(group, 4ms), Eq(group.recommendation));
+}
+
+TEST_F(DeadlineFrameScheduler, uses_recommended_sleep_until_render_times_are_known)
+{
+    group.vblank_was(0ms);
+
+    EXPECT_THAT(scheduler.delay_after_post(group, 4ms), Eq(group.recommendation));
+}
+
+TEST_F(DeadlineFrameScheduler, starts_frame_as_late_as_render_times_allow_before_next_vblank)
+{
+    render_frames(4ms);
+    group.vblank_was(1ms);
+
+    auto const delay = scheduler.delay_after_post(group, 4ms);
+
+    // 15.67ms until vblank, less 4.25ms (upper edge of the bin) and a safety margin
+    EXPECT_THAT(delay, Lt(15'667us - 4'250us));
+    EXPECT_THAT(delay, Gt(15'667us - 4'250us - 3ms - tolerance));
+}
+
+TEST_F(DeadlineFrameScheduler, slower_rendering_starts_frame_earlier)
+{
+    mc::DeadlineFrameScheduler slow_scheduler;
+    render_frames(2ms);
+    for (auto i = 0; i != 64; ++i)
+        slow_scheduler.delay_after_post(group, 8ms);
+    group.vblank_was(0ms);
+
+    auto const fast_delay = scheduler.delay_after_post(group, 2ms);
+    auto const slow_delay = slow_scheduler.delay_after_post(group, 8ms);
+
+    EXPECT_THAT(fast_delay - slow_delay, Gt(6ms - tolerance));
+}
+
+TEST_F(DeadlineFrameScheduler, occasional_slow_frames_are_allowed_for)
+{
+    render_frames(2ms);
+    for (auto i = 0; i != 4; ++i)
+        scheduler.delay_after_post(group, 10ms);
+    group.vblank_was(0ms);
+
+    EXPECT_THAT(scheduler.delay_after_post(group, 2ms), Lt(group.refresh_interval - 10ms));
+}
+
+TEST_F(DeadlineFrameScheduler, when_next_deadline_has_passed_aims_for_following_vblank)
+{
+    render_frames(4ms);
+    group.vblank_was(14ms);
+
+    auto const delay = scheduler.delay_after_post(group, 4ms);
+
+    // 2.67ms to the next vblank isn't enough, so aim for the one after
+    EXPECT_THAT(delay, Gt(2'667us));
+    EXPECT_THAT(delay, Lt(2'667us + group.refresh_interval - 4'250us));
+}
+
+TEST_F(DeadlineFrameScheduler, does_not_wait_if_rendering_takes_a_whole_frame)
+{
+    render_frames(20ms);
+    group.vblank_was(0ms);
+
+    EXPECT_THAT(scheduler.delay_after_post(group, 20ms), Eq(0ns));
+}
+
+TEST_F(DeadlineFrameScheduler, copes_with_stale_vblank_timing)
+{
+    render_frames(4ms);
+    group.vblank_was(10s + 1ms);
+
+    auto const delay = scheduler.delay_after_post(group, 4ms);
+
+    EXPECT_THAT(delay, Gt(0ns));
+    EXPECT_THAT(delay, Lt(group.refresh_interval));
+}
+
+TEST(FixedDelayFrameScheduler, always_waits_for_configured_delay)
+{
+    StubSyncGroup group;
+    group.vblank_was(1ms);
+    mc::FixedDelayFrameSchedulerFactory factory{7ms};
+    auto const scheduler = factory.create_scheduler_for(group);
+
+    EXPECT_THAT(scheduler->delay_after_post(group, 1ms), Eq(7ms));
+    EXPECT_THAT(scheduler->delay_after_post(group, 30ms), Eq(7ms));
+}
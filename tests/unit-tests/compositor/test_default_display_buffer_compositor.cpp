@@ -380,3 +380,64 @@ TEST_F(DefaultDisplayBufferCompositor, marks_occluded_scene_elements)
     compositor.composite({element0_occluded, element1_rendered, element2_occluded});
 }
 
+
+TEST_F(DefaultDisplayBufferCompositor, reports_cpu_time_of_rendered_and_bypassed_frames)
+{
+    using namespace testing;
+    auto report = std::make_shared<NiceMock<mtd::MockCompositorReport>>();
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        report);
+
+    EXPECT_CALL(*report, frame_cpu_time(&compositor, Ge(std::chrono::nanoseconds{0})))
+        .Times(2);
+
+    EXPECT_CALL(display_buffer, overlay(_))
+        .WillOnce(Return(false))
+        .WillOnce(Return(true));
+
+    compositor.composite(make_scene_elements({big, small}));
+    compositor.composite(make_scene_elements({fullscreen}));
+}
+
+TEST_F(DefaultDisplayBufferCompositor, reports_gpu_time_once_renderer_knows_it)
+{
+    using namespace testing;
+    auto report = std::make_shared<NiceMock<mtd::MockCompositorReport>>();
+    std::chrono::nanoseconds const gpu_time{std::chrono::microseconds{1234}};
+    ON_CALL(*report, wants_gpu_times()).WillByDefault(Return(true));
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        report);
+
+    EXPECT_CALL(mock_renderer, completed_gpu_time())
+        .WillOnce(Return(std::nullopt))
+        .WillOnce(Return(gpu_time));
+    EXPECT_CALL(*report, frame_gpu_time(&compositor, gpu_time))
+        .Times(1);
+
+    compositor.composite(make_scene_elements({big, small}));
+    compositor.composite(make_scene_elements({big, small}));
+}
+
+TEST_F(DefaultDisplayBufferCompositor, does_not_time_gpu_for_report_that_ignores_it)
+{
+    using namespace testing;
+    auto report = std::make_shared<NiceMock<mtd::MockCompositorReport>>();
+    ON_CALL(*report, wants_gpu_times()).WillByDefault(Return(false));
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        report);
+
+    EXPECT_CALL(mock_renderer, completed_gpu_time()).Times(0);
+    EXPECT_CALL(*report, frame_gpu_time(_, _)).Times(0);
+
+    compositor.composite(make_scene_elements({big, small}));
+    compositor.composite(make_scene_elements({big, small}));
+}
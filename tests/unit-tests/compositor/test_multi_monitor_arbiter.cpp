@@ -23,6 +23,8 @@
 #include "src/server/compositor/schedule.h"
 
 #include <gtest/gtest.h>
+
+#include <array>
 using namespace testing;
 namespace mt = mir::test;
 namespace mtd = mir::test::doubles;
@@ -656,3 +658,48 @@ TEST_F(MultiMonitorArbiter, second_compositor_advances_schedule_after_both_aquir
     auto cbuffer4 = arbiter.compositor_acquire(&comp_id2);
     EXPECT_THAT(cbuffer1, Not(IsSameBufferAs(cbuffer4)));
 }
+
+TEST_F(MultiMonitorArbiter, tracks_more_compositors_than_it_has_slots_for)
+{
+    std::array<int, 20> comp_ids{};
+    schedule.set_schedule({buffers[0]});
+
+    for (auto& comp_id : comp_ids)
+    {
+        EXPECT_TRUE(arbiter.buffer_ready_for(&comp_id));
+        arbiter.compositor_acquire(&comp_id);
+    }
+
+    for (auto& comp_id : comp_ids)
+    {
+        EXPECT_FALSE(arbiter.buffer_ready_for(&comp_id));
+    }
+}
+
+TEST_F(MultiMonitorArbiter, compositors_beyond_the_slots_are_offered_the_next_buffer)
+{
+    std::array<int, 20> comp_ids{};
+    schedule.set_schedule({buffers[0]});
+
+    for (auto& comp_id : comp_ids)
+        arbiter.compositor_acquire(&comp_id);
+
+    schedule.set_schedule({buffers[1]});
+
+    auto const last = arbiter.compositor_acquire(&comp_ids.back());
+    EXPECT_THAT(last, IsSameBufferAs(buffers[1]));
+    EXPECT_TRUE(arbiter.buffer_ready_for(&comp_ids.front()));
+    EXPECT_FALSE(arbiter.buffer_ready_for(&comp_ids.back()));
+}
+
+TEST_F(MultiMonitorArbiter, releases_schedules_it_no_longer_uses)
+{
+    auto const first = std::make_shared<FixedSchedule>();
+    auto const second = std::make_shared<FixedSchedule>();
+
+    arbiter.set_schedule(first);
+    arbiter.set_schedule(second);
+
+    EXPECT_THAT(first.use_count(), Eq(1));
+    EXPECT_THAT(second.use_count(), Eq(2));
+}
@@ -17,6 +17,8 @@
  */
 
 #include "src/server/compositor/multi_threaded_compositor.h"
+#include "src/server/compositor/deadline_frame_scheduler.h"
+#include "src/server/compositor/fixed_delay_frame_scheduler.h"
 #include "src/server/report/null_report_factory.h"
 
 #include "mir/compositor/display_listener.h"
@@ -361,7 +363,7 @@ struct MockDisplayListener : mc::DisplayListener
 auto const null_report = mr::null_compositor_report();
 unsigned int const composites_per_update{1};
 auto const null_display_listener = std::make_shared<StubDisplayListener>();
-std::chrono::milliseconds const default_delay{-1};
+auto const default_scheduling = std::make_shared<mc::DeadlineFrameSchedulerFactory>();
 
 }
 
@@ -374,7 +376,7 @@ TEST(MultiThreadedCompositor, compositing_happens_in_different_threads)
     auto display = std::make_shared<mtd::StubDisplay>(nbuffers);
     auto scene = std::make_shared<StubScene>();
     auto db_compositor_factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
-    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_delay, true};
+    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_scheduling, true};
 
     compositor.start();
 
@@ -415,7 +417,7 @@ TEST(MultiThreadedCompositor, does_not_deadlock_itself)
         std::make_shared<mtd::NullDisplayBufferCompositorFactory>(),
         std::make_shared<ReentrantDisplayListener>(scene),
         null_report,
-        default_delay,
+        default_scheduling,
         true
     };
 
@@ -440,7 +442,7 @@ TEST(MultiThreadedCompositor, reports_in_the_right_places)
                                            db_compositor_factory,
                                            null_display_listener,
                                            mock_report,
-                                           default_delay,
+                                           default_scheduling,
                                            true};
 
     EXPECT_CALL(*mock_report, started())
@@ -456,6 +458,8 @@ TEST(MultiThreadedCompositor, reports_in_the_right_places)
         .Times(1);
     EXPECT_CALL(*mock_report, scheduled())
         .Times(2);
+    EXPECT_CALL(*mock_report, frame_post_wait(_,_))
+        .Times(AtLeast(1));
 
     EXPECT_CALL(*mock_report, stopped())
         .Times(AtLeast(1));
@@ -485,7 +489,7 @@ TEST(MultiThreadedCompositor, composites_only_on_demand)
     auto display = std::make_shared<mtd::StubDisplay>(nbuffers);
     auto scene = std::make_shared<StubScene>();
     auto db_compositor_factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
-    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_delay, true};
+    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_scheduling, true};
 
     // Verify we're actually starting at zero frames
     EXPECT_TRUE(db_compositor_factory->check_record_count_for_each_buffer(nbuffers, 0, 0));
@@ -546,7 +550,7 @@ TEST(MultiThreadedCompositor, schedules_enough_frames)
     auto scene = std::make_shared<StubScene>();
     auto factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
     mc::MultiThreadedCompositor compositor{display, scene, factory,
-                                           null_display_listener, null_report, default_delay, true};
+                                           null_display_listener, null_report, default_scheduling, true};
 
     EXPECT_TRUE(factory->check_record_count_for_each_buffer(nbuffers, 0, 0));
 
@@ -622,7 +626,8 @@ TEST(MultiThreadedCompositor, recommended_sleep_throttles_compositor_loop)
     auto factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
     mc::MultiThreadedCompositor compositor{display, scene, factory,
                                            null_display_listener, null_report,
-                                           recommendation, false};
+                                           std::make_shared<mc::FixedDelayFrameSchedulerFactory>(recommendation),
+                                           false};
 
     EXPECT_TRUE(factory->check_record_count_for_each_buffer(nbuffers, 0, 0));
 
@@ -670,7 +675,7 @@ TEST(MultiThreadedCompositor, when_no_initial_composite_is_needed_there_is_none)
     auto display = std::make_shared<mtd::StubDisplay>(nbuffers);
     auto scene = std::make_shared<StubScene>();
     auto db_compositor_factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
-    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_delay, false};
+    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_scheduling, false};
 
     // Verify we're actually starting at zero frames
     ASSERT_TRUE(db_compositor_factory->check_record_count_for_each_buffer(nbuffers, 0, 0));
@@ -693,7 +698,7 @@ TEST(MultiThreadedCompositor, when_no_initial_composite_is_needed_we_still_compo
     auto display = std::make_shared<mtd::StubDisplay>(nbuffers);
     auto scene = std::make_shared<StubScene>();
     auto db_compositor_factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
-    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_delay, false};
+    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_scheduling, false};
 
     compositor.start();
 
@@ -728,7 +733,7 @@ TEST(MultiThreadedCompositor, surface_update_from_render_doesnt_deadlock)
     auto display = std::make_shared<mtd::StubDisplay>(nbuffers);
     auto scene = std::make_shared<StubScene>();
     auto db_compositor_factory = std::make_shared<SurfaceUpdatingDisplayBufferCompositorFactory>(scene);
-    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_delay, true};
+    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_scheduling, true};
 
     compositor.start();
 
@@ -760,7 +765,7 @@ TEST(MultiThreadedCompositor, double_start_or_stop_ignored)
         .Times(AtLeast(0))
         .WillRepeatedly(Return(mc::SceneElementSequence{}));
 
-    mc::MultiThreadedCompositor compositor{display, mock_scene, db_compositor_factory, null_display_listener, mock_report, default_delay, true};
+    mc::MultiThreadedCompositor compositor{display, mock_scene, db_compositor_factory, null_display_listener, mock_report, default_scheduling, true};
 
     compositor.start();
     compositor.start();
@@ -775,7 +780,7 @@ TEST(MultiThreadedCompositor, cleans_up_after_throw_in_start)
     auto display = std::make_shared<StubDisplayWithMockBuffers>(nbuffers);
     auto scene = std::make_shared<StubScene>();
     auto db_compositor_factory = std::make_shared<RecordingDisplayBufferCompositorFactory>();
-    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_delay, true};
+    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_scheduling, true};
 
     scene->throw_on_add_observer(true);
 
@@ -829,7 +834,7 @@ TEST(MultiThreadedCompositor, DISABLED_names_compositor_threads)
     auto display = std::make_shared<StubDisplayWithMockBuffers>(nbuffers);
     auto scene = std::make_shared<StubScene>();
     auto db_compositor_factory = std::make_shared<ThreadNameDisplayBufferCompositorFactory>();
-    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_delay, true};
+    mc::MultiThreadedCompositor compositor{display, scene, db_compositor_factory, null_display_listener, null_report, default_scheduling, true};
 
     compositor.start();
 
@@ -858,7 +863,7 @@ TEST(MultiThreadedCompositor, registers_and_unregisters_with_scene)
     EXPECT_CALL(*mock_scene, register_compositor(_))
         .Times(nbuffers);
     mc::MultiThreadedCompositor compositor{
-        display, mock_scene, db_compositor_factory, null_display_listener, mock_report, default_delay, true};
+        display, mock_scene, db_compositor_factory, null_display_listener, mock_report, default_scheduling, true};
 
     compositor.start();
 
@@ -881,7 +886,7 @@ TEST(MultiThreadedCompositor, notifies_about_display_additions_and_removals)
     auto mock_report = std::make_shared<testing::NiceMock<mtd::MockCompositorReport>>();
 
     mc::MultiThreadedCompositor compositor{
-        display, stub_scene, db_compositor_factory, mock_display_listener, mock_report, default_delay, true};
+        display, stub_scene, db_compositor_factory, mock_display_listener, mock_report, default_scheduling, true};
 
     EXPECT_CALL(*mock_display_listener, add_display(_)).Times(nbuffers);
 
@@ -903,7 +908,7 @@ TEST(MultiThreadedCompositor, when_compositor_thread_fails_start_reports_error)
     auto mock_report = std::make_shared<testing::NiceMock<mtd::MockCompositorReport>>();
 
     mc::MultiThreadedCompositor compositor{
-        display, stub_scene, db_compositor_factory, mock_display_listener, mock_report, default_delay, true};
+        display, stub_scene, db_compositor_factory, mock_display_listener, mock_report, default_scheduling, true};
 
     EXPECT_CALL(*mock_display_listener, add_display(_))
         .WillRepeatedly(Throw(std::runtime_error("Failed to add display")));
@@ -926,7 +931,7 @@ TEST(MultiThreadedCompositor, can_schedule_from_display_observer_when_adding_dis
         .WillByDefault(InvokeWithoutArgs([&]{ stub_scene->emit_change_event(); }));
 
     mc::MultiThreadedCompositor compositor{
-        display, stub_scene, db_compositor_factory, mock_display_listener, mock_report, default_delay, true};
+        display, stub_scene, db_compositor_factory, mock_display_listener, mock_report, default_scheduling, true};
     compositor.start();
 }
 
@@ -944,6 +949,134 @@ TEST(MultiThreadedCompositor, can_schedule_from_display_observer_when_removing_d
         .WillByDefault(InvokeWithoutArgs([&]{ stub_scene->emit_change_event(); }));
 
     mc::MultiThreadedCompositor compositor{
-        display, stub_scene, db_compositor_factory, mock_display_listener, mock_report, default_delay, true};
+        display, stub_scene, db_compositor_factory, mock_display_listener, mock_report, default_scheduling, true};
+    compositor.start();
+}
+
+namespace
+{
+class ReconfigurableDisplay : public mtd::NullDisplay
+{
+public:
+    ReconfigurableDisplay(unsigned int ngroups)
+    {
+        for (auto i = 0u; i != ngroups; ++i)
+            groups.push_back(std::make_unique<mtd::StubDisplaySyncGroup>(geom::Size{1, 1}));
+    }
+
+    void for_each_display_sync_group(std::function<void(mg::DisplaySyncGroup&)> const& f) override
+    {
+        for (auto& group : groups)
+            f(*group);
+    }
+
+    void replace_group(size_t index)
+    {
+        groups[index] = std::make_unique<mtd::StubDisplaySyncGroup>(geom::Size{1, 1});
+    }
+
+    std::vector<std::unique_ptr<mtd::StubDisplaySyncGroup>> groups;
+};
+
+class CountingDisplayBufferCompositorFactory : public mc::DisplayBufferCompositorFactory
+{
+public:
+    std::unique_ptr<mc::DisplayBufferCompositor> create_compositor_for(mg::DisplayBuffer&) override
+    {
+        ++compositors_created;
+        return std::make_unique<RecordingDisplayBufferCompositor>([this] { ++frames_composited; });
+    }
+
+    std::atomic<int> compositors_created{0};
+    std::atomic<int> frames_composited{0};
+};
+}
+
+TEST(MultiThreadedCompositor, reconfigure_only_restarts_compositing_for_groups_not_preserved)
+{
+    using namespace testing;
+
+    auto display = std::make_shared<ReconfigurableDisplay>(3);
+    auto scene = std::make_shared<StubScene>();
+    auto factory = std::make_shared<CountingDisplayBufferCompositorFactory>();
+    mc::MultiThreadedCompositor compositor{display, scene, factory, null_display_listener, null_report,
+                                           default_scheduling, false};
+
+    compositor.start();
+    ASSERT_THAT(factory->compositors_created, Eq(3));
+
+    auto const replaced = display->groups[1].get();
+
+    compositor.reconfigure(
+        [replaced](mg::DisplaySyncGroup const& group) { return &group != replaced; },
+        [&]
+        {
+            // The preserved groups carry on compositing during the change
+            auto const frames_before = factory->frames_composited.load();
+            scene->emit_change_event();
+
+            int retry = 0;
+            while (retry < 100 && factory->frames_composited < frames_before + 2)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                ++retry;
+            }
+            EXPECT_THAT(factory->frames_composited, Ge(frames_before + 2));
+
+            display->replace_group(1);
+        });
+
+    EXPECT_THAT(factory->compositors_created, Eq(4));
+
+    compositor.stop();
+}
+
+TEST(MultiThreadedCompositor, reconfigure_composites_new_groups_immediately)
+{
+    using namespace testing;
+
+    auto display = std::make_shared<ReconfigurableDisplay>(2);
+    auto scene = std::make_shared<StubScene>();
+    auto factory = std::make_shared<CountingDisplayBufferCompositorFactory>();
+    mc::MultiThreadedCompositor compositor{display, scene, factory, null_display_listener, null_report,
+                                           default_scheduling, false};
+
     compositor.start();
+    ASSERT_THAT(factory->frames_composited, Eq(0));
+
+    auto const replaced = display->groups[0].get();
+    compositor.reconfigure(
+        [replaced](mg::DisplaySyncGroup const& group) { return &group != replaced; },
+        [&] { display->replace_group(0); });
+
+    int retry = 0;
+    while (retry < 100 && factory->frames_composited < 1)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ++retry;
+    }
+    EXPECT_THAT(factory->frames_composited, Eq(1));
+
+    compositor.stop();
+}
+
+TEST(MultiThreadedCompositor, reconfigure_when_stopped_falls_back_to_stopping_and_starting)
+{
+    using namespace testing;
+
+    auto display = std::make_shared<ReconfigurableDisplay>(2);
+    auto scene = std::make_shared<StubScene>();
+    auto factory = std::make_shared<CountingDisplayBufferCompositorFactory>();
+    mc::MultiThreadedCompositor compositor{display, scene, factory, null_display_listener, null_report,
+                                           default_scheduling, false};
+
+    bool changed{false};
+    compositor.reconfigure(
+        [](mg::DisplaySyncGroup const&) { return true; },
+        [&] { changed = true; });
+
+    EXPECT_TRUE(changed);
+    EXPECT_THAT(factory->compositors_created, Eq(2));
+
+    compositor.stop();
 }
@@ -202,3 +202,107 @@ TEST_F(OcclusionFilterTest,
     EXPECT_THAT(renderables_from(occlusions), ElementsAre(partially_onscreen));
     EXPECT_THAT(renderables_from(elements), ElementsAre(covering));
 }
+
+TEST_F(OcclusionFilterTest, shaped_window_occludes_with_its_opaque_region)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(Rectangle{{10, 10}, {10, 10}}, 1.0f, false);
+    top->set_opaque_region({{Rectangle{{10, 10}, {10, 8}}}});
+    auto covered = std::make_shared<mtd::FakeRenderable>(12, 12, 5, 5);
+    auto uncovered = std::make_shared<mtd::FakeRenderable>(12, 17, 5, 2);
+    auto elements = scene_elements_from({uncovered, covered, top});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(occlusions), ElementsAre(covered));
+    auto const renderables = renderables_from(elements);
+    ASSERT_THAT(renderables, SizeIs(2));
+    EXPECT_THAT(renderables[1], Eq(top));
+    // Only the row below the opaque region is visible
+    EXPECT_THAT(renderables[0]->id(), Eq(uncovered->id()));
+    EXPECT_THAT(renderables[0]->clip_area(), Eq(Rectangle{{12, 18}, {5, 1}}));
+}
+
+TEST_F(OcclusionFilterTest, partially_covered_window_still_allows_tearing)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(Rectangle{{10, 10}, {10, 10}}, 1.0f, false);
+    top->set_opaque_region({{Rectangle{{10, 10}, {10, 8}}}});
+    auto uncovered = std::make_shared<mtd::FakeRenderable>(12, 17, 5, 2);
+    uncovered->set_allow_tearing(true);
+    auto elements = scene_elements_from({uncovered, top});
+
+    filter_occlusions_from(elements, monitor_rect);
+
+    auto const renderables = renderables_from(elements);
+    ASSERT_THAT(renderables, SizeIs(2));
+    // Clipped to the row below the opaque region, but still the same surface
+    ASSERT_THAT(renderables[0]->clip_area(), Eq(Rectangle{{12, 18}, {5, 1}}));
+    EXPECT_TRUE(renderables[0]->allow_tearing());
+}
+
+TEST_F(OcclusionFilterTest, translucent_window_occludes_nothing_despite_opaque_region)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(Rectangle{{10, 10}, {10, 10}}, 0.5f, false);
+    top->set_opaque_region({{Rectangle{{10, 10}, {10, 10}}}});
+    auto bottom = std::make_shared<mtd::FakeRenderable>(12, 12, 5, 5);
+    auto elements = scene_elements_from({bottom, top});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(occlusions), IsEmpty());
+    EXPECT_THAT(renderables_from(elements), ElementsAre(bottom, top));
+}
+
+TEST_F(OcclusionFilterTest, opaque_region_does_not_extend_beyond_window)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(Rectangle{{10, 10}, {10, 10}}, 1.0f, false);
+    top->set_opaque_region({{Rectangle{{0, 0}, {100, 100}}}});
+    auto bottom = std::make_shared<mtd::FakeRenderable>(15, 15, 10, 10);
+    auto elements = scene_elements_from({bottom, top});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(occlusions), IsEmpty());
+    EXPECT_THAT(renderables_from(elements), ElementsAre(bottom, top));
+}
+
+TEST_F(OcclusionFilterTest, window_covered_by_several_windows_together_is_occluded)
+{
+    auto left = std::make_shared<mtd::FakeRenderable>(0, 0, 960, 1200);
+    auto right = std::make_shared<mtd::FakeRenderable>(960, 0, 960, 1200);
+    auto behind = std::make_shared<mtd::FakeRenderable>(100, 100, 1000, 500);
+    auto elements = scene_elements_from({behind, left, right});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(occlusions), ElementsAre(behind));
+    EXPECT_THAT(renderables_from(elements), ElementsAre(left, right));
+}
+
+TEST_F(OcclusionFilterTest, partially_covered_window_is_clipped_to_visible_part)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(0, 0, 100, 200);
+    auto bottom = std::make_shared<mtd::FakeRenderable>(50, 50, 100, 100);
+    auto elements = scene_elements_from({bottom, top});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(occlusions), IsEmpty());
+    auto const renderables = renderables_from(elements);
+    ASSERT_THAT(renderables, SizeIs(2));
+    EXPECT_THAT(renderables[1], Eq(top));
+    EXPECT_THAT(renderables[0]->id(), Eq(bottom->id()));
+    EXPECT_THAT(renderables[0]->buffer(), Eq(bottom->buffer()));
+    EXPECT_THAT(renderables[0]->screen_position(), Eq(bottom->screen_position()));
+    EXPECT_THAT(renderables[0]->clip_area(), Eq(Rectangle{{100, 50}, {50, 100}}));
+}
+
+TEST_F(OcclusionFilterTest, partially_covered_window_is_not_clipped_if_visible_part_spans_it)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(60, 60, 10, 10);
+    auto bottom = std::make_shared<mtd::FakeRenderable>(50, 50, 100, 100);
+    auto elements = scene_elements_from({bottom, top});
+
+    filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(elements), ElementsAre(bottom, top));
+}
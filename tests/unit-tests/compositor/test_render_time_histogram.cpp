@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/render_time_histogram.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace mc = mir::compositor;
+using namespace std::chrono_literals;
+using namespace testing;
+
+TEST(RenderTimeHistogram, is_empty_initially)
+{
+    mc::RenderTimeHistogram const histogram{1ms, 10, 10};
+
+    EXPECT_THAT(histogram.samples(), Eq(0u));
+    EXPECT_THAT(histogram.percentile(0.99), Eq(0ns));
+}
+
+TEST(RenderTimeHistogram, percentile_is_upper_edge_of_bin)
+{
+    mc::RenderTimeHistogram histogram{1ms, 10, 100};
+
+    for (auto i = 0; i != 90; ++i)
+        histogram.record(2500us);
+    for (auto i = 0; i != 10; ++i)
+        histogram.record(7200us);
+
+    EXPECT_THAT(histogram.samples(), Eq(100u));
+    EXPECT_THAT(histogram.percentile(0.5), Eq(3ms));
+    EXPECT_THAT(histogram.percentile(0.9), Eq(3ms));
+    EXPECT_THAT(histogram.percentile(0.91), Eq(8ms));
+    EXPECT_THAT(histogram.percentile(1.0), Eq(8ms));
+}
+
+TEST(RenderTimeHistogram, slow_frames_are_counted_in_last_bin)
+{
+    mc::RenderTimeHistogram histogram{1ms, 10, 10};
+
+    histogram.record(1s);
+
+    EXPECT_THAT(histogram.percentile(1.0), Eq(10ms));
+}
+
+TEST(RenderTimeHistogram, forgets_samples_outside_window)
+{
+    mc::RenderTimeHistogram histogram{1ms, 10, 4};
+
+    for (auto i = 0; i != 4; ++i)
+        histogram.record(9ms);
+    for (auto i = 0; i != 4; ++i)
+        histogram.record(1ms);
+
+    EXPECT_THAT(histogram.samples(), Eq(4u));
+    EXPECT_THAT(histogram.percentile(1.0), Eq(2ms));
+}
+
+TEST(RenderTimeHistogram, rejects_empty_configuration)
+{
+    EXPECT_THROW((mc::RenderTimeHistogram{0ms, 10, 10}), std::invalid_argument);
+    EXPECT_THROW((mc::RenderTimeHistogram{1ms, 0, 10}), std::invalid_argument);
+    EXPECT_THROW((mc::RenderTimeHistogram{1ms, 10, 0}), std::invalid_argument);
+}
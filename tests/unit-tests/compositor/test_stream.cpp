@@ -18,11 +18,16 @@
 
 #include "mir/test/doubles/stub_buffer.h"
 #include "mir/test/fake_shared.h"
+#include "mir/test/auto_unblock_thread.h"
 #include "src/server/compositor/stream.h"
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+
 using namespace testing;
 namespace mf = mir::frontend;
 namespace mt = mir::test;
@@ -238,3 +243,116 @@ TEST_F(Stream, stream_remembers_scale_when_buffer_added)
     stream.submit_buffer(buffers[0]);
     ASSERT_THAT(stream.stream_size(), Eq(initial_size / 2));
 }
+
+TEST_F(Stream, reports_damage_between_consecutive_buffers)
+{
+    geom::Rectangles const damage{{{1, 0}, {2, 2}}};
+    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[1], damage);
+
+    EXPECT_THAT(stream.damage_between(buffers[0]->id(), buffers[1]->id()), Eq(damage));
+}
+
+TEST_F(Stream, accumulates_damage_of_buffers_the_compositor_did_not_see)
+{
+    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[1], {{{1, 0}, {2, 2}}});
+    stream.submit_buffer(buffers[2], {{{20, 0}, {4, 1}}});
+
+    EXPECT_THAT(
+        stream.damage_between(buffers[0]->id(), buffers[2]->id()),
+        Eq(geom::Rectangles{{{1, 0}, {2, 2}}, {{20, 0}, {4, 1}}}));
+}
+
+TEST_F(Stream, reports_no_damage_for_the_same_buffer)
+{
+    stream.submit_buffer(buffers[0]);
+
+    EXPECT_THAT(stream.damage_between(buffers[0]->id(), buffers[0]->id()), Eq(geom::Rectangles{}));
+}
+
+TEST_F(Stream, damage_is_unknown_if_any_intermediate_buffer_had_no_damage)
+{
+    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[1]);
+    stream.submit_buffer(buffers[2], {{{1, 0}, {2, 2}}});
+
+    EXPECT_THAT(stream.damage_between(buffers[0]->id(), buffers[2]->id()), Eq(std::nullopt));
+}
+
+TEST_F(Stream, damage_is_unknown_after_buffer_size_changes)
+{
+    auto const resized = std::make_shared<mtd::StubBuffer>(geom::Size{10, 10});
+    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(resized, {{{1, 0}, {2, 2}}});
+
+    EXPECT_THAT(stream.damage_between(buffers[0]->id(), resized->id()), Eq(std::nullopt));
+}
+
+TEST_F(Stream, damage_is_unknown_for_buffers_never_submitted)
+{
+    auto const unsubmitted = std::make_shared<mtd::StubBuffer>(initial_size);
+    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[1], {{{1, 0}, {2, 2}}});
+
+    EXPECT_THAT(stream.damage_between(unsubmitted->id(), buffers[1]->id()), Eq(std::nullopt));
+}
+
+TEST_F(Stream, compositors_see_buffers_in_submission_order_while_client_submits)
+{
+    unsigned int const submissions{2000};
+    unsigned int const compositors{4};
+
+    std::vector<std::shared_ptr<mg::Buffer>> submitted;
+    std::unordered_map<mg::BufferID, unsigned int> submission_of;
+    for (auto i = 0u; i != submissions; ++i)
+    {
+        submitted.push_back(std::make_shared<mtd::StubBuffer>(initial_size));
+        submission_of[submitted.back()->id()] = i;
+    }
+
+    stream.allow_framedropping(true);
+    stream.submit_buffer(submitted[0]);
+
+    std::atomic<bool> done{false};
+    std::atomic<unsigned int> started{0};
+    std::atomic<unsigned int> out_of_order{0};
+    {
+        std::vector<mt::AutoJoinThread> compositor_threads;
+        for (auto c = 0u; c != compositors; ++c)
+        {
+            compositor_threads.emplace_back(
+                [&, id = &compositor_threads + c]
+                {
+                    unsigned int latest{0};
+                    ++started;
+                    while (!done)
+                    {
+                        if (!stream.buffers_ready_for_compositor(id))
+                            continue;
+
+                        auto const seen = submission_of.at(stream.lock_compositor_buffer(id)->id());
+                        if (seen < latest)
+                            ++out_of_order;
+                        latest = seen;
+                    }
+                });
+        }
+
+        while (started != compositors)
+            std::this_thread::yield();
+
+        for (auto i = 1u; i != submissions; ++i)
+            stream.submit_buffer(submitted[i]);
+
+        done = true;
+    }
+
+    EXPECT_THAT(out_of_order, Eq(0u));
+
+    // Catching up with the latest buffer must have released all the others
+    while (stream.buffers_ready_for_compositor(this))
+        stream.lock_compositor_buffer(this);
+    for (auto i = 0u; i != submissions - 1; ++i)
+        EXPECT_TRUE(submitted[i].unique()) << "Buffer " << i << " still in use";
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/geometry/region.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using namespace mir::geometry;
+using namespace testing;
+
+TEST(Region, default_region_is_empty)
+{
+    Region const region;
+
+    EXPECT_TRUE(region.empty());
+    EXPECT_THAT(region.rectangles().size(), Eq(0u));
+    EXPECT_THAT(region.bounding_rectangle(), Eq(Rectangle{}));
+}
+
+TEST(Region, empty_rectangles_add_nothing)
+{
+    Region region;
+    region.add(Rectangle{{10, 10}, {0, 10}});
+    region.add(Rectangle{{10, 10}, {10, 0}});
+
+    EXPECT_TRUE(region.empty());
+}
+
+TEST(Region, contains_its_rectangle)
+{
+    Rectangle const rect{{10, 20}, {30, 40}};
+    Region const region{rect};
+
+    EXPECT_TRUE(region.contains(rect));
+    EXPECT_TRUE(region.contains({{15, 25}, {5, 5}}));
+    EXPECT_FALSE(region.contains({{15, 25}, {30, 5}}));
+    EXPECT_THAT(region.rectangles(), Eq(Rectangles{rect}));
+}
+
+TEST(Region, side_by_side_rectangles_contain_what_they_cover_together)
+{
+    Region region;
+    region.add(Rectangle{{0, 0}, {960, 1080}});
+    region.add(Rectangle{{960, 0}, {960, 1080}});
+
+    EXPECT_TRUE(region.contains({{900, 100}, {200, 200}}));
+    EXPECT_THAT(region.rectangles(), Eq(Rectangles{{{0, 0}, {1920, 1080}}}));
+}
+
+TEST(Region, stacked_rectangles_contain_what_they_cover_together)
+{
+    Region region;
+    region.add(Rectangle{{0, 0}, {100, 50}});
+    region.add(Rectangle{{0, 50}, {100, 50}});
+
+    EXPECT_TRUE(region.contains({{10, 40}, {20, 20}}));
+    EXPECT_THAT(region.rectangles(), Eq(Rectangles{{{0, 0}, {100, 100}}}));
+}
+
+TEST(Region, gap_between_rectangles_is_not_contained)
+{
+    Region region;
+    region.add(Rectangle{{0, 0}, {100, 50}});
+    region.add(Rectangle{{0, 51}, {100, 50}});
+
+    EXPECT_FALSE(region.contains({{10, 40}, {20, 20}}));
+    EXPECT_FALSE(region.contains({{10, 45}, {20, 6}}));
+    EXPECT_TRUE(region.contains({{10, 45}, {20, 5}}));
+}
+
+TEST(Region, union_of_overlapping_rectangles_has_no_overlaps)
+{
+    Region region;
+    region.add(Rectangle{{0, 0}, {20, 20}});
+    region.add(Rectangle{{10, 10}, {20, 20}});
+
+    EXPECT_THAT(region.rectangles(), Eq(Rectangles{
+        {{0, 0}, {20, 10}},
+        {{0, 10}, {30, 10}},
+        {{10, 20}, {20, 10}}}));
+}
+
+TEST(Region, subtraction_leaves_a_frame)
+{
+    Region region{Rectangle{{0, 0}, {30, 30}}};
+    region.subtract(Rectangle{{10, 10}, {10, 10}});
+
+    EXPECT_FALSE(region.overlaps({{10, 10}, {10, 10}}));
+    EXPECT_TRUE(region.overlaps({{5, 5}, {10, 10}}));
+    EXPECT_THAT(region.bounding_rectangle(), Eq(Rectangle{{0, 0}, {30, 30}}));
+    EXPECT_THAT(region.rectangles(), Eq(Rectangles{
+        {{0, 0}, {30, 10}},
+        {{0, 10}, {10, 10}},
+        {{20, 10}, {10, 10}},
+        {{0, 20}, {30, 10}}}));
+}
+
+TEST(Region, subtracting_everything_leaves_nothing)
+{
+    Region region{Rectangles{{{0, 0}, {30, 30}}, {{50, 50}, {10, 10}}}};
+    region.subtract(Rectangle{{-10, -10}, {100, 100}});
+
+    EXPECT_TRUE(region.empty());
+}
+
+TEST(Region, intersection_keeps_common_area)
+{
+    Region region{Rectangles{{{0, 0}, {30, 30}}, {{50, 0}, {30, 30}}}};
+    region.intersect(Rectangle{{20, 10}, {40, 10}});
+
+    EXPECT_THAT(region.rectangles(), Eq(Rectangles{
+        {{20, 10}, {10, 10}},
+        {{50, 10}, {10, 10}}}));
+}
+
+TEST(Region, equality_depends_only_on_area_covered)
+{
+    Region horizontal;
+    horizontal.add(Rectangle{{0, 0}, {10, 20}});
+    horizontal.add(Rectangle{{10, 0}, {10, 20}});
+
+    Region vertical;
+    vertical.add(Rectangle{{0, 10}, {20, 10}});
+    vertical.add(Rectangle{{0, 0}, {20, 10}});
+
+    EXPECT_THAT(horizontal, Eq(vertical));
+    EXPECT_THAT(horizontal, Ne(Region{Rectangle{{0, 0}, {20, 21}}}));
+}
+
+TEST(Region, bounding_rectangle_outside_covers_only_the_uncovered_part)
+{
+    Region region;
+    region.add(Rectangle{{0, 0}, {100, 200}});
+    region.add(Rectangle{{0, 150}, {300, 50}});
+
+    EXPECT_THAT(region.bounding_rectangle_outside({{50, 50}, {100, 100}}), Eq(Rectangle{{100, 50}, {50, 100}}));
+    EXPECT_THAT(region.bounding_rectangle_outside({{50, 100}, {100, 100}}), Eq(Rectangle{{100, 100}, {50, 50}}));
+    EXPECT_THAT(region.bounding_rectangle_outside({{10, 10}, {50, 50}}), Eq(Rectangle{}));
+    EXPECT_THAT(Region{}.bounding_rectangle_outside({{10, 10}, {50, 50}}), Eq(Rectangle{{10, 10}, {50, 50}}));
+}
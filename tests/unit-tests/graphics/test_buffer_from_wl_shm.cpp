@@ -0,0 +1,420 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/platforms/common/server/buffer_from_wl_shm.h"
+#include "src/platforms/common/server/egl_context_executor.h"
+#include "mir/renderer/gl/context.h"
+#include "mir/renderer/sw/pixel_source.h"
+#include "mir/graphics/texture.h"
+#include "mir/graphics/buffer.h"
+#include "mir/fd.h"
+
+#include "mir/test/doubles/mock_gl.h"
+#include "mir/test/doubles/mock_egl.h"
+#include "mir/test/doubles/explicit_executor.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <GLES2/gl2ext.h>
+#include <wayland-server.h>
+
+#include <boost/throw_exception.hpp>
+
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+#include <future>
+#include <system_error>
+
+namespace mg = mir::graphics;
+namespace mgc = mir::graphics::common;
+namespace mrs = mir::renderer::software;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+using namespace testing;
+
+namespace
+{
+class DumbGLContext : public mir::renderer::gl::Context
+{
+public:
+    void make_current() const override
+    {
+        eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+    }
+
+    void release_current() const override
+    {
+        eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+
+private:
+    EGLDisplay const dpy{reinterpret_cast<void*>(0xdeebbeed)};
+    EGLContext const ctx{reinterpret_cast<void*>(0x0011223344)};
+};
+
+/// Holds the EGL thread up until released, so work can be queued behind it
+class EGLThreadGate
+{
+public:
+    explicit EGLThreadGate(mgc::EGLContextExecutor& egl_delegate)
+    {
+        egl_delegate.spawn([opened = opened.get_future().share()]() { opened.wait(); });
+    }
+
+    ~EGLThreadGate()
+    {
+        open();
+    }
+
+    void open()
+    {
+        if (!is_open)
+        {
+            opened.set_value();
+            is_open = true;
+        }
+    }
+
+private:
+    std::promise<void> opened;
+    bool is_open{false};
+};
+
+// Request opcodes, from wayland.xml
+uint16_t const sync_opcode{0};
+uint16_t const get_registry_opcode{1};
+uint16_t const bind_opcode{0};
+uint16_t const create_pool_opcode{0};
+uint16_t const create_buffer_opcode{0};
+
+/// Just enough of a Wayland client, speaking the wire protocol, to create a wl_shm buffer
+class RawClient
+{
+public:
+    explicit RawClient(mir::Fd socket)
+        : socket{std::move(socket)}
+    {
+    }
+
+    template<typename... Args>
+    void send(uint32_t object, uint16_t opcode, Args... args)
+    {
+        std::vector<uint32_t> message{object, 0u, args...};
+        message[1] = (message.size() * sizeof(uint32_t)) << 16 | opcode;
+        ::send(socket, message.data(), message.size() * sizeof(uint32_t), 0);
+    }
+
+    void send_with_fd(uint32_t object, uint16_t opcode, int fd, uint32_t arg0, uint32_t arg1)
+    {
+        uint32_t message[]{object, uint32_t{4 * sizeof(uint32_t) << 16} | opcode, arg0, arg1};
+        iovec iov{message, sizeof(message)};
+
+        union
+        {
+            cmsghdr header;
+            char buffer[CMSG_SPACE(sizeof(int))];
+        } control{};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+        auto const cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+        sendmsg(socket, &msg, 0);
+    }
+
+    /// The opcodes of the events received for object
+    auto events_for(uint32_t object) -> std::vector<uint32_t>
+    {
+        char buffer[4096];
+        ssize_t len;
+        while ((len = recv(socket, buffer, sizeof buffer, MSG_DONTWAIT)) > 0)
+        {
+            received.insert(received.end(), buffer, buffer + len);
+        }
+
+        std::vector<uint32_t> opcodes;
+        size_t offset{0};
+        while (offset + 2 * sizeof(uint32_t) <= received.size())
+        {
+            uint32_t header[2];
+            memcpy(header, received.data() + offset, sizeof header);
+            if (header[0] == object)
+            {
+                opcodes.push_back(header[1] & 0xffff);
+            }
+            offset += header[1] >> 16;
+        }
+        received.erase(received.begin(), received.begin() + std::min(offset, received.size()));
+        return opcodes;
+    }
+
+private:
+    mir::Fd const socket;
+    std::vector<char> received;
+};
+
+struct BufferFromWlShm : Test
+{
+    BufferFromWlShm()
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+        {
+            BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to create socketpair"}));
+        }
+        raw_client = std::make_unique<RawClient>(mir::Fd{fds[1]});
+
+        wl_display_init_shm(display);
+        client = wl_client_create(display, fds[0]);
+
+        mir::Fd const pool{memfd_create("test_buffer_from_wl_shm", MFD_CLOEXEC)};
+        if (ftruncate(pool, stride * size.height.as_int()) != 0)
+        {
+            BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to size shm pool"}));
+        }
+
+        uint32_t const registry_id{2}, shm_id{3}, pool_id{4};
+        uint32_t const shm_global_name{1};  // wl_shm is the only global
+        raw_client->send(1, get_registry_opcode, registry_id);
+        raw_client->send(
+            registry_id, bind_opcode,
+            shm_global_name,
+            7u, word_of("wl_s"), word_of("hm\0\0"),
+            1u, shm_id);
+        raw_client->send_with_fd(shm_id, create_pool_opcode, pool, pool_id, stride * size.height.as_int());
+        raw_client->send(
+            pool_id, create_buffer_opcode,
+            buffer_id, 0u, size.width.as_uint32_t(), size.height.as_uint32_t(), uint32_t(stride),
+            uint32_t(WL_SHM_FORMAT_ARGB8888));
+
+        for (auto i = 0; i != 10 && !resource; ++i)
+        {
+            wl_event_loop_dispatch(wl_display_get_event_loop(display), 0);
+            resource = wl_client_get_object(client, buffer_id);
+        }
+        if (!resource)
+        {
+            BOOST_THROW_EXCEPTION((std::runtime_error{"Failed to create wl_shm buffer"}));
+        }
+
+        ON_CALL(mock_gl, glGenTextures(1, _))
+            .WillByDefault(Invoke([this](GLsizei, GLuint* id) { *id = ++textures_generated; }));
+    }
+
+    ~BufferFromWlShm()
+    {
+        wait_for_egl_thread();
+        wl_client_destroy(client);
+        wayland_executor->execute();
+        wl_display_destroy(display);
+    }
+
+    static auto word_of(char const (&chars)[5]) -> uint32_t
+    {
+        uint32_t word;
+        memcpy(&word, chars, sizeof word);
+        return word;
+    }
+
+    /// Import the wl_buffer, and wait for its upload to finish before dropping it
+    void import_and_drop()
+    {
+        auto const buffer = import();
+        wait_for_egl_thread();
+    }
+
+    auto import(std::optional<geom::Rectangles> const& damage = std::nullopt) -> std::shared_ptr<mg::Buffer>
+    {
+        return mg::wayland::buffer_from_wl_shm(resource, wayland_executor, egl_delegate, damage, [](){});
+    }
+
+    void wait_for_egl_thread()
+    {
+        std::promise<void> drained;
+        egl_delegate->spawn([&drained]() { drained.set_value(); });
+        drained.get_future().wait();
+    }
+
+    /// The opcodes of the events the client has been sent for the buffer
+    auto buffer_events() -> std::vector<uint32_t>
+    {
+        wayland_executor->execute();
+
+        // wl_buffer.release is only queued, so have the client round-trip to get it sent
+        raw_client->send(1, sync_opcode, next_id++);
+        wl_event_loop_dispatch(wl_display_get_event_loop(display), 0);
+        wl_client_flush(client);
+
+        return raw_client->events_for(buffer_id);
+    }
+
+    NiceMock<mtd::MockEGL> mock_egl;
+    NiceMock<mtd::MockGL> mock_gl;
+    GLuint textures_generated{0};
+
+    geom::Size const size{4, 3};
+    int32_t const stride{4 * 4};
+    uint32_t const buffer_id{5};
+    uint32_t next_id{buffer_id + 1};
+
+    std::shared_ptr<mgc::EGLContextExecutor> const egl_delegate{
+        std::make_shared<mgc::EGLContextExecutor>(std::make_unique<DumbGLContext>())};
+    std::shared_ptr<mtd::ExplicitExectutor> const wayland_executor{std::make_shared<mtd::ExplicitExectutor>()};
+
+    wl_display* const display{wl_display_create()};
+    std::unique_ptr<RawClient> raw_client;
+    wl_client* client;
+    wl_resource* resource{nullptr};
+};
+}
+
+TEST_F(BufferFromWlShm, releases_wl_buffer_once_uploaded_rather_than_once_consumed)
+{
+    EGLThreadGate gate{*egl_delegate};
+    auto const buffer = import();
+
+    EXPECT_THAT(buffer_events(), IsEmpty());
+
+    gate.open();
+    wait_for_egl_thread();
+
+    EXPECT_THAT(buffer_events(), ElementsAre(WL_BUFFER_RELEASE));
+}
+
+TEST_F(BufferFromWlShm, reads_pixels_back_from_texture_on_egl_thread_once_wl_buffer_is_released)
+{
+    ON_CALL(mock_gl, glCheckFramebufferStatus(GL_FRAMEBUFFER))
+        .WillByDefault(Return(GL_FRAMEBUFFER_COMPLETE));
+    EXPECT_CALL(
+        mock_gl,
+        glReadPixels(0, 0, size.width.as_int(), size.height.as_int(), GL_RGBA, GL_UNSIGNED_BYTE, _))
+        .WillOnce(Invoke(
+            [this](GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, GLvoid* pixels)
+            {
+                EXPECT_THAT(
+                    mock_egl.current_contexts[std::this_thread::get_id()],
+                    Ne(EGL_NO_CONTEXT));
+
+                auto const rgba = static_cast<unsigned char*>(pixels);
+                for (auto i = 0; i != size.width.as_int() * size.height.as_int() * 4; i += 4)
+                {
+                    rgba[i] = 0x11;
+                    rgba[i + 1] = 0x22;
+                    rgba[i + 2] = 0x33;
+                    rgba[i + 3] = 0x44;
+                }
+            }));
+
+    auto const buffer = import();
+    wait_for_egl_thread();
+    ASSERT_THAT(buffer_events(), ElementsAre(WL_BUFFER_RELEASE));
+
+    auto const mapping = std::dynamic_pointer_cast<mrs::ReadMappableBuffer>(buffer)->map_readable();
+
+    ASSERT_THAT(mapping->size(), Eq(size));
+    ASSERT_THAT(mapping->format(), Eq(mir_pixel_format_argb_8888));
+    // argb_8888 is laid out BGRA in memory
+    EXPECT_THAT(
+        std::vector<unsigned char>(mapping->data(), mapping->data() + 4),
+        ElementsAre(0x33, 0x22, 0x11, 0x44));
+}
+
+TEST_F(BufferFromWlShm, does_not_upload_buffer_destroyed_before_its_upload_started)
+{
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, _)).Times(0);
+
+    EGLThreadGate gate{*egl_delegate};
+    import().reset();
+
+    gate.open();
+    wait_for_egl_thread();
+
+    EXPECT_THAT(buffer_events(), ElementsAre(WL_BUFFER_RELEASE));
+}
+
+TEST_F(BufferFromWlShm, destruction_waits_for_upload_in_progress)
+{
+    std::promise<void> uploading;
+    std::promise<void> finish_upload;
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, _))
+        .WillOnce(InvokeWithoutArgs(
+            [&]()
+            {
+                uploading.set_value();
+                finish_upload.get_future().wait();
+            }));
+
+    auto buffer = import();
+    uploading.get_future().wait();
+
+    auto const destroyed = std::async(std::launch::async, [&buffer]() { buffer.reset(); });
+    EXPECT_THAT(destroyed.wait_for(std::chrono::milliseconds{50}), Eq(std::future_status::timeout));
+
+    finish_upload.set_value();
+    destroyed.wait();
+
+    EXPECT_THAT(buffer_events(), ElementsAre(WL_BUFFER_RELEASE));
+}
+
+TEST_F(BufferFromWlShm, uploads_only_damage_into_texture_of_previous_import)
+{
+    import_and_drop();
+
+    geom::Rectangle const damage{{1, 1}, {2, 1}};
+    EXPECT_CALL(mock_gl, glGenTextures(_, _)).Times(0);
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, _)).Times(0);
+    EXPECT_CALL(mock_gl, glBindTexture(GL_TEXTURE_2D, textures_generated)).Times(AtLeast(1));
+    EXPECT_CALL(mock_gl, glTexSubImage2D(GL_TEXTURE_2D, 0, 1, 1, 2, 1, GL_BGRA_EXT, GL_UNSIGNED_BYTE, _));
+
+    auto const buffer = import(geom::Rectangles{damage});
+    wait_for_egl_thread();
+}
+
+TEST_F(BufferFromWlShm, uploads_everything_into_new_texture_while_previous_import_is_in_use)
+{
+    auto const previous = import();
+    wait_for_egl_thread();
+    auto const previous_texture = textures_generated;
+
+    EXPECT_CALL(mock_gl, glTexSubImage2D(_, _, _, _, _, _, _, _, _)).Times(0);
+    EXPECT_CALL(
+        mock_gl,
+        glTexImage2D(GL_TEXTURE_2D, 0, _, size.width.as_int(), size.height.as_int(), 0, _, _, _));
+
+    auto const buffer = import(geom::Rectangles{geom::Rectangle{{1, 1}, {2, 1}}});
+    wait_for_egl_thread();
+
+    EXPECT_THAT(textures_generated, Ne(previous_texture));
+}
+
+TEST_F(BufferFromWlShm, uploads_everything_when_damage_is_unknown)
+{
+    import_and_drop();
+
+    EXPECT_CALL(mock_gl, glTexSubImage2D(_, _, _, _, _, _, _, _, _)).Times(0);
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, _));
+
+    auto const buffer = import();
+    wait_for_egl_thread();
+}
@@ -284,6 +284,20 @@ TEST(DisplayConfiguration, outputs_with_different_form_factors_compare_unequal)
     EXPECT_THAT(b, Ne(a));
 }
 
+TEST(DisplayConfiguration, outputs_with_different_vrr_settings_compare_unequal)
+{
+    mg::DisplayConfigurationOutput a = tmpl_output;
+    mg::DisplayConfigurationOutput b = tmpl_output;
+
+    EXPECT_THAT(a, Eq(b));
+    EXPECT_THAT(b, Eq(a));
+    a.vrr_capable = true;
+    b.vrr_capable = true;
+    a.vrr_enabled = true;
+    EXPECT_THAT(a, Ne(b));
+    EXPECT_THAT(b, Ne(a));
+}
+
 TEST(DisplayConfiguration, output_extents_uses_current_mode)
 {
     mg::DisplayConfigurationOutput out = tmpl_output;
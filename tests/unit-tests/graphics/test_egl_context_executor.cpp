@@ -0,0 +1,191 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/platforms/common/server/egl_context_executor.h"
+#include "mir/renderer/gl/context.h"
+
+#include "mir/test/doubles/mock_egl.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <future>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace mgc = mir::graphics::common;
+namespace mtd = mir::test::doubles;
+using namespace testing;
+
+namespace
+{
+class StubContext : public mir::renderer::gl::Context
+{
+public:
+    explicit StubContext(EGLContext ctx)
+        : ctx{ctx}
+    {
+    }
+
+    void make_current() const override
+    {
+        eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+    }
+
+    void release_current() const override
+    {
+        eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+
+private:
+    EGLDisplay const dpy{reinterpret_cast<void*>(0xdeebbeed)};
+    EGLContext const ctx;
+};
+
+struct EGLContextExecutor : public Test
+{
+    auto make_context() -> std::unique_ptr<mir::renderer::gl::Context>
+    {
+        return std::make_unique<StubContext>(reinterpret_cast<EGLContext>(++contexts_made));
+    }
+
+    NiceMock<mtd::MockEGL> mock_egl;
+    intptr_t contexts_made{0};
+    std::chrono::seconds const timeout{10};
+};
+}
+
+TEST_F(EGLContextExecutor, creates_a_context_per_thread)
+{
+    mgc::EGLContextExecutor executor{[this]() { return make_context(); }, 3};
+
+    EXPECT_THAT(contexts_made, Eq(3));
+}
+
+TEST_F(EGLContextExecutor, runs_work_with_a_context_current)
+{
+    mgc::EGLContextExecutor executor{[this]() { return make_context(); }, 2};
+
+    for (auto i = 0; i != 4; ++i)
+    {
+        std::promise<EGLContext> current;
+        executor.spawn(
+            [this, &current]()
+            {
+                std::lock_guard<std::mutex> lock{mock_egl.current_contexts_mutex};
+                current.set_value(mock_egl.current_contexts[std::this_thread::get_id()]);
+            });
+
+        auto result = current.get_future();
+        ASSERT_THAT(result.wait_for(timeout), Eq(std::future_status::ready));
+        EXPECT_THAT(result.get(), Ne(EGL_NO_CONTEXT));
+    }
+}
+
+TEST_F(EGLContextExecutor, runs_work_with_the_same_affinity_on_one_thread_in_order)
+{
+    int const client{0};
+    mgc::EGLContextExecutor executor{[this]() { return make_context(); }, 4};
+
+    std::mutex mutex;
+    std::vector<int> order;
+    std::vector<std::thread::id> threads;
+    std::promise<void> done;
+
+    for (auto i = 0; i != 20; ++i)
+    {
+        executor.spawn(
+            &client,
+            [&, i]()
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                order.push_back(i);
+                threads.push_back(std::this_thread::get_id());
+                if (i == 19)
+                {
+                    done.set_value();
+                }
+            });
+    }
+
+    ASSERT_THAT(done.get_future().wait_for(timeout), Eq(std::future_status::ready));
+
+    std::lock_guard<std::mutex> lock{mutex};
+    for (auto i = 0; i != 20; ++i)
+    {
+        EXPECT_THAT(order[i], Eq(i));
+        EXPECT_THAT(threads[i], Eq(threads[0]));
+    }
+}
+
+TEST_F(EGLContextExecutor, spreads_work_with_different_aligned_affinities_over_threads)
+{
+    // Like wl_client*, these are all 16-byte aligned
+    struct alignas(16) Client { char padding[16]; };
+    std::vector<Client> const clients(8);
+
+    mgc::EGLContextExecutor executor{[this]() { return make_context(); }, 4};
+
+    std::vector<std::promise<std::thread::id>> ran(clients.size());
+    for (auto i = 0u; i != clients.size(); ++i)
+    {
+        executor.spawn(
+            &clients[i],
+            [&ran, i]()
+            {
+                ran[i].set_value(std::this_thread::get_id());
+            });
+    }
+
+    std::set<std::thread::id> threads;
+    for (auto& thread : ran)
+    {
+        auto result = thread.get_future();
+        ASSERT_THAT(result.wait_for(timeout), Eq(std::future_status::ready));
+        threads.insert(result.get());
+    }
+
+    EXPECT_THAT(threads.size(), Gt(1u));
+}
+
+TEST_F(EGLContextExecutor, work_can_spawn_more_work)
+{
+    mgc::EGLContextExecutor executor{[this]() { return make_context(); }, 1};
+
+    std::promise<void> done;
+    executor.spawn(
+        [&executor, &done]()
+        {
+            executor.spawn([&done]() { done.set_value(); });
+        });
+
+    EXPECT_THAT(done.get_future().wait_for(timeout), Eq(std::future_status::ready));
+}
+
+TEST_F(EGLContextExecutor, runs_queued_work_before_shutting_down)
+{
+    int runs{0};
+    {
+        mgc::EGLContextExecutor executor{[this]() { return make_context(); }, 2};
+        for (auto i = 0; i != 10; ++i)
+        {
+            executor.spawn(&runs, [&runs]() { ++runs; });
+        }
+    }
+
+    EXPECT_THAT(runs, Eq(10));
+}
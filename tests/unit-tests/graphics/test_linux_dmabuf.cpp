@@ -0,0 +1,803 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/graphics/linux_dmabuf.h"
+#include "mir/graphics/egl_extensions.h"
+#include "mir/renderer/gl/context.h"
+#include "mir/graphics/texture.h"
+#include "mir/graphics/buffer.h"
+#include "mir/graphics/dmabuf_buffer.h"
+#include "mir/fd.h"
+#include "wayland_wrapper.h"
+
+#include "mir/test/doubles/mock_gl.h"
+#include "mir/test/doubles/mock_egl.h"
+#include "mir/test/doubles/explicit_executor.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <drm_fourcc.h>
+#include <wayland-server.h>
+
+#include <boost/throw_exception.hpp>
+
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+
+namespace mg = mir::graphics;
+namespace mw = mir::wayland;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+using namespace testing;
+
+namespace
+{
+class StubGLContext : public mir::renderer::gl::Context
+{
+public:
+    void make_current() const override
+    {
+    }
+
+    void release_current() const override
+    {
+    }
+};
+
+// The dma-buf formats the EGL display supports, with the modifiers each supports
+std::vector<std::pair<EGLint, std::vector<EGLuint64KHR>>> const supported_formats{
+    {DRM_FORMAT_XRGB8888, {DRM_FORMAT_MOD_LINEAR, I915_FORMAT_MOD_X_TILED}},
+    {DRM_FORMAT_ARGB8888, {DRM_FORMAT_MOD_LINEAR}}};
+
+EGLBoolean query_dmabuf_formats(EGLDisplay, EGLint max_formats, EGLint* formats, EGLint* num_formats)
+{
+    *num_formats = supported_formats.size();
+    for (auto i = 0; i < max_formats && i < *num_formats; ++i)
+    {
+        formats[i] = supported_formats[i].first;
+    }
+    return EGL_TRUE;
+}
+
+EGLBoolean query_dmabuf_modifiers(
+    EGLDisplay,
+    EGLint format,
+    EGLint max_modifiers,
+    EGLuint64KHR* modifiers,
+    EGLBoolean* external_only,
+    EGLint* num_modifiers)
+{
+    for (auto const& [supported_format, supported_modifiers] : supported_formats)
+    {
+        if (supported_format == format)
+        {
+            *num_modifiers = supported_modifiers.size();
+            for (auto i = 0; i < max_modifiers && i < *num_modifiers; ++i)
+            {
+                modifiers[i] = supported_modifiers[i];
+                external_only[i] = EGL_FALSE;
+            }
+            return EGL_TRUE;
+        }
+    }
+    return EGL_FALSE;
+}
+
+EGLDeviceEXT const render_device{reinterpret_cast<EGLDeviceEXT>(0xde71ce)};
+
+EGLBoolean query_display_attrib(EGLDisplay, EGLint attribute, EGLAttrib* value)
+{
+    if (attribute != EGL_DEVICE_EXT)
+    {
+        return EGL_FALSE;
+    }
+    *value = reinterpret_cast<EGLAttrib>(render_device);
+    return EGL_TRUE;
+}
+
+char const* query_device_string(EGLDeviceEXT device, EGLint name)
+{
+    if (device != render_device)
+    {
+        return nullptr;
+    }
+    switch (name)
+    {
+    case EGL_EXTENSIONS:
+        return "EGL_EXT_device_drm";
+    case EGL_DRM_DEVICE_FILE_EXT:
+        // Any character device will do
+        return "/dev/null";
+    default:
+        return nullptr;
+    }
+}
+
+auto render_device_number() -> dev_t
+{
+    struct stat info;
+    stat("/dev/null", &info);
+    return info.st_rdev;
+}
+
+// Request opcodes, from wayland.xml and linux-dmabuf-unstable-v1.xml
+uint16_t const get_registry_opcode{1};
+uint16_t const bind_opcode{0};
+uint16_t const create_surface_opcode{0};
+uint16_t const buffer_destroy_opcode{0};
+uint16_t const create_params_opcode{1};
+uint16_t const get_default_feedback_opcode{2};
+uint16_t const get_surface_feedback_opcode{3};
+uint16_t const params_add_opcode{1};
+uint16_t const params_create_immed_opcode{3};
+
+// Event opcodes
+uint16_t const global_opcode{0};
+uint16_t const feedback_done_opcode{0};
+uint16_t const feedback_format_table_opcode{1};
+uint16_t const feedback_main_device_opcode{2};
+uint16_t const feedback_tranche_done_opcode{3};
+uint16_t const feedback_tranche_target_device_opcode{4};
+uint16_t const feedback_tranche_formats_opcode{5};
+uint16_t const feedback_tranche_flags_opcode{6};
+
+class StubSurface : public mw::Surface
+{
+public:
+    using mw::Surface::Surface;
+
+private:
+    void attach(std::optional<wl_resource*> const&, int32_t, int32_t) override {}
+    void damage(int32_t, int32_t, int32_t, int32_t) override {}
+    void frame(wl_resource*) override {}
+    void set_opaque_region(std::optional<wl_resource*> const&) override {}
+    void set_input_region(std::optional<wl_resource*> const&) override {}
+    void commit() override {}
+    void set_buffer_transform(int32_t) override {}
+    void set_buffer_scale(int32_t) override {}
+    void damage_buffer(int32_t, int32_t, int32_t, int32_t) override {}
+};
+
+class StubCompositor : public mw::Compositor
+{
+public:
+    using mw::Compositor::Compositor;
+
+private:
+    void create_surface(wl_resource* id) override
+    {
+        new StubSurface{id, Version<4>{}};
+    }
+
+    void create_region(wl_resource*) override
+    {
+    }
+};
+
+class StubCompositorGlobal : public mw::Compositor::Global
+{
+public:
+    explicit StubCompositorGlobal(wl_display* display)
+        : Global{display, Version<4>{}}
+    {
+    }
+
+private:
+    void bind(wl_resource* new_wl_compositor) override
+    {
+        new StubCompositor{new_wl_compositor, mw::Resource::Version<4>{}};
+    }
+};
+
+/// Just enough of a Wayland client, speaking the wire protocol, to create dma-buf buffers and read feedback
+class RawClient
+{
+public:
+    explicit RawClient(mir::Fd socket)
+        : socket{std::move(socket)}
+    {
+    }
+
+    struct Message
+    {
+        uint32_t object;
+        uint16_t opcode;
+        std::vector<uint32_t> args;
+    };
+
+    template<typename... Args>
+    void send(uint32_t object, uint16_t opcode, Args... args)
+    {
+        send_message({object, 0u, uint32_t(args)...}, opcode, nullptr);
+    }
+
+    template<typename... Args>
+    void send_with_fd(uint32_t object, uint16_t opcode, int fd, Args... args)
+    {
+        send_message({object, 0u, uint32_t(args)...}, opcode, &fd);
+    }
+
+    /// The words of a wire protocol string argument
+    static auto string_arg(char const* string) -> std::vector<uint32_t>
+    {
+        auto const length = strlen(string) + 1;
+        std::vector<uint32_t> words(1 + (length + 3) / 4);
+        words[0] = length;
+        memcpy(words.data() + 1, string, length);
+        return words;
+    }
+
+    void send_message(std::vector<uint32_t> message, uint16_t opcode, int const* fd)
+    {
+        message[1] = (message.size() * sizeof(uint32_t)) << 16 | opcode;
+        iovec iov{message.data(), message.size() * sizeof(uint32_t)};
+
+        union
+        {
+            cmsghdr header;
+            char buffer[CMSG_SPACE(sizeof(int))];
+        } control{};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (fd)
+        {
+            msg.msg_control = control.buffer;
+            msg.msg_controllen = sizeof(control.buffer);
+            auto const cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cmsg), fd, sizeof(int));
+        }
+
+        sendmsg(socket, &msg, 0);
+    }
+
+    /// The messages sent to the client since last called; any fds sent are added to fds
+    auto receive() -> std::vector<Message>
+    {
+        std::vector<uint32_t> words;
+        for (;;)
+        {
+            uint32_t buffer[1024];
+            iovec iov{buffer, sizeof(buffer)};
+
+            union
+            {
+                cmsghdr header;
+                char buffer[CMSG_SPACE(sizeof(int) * 28)];
+            } control{};
+            msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control.buffer;
+            msg.msg_controllen = sizeof(control.buffer);
+
+            auto const received = recvmsg(socket, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+            if (received <= 0)
+            {
+                break;
+            }
+            words.insert(words.end(), buffer, buffer + received / sizeof(uint32_t));
+
+            for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                auto const count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for (auto i = 0u; i != count; ++i)
+                {
+                    int fd;
+                    memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                    fds.emplace_back(fd);
+                }
+            }
+        }
+
+        std::vector<Message> messages;
+        for (auto i = 0u; i + 2 <= words.size();)
+        {
+            auto const length = (words[i + 1] >> 16) / sizeof(uint32_t);
+            messages.push_back({
+                words[i],
+                static_cast<uint16_t>(words[i + 1] & 0xffff),
+                {words.begin() + i + 2, words.begin() + i + length}});
+            i += length;
+        }
+        return messages;
+    }
+
+    std::vector<mir::Fd> fds;
+
+private:
+    mir::Fd const socket;
+};
+
+/// The contents of a wire protocol array argument
+template<typename T>
+auto array_arg(std::vector<uint32_t> const& args, size_t index) -> std::vector<T>
+{
+    std::vector<T> contents(args[index] / sizeof(T));
+    memcpy(contents.data(), args.data() + index + 1, args[index]);
+    return contents;
+}
+
+/// One round of dma-buf feedback, as the client saw it
+struct Feedback
+{
+    struct Tranche
+    {
+        dev_t target_device;
+        uint32_t flags;
+        std::vector<uint16_t> formats;
+    };
+
+    uint32_t table_size{0};
+    dev_t main_device{0};
+    std::vector<Tranche> tranches;
+    bool done{false};
+};
+
+/// The feedback rounds sent to the feedback object id
+auto feedback_from(std::vector<RawClient::Message> const& messages, uint32_t id) -> std::vector<Feedback>
+{
+    std::vector<Feedback> rounds;
+    Feedback current;
+    Feedback::Tranche tranche{};
+    for (auto const& message : messages)
+    {
+        if (message.object != id)
+        {
+            continue;
+        }
+
+        switch (message.opcode)
+        {
+        case feedback_format_table_opcode:
+            // The fd isn't in the message data, only the size
+            current.table_size = message.args[0];
+            break;
+        case feedback_main_device_opcode:
+            current.main_device = array_arg<dev_t>(message.args, 0).at(0);
+            break;
+        case feedback_tranche_target_device_opcode:
+            tranche.target_device = array_arg<dev_t>(message.args, 0).at(0);
+            break;
+        case feedback_tranche_flags_opcode:
+            tranche.flags = message.args[0];
+            break;
+        case feedback_tranche_formats_opcode:
+            tranche.formats = array_arg<uint16_t>(message.args, 0);
+            break;
+        case feedback_tranche_done_opcode:
+            current.tranches.push_back(tranche);
+            tranche = {};
+            break;
+        case feedback_done_opcode:
+            current.done = true;
+            rounds.push_back(current);
+            current = {};
+            break;
+        }
+    }
+    return rounds;
+}
+
+MATCHER_P2(TrancheOf, flags, formats, "")
+{
+    return arg.target_device == render_device_number() &&
+           arg.flags == static_cast<uint32_t>(flags) &&
+           arg.formats == std::vector<uint16_t>(formats);
+}
+
+struct LinuxDmaBuf : Test
+{
+    LinuxDmaBuf()
+    {
+        ON_CALL(mock_egl, eglQueryString(_, EGL_EXTENSIONS))
+            .WillByDefault(Return(
+                "EGL_KHR_image_base "
+                "EGL_EXT_image_dma_buf_import "
+                "EGL_EXT_image_dma_buf_import_modifiers "
+                "EGL_EXT_device_query"));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("eglQueryDmaBufFormatsEXT")))
+            .WillByDefault(Return(reinterpret_cast<mtd::MockEGL::generic_function_pointer_t>(&query_dmabuf_formats)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("eglQueryDmaBufModifiersEXT")))
+            .WillByDefault(Return(reinterpret_cast<mtd::MockEGL::generic_function_pointer_t>(&query_dmabuf_modifiers)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("eglQueryDisplayAttribEXT")))
+            .WillByDefault(Return(reinterpret_cast<mtd::MockEGL::generic_function_pointer_t>(&query_display_attrib)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("eglQueryDeviceStringEXT")))
+            .WillByDefault(Return(reinterpret_cast<mtd::MockEGL::generic_function_pointer_t>(&query_device_string)));
+        ON_CALL(mock_egl, eglCreateImageKHR(_, _, EGL_LINUX_DMA_BUF_EXT, _, _))
+            .WillByDefault(Return(image));
+        ON_CALL(mock_gl, glGenTextures(1, _))
+            .WillByDefault(Invoke([this](GLsizei, GLuint* id) { *id = ++textures_generated; }));
+
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+        {
+            BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to create socketpair"}));
+        }
+        raw_client = std::make_unique<RawClient>(mir::Fd{fds[1]});
+        client = wl_client_create(display, fds[0]);
+
+        raw_client->send(1, get_registry_opcode, registry_id);
+        bind(compositor_global_name, "wl_compositor", 4, compositor_id);
+    }
+
+    ~LinuxDmaBuf()
+    {
+        wl_client_destroy(client);
+        wayland_executor->execute();
+        dmabuf.reset();
+        compositor.reset();
+        wl_display_destroy(display);
+    }
+
+    void bind(uint32_t name, char const* interface, uint32_t version, uint32_t id)
+    {
+        std::vector<uint32_t> message{registry_id, 0u, name};
+        auto const interface_arg = RawClient::string_arg(interface);
+        message.insert(message.end(), interface_arg.begin(), interface_arg.end());
+        message.push_back(version);
+        message.push_back(id);
+        raw_client->send_message(message, bind_opcode, nullptr);
+    }
+
+    /// Create the linux-dmabuf global and have the client bind it
+    void bind_dmabuf(uint32_t version)
+    {
+        dmabuf = std::make_unique<mg::LinuxDmaBufUnstable>(
+            display,
+            dpy,
+            std::make_shared<mg::EGLExtensions>(),
+            mg::EGLExtensions::EXTImageDmaBufImportModifiers{dpy},
+            scanout_formats);
+
+        bind(dmabuf_global_name, "zwp_linux_dmabuf_v1", version, dmabuf_id);
+    }
+
+    /// Process the client's requests, and everything they spawn, then see what it was sent
+    auto dispatch() -> std::vector<RawClient::Message>
+    {
+        wl_event_loop_dispatch(wl_display_get_event_loop(display), 0);
+        wayland_executor->execute();
+        wl_display_flush_clients(display);
+        return raw_client->receive();
+    }
+
+    /// Have the client create a wl_surface
+    auto create_surface() -> wl_resource*
+    {
+        auto const surface_id = next_id++;
+        raw_client->send(compositor_id, create_surface_opcode, surface_id);
+        dispatch();
+        return wl_client_get_object(client, surface_id);
+    }
+
+    /// Have the client create a dma-buf feedback object for surface (or the default one)
+    auto create_feedback(wl_resource* surface = nullptr) -> uint32_t
+    {
+        auto const feedback_id = next_id++;
+        if (surface)
+        {
+            raw_client->send(dmabuf_id, get_surface_feedback_opcode, feedback_id, wl_resource_get_id(surface));
+        }
+        else
+        {
+            raw_client->send(dmabuf_id, get_default_feedback_opcode, feedback_id);
+        }
+        return feedback_id;
+    }
+
+    /// Have the client create a single-plane XRGB8888 dma-buf wl_buffer
+    auto create_buffer() -> wl_resource*
+    {
+        mir::Fd const dmabuf_fd{memfd_create("test_linux_dmabuf", MFD_CLOEXEC)};
+        if (ftruncate(dmabuf_fd, stride * size.height.as_int()) != 0)
+        {
+            BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to size dma-buf"}));
+        }
+
+        auto const params_id = next_id++;
+        auto const buffer_id = next_id++;
+        raw_client->send(dmabuf_id, create_params_opcode, params_id);
+        raw_client->send_with_fd(
+            params_id, params_add_opcode, dmabuf_fd,
+            0u, 0u, stride,
+            uint32_t(DRM_FORMAT_MOD_LINEAR >> 32), uint32_t(DRM_FORMAT_MOD_LINEAR & 0xffffffff));
+        raw_client->send(
+            params_id, params_create_immed_opcode,
+            buffer_id, size.width.as_uint32_t(), size.height.as_uint32_t(), uint32_t(DRM_FORMAT_XRGB8888), 0u);
+
+        wl_resource* resource{nullptr};
+        for (auto i = 0; i != 10 && !resource; ++i)
+        {
+            wl_event_loop_dispatch(wl_display_get_event_loop(display), 0);
+            resource = wl_client_get_object(client, buffer_id);
+        }
+        if (!resource)
+        {
+            BOOST_THROW_EXCEPTION((std::runtime_error{"Failed to create dma-buf buffer"}));
+        }
+        return resource;
+    }
+
+    /// Have the client destroy its wl_buffer
+    void destroy_buffer(wl_resource* buffer)
+    {
+        raw_client->send(wl_resource_get_id(buffer), buffer_destroy_opcode);
+        wl_event_loop_dispatch(wl_display_get_event_loop(display), 0);
+        wayland_executor->execute();
+    }
+
+    auto import(wl_resource* buffer, wl_resource* surface) -> std::shared_ptr<mg::Buffer>
+    {
+        return dmabuf->buffer_from_resource(buffer, surface, ctx, [](){}, [](){}, wayland_executor);
+    }
+
+    NiceMock<mtd::MockEGL> mock_egl;
+    NiceMock<mtd::MockGL> mock_gl;
+    GLuint textures_generated{0};
+
+    EGLDisplay const dpy{reinterpret_cast<EGLDisplay>(0xdeebbeed)};
+    EGLImageKHR const image{reinterpret_cast<EGLImageKHR>(0xfaceb00c)};
+    geom::Size const size{4, 3};
+    uint32_t const stride{4 * 4};
+    uint32_t const registry_id{2};
+    uint32_t const compositor_id{3};
+    uint32_t const dmabuf_id{4};
+    uint32_t next_id{dmabuf_id + 1};
+    // Globals are named in order of creation
+    uint32_t const compositor_global_name{1};
+    uint32_t const dmabuf_global_name{2};
+
+    std::vector<mg::DRMFormatModifier> const scanout_formats{{DRM_FORMAT_XRGB8888, I915_FORMAT_MOD_X_TILED}};
+
+    std::shared_ptr<mir::renderer::gl::Context> const ctx{std::make_shared<StubGLContext>()};
+    std::shared_ptr<mtd::ExplicitExectutor> const wayland_executor{std::make_shared<mtd::ExplicitExectutor>()};
+
+    wl_display* const display{wl_display_create()};
+    std::unique_ptr<StubCompositorGlobal> compositor{std::make_unique<StubCompositorGlobal>(display)};
+    std::unique_ptr<mg::LinuxDmaBufUnstable> dmabuf;
+    std::unique_ptr<RawClient> raw_client;
+    wl_client* client;
+};
+}
+
+TEST_F(LinuxDmaBuf, resubmitted_buffer_reuses_its_egl_image_and_texture)
+{
+    EXPECT_CALL(mock_egl, eglCreateImageKHR(_, _, EGL_LINUX_DMA_BUF_EXT, _, _)).Times(1);
+    EXPECT_CALL(mock_gl, glGenTextures(_, _)).Times(1);
+    EXPECT_CALL(mock_egl, glEGLImageTargetTexture2DOES(_, image)).Times(1);
+
+    bind_dmabuf(3);
+    auto const surface = create_surface();
+    auto const buffer = create_buffer();
+    import(buffer, surface).reset();
+    import(buffer, surface).reset();
+    auto const resubmitted = import(buffer, surface);
+
+    EXPECT_CALL(mock_gl, glBindTexture(_, textures_generated));
+    dynamic_cast<mg::gl::Texture*>(resubmitted->native_buffer_base())->bind();
+}
+
+TEST_F(LinuxDmaBuf, import_counts_cache_hits_and_misses)
+{
+    bind_dmabuf(3);
+    auto const surface = create_surface();
+    auto const buffer = create_buffer();
+    auto const other_buffer = create_buffer();
+
+    auto const before = mg::LinuxDmaBufUnstable::import_counts();
+
+    import(buffer, surface).reset();
+    import(buffer, surface).reset();
+    import(other_buffer, surface).reset();
+    import(buffer, surface).reset();
+
+    auto const after = mg::LinuxDmaBufUnstable::import_counts();
+    EXPECT_THAT(after.misses - before.misses, Eq(2u));
+    EXPECT_THAT(after.hits - before.hits, Eq(2u));
+}
+
+TEST_F(LinuxDmaBuf, destroying_buffer_frees_its_egl_image_and_texture)
+{
+    bind_dmabuf(3);
+    auto const surface = create_surface();
+    auto const buffer = create_buffer();
+    import(buffer, surface).reset();
+
+    EXPECT_CALL(mock_egl, eglDestroyImageKHR(_, image));
+    EXPECT_CALL(mock_gl, glDeleteTextures(1, Pointee(textures_generated)));
+
+    destroy_buffer(buffer);
+}
+
+TEST_F(LinuxDmaBuf, texture_outlives_destroyed_buffer_while_still_in_use)
+{
+    bind_dmabuf(3);
+    auto const surface = create_surface();
+    auto const buffer = create_buffer();
+    auto in_use = import(buffer, surface);
+
+    EXPECT_CALL(mock_gl, glDeleteTextures(_, _)).Times(0);
+    destroy_buffer(buffer);
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    EXPECT_CALL(mock_gl, glDeleteTextures(1, Pointee(textures_generated)));
+    in_use.reset();
+    wayland_executor->execute();
+}
+
+TEST_F(LinuxDmaBuf, global_offers_feedback_when_render_device_is_known)
+{
+    bind_dmabuf(4);
+
+    auto const messages = dispatch();
+    auto const global = std::find_if(
+        messages.begin(), messages.end(),
+        [this](auto const& message)
+        {
+            return message.object == registry_id && message.opcode == global_opcode &&
+                   message.args[0] == dmabuf_global_name;
+        });
+    ASSERT_THAT(global, Ne(messages.end()));
+    EXPECT_THAT(global->args.back(), Eq(4u));
+}
+
+TEST_F(LinuxDmaBuf, global_does_not_offer_feedback_when_render_device_is_unknown)
+{
+    ON_CALL(mock_egl, eglGetProcAddress(StrEq("eglQueryDisplayAttribEXT")))
+        .WillByDefault(Return(nullptr));
+    bind_dmabuf(3);
+
+    auto const messages = dispatch();
+    auto const global = std::find_if(
+        messages.begin(), messages.end(),
+        [this](auto const& message)
+        {
+            return message.object == registry_id && message.opcode == global_opcode &&
+                   message.args[0] == dmabuf_global_name;
+        });
+    ASSERT_THAT(global, Ne(messages.end()));
+    EXPECT_THAT(global->args.back(), Eq(3u));
+}
+
+TEST_F(LinuxDmaBuf, format_table_lists_every_format_and_modifier)
+{
+    struct TableEntry
+    {
+        uint32_t format;
+        uint32_t padding;
+        uint64_t modifier;
+    };
+
+    bind_dmabuf(4);
+    auto const feedback_id = create_feedback();
+    auto const feedback = feedback_from(dispatch(), feedback_id);
+
+    ASSERT_THAT(feedback, SizeIs(1));
+    ASSERT_THAT(raw_client->fds, SizeIs(1));
+    ASSERT_THAT(feedback[0].table_size, Eq(3 * sizeof(TableEntry)));
+
+    auto const mapping = mmap(nullptr, feedback[0].table_size, PROT_READ, MAP_PRIVATE, raw_client->fds[0], 0);
+    ASSERT_THAT(mapping, Ne(MAP_FAILED));
+    std::vector<TableEntry> table(3);
+    memcpy(table.data(), mapping, feedback[0].table_size);
+    munmap(mapping, feedback[0].table_size);
+
+    EXPECT_THAT(table[0].format, Eq(DRM_FORMAT_XRGB8888));
+    EXPECT_THAT(table[0].modifier, Eq(DRM_FORMAT_MOD_LINEAR));
+    EXPECT_THAT(table[1].format, Eq(DRM_FORMAT_XRGB8888));
+    EXPECT_THAT(table[1].modifier, Eq(I915_FORMAT_MOD_X_TILED));
+    EXPECT_THAT(table[2].format, Eq(DRM_FORMAT_ARGB8888));
+    EXPECT_THAT(table[2].modifier, Eq(DRM_FORMAT_MOD_LINEAR));
+}
+
+TEST_F(LinuxDmaBuf, default_feedback_has_only_the_render_tranche)
+{
+    bind_dmabuf(4);
+    auto const feedback_id = create_feedback();
+    auto const feedback = feedback_from(dispatch(), feedback_id);
+
+    ASSERT_THAT(feedback, SizeIs(1));
+    EXPECT_THAT(feedback[0].main_device, Eq(render_device_number()));
+    EXPECT_THAT(feedback[0].tranches, ElementsAre(TrancheOf(0, std::vector<uint16_t>{0, 1, 2})));
+}
+
+TEST_F(LinuxDmaBuf, surface_feedback_has_only_the_render_tranche_until_the_surface_could_be_scanned_out)
+{
+    bind_dmabuf(4);
+    auto const surface = create_surface();
+    auto const feedback_id = create_feedback(surface);
+    auto const feedback = feedback_from(dispatch(), feedback_id);
+
+    ASSERT_THAT(feedback, SizeIs(1));
+    EXPECT_THAT(feedback[0].tranches, ElementsAre(TrancheOf(0, std::vector<uint16_t>{0, 1, 2})));
+}
+
+TEST_F(LinuxDmaBuf, surface_feedback_is_resent_with_scanout_tranche_when_buffer_is_scanout_candidate)
+{
+    bind_dmabuf(4);
+    auto const surface = create_surface();
+    auto const feedback_id = create_feedback(surface);
+    dispatch();
+
+    auto const buffer = import(create_buffer(), surface);
+    dynamic_cast<mg::DMABufBuffer*>(buffer->native_buffer_base())->mark_scanout_candidate();
+    auto const feedback = feedback_from(dispatch(), feedback_id);
+
+    ASSERT_THAT(feedback, SizeIs(1));
+    EXPECT_THAT(feedback[0].main_device, Eq(render_device_number()));
+    EXPECT_THAT(
+        feedback[0].tranches,
+        ElementsAre(
+            TrancheOf(mw::LinuxDmabufFeedbackV1::TrancheFlags::scanout, std::vector<uint16_t>{1}),
+            TrancheOf(0, std::vector<uint16_t>{0, 1, 2})));
+}
+
+TEST_F(LinuxDmaBuf, scanout_candidate_surface_feedback_is_resent_only_once)
+{
+    bind_dmabuf(4);
+    auto const surface = create_surface();
+    auto const feedback_id = create_feedback(surface);
+    dispatch();
+
+    auto const buffer = create_buffer();
+    dynamic_cast<mg::DMABufBuffer*>(import(buffer, surface)->native_buffer_base())->mark_scanout_candidate();
+    dispatch();
+    dynamic_cast<mg::DMABufBuffer*>(import(buffer, surface)->native_buffer_base())->mark_scanout_candidate();
+
+    EXPECT_THAT(feedback_from(dispatch(), feedback_id), IsEmpty());
+}
+
+TEST_F(LinuxDmaBuf, new_feedback_for_scanout_candidate_surface_includes_scanout_tranche)
+{
+    bind_dmabuf(4);
+    auto const surface = create_surface();
+    auto const buffer = import(create_buffer(), surface);
+    dynamic_cast<mg::DMABufBuffer*>(buffer->native_buffer_base())->mark_scanout_candidate();
+    dispatch();
+
+    auto const feedback_id = create_feedback(surface);
+    auto const feedback = feedback_from(dispatch(), feedback_id);
+
+    ASSERT_THAT(feedback, SizeIs(1));
+    EXPECT_THAT(
+        feedback[0].tranches,
+        ElementsAre(
+            TrancheOf(mw::LinuxDmabufFeedbackV1::TrancheFlags::scanout, std::vector<uint16_t>{1}),
+            TrancheOf(0, std::vector<uint16_t>{0, 1, 2})));
+}
+
+TEST_F(LinuxDmaBuf, other_surfaces_feedback_is_unchanged_by_scanout_candidate)
+{
+    bind_dmabuf(4);
+    auto const surface = create_surface();
+    auto const other_surface = create_surface();
+    auto const other_feedback_id = create_feedback(other_surface);
+    dispatch();
+
+    auto const buffer = import(create_buffer(), surface);
+    dynamic_cast<mg::DMABufBuffer*>(buffer->native_buffer_base())->mark_scanout_candidate();
+
+    EXPECT_THAT(feedback_from(dispatch(), other_feedback_id), IsEmpty());
+}
@@ -353,3 +353,40 @@ TEST_F(ShmBufferTest, texture_is_destroyed_on_thread_with_current_context)
         eglMakeCurrent(dummy_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     }
 }
+
+TEST_F(ShmBufferTest, uploads_only_damaged_region_to_bound_texture)
+{
+    PlatformlessShmBuffer buf(size, mir_pixel_format_rgba_4444, egl_delegate);
+    int const bytes_per_pixel{MIR_BYTES_PER_PIXEL(mir_pixel_format_rgba_4444)};
+    geom::Rectangle const damage{{10, 20}, {30, 40}};
+
+    EXPECT_CALL(mock_gl, glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, size.width.as_int()));
+    EXPECT_CALL(mock_gl, glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0));
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, _)).Times(0);
+    EXPECT_CALL(
+        mock_gl,
+        glTexSubImage2D(
+            GL_TEXTURE_2D, 0,
+            10, 20,
+            30, 40,
+            GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4,
+            buf.pixel_buffer() + 20 * size.width.as_int() * bytes_per_pixel + 10 * bytes_per_pixel));
+
+    buf.upload_to_bound_texture(geom::Rectangles{damage});
+}
+
+TEST_F(ShmBufferTest, uploads_whole_buffer_to_bound_texture_without_damage)
+{
+    PlatformlessShmBuffer buf(size, mir_pixel_format_rgba_4444, egl_delegate);
+
+    EXPECT_CALL(mock_gl, glTexSubImage2D(_, _, _, _, _, _, _, _, _)).Times(0);
+    EXPECT_CALL(
+        mock_gl,
+        glTexImage2D(
+            GL_TEXTURE_2D, 0, GL_RGBA,
+            size.width.as_int(), size.height.as_int(),
+            0, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4,
+            buf.pixel_buffer()));
+
+    buf.upload_to_bound_texture(std::nullopt);
+}
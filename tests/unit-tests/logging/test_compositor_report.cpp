@@ -189,3 +189,51 @@ TEST_F(LoggingCompositorReport, bypass_has_no_render_time)
 
     report.stopped();
 }
+
+TEST_F(LoggingCompositorReport, reports_cpu_gpu_and_post_wait_times)
+{
+    const void* const id = "My Screen";
+
+    report.started();
+
+    for (int f = 0; f < 3; ++f)
+    {
+        report.began_frame(id);
+        clock->advance_by(chrono::microseconds(2000));
+        report.frame_cpu_time(id, chrono::microseconds(2000));
+        report.rendered_frame(id);
+        report.frame_gpu_time(id, chrono::microseconds(3500));
+        report.finished_frame(id);
+        report.frame_post_wait(id, chrono::microseconds(12000));
+        clock->advance_by(chrono::microseconds(1234567));
+    }
+    EXPECT_TRUE(recorder->last_message_contains("cpu 2.000 ms"))
+        << recorder->last_message();
+    EXPECT_TRUE(recorder->last_message_contains("gpu 3.500 ms"))
+        << recorder->last_message();
+    EXPECT_TRUE(recorder->last_message_contains("post wait 12.000 ms"))
+        << recorder->last_message();
+
+    report.stopped();
+}
+
+TEST_F(LoggingCompositorReport, omits_gpu_time_if_unknown)
+{
+    const void* const id = "My Screen";
+
+    report.started();
+
+    for (int f = 0; f < 3; ++f)
+    {
+        report.began_frame(id);
+        report.rendered_frame(id);
+        report.finished_frame(id);
+        clock->advance_by(chrono::microseconds(1234567));
+    }
+    EXPECT_TRUE(recorder->last_message_contains("averaged"))
+        << recorder->last_message();
+    EXPECT_FALSE(recorder->last_message_contains("gpu"))
+        << recorder->last_message();
+
+    report.stopped();
+}
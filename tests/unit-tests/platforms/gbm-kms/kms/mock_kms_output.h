@@ -30,6 +30,17 @@ namespace test
 
 struct MockKMSOutput : public graphics::gbm::KMSOutput
 {
+    MockKMSOutput()
+    {
+        using namespace testing;
+        ON_CALL(*this, assign_overlays_thunk(_, _))
+            .WillByDefault(Invoke(
+                [](auto const&, std::vector<graphics::gbm::OverlayLayer> const& candidates)
+                {
+                    return std::vector<bool>(candidates.size(), false);
+                }));
+    }
+
     MOCK_CONST_METHOD0(id, uint32_t());
     MOCK_METHOD0(reset, void());
     MOCK_METHOD2(configure, void(geometry::Displacement, size_t));
@@ -49,8 +60,30 @@ struct MockKMSOutput : public graphics::gbm::KMSOutput
         return schedule_page_flip_thunk(&fb);
     }
     MOCK_METHOD1(schedule_page_flip_thunk, bool(graphics::gbm::FBHandle const*));
+
+    bool schedule_async_page_flip(graphics::gbm::FBHandle const& fb) override
+    {
+        return schedule_async_page_flip_thunk(&fb);
+    }
+    MOCK_METHOD1(schedule_async_page_flip_thunk, bool(graphics::gbm::FBHandle const*));
     MOCK_METHOD0(wait_for_page_flip, void());
 
+    bool add_page_flip(graphics::gbm::AtomicPageFlip& flip, graphics::gbm::FBHandle const& fb) override
+    {
+        return add_page_flip_thunk(&flip, &fb);
+    }
+    MOCK_METHOD2(add_page_flip_thunk, bool(graphics::gbm::AtomicPageFlip*, graphics::gbm::FBHandle const*));
+    MOCK_METHOD1(commit_page_flips, bool(graphics::gbm::AtomicPageFlip&));
+
+    auto assign_overlays(
+        graphics::gbm::FBHandle const& fb,
+        std::vector<graphics::gbm::OverlayLayer> const& candidates) -> std::vector<bool> override
+    {
+        return assign_overlays_thunk(&fb, candidates);
+    }
+    MOCK_METHOD2(assign_overlays_thunk, std::vector<bool>(
+        graphics::gbm::FBHandle const*, std::vector<graphics::gbm::OverlayLayer> const&));
+
     MOCK_CONST_METHOD0(last_frame, graphics::Frame());
 
     MOCK_METHOD1(set_cursor, bool(gbm_bo*));
@@ -60,6 +93,8 @@ struct MockKMSOutput : public graphics::gbm::KMSOutput
 
     MOCK_METHOD1(set_power_mode, void(MirPowerMode));
     MOCK_METHOD1(set_gamma, void(mir::graphics::GammaCurves const&));
+    MOCK_METHOD1(set_vrr_enabled, void(bool));
+    MOCK_CONST_METHOD0(vrr_enabled, bool());
 
     MOCK_METHOD0(refresh_hardware_state, void());
     MOCK_CONST_METHOD1(update_from_hardware_state, void(graphics::DisplayConfigurationOutput&));
@@ -95,7 +95,7 @@ protected:
         display = platform->create_display(
             std::make_shared<mtd::NullDisplayConfigurationPolicy>(),
             std::make_shared<mtd::NullGLConfig>());
-        allocator.reset(new mgg::BufferAllocator(*display));
+        allocator.reset(new mgg::BufferAllocator(*display, {}));
     }
 
     // Defaults
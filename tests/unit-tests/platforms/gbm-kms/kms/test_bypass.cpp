@@ -267,3 +267,55 @@ TEST_F(BypassMatchTest, multimonitor_oversized_no_bypass)
     EXPECT_EQ(list.rend(), std::find_if(list.rbegin(), list.rend(), primary_matcher));
     EXPECT_EQ(list.rend(), std::find_if(list.rbegin(), list.rend(), secondary_matcher));
 }
+
+TEST_F(BypassMatchTest, small_window_is_overlay_candidate)
+{
+    auto window = std::make_shared<mtd::FakeRenderable>(1930, 20, 640, 480);
+    mg::RenderableList list{window};
+
+    auto const candidates = mgg::overlay_candidates(list, secondary_monitor);
+
+    ASSERT_EQ(1u, candidates.size());
+    EXPECT_EQ(window, candidates[0].renderable);
+    EXPECT_EQ((geom::Rectangle{{10, 20}, {640, 480}}), candidates[0].destination);
+}
+
+TEST_F(BypassMatchTest, overlapped_window_is_not_overlay_candidate)
+{
+    auto top = std::make_shared<mtd::FakeRenderable>(100, 100, 200, 200);
+    mg::RenderableList list{
+        std::make_shared<mtd::FakeRenderable>(0, 0, 640, 480),
+        top
+    };
+
+    auto const candidates = mgg::overlay_candidates(list, primary_monitor);
+
+    ASSERT_EQ(1u, candidates.size());
+    EXPECT_EQ(top, candidates[0].renderable);
+}
+
+TEST_F(BypassMatchTest, unsuitable_windows_are_not_overlay_candidates)
+{
+    mg::RenderableList list{
+        std::make_shared<mtd::FakeRenderable>(geom::Rectangle{{0, 0}, {100, 100}}, 0.5f),
+        std::make_shared<mtd::FakeRenderable>(geom::Rectangle{{200, 0}, {100, 100}}, 1.0f, false),
+        std::make_shared<mtd::FakeRenderable>(1900, 0, 100, 100)
+    };
+
+    EXPECT_TRUE(mgg::overlay_candidates(list, primary_monitor).empty());
+}
+
+TEST_F(BypassMatchTest, larger_overlay_candidates_come_first)
+{
+    auto small = std::make_shared<mtd::FakeRenderable>(0, 0, 100, 100);
+    auto large = std::make_shared<mtd::FakeRenderable>(500, 0, 800, 600);
+    auto medium = std::make_shared<mtd::FakeRenderable>(0, 500, 300, 300);
+    mg::RenderableList list{small, large, medium};
+
+    auto const candidates = mgg::overlay_candidates(list, primary_monitor);
+
+    ASSERT_EQ(3u, candidates.size());
+    EXPECT_EQ(large, candidates[0].renderable);
+    EXPECT_EQ(medium, candidates[1].renderable);
+    EXPECT_EQ(small, candidates[2].renderable);
+}
@@ -54,6 +54,7 @@ public:
     MOCK_CONST_METHOD0(modifier, std::optional<uint64_t>());
     MOCK_CONST_METHOD0(planes, std::vector<PlaneDescriptor> const&());
     MOCK_CONST_METHOD0(size, geometry::Size());
+    MOCK_METHOD0(mark_scanout_candidate, void());
 };
 }
 
@@ -242,6 +243,228 @@ TEST_F(MesaDisplayBufferTest, frames_requiring_gl_are_not_throttled)
     }
 }
 
+TEST_F(MesaDisplayBufferTest, reports_vblank_timing_of_last_page_flip)
+{
+    graphics::Frame flip;
+    flip.msc = 1234;
+    flip.ust = {CLOCK_MONOTONIC, std::chrono::seconds{5}};
+    ON_CALL(*mock_kms_output, last_frame())
+        .WillByDefault(Return(flip));
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    auto const timing = db.vblank_timing();
+    ASSERT_TRUE(timing);
+    EXPECT_THAT(timing->last_vblank.msc, Eq(flip.msc));
+    EXPECT_THAT(timing->last_vblank.ust, Eq(flip.ust));
+    EXPECT_THAT(timing->refresh_interval, Eq(std::chrono::nanoseconds{1000000000 / mock_refresh_rate}));
+}
+
+TEST_F(MesaDisplayBufferTest, reports_no_vblank_timing_before_first_page_flip)
+{
+    ON_CALL(*mock_kms_output, last_frame())
+        .WillByDefault(Return(graphics::Frame{}));
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_FALSE(db.vblank_timing());
+}
+
+TEST_F(MesaDisplayBufferTest, bypass_on_adaptive_sync_output_flips_on_client_commit)
+{
+    graphics::Frame flip;
+    flip.msc = 1234;
+    flip.ust = {CLOCK_MONOTONIC, std::chrono::seconds{5}};
+    ON_CALL(*mock_kms_output, last_frame())
+        .WillByDefault(Return(flip));
+    ON_CALL(*mock_kms_output, vrr_enabled())
+        .WillByDefault(Return(true));
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    ASSERT_TRUE(db.overlay(bypassable_list));
+    db.post();
+
+    EXPECT_FALSE(db.vblank_timing());
+    EXPECT_EQ(0, db.recommended_sleep().count());
+}
+
+TEST_F(MesaDisplayBufferTest, composited_frames_on_adaptive_sync_output_keep_vblank_timing)
+{
+    graphics::Frame flip;
+    flip.msc = 1234;
+    flip.ust = {CLOCK_MONOTONIC, std::chrono::seconds{5}};
+    ON_CALL(*mock_kms_output, last_frame())
+        .WillByDefault(Return(flip));
+    ON_CALL(*mock_kms_output, vrr_enabled())
+        .WillByDefault(Return(true));
+
+    graphics::RenderableList non_bypassable_list{
+        std::make_shared<FakeRenderable>(geometry::Rectangle{{12, 34}, {1, 1}})
+    };
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    ASSERT_TRUE(db.overlay(bypassable_list));
+    db.post();
+    ASSERT_FALSE(db.overlay(non_bypassable_list));
+    db.post();
+
+    EXPECT_TRUE(db.vblank_timing());
+}
+
+TEST_F(MesaDisplayBufferTest, bypass_of_client_allowing_tearing_flips_asynchronously)
+{
+    fake_bypassable_renderable->set_allow_tearing(true);
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(*mock_kms_output, schedule_async_page_flip_thunk(_))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_kms_output, add_page_flip_thunk(_, _))
+        .Times(0);
+    EXPECT_CALL(*mock_kms_output, schedule_page_flip_thunk(_))
+        .Times(0);
+
+    ASSERT_TRUE(db.overlay(bypassable_list));
+    db.post();
+
+    EXPECT_FALSE(db.vblank_timing());
+    EXPECT_EQ(0, db.recommended_sleep().count());
+}
+
+TEST_F(MesaDisplayBufferTest, falls_back_to_vsynced_flip_when_async_flip_fails)
+{
+    fake_bypassable_renderable->set_allow_tearing(true);
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(*mock_kms_output, schedule_async_page_flip_thunk(_))
+        .WillOnce(Return(false));
+    EXPECT_CALL(*mock_kms_output, schedule_page_flip_thunk(_))
+        .WillOnce(Return(true));
+
+    ASSERT_TRUE(db.overlay(bypassable_list));
+    db.post();
+}
+
+TEST_F(MesaDisplayBufferTest, composited_frames_never_flip_asynchronously)
+{
+    auto const small_renderable = std::make_shared<FakeRenderable>(geometry::Rectangle{{12, 34}, {1, 1}});
+    small_renderable->set_allow_tearing(true);
+    graphics::RenderableList non_bypassable_list{small_renderable};
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(*mock_kms_output, schedule_async_page_flip_thunk(_))
+        .Times(0);
+
+    ASSERT_FALSE(db.overlay(non_bypassable_list));
+    db.post();
+}
+
+TEST_F(MesaDisplayBufferTest, page_flips_with_atomic_commit_when_outputs_support_it)
+{
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(*mock_kms_output, add_page_flip_thunk(_, _))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_kms_output, commit_page_flips(_))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_kms_output, schedule_page_flip_thunk(_))
+        .Times(0);
+
+    db.post();
+}
+
+TEST_F(MesaDisplayBufferTest, falls_back_to_legacy_page_flip_when_atomic_commit_fails)
+{
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    ON_CALL(*mock_kms_output, add_page_flip_thunk(_, _))
+        .WillByDefault(Return(true));
+    EXPECT_CALL(*mock_kms_output, commit_page_flips(_))
+        .WillOnce(Return(false));
+    EXPECT_CALL(*mock_kms_output, schedule_page_flip_thunk(_))
+        .WillOnce(Return(true));
+
+    db.post();
+}
+
+TEST_F(MesaDisplayBufferTest, does_not_commit_atomically_when_an_output_cannot_join)
+{
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(*mock_kms_output, add_page_flip_thunk(_, _))
+        .WillOnce(Return(false));
+    EXPECT_CALL(*mock_kms_output, commit_page_flips(_))
+        .Times(0);
+    EXPECT_CALL(*mock_kms_output, schedule_page_flip_thunk(_))
+        .WillOnce(Return(true));
+
+    db.post();
+}
+
 TEST_F(MesaDisplayBufferTest, bypass_buffer_only_referenced_once_by_db)
 {
     graphics::gbm::DisplayBuffer db(
@@ -306,6 +529,23 @@ TEST_F(MesaDisplayBufferTest, failed_bypass_falls_back_gracefully)
     EXPECT_TRUE(db.overlay(bypassable_list));
 }
 
+TEST_F(MesaDisplayBufferTest, fullscreen_dmabuf_is_marked_scanout_candidate_even_if_kms_rejects_it)
+{
+    ON_CALL(*mock_kms_output, fb_for(A<DMABufBuffer const&>()))
+        .WillByDefault(Return(nullptr));
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(mock_dmabuf_buffer, mark_scanout_candidate());
+    EXPECT_FALSE(db.overlay(bypassable_list));
+}
+
 TEST_F(MesaDisplayBufferTest, skips_bypass_because_of_lagging_resize)
 {  // Another regression test for LP: #1398296
     auto fullscreen = std::make_shared<FakeRenderable>(display_area);
@@ -483,3 +723,190 @@ TEST_F(MesaDisplayBufferTest, skips_bypass_because_of_incompatible_list)
 
     EXPECT_FALSE(db.overlay(list));
 }
+
+TEST_F(MesaDisplayBufferTest, clones_on_one_device_scan_out_the_same_rendered_frame)
+{
+    auto const clone = std::make_shared<NiceMock<MockKMSOutput>>();
+    ON_CALL(*clone, schedule_page_flip_thunk(_))
+        .WillByDefault(Return(true));
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output, clone},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    FBHandle const* const rendered_fb = reinterpret_cast<FBHandle const*>(0x12ad);
+    EXPECT_CALL(mock_gbm, gbm_surface_lock_front_buffer(_))
+        .Times(1);
+    EXPECT_CALL(*clone, fb_for(A<gbm_bo*>()))
+        .Times(0);
+    EXPECT_CALL(*mock_kms_output, schedule_page_flip_thunk(rendered_fb))
+        .Times(1);
+    EXPECT_CALL(*clone, schedule_page_flip_thunk(rendered_fb))
+        .Times(1);
+
+    db.swap_buffers();
+    db.post();
+}
+
+TEST_F(MesaDisplayBufferTest, clones_on_different_devices_are_rendered_once)
+{
+    FBHandle const* const other_device_fb = reinterpret_cast<FBHandle const*>(0x34cd);
+    auto const clone = std::make_shared<NiceMock<MockKMSOutput>>();
+    ON_CALL(*clone, drm_fd())
+        .WillByDefault(Return(1));
+    ON_CALL(*clone, schedule_page_flip_thunk(_))
+        .WillByDefault(Return(true));
+    ON_CALL(*clone, fb_for(A<gbm_bo*>()))
+        .WillByDefault(Return(fake_shared_ptr<FBHandle>(0x34cd)));
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output, clone},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(mock_gbm, gbm_surface_lock_front_buffer(_))
+        .Times(1);
+    EXPECT_CALL(*mock_kms_output, schedule_page_flip_thunk(reinterpret_cast<FBHandle const*>(0x12ad)))
+        .Times(1);
+    EXPECT_CALL(*clone, schedule_page_flip_thunk(other_device_fb))
+        .Times(1);
+
+    db.swap_buffers();
+    db.post();
+}
+
+TEST_F(MesaDisplayBufferTest, clones_on_different_devices_cannot_bypass)
+{
+    auto const clone = std::make_shared<NiceMock<MockKMSOutput>>();
+    ON_CALL(*clone, drm_fd())
+        .WillByDefault(Return(1));
+    ON_CALL(*clone, fb_for(A<gbm_bo*>()))
+        .WillByDefault(Return(fake_shared_ptr<FBHandle>(0x34cd)));
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output, clone},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_FALSE(db.overlay(bypassable_list));
+}
+
+TEST_F(MesaDisplayBufferTest, renderables_assigned_to_overlay_planes_are_not_composited)
+{
+    auto const overlay_buffer = std::make_shared<NiceMock<MockBuffer>>();
+    ON_CALL(*overlay_buffer, size())
+        .WillByDefault(Return(geometry::Size{20, 20}));
+    ON_CALL(*overlay_buffer, native_buffer_base())
+        .WillByDefault(Return(&mock_dmabuf_buffer));
+    auto const overlay_renderable = std::make_shared<FakeRenderable>(22, 44, 20, 20);
+    overlay_renderable->set_buffer(overlay_buffer);
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    EXPECT_CALL(*mock_kms_output, assign_overlays_thunk(_, ElementsAre(
+            Field(&OverlayLayer::destination, Eq(geometry::Rectangle{{10, 10}, {20, 20}})))))
+        .WillOnce(Return(std::vector<bool>{true}));
+
+    mir::graphics::RenderableList list{fake_software_renderable, overlay_renderable};
+    auto const original_count = overlay_buffer.use_count();
+
+    EXPECT_FALSE(db.overlay_some(list));
+    EXPECT_THAT(list, ElementsAre(fake_software_renderable));
+
+    // The overlaid buffer must stay alive while it's on screen
+    db.swap_buffers();
+    db.post();
+    EXPECT_EQ(original_count+1, overlay_buffer.use_count());
+}
+
+TEST_F(MesaDisplayBufferTest, renderables_rejected_for_overlay_planes_are_composited)
+{
+    auto const overlay_buffer = std::make_shared<NiceMock<MockBuffer>>();
+    ON_CALL(*overlay_buffer, size())
+        .WillByDefault(Return(geometry::Size{20, 20}));
+    ON_CALL(*overlay_buffer, native_buffer_base())
+        .WillByDefault(Return(&mock_dmabuf_buffer));
+    auto const overlay_renderable = std::make_shared<FakeRenderable>(22, 44, 20, 20);
+    overlay_renderable->set_buffer(overlay_buffer);
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    mir::graphics::RenderableList list{fake_software_renderable, overlay_renderable};
+
+    EXPECT_FALSE(db.overlay_some(list));
+    EXPECT_THAT(list, ElementsAre(fake_software_renderable, overlay_renderable));
+}
+
+TEST_F(MesaDisplayBufferTest, overlay_candidates_are_marked_scanout_candidates)
+{
+    auto const overlay_buffer = std::make_shared<NiceMock<MockBuffer>>();
+    ON_CALL(*overlay_buffer, size())
+        .WillByDefault(Return(geometry::Size{20, 20}));
+    ON_CALL(*overlay_buffer, native_buffer_base())
+        .WillByDefault(Return(&mock_dmabuf_buffer));
+    auto const overlay_renderable = std::make_shared<FakeRenderable>(22, 44, 20, 20);
+    overlay_renderable->set_buffer(overlay_buffer);
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    mir::graphics::RenderableList list{fake_software_renderable, overlay_renderable};
+
+    EXPECT_CALL(mock_dmabuf_buffer, mark_scanout_candidate());
+    db.overlay_some(list);
+}
+
+TEST_F(MesaDisplayBufferTest, fullscreen_buffer_with_overlays_above_it_is_bypassed)
+{
+    auto const overlay_buffer = std::make_shared<NiceMock<MockBuffer>>();
+    ON_CALL(*overlay_buffer, size())
+        .WillByDefault(Return(geometry::Size{20, 20}));
+    ON_CALL(*overlay_buffer, native_buffer_base())
+        .WillByDefault(Return(&mock_dmabuf_buffer));
+    auto const overlay_renderable = std::make_shared<FakeRenderable>(22, 44, 20, 20);
+    overlay_renderable->set_buffer(overlay_buffer);
+
+    graphics::gbm::DisplayBuffer db(
+        graphics::gbm::BypassOption::allowed,
+        null_display_report(),
+        {mock_kms_output},
+        make_output_surface(),
+        display_area,
+        identity);
+
+    auto const bypass_fb = reinterpret_cast<FBHandle const*>(0xe0e0);
+    EXPECT_CALL(*mock_kms_output, assign_overlays_thunk(bypass_fb, SizeIs(1)))
+        .WillOnce(Return(std::vector<bool>{true}));
+
+    mir::graphics::RenderableList list{fake_bypassable_renderable, overlay_renderable};
+
+    EXPECT_FALSE(db.overlay(list));
+    EXPECT_TRUE(db.overlay_some(list));
+}
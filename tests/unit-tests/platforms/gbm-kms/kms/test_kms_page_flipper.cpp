@@ -17,6 +17,7 @@
  */
 
 #include "src/platforms/gbm-kms/server/kms/kms_page_flipper.h"
+#include "src/platforms/gbm-kms/server/kms/atomic_page_flip.h"
 
 #include "mir/test/doubles/mock_drm.h"
 #include "mir/test/doubles/mock_display_report.h"
@@ -29,6 +30,8 @@
 #include <stdexcept>
 #include <atomic>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <unordered_set>
 
 #include <sys/time.h>
@@ -69,6 +72,33 @@ ACTION_P(InvokePageFlipHandler, param)
     ASSERT_EQ(1, read(arg0, &dummy, 1));
 }
 
+ACTION_P2(InvokePageFlipHandler2, param, crtc_id)
+{
+    int const dont_care{0};
+    char dummy;
+
+    arg1->page_flip_handler2(dont_care, dont_care, dont_care, dont_care, crtc_id, *param);
+    ASSERT_EQ(1, read(arg0, &dummy, 1));
+}
+
+class AtomicKMSPageFlipperTest : public KMSPageFlipperTest
+{
+public:
+    AtomicKMSPageFlipperTest()
+    {
+        using namespace testing;
+
+        ON_CALL(mock_drm, drmGetCap(drm_fd, DRM_CAP_CRTC_IN_VBLANK_EVENT, _))
+            .WillByDefault(DoAll(SetArgPointee<2>(1), Return(0)));
+        ON_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, _, _))
+            .WillByDefault(Return(0));
+
+        atomic_page_flipper = std::make_unique<mgg::KMSPageFlipper>(drm_fd, mt::fake_shared(report));
+    }
+
+    std::unique_ptr<mgg::KMSPageFlipper> atomic_page_flipper;
+};
+
 }
 
 TEST_F(KMSPageFlipperTest, schedule_flip_calls_drm_page_flip)
@@ -180,11 +210,11 @@ TEST_F(KMSPageFlipperTest, failure_in_wait_for_flip_throws)
     EXPECT_CALL(mock_drm, drmHandleEvent(_, _))
         .Times(0);
 
-    page_flipper.schedule_flip(crtc_id, fb_id, connector_id);
-
-    /* Cause a failure in wait_for_flip */
+    /* Cause a failure in waiting for the flip event */
     close(drm_fd);
 
+    page_flipper.schedule_flip(crtc_id, fb_id, connector_id);
+
     EXPECT_THROW({
         page_flipper.wait_for_flip(crtc_id);
     }, std::runtime_error);
@@ -274,134 +304,78 @@ private:
 
 }
 
-TEST_F(KMSPageFlipperTest, threads_switch_worker)
+TEST_F(KMSPageFlipperTest, page_flip_events_are_handled_without_waiting)
 {
     using namespace testing;
 
-    size_t const worker_index{0};
-    size_t const other_index{1};
-    std::vector<uint32_t> const crtc_ids{10, 11};
-    std::vector<void*> user_data{nullptr, nullptr};
-    std::vector<std::unique_ptr<PageFlippingFunctor>> page_flipping_functors;
-    std::vector<std::thread> page_flipping_threads;
-    std::thread::id tid;
-
-    EXPECT_CALL(mock_drm, drmModePageFlip(drm_fd, _, _, _, _))
-        .Times(2)
-        .WillOnce(DoAll(SaveArg<4>(&user_data[worker_index]), Return(0)))
-        .WillOnce(DoAll(SaveArg<4>(&user_data[other_index]), Return(0)));
-
-    /*
-     * The first event releases the original worker, hence we expect that
-     * then the other thread will become the worker.
-     */
-    EXPECT_CALL(mock_drm, drmHandleEvent(drm_fd, _))
-        .Times(2)
-        .WillOnce(DoAll(InvokePageFlipHandler(&user_data[worker_index]), Return(0)))
-        .WillOnce(DoAll(InvokePageFlipHandler(&user_data[other_index]), Return(0)));
-
-    /* Start the page-flipping threads */
-    for (auto crtc_id : crtc_ids)
-    {
-        auto pf = std::unique_ptr<PageFlippingFunctor>(new PageFlippingFunctor{page_flipper, crtc_id});
-        page_flipping_functors.push_back(std::move(pf));
-        page_flipping_threads.push_back(std::thread{std::ref(*page_flipping_functors.back())});
-
-        /* Wait for page-flip request and tell flipper to stop after this iteration */
-        while (page_flipping_functors.back()->page_flip_count() == 0)
-            std::this_thread::sleep_for(std::chrono::milliseconds{1});
-        page_flipping_functors.back()->stop();
-
-        /* Wait until the (first) thread has become the worker */
-        while (tid == std::thread::id())
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds{1});
-            tid = page_flipper.debug_get_worker_tid();
-        }
-    }
-
-    EXPECT_EQ(page_flipping_threads[worker_index].get_id(), tid);
-
-    /* Fake a DRM event */
-    mock_drm.generate_event_on(drm_device);
+    uint32_t const crtc_id{10};
+    uint32_t const fb_id{101};
+    uint32_t const connector_id{345};
+    void* user_data{nullptr};
+    std::mutex reported_mutex;
+    std::condition_variable reported_cv;
+    bool reported{false};
 
-    page_flipping_threads[worker_index].join();
+    ON_CALL(mock_drm, drmModePageFlip(_, _, _, _, _))
+        .WillByDefault(DoAll(SaveArg<4>(&user_data), Return(0)));
+    ON_CALL(mock_drm, drmHandleEvent(_, _))
+        .WillByDefault(DoAll(InvokePageFlipHandler(&user_data), Return(0)));
 
-    /* Wait for the worker to switch */
-    while (tid != page_flipping_threads[other_index].get_id())
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds{1});
-        tid = page_flipper.debug_get_worker_tid();
-    }
+    EXPECT_CALL(report, report_vsync(connector_id, _))
+        .WillOnce(InvokeWithoutArgs(
+            [&]()
+            {
+                std::lock_guard<std::mutex> lock{reported_mutex};
+                reported = true;
+                reported_cv.notify_all();
+            }));
 
-    /* Fake another DRM event to unblock the remaining thread */
+    page_flipper.schedule_flip(crtc_id, fb_id, connector_id);
     mock_drm.generate_event_on(drm_device);
 
-    page_flipping_threads[other_index].join();
+    /* The flip is reported when it happens, not when someone next waits for it */
+    std::unique_lock<std::mutex> lock{reported_mutex};
+    EXPECT_TRUE(reported_cv.wait_for(lock, std::chrono::seconds{10}, [&] { return reported; }));
 }
 
-TEST_F(KMSPageFlipperTest, threads_worker_notifies_non_worker)
+TEST_F(KMSPageFlipperTest, waiting_for_one_crtc_does_not_delay_another)
 {
     using namespace testing;
 
-    size_t const worker_index{0};
-    size_t const other_index{1};
     std::vector<uint32_t> const crtc_ids{10, 11};
     std::vector<void*> user_data{nullptr, nullptr};
-    std::vector<std::unique_ptr<PageFlippingFunctor>> page_flipping_functors;
-    std::vector<std::thread> page_flipping_threads;
-    std::thread::id tid;
+    std::atomic<bool> first_flipped{false};
 
     EXPECT_CALL(mock_drm, drmModePageFlip(drm_fd, _, _, _, _))
         .Times(2)
-        .WillOnce(DoAll(SaveArg<4>(&user_data[worker_index]), Return(0)))
-        .WillOnce(DoAll(SaveArg<4>(&user_data[other_index]), Return(0)));
+        .WillOnce(DoAll(SaveArg<4>(&user_data[0]), Return(0)))
+        .WillOnce(DoAll(SaveArg<4>(&user_data[1]), Return(0)));
 
-    /*
-     * The first event releases the non-worker thread, hence we expect that
-     * original worker not change.
-     */
+    /* The second CRTC's flip completes first */
     EXPECT_CALL(mock_drm, drmHandleEvent(drm_fd, _))
         .Times(2)
-        .WillOnce(DoAll(InvokePageFlipHandler(&user_data[other_index]), Return(0)))
-        .WillOnce(DoAll(InvokePageFlipHandler(&user_data[worker_index]), Return(0)));
+        .WillOnce(DoAll(InvokePageFlipHandler(&user_data[1]), Return(0)))
+        .WillOnce(DoAll(InvokePageFlipHandler(&user_data[0]), Return(0)));
 
-    /* Start the page-flipping threads */
     for (auto crtc_id : crtc_ids)
-    {
-        auto pf = std::unique_ptr<PageFlippingFunctor>(new PageFlippingFunctor{page_flipper, crtc_id});
-        page_flipping_functors.push_back(std::move(pf));
-        page_flipping_threads.push_back(std::thread{std::ref(*page_flipping_functors.back())});
+        page_flipper.schedule_flip(crtc_id, 0, 987);
 
-        /* Wait for page-flip request and tell flipper to stop after this iteration */
-        while (page_flipping_functors.back()->page_flip_count() == 0)
-            std::this_thread::sleep_for(std::chrono::milliseconds{1});
-        page_flipping_functors.back()->stop();
-
-        /* Wait until the (first) thread has become the worker */
-        while (tid == std::thread::id())
+    std::thread first_waiter{
+        [&]()
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds{1});
-            tid = page_flipper.debug_get_worker_tid();
-        }
-    }
+            page_flipper.wait_for_flip(crtc_ids[0]);
+            first_flipped = true;
+        }};
 
-    EXPECT_EQ(page_flipping_threads[worker_index].get_id(), tid);
-
-    /* Fake a DRM event */
     mock_drm.generate_event_on(drm_device);
+    page_flipper.wait_for_flip(crtc_ids[1]);
 
-    /* Wait for the non-worker thread to exit */
-    page_flipping_threads[other_index].join();
+    EXPECT_FALSE(first_flipped);
 
-    /* Check that the worker hasn't changed */
-    EXPECT_EQ(page_flipping_threads[worker_index].get_id(),
-              page_flipper.debug_get_worker_tid());
-
-    /* Fake another DRM event to unblock the remaining thread */
     mock_drm.generate_event_on(drm_device);
+    first_waiter.join();
 
-    page_flipping_threads[worker_index].join();
+    EXPECT_TRUE(first_flipped);
 }
 
 namespace
@@ -581,3 +555,137 @@ TEST_F(KMSPageFlipperTest, threads_concurrent_page_flips_dont_deadlock)
     EXPECT_EQ(counter.count_flips(), counter.count_handle_events());
     EXPECT_TRUE(counter.no_consecutive_flips_for_same_crtc_id());
 }
+
+TEST_F(KMSPageFlipperTest, atomic_flip_is_not_used_without_crtc_in_vblank_events)
+{
+    using namespace testing;
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, _, _))
+        .Times(0);
+
+    mgg::AtomicPageFlip flip;
+    flip.add_flip(10, 345);
+
+    EXPECT_FALSE(page_flipper.schedule_atomic_flip(flip));
+}
+
+TEST_F(AtomicKMSPageFlipperTest, atomic_flip_is_tested_then_committed_nonblocking)
+{
+    using namespace testing;
+
+    mgg::AtomicPageFlip flip;
+    flip.add_flip(10, 345);
+    flip.add_flip(11, 346);
+
+    InSequence seq;
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, flip.request(), DRM_MODE_ATOMIC_TEST_ONLY, _));
+    EXPECT_CALL(
+        mock_drm,
+        drmModeAtomicCommit(drm_fd, flip.request(), DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, NotNull()));
+
+    EXPECT_TRUE(atomic_page_flipper->schedule_atomic_flip(flip));
+}
+
+TEST_F(AtomicKMSPageFlipperTest, committed_atomic_flip_runs_commit_callbacks)
+{
+    bool committed{false};
+
+    mgg::AtomicPageFlip flip;
+    flip.add_flip(10, 345);
+    flip.on_commit([&committed] { committed = true; });
+
+    EXPECT_TRUE(atomic_page_flipper->schedule_atomic_flip(flip));
+    EXPECT_TRUE(committed);
+}
+
+TEST_F(AtomicKMSPageFlipperTest, rejected_atomic_flip_leaves_nothing_pending)
+{
+    using namespace testing;
+
+    uint32_t const crtc_id{10};
+    uint32_t const fb_id{101};
+    uint32_t const connector_id{345};
+    bool committed{false};
+
+    mgg::AtomicPageFlip flip;
+    flip.add_flip(crtc_id, connector_id);
+    flip.on_commit([&committed] { committed = true; });
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, DRM_MODE_ATOMIC_TEST_ONLY, _))
+        .WillOnce(Return(-EINVAL));
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, _))
+        .Times(0);
+
+    EXPECT_FALSE(atomic_page_flipper->schedule_atomic_flip(flip));
+    EXPECT_FALSE(committed);
+
+    // The caller falls back to a legacy flip of the same CRTC
+    EXPECT_NO_THROW(atomic_page_flipper->schedule_flip(crtc_id, fb_id, connector_id));
+}
+
+TEST_F(AtomicKMSPageFlipperTest, wait_for_flip_handles_atomic_drm_event)
+{
+    using namespace testing;
+
+    uint32_t const crtc_id{10};
+    uint32_t const connector_id{345};
+    void* user_data{nullptr};
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, DRM_MODE_ATOMIC_TEST_ONLY, _))
+        .WillOnce(Return(0));
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(drm_fd, _, DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, _))
+        .WillOnce(DoAll(SaveArg<3>(&user_data), Return(0)));
+
+    EXPECT_CALL(mock_drm, drmHandleEvent(drm_fd, _))
+        .WillOnce(DoAll(InvokePageFlipHandler2(&user_data, crtc_id), Return(0)));
+
+    mgg::AtomicPageFlip flip;
+    flip.add_flip(crtc_id, connector_id);
+    ASSERT_TRUE(atomic_page_flipper->schedule_atomic_flip(flip));
+
+    /* Fake a DRM event */
+    mock_drm.generate_event_on(drm_device);
+
+    atomic_page_flipper->wait_for_flip(crtc_id);
+
+    // The flip has completed, so the CRTC can be flipped again
+    EXPECT_NO_THROW(atomic_page_flipper->schedule_flip(crtc_id, 101, connector_id));
+}
+
+TEST_F(KMSPageFlipperTest, schedule_async_flip_requests_async_drm_page_flip_when_supported)
+{
+    using namespace testing;
+
+    uint32_t const crtc_id{10};
+    uint32_t const fb_id{101};
+    uint32_t const connector_id{345};
+
+    ON_CALL(mock_drm, drmGetCap(drm_fd, DRM_CAP_ASYNC_PAGE_FLIP, _))
+        .WillByDefault(DoAll(SetArgPointee<2>(1), Return(0)));
+    mgg::KMSPageFlipper async_page_flipper{drm_fd, mt::fake_shared(report)};
+
+    EXPECT_CALL(mock_drm, drmModePageFlip(drm_fd, crtc_id, fb_id, DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_PAGE_FLIP_ASYNC, _))
+        .WillOnce(Return(0));
+
+    EXPECT_TRUE(async_page_flipper.schedule_async_flip(crtc_id, fb_id, connector_id));
+}
+
+TEST_F(KMSPageFlipperTest, schedule_async_flip_does_nothing_when_unsupported)
+{
+    using namespace testing;
+
+    uint32_t const crtc_id{10};
+    uint32_t const fb_id{101};
+    uint32_t const connector_id{345};
+
+    EXPECT_CALL(mock_drm, drmModePageFlip(_, _, _, _, _))
+        .Times(0);
+
+    EXPECT_FALSE(page_flipper.schedule_async_flip(crtc_id, fb_id, connector_id));
+
+    // Nothing is pending, so the caller can fall back to a vsynced flip
+    Mock::VerifyAndClearExpectations(&mock_drm);
+    EXPECT_CALL(mock_drm, drmModePageFlip(drm_fd, crtc_id, fb_id, DRM_MODE_PAGE_FLIP_EVENT, _))
+        .WillOnce(Return(0));
+    EXPECT_TRUE(page_flipper.schedule_flip(crtc_id, fb_id, connector_id));
+}
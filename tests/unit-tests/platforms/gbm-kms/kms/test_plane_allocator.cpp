@@ -0,0 +1,384 @@
+/*
+ * Copyright © 2021 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/platforms/gbm-kms/server/kms/plane_allocator.h"
+#include "src/platforms/gbm-kms/server/kms/atomic_page_flip.h"
+
+#include "mir/test/doubles/mock_drm.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <array>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <optional>
+
+namespace mg = mir::graphics;
+namespace mgg = mir::graphics::gbm;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+using namespace testing;
+
+namespace
+{
+uint32_t const crtc_id{10};
+int const crtc_index{0};
+uint32_t const primary_plane{39};
+uint32_t const overlay_planes[]{40, 41};
+uint32_t const other_crtc_plane{42};
+
+char const* const plane_property_names[]{
+    "type", "FB_ID", "CRTC_ID",
+    "SRC_X", "SRC_Y", "SRC_W", "SRC_H",
+    "CRTC_X", "CRTC_Y", "CRTC_W", "CRTC_H"};
+size_t const plane_property_count{std::size(plane_property_names)};
+
+auto property_id(uint32_t plane_id, char const* name) -> uint32_t
+{
+    for (auto i = 0u; i != plane_property_count; ++i)
+    {
+        if (strcmp(plane_property_names[i], name) == 0)
+            return plane_id * 100 + i;
+    }
+    throw std::logic_error{"No such plane property"};
+}
+
+/// The properties of one atomic request, keyed by (object, property)
+using Request = std::map<std::pair<uint32_t, uint32_t>, uint64_t>;
+
+auto fb_on(Request const& request, uint32_t plane_id) -> std::optional<uint64_t>
+{
+    auto const i = request.find({plane_id, property_id(plane_id, "FB_ID")});
+    if (i == request.end())
+        return std::nullopt;
+    return i->second;
+}
+
+auto crtc_on(Request const& request, uint32_t plane_id) -> std::optional<uint64_t>
+{
+    auto const i = request.find({plane_id, property_id(plane_id, "CRTC_ID")});
+    if (i == request.end())
+        return std::nullopt;
+    return i->second;
+}
+
+class PlaneAllocatorTest : public ::testing::Test
+{
+public:
+    PlaneAllocatorTest()
+    {
+        plane_ids = {primary_plane, overlay_planes[0], overlay_planes[1], other_crtc_plane};
+        plane_res.count_planes = plane_ids.size();
+        plane_res.planes = plane_ids.data();
+
+        for (auto id : plane_ids)
+        {
+            auto& plane = planes[id];
+            plane.plane_id = id;
+            plane.possible_crtcs = id == other_crtc_plane ? 0x3 : 1u << crtc_index;
+
+            auto& props = plane_props[id];
+            for (auto i = 0u; i != plane_property_count; ++i)
+            {
+                props.ids[i] = id * 100 + i;
+                props.values[i] = 0;
+
+                auto& property = properties[props.ids[i]];
+                property.prop_id = props.ids[i];
+                strncpy(property.name, plane_property_names[i], sizeof(property.name) - 1);
+            }
+            props.values[0] = id == primary_plane ? DRM_PLANE_TYPE_PRIMARY : DRM_PLANE_TYPE_OVERLAY;
+            props.res.count_props = plane_property_count;
+            props.res.props = props.ids.data();
+            props.res.prop_values = props.values.data();
+        }
+
+        ON_CALL(mock_drm, drmModeGetPlaneResources(_))
+            .WillByDefault(Return(&plane_res));
+        ON_CALL(mock_drm, drmModeGetPlane(_, _))
+            .WillByDefault(Invoke([this](int, uint32_t id) { return &planes.at(id); }));
+        ON_CALL(mock_drm, drmModeObjectGetProperties(_, _, DRM_MODE_OBJECT_PLANE))
+            .WillByDefault(Invoke([this](int, uint32_t id, uint32_t) { return &plane_props.at(id).res; }));
+        ON_CALL(mock_drm, drmModeGetProperty(_, _))
+            .WillByDefault(Invoke([this](int, uint32_t id) { return &properties.at(id); }));
+
+        ON_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+            .WillByDefault(
+                Invoke(
+                    [this](drmModeAtomicReqPtr req, uint32_t object_id, uint32_t property_id, uint64_t value)
+                    {
+                        requests[req][{object_id, property_id}] = value;
+                        return 0;
+                    }));
+        ON_CALL(mock_drm, drmModeAtomicFree(_))
+            .WillByDefault(
+                Invoke(
+                    [this](drmModeAtomicReqPtr req)
+                    {
+                        requests.erase(req);
+                        delete reinterpret_cast<char*>(req);
+                    }));
+        ON_CALL(mock_drm, drmModeAtomicCommit(_, _, DRM_MODE_ATOMIC_TEST_ONLY, _))
+            .WillByDefault(
+                Invoke(
+                    [this](int, drmModeAtomicReqPtr req, uint32_t, void*)
+                    {
+                        return kernel_accepts(requests[req]) ? 0 : -EINVAL;
+                    }));
+    }
+
+    auto layer(uint32_t fb_id, geom::Rectangle destination = {{100, 100}, {64, 64}}) -> mgg::PlaneAllocator::Layer
+    {
+        return {fb_id, destination.size, destination};
+    }
+
+    void add_primary(mgg::AtomicPageFlip& flip)
+    {
+        flip.add_property(primary_plane, property_id(primary_plane, "FB_ID"), primary_fb);
+    }
+
+    /// Add the allocator's state to a flip, and commit it
+    auto commit(mgg::PlaneAllocator& allocator) -> Request
+    {
+        mgg::AtomicPageFlip flip;
+        allocator.add_to(flip);
+        auto const request = requests[flip.request()];
+        flip.committed();
+        return request;
+    }
+
+    NiceMock<mtd::MockDRM> mock_drm;
+    int const drm_fd{42};
+    uint32_t const primary_fb{1};
+
+    std::function<bool(Request const&)> kernel_accepts{[](auto const&) { return true; }};
+
+    std::function<void(mgg::AtomicPageFlip&)> const primary{[this](auto& flip) { add_primary(flip); }};
+
+    std::vector<uint32_t> plane_ids;
+    drmModePlaneRes plane_res{};
+    std::map<uint32_t, drmModePlane> planes;
+    struct PlaneProperties
+    {
+        drmModeObjectProperties res{};
+        std::array<uint32_t, plane_property_count> ids;
+        std::array<uint64_t, plane_property_count> values;
+    };
+    std::map<uint32_t, PlaneProperties> plane_props;
+    std::map<uint32_t, drmModePropertyRes> properties;
+    std::map<drmModeAtomicReqPtr, Request> requests;
+};
+}
+
+TEST_F(PlaneAllocatorTest, uses_only_overlay_planes_exclusive_to_the_crtc)
+{
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    EXPECT_THAT(allocator.plane_count(), Eq(2u));
+}
+
+TEST_F(PlaneAllocatorTest, candidate_is_tested_with_the_primary_plane)
+{
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, DRM_MODE_ATOMIC_TEST_ONLY, _))
+        .WillOnce(
+            Invoke(
+                [this](int, drmModeAtomicReqPtr req, uint32_t, void*)
+                {
+                    EXPECT_THAT(fb_on(requests[req], primary_plane), Eq(primary_fb));
+                    EXPECT_THAT(fb_on(requests[req], overlay_planes[0]), Eq(100u));
+                    return 0;
+                }));
+
+    EXPECT_THAT(allocator.assign(primary, {layer(100)}), ElementsAre(true));
+}
+
+TEST_F(PlaneAllocatorTest, candidate_rejected_by_one_plane_is_tried_on_the_next)
+{
+    kernel_accepts = [](Request const& request) { return !fb_on(request, overlay_planes[0]); };
+
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, DRM_MODE_ATOMIC_TEST_ONLY, _)).Times(2);
+
+    EXPECT_THAT(allocator.assign(primary, {layer(100)}), ElementsAre(true));
+
+    auto const shown = commit(allocator);
+    EXPECT_THAT(fb_on(shown, overlay_planes[0]), Eq(std::nullopt));
+    EXPECT_THAT(fb_on(shown, overlay_planes[1]), Eq(100u));
+    EXPECT_THAT(crtc_on(shown, overlay_planes[1]), Eq(crtc_id));
+}
+
+TEST_F(PlaneAllocatorTest, candidate_rejected_by_every_plane_is_not_assigned)
+{
+    kernel_accepts = [](Request const& request)
+        {
+            return !fb_on(request, overlay_planes[0]) && !fb_on(request, overlay_planes[1]);
+        };
+
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    EXPECT_THAT(allocator.assign(primary, {layer(100), layer(101)}), ElementsAre(false, false));
+
+    auto const shown = commit(allocator);
+    EXPECT_THAT(shown, IsEmpty());
+}
+
+TEST_F(PlaneAllocatorTest, candidates_beyond_the_planes_available_are_not_assigned)
+{
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    EXPECT_THAT(
+        allocator.assign(
+            primary,
+            {layer(100, {{0, 0}, {10, 10}}), layer(101, {{20, 0}, {10, 10}}), layer(102, {{40, 0}, {10, 10}})}),
+        ElementsAre(true, true, false));
+}
+
+TEST_F(PlaneAllocatorTest, planes_no_longer_used_are_disabled)
+{
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    allocator.assign(primary, {layer(100)});
+    commit(allocator);
+
+    allocator.assign(primary, {});
+    auto const shown = commit(allocator);
+
+    EXPECT_THAT(fb_on(shown, overlay_planes[0]), Eq(0u));
+    EXPECT_THAT(crtc_on(shown, overlay_planes[0]), Eq(0u));
+    EXPECT_THAT(fb_on(shown, overlay_planes[1]), Eq(std::nullopt));
+}
+
+TEST_F(PlaneAllocatorTest, planes_are_not_disabled_again)
+{
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    allocator.assign(primary, {layer(100)});
+    commit(allocator);
+    commit(allocator);
+
+    auto const shown = commit(allocator);
+
+    EXPECT_THAT(shown, IsEmpty());
+}
+
+TEST_F(PlaneAllocatorTest, planes_left_showing_are_disabled_without_atomic_commit)
+{
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    allocator.assign(primary, {layer(100)});
+    commit(allocator);
+
+    EXPECT_CALL(mock_drm, drmModeSetPlane(_, overlay_planes[0], crtc_id, 0, _, _, _, _, _, _, _, _, _));
+    EXPECT_CALL(mock_drm, drmModeSetPlane(_, overlay_planes[1], _, _, _, _, _, _, _, _, _, _, _)).Times(0);
+
+    allocator.disable_legacy();
+}
+
+TEST_F(PlaneAllocatorTest, unchanged_layout_is_retested_with_a_single_commit)
+{
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    allocator.assign(primary, {layer(100, {{0, 0}, {10, 10}}), layer(101, {{20, 0}, {10, 10}})});
+    commit(allocator);
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, DRM_MODE_ATOMIC_TEST_ONLY, _))
+        .WillOnce(
+            Invoke(
+                [this](int, drmModeAtomicReqPtr req, uint32_t, void*)
+                {
+                    EXPECT_THAT(fb_on(requests[req], overlay_planes[0]), Eq(200u));
+                    EXPECT_THAT(fb_on(requests[req], overlay_planes[1]), Eq(201u));
+                    return 0;
+                }));
+
+    EXPECT_THAT(
+        allocator.assign(primary, {layer(200, {{0, 0}, {10, 10}}), layer(201, {{20, 0}, {10, 10}})}),
+        ElementsAre(true, true));
+}
+
+TEST_F(PlaneAllocatorTest, changed_layout_is_searched_again)
+{
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    allocator.assign(primary, {layer(100, {{0, 0}, {10, 10}})});
+    commit(allocator);
+
+    // The moved candidate is tried on the first plane again
+    kernel_accepts = [](Request const& request) { return fb_on(request, overlay_planes[0]).value_or(0) == 0; };
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, DRM_MODE_ATOMIC_TEST_ONLY, _)).Times(2);
+
+    EXPECT_THAT(allocator.assign(primary, {layer(100, {{5, 0}, {10, 10}})}), ElementsAre(true));
+
+    auto const shown = commit(allocator);
+    EXPECT_THAT(fb_on(shown, overlay_planes[0]), Eq(0u));
+    EXPECT_THAT(fb_on(shown, overlay_planes[1]), Eq(100u));
+}
+
+TEST_F(PlaneAllocatorTest, failed_retest_falls_back_to_searching)
+{
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    allocator.assign(primary, {layer(100)});
+    commit(allocator);
+
+    // The new buffer can't go on the first plane, but can on the second
+    kernel_accepts = [](Request const& request) { return fb_on(request, overlay_planes[0]) != 200u; };
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, DRM_MODE_ATOMIC_TEST_ONLY, _)).Times(3);
+
+    EXPECT_THAT(allocator.assign(primary, {layer(200)}), ElementsAre(true));
+
+    auto const shown = commit(allocator);
+    EXPECT_THAT(fb_on(shown, overlay_planes[1]), Eq(200u));
+}
+
+TEST_F(PlaneAllocatorTest, rejected_buffer_is_not_retried_while_layout_is_unchanged)
+{
+    kernel_accepts = [](Request const& request)
+        {
+            return !fb_on(request, overlay_planes[0]) && !fb_on(request, overlay_planes[1]);
+        };
+
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    allocator.assign(primary, {layer(100)});
+    commit(allocator);
+
+    EXPECT_CALL(mock_drm, drmModeAtomicCommit(_, _, DRM_MODE_ATOMIC_TEST_ONLY, _)).Times(0);
+
+    EXPECT_THAT(allocator.assign(primary, {layer(100)}), ElementsAre(false));
+}
+
+TEST_F(PlaneAllocatorTest, new_buffer_is_tried_even_if_an_earlier_one_was_rejected)
+{
+    kernel_accepts = [](Request const& request)
+        {
+            return fb_on(request, overlay_planes[0]).value_or(0) != 100u &&
+                   fb_on(request, overlay_planes[1]).value_or(0) != 100u;
+        };
+
+    mgg::PlaneAllocator allocator{drm_fd, crtc_id, crtc_index};
+
+    EXPECT_THAT(allocator.assign(primary, {layer(100)}), ElementsAre(false));
+    commit(allocator);
+
+    EXPECT_THAT(allocator.assign(primary, {layer(101)}), ElementsAre(true));
+}
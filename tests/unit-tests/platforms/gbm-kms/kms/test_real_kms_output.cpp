@@ -18,6 +18,7 @@
 
 #include "src/platforms/gbm-kms/server/kms/real_kms_output.h"
 #include "src/platforms/gbm-kms/server/kms/page_flipper.h"
+#include "src/platforms/gbm-kms/server/kms/atomic_page_flip.h"
 #include "mir/fatal.h"
 
 #include "mir/test/fake_shared.h"
@@ -26,6 +27,9 @@
 #include "mir/test/doubles/mock_gbm.h"
 
 #include <stdexcept>
+#include <cstring>
+#include <map>
+#include <tuple>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -46,6 +50,8 @@ class NullPageFlipper : public mgg::PageFlipper
 {
 public:
     bool schedule_flip(uint32_t,uint32_t,uint32_t) override { return true; }
+    bool schedule_async_flip(uint32_t,uint32_t,uint32_t) override { return false; }
+    bool schedule_atomic_flip(mgg::AtomicPageFlip&) override { return false; }
     mg::Frame wait_for_flip(uint32_t) override { return {}; }
 };
 
@@ -53,6 +59,8 @@ class MockPageFlipper : public mgg::PageFlipper
 {
 public:
     MOCK_METHOD3(schedule_flip, bool(uint32_t,uint32_t,uint32_t));
+    MOCK_METHOD3(schedule_async_flip, bool(uint32_t,uint32_t,uint32_t));
+    MOCK_METHOD1(schedule_atomic_flip, bool(mgg::AtomicPageFlip&));
     MOCK_METHOD1(wait_for_flip, mg::Frame(uint32_t));
 };
 
@@ -148,6 +156,97 @@ public:
         mock_drm.prepare(drm_device);
     }
 
+    /// Give the connector a "vrr_capable" property and the CRTC (optionally) a "VRR_ENABLED" one
+    void setup_vrr_properties(bool connector_capable, bool crtc_supports_vrr, bool crtc_vrr_enabled)
+    {
+        vrr_capable_value = connector_capable;
+        vrr_enabled_value = crtc_vrr_enabled;
+
+        strncpy(vrr_capable_prop.name, "vrr_capable", sizeof(vrr_capable_prop.name) - 1);
+        vrr_capable_prop.prop_id = vrr_capable_prop_id;
+        strncpy(vrr_enabled_prop.name, "VRR_ENABLED", sizeof(vrr_enabled_prop.name) - 1);
+        vrr_enabled_prop.prop_id = vrr_enabled_prop_id;
+
+        connector_props.count_props = 1;
+        connector_props.props = const_cast<uint32_t*>(&vrr_capable_prop_id);
+        connector_props.prop_values = &vrr_capable_value;
+
+        crtc_props.count_props = crtc_supports_vrr ? 1 : 0;
+        crtc_props.props = const_cast<uint32_t*>(&vrr_enabled_prop_id);
+        crtc_props.prop_values = &vrr_enabled_value;
+
+        ON_CALL(mock_drm, drmModeObjectGetProperties(_, connector_ids[0], DRM_MODE_OBJECT_CONNECTOR))
+            .WillByDefault(Return(&connector_props));
+        ON_CALL(mock_drm, drmModeObjectGetProperties(_, crtc_ids[0], DRM_MODE_OBJECT_CRTC))
+            .WillByDefault(Return(&crtc_props));
+        ON_CALL(mock_drm, drmModeGetProperty(_, vrr_capable_prop_id))
+            .WillByDefault(Return(&vrr_capable_prop));
+        ON_CALL(mock_drm, drmModeGetProperty(_, vrr_enabled_prop_id))
+            .WillByDefault(Return(&vrr_enabled_prop));
+    }
+
+    struct FakeObjectProperties
+    {
+        std::vector<uint32_t> ids;
+        std::vector<uint64_t> values;
+        drmModeObjectProperties res{};
+    };
+
+    void add_fake_property(FakeObjectProperties& object, uint32_t id, char const* name, uint64_t value)
+    {
+        auto& property = fake_properties[id];
+        property.prop_id = id;
+        strncpy(property.name, name, sizeof(property.name) - 1);
+
+        object.ids.push_back(id);
+        object.values.push_back(value);
+        object.res.count_props = object.ids.size();
+        object.res.props = object.ids.data();
+        object.res.prop_values = object.values.data();
+    }
+
+    /**
+     * Give the CRTC a GAMMA_LUT, and two primary planes able to drive either
+     * CRTC: the first bound to the other CRTC, the second to ours.
+     */
+    void setup_atomic_properties(uint64_t gamma_lut_size)
+    {
+        for (auto id : primary_plane_ids)
+        {
+            auto& plane = fake_planes[id];
+            plane.plane_id = id;
+            plane.possible_crtcs = 0x3;
+            add_fake_property(fake_plane_props[id], id * 10, "type", DRM_PLANE_TYPE_PRIMARY);
+            add_fake_property(fake_plane_props[id], id * 10 + 1, "FB_ID", 0);
+        }
+        fake_planes[primary_plane_ids[0]].crtc_id = crtc_ids[1];
+        fake_planes[primary_plane_ids[1]].crtc_id = crtc_ids[0];
+        fake_plane_res.count_planes = primary_plane_ids.size();
+        fake_plane_res.planes = const_cast<uint32_t*>(primary_plane_ids.data());
+
+        add_fake_property(fake_crtc_props, gamma_lut_prop_id, "GAMMA_LUT", 0);
+        add_fake_property(fake_crtc_props, gamma_lut_prop_id + 1, "GAMMA_LUT_SIZE", gamma_lut_size);
+
+        ON_CALL(mock_drm, drmModeGetPlaneResources(_))
+            .WillByDefault(Return(&fake_plane_res));
+        ON_CALL(mock_drm, drmModeGetPlane(_, _))
+            .WillByDefault(Invoke([this](int, uint32_t id) { return &fake_planes.at(id); }));
+        ON_CALL(mock_drm, drmModeObjectGetProperties(_, _, DRM_MODE_OBJECT_PLANE))
+            .WillByDefault(Invoke([this](int, uint32_t id, uint32_t) { return &fake_plane_props.at(id).res; }));
+        ON_CALL(mock_drm, drmModeObjectGetProperties(_, crtc_ids[0], DRM_MODE_OBJECT_CRTC))
+            .WillByDefault(Return(&fake_crtc_props.res));
+        ON_CALL(mock_drm, drmModeGetProperty(_, _))
+            .WillByDefault(Invoke([this](int, uint32_t id) { return &fake_properties.at(id); }));
+        ON_CALL(mock_drm, drmModeAtomicAddProperty(_, _, _, _))
+            .WillByDefault(
+                Invoke(
+                    [this](drmModeAtomicReqPtr, uint32_t object_id, uint32_t property_id, uint64_t value)
+                    {
+                        added_properties.push_back(std::make_tuple(object_id, property_id, value));
+                        return 0;
+                    }));
+    }
+
     void append_fb_id(uint32_t fb_id)
     {
         EXPECT_CALL(mock_drm, drmModeAddFB2(_,_,_,_,_,_,_,_,_))
@@ -173,6 +272,24 @@ public:
     std::vector<uint32_t> const connector_ids;
     std::vector<uint32_t> possible_encoder_ids1;
     std::vector<uint32_t> possible_encoder_ids2;
+
+    uint32_t const vrr_capable_prop_id{1001};
+    uint32_t const vrr_enabled_prop_id{1002};
+    uint64_t vrr_capable_value{0};
+    uint64_t vrr_enabled_value{0};
+    drmModePropertyRes vrr_capable_prop{};
+    drmModePropertyRes vrr_enabled_prop{};
+    drmModeObjectProperties connector_props{};
+    drmModeObjectProperties crtc_props{};
+
+    std::vector<uint32_t> const primary_plane_ids{50, 51};
+    uint32_t const gamma_lut_prop_id{2001};
+    drmModePlaneRes fake_plane_res{};
+    std::map<uint32_t, drmModePlane> fake_planes;
+    std::map<uint32_t, FakeObjectProperties> fake_plane_props;
+    FakeObjectProperties fake_crtc_props;
+    std::map<uint32_t, drmModePropertyRes> fake_properties;
+    std::vector<std::tuple<uint32_t, uint32_t, uint64_t>> added_properties;
 };
 
 }
@@ -548,3 +665,222 @@ TEST_F(RealKMSOutputTest, drm_set_gamma_failure_does_not_throw)
 
     EXPECT_NO_THROW(output.set_gamma(gamma););
 }
+
+TEST_F(RealKMSOutputTest, atomic_flip_uses_primary_plane_bound_to_crtc)
+{
+    uint32_t const fb_id{67};
+
+    setup_outputs_connected_crtc();
+    setup_atomic_properties(4);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    append_fb_id(fb_id);
+    auto fb = output.fb_for(fake_bo);
+    EXPECT_TRUE(output.set_crtc(*fb));
+
+    mgg::AtomicPageFlip flip;
+    EXPECT_TRUE(output.add_page_flip(flip, *fb));
+
+    auto const bound_plane = primary_plane_ids[1];
+    auto const other_plane = primary_plane_ids[0];
+    EXPECT_THAT(added_properties, Contains(std::make_tuple(bound_plane, bound_plane * 10 + 1, uint64_t{fb_id})));
+    EXPECT_THAT(added_properties, Not(Contains(FieldsAre(other_plane, _, _))));
+}
+
+TEST_F(RealKMSOutputTest, atomic_gamma_is_resampled_to_gamma_lut_size)
+{
+    uint32_t const fb_id{67};
+    size_t const lut_size{4};
+
+    setup_outputs_connected_crtc();
+    setup_atomic_properties(lut_size);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    append_fb_id(fb_id);
+    auto fb = output.fb_for(fake_bo);
+    EXPECT_TRUE(output.set_crtc(*fb));
+
+    {
+        mgg::AtomicPageFlip flip;
+        ASSERT_TRUE(output.add_page_flip(flip, *fb));
+        flip.committed();
+    }
+
+    // Gamma now waits for the next atomic flip rather than going out by itself
+    EXPECT_CALL(mock_drm, drmModeCrtcSetGamma(_, _, _, _, _, _)).Times(0);
+    output.set_gamma({{0, 65535}, {0, 0}, {65535, 65535}});
+
+    std::vector<drm_color_lut> lut;
+    EXPECT_CALL(mock_drm, drmModeCreatePropertyBlob(drm_fd, _, lut_size * sizeof(drm_color_lut), _))
+        .WillOnce(
+            Invoke(
+                [&lut](int, void const* data, size_t size, uint32_t* id)
+                {
+                    auto const entries = static_cast<drm_color_lut const*>(data);
+                    lut.assign(entries, entries + size / sizeof(drm_color_lut));
+                    *id = 77;
+                    return 0;
+                }));
+
+    mgg::AtomicPageFlip flip;
+    EXPECT_TRUE(output.add_page_flip(flip, *fb));
+
+    ASSERT_THAT(lut.size(), Eq(lut_size));
+    EXPECT_THAT(lut[0].red, Eq(0));
+    EXPECT_THAT(lut[1].red, Eq(21845));
+    EXPECT_THAT(lut[2].red, Eq(43690));
+    EXPECT_THAT(lut[3].red, Eq(65535));
+    EXPECT_THAT(lut[2].green, Eq(0));
+    EXPECT_THAT(lut[2].blue, Eq(65535));
+    EXPECT_THAT(added_properties, Contains(std::make_tuple(crtc_ids[0], gamma_lut_prop_id, uint64_t{77})));
+}
+
+TEST_F(RealKMSOutputTest, vrr_is_enabled_on_capable_output)
+{
+    setup_outputs_connected_crtc();
+    setup_vrr_properties(true, true, false);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    EXPECT_CALL(mock_drm, drmModeObjectSetProperty(drm_fd, crtc_ids[0], DRM_MODE_OBJECT_CRTC, vrr_enabled_prop_id, 1))
+        .WillOnce(Return(0));
+
+    output.set_vrr_enabled(true);
+
+    EXPECT_TRUE(output.vrr_enabled());
+}
+
+TEST_F(RealKMSOutputTest, vrr_is_disabled_when_requested)
+{
+    setup_outputs_connected_crtc();
+    setup_vrr_properties(true, true, true);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    EXPECT_CALL(mock_drm, drmModeObjectSetProperty(drm_fd, crtc_ids[0], DRM_MODE_OBJECT_CRTC, vrr_enabled_prop_id, 0))
+        .WillOnce(Return(0));
+
+    output.set_vrr_enabled(false);
+
+    EXPECT_FALSE(output.vrr_enabled());
+}
+
+TEST_F(RealKMSOutputTest, vrr_already_in_requested_state_is_not_set_again)
+{
+    setup_outputs_connected_crtc();
+    setup_vrr_properties(true, true, true);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    EXPECT_CALL(mock_drm, drmModeObjectSetProperty(_, _, _, _, _)).Times(0);
+
+    output.set_vrr_enabled(true);
+
+    EXPECT_TRUE(output.vrr_enabled());
+}
+
+TEST_F(RealKMSOutputTest, vrr_is_not_enabled_on_incapable_connector)
+{
+    setup_outputs_connected_crtc();
+    setup_vrr_properties(false, true, false);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    EXPECT_CALL(mock_drm, drmModeObjectSetProperty(_, _, _, _, _)).Times(0);
+
+    output.set_vrr_enabled(true);
+
+    EXPECT_FALSE(output.vrr_enabled());
+}
+
+TEST_F(RealKMSOutputTest, vrr_is_not_enabled_if_crtc_lacks_vrr_property)
+{
+    setup_outputs_connected_crtc();
+    setup_vrr_properties(true, false, false);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    EXPECT_CALL(mock_drm, drmModeObjectSetProperty(_, _, _, _, _)).Times(0);
+
+    output.set_vrr_enabled(true);
+
+    EXPECT_FALSE(output.vrr_enabled());
+}
+
+TEST_F(RealKMSOutputTest, failure_to_enable_vrr_is_not_fatal)
+{
+    setup_outputs_connected_crtc();
+    setup_vrr_properties(true, true, false);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    EXPECT_CALL(mock_drm, drmModeObjectSetProperty(drm_fd, crtc_ids[0], DRM_MODE_OBJECT_CRTC, vrr_enabled_prop_id, 1))
+        .WillOnce(Return(-EINVAL));
+
+    EXPECT_NO_THROW(output.set_vrr_enabled(true));
+
+    EXPECT_FALSE(output.vrr_enabled());
+}
+
+TEST_F(RealKMSOutputTest, hardware_state_reports_vrr_capability)
+{
+    setup_outputs_connected_crtc();
+    setup_vrr_properties(true, true, false);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    mg::DisplayConfigurationOutput conf_output{};
+    output.update_from_hardware_state(conf_output);
+
+    EXPECT_TRUE(conf_output.vrr_capable);
+}
+
+TEST_F(RealKMSOutputTest, connector_vanishing_while_querying_vrr_capability_reports_incapable)
+{
+    setup_outputs_connected_crtc();
+    setup_vrr_properties(true, true, false);
+
+    mgg::RealKMSOutput output{
+        drm_fd,
+        mg::kms::get_connector(drm_fd, connector_ids[0]),
+        mt::fake_shared(mock_page_flipper)};
+
+    // The EDID is read first; the connector is unplugged before its VRR support is
+    EXPECT_CALL(mock_drm, drmModeObjectGetProperties(_, connector_ids[0], DRM_MODE_OBJECT_CONNECTOR))
+        .WillOnce(Return(&connector_props))
+        .WillOnce(DoAll(Assign(&errno, ENOENT), Return(nullptr)));
+
+    mg::DisplayConfigurationOutput conf_output{};
+    EXPECT_NO_THROW(output.update_from_hardware_state(conf_output));
+
+    EXPECT_FALSE(conf_output.vrr_capable);
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/platforms/virtual/display_buffer.h"
+#include "mir/graphics/atomic_frame.h"
+#include "mir/test/doubles/mock_display_report.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstring>
+
+namespace mg = mir::graphics;
+namespace mgv = mir::graphics::virt;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct VirtualDisplayBuffer : Test
+{
+    auto display_buffer_at(double refresh_rate) -> std::unique_ptr<mgv::DisplayBuffer>
+    {
+        return std::make_unique<mgv::DisplayBuffer>(
+            mg::DisplayConfigurationOutputId{1}, size, geom::Rectangle{{0, 0}, size},
+            refresh_rate, last_frame, report);
+    }
+
+    geom::Size const size{4, 2};
+    std::shared_ptr<mg::AtomicFrame> const last_frame{std::make_shared<mg::AtomicFrame>()};
+    std::shared_ptr<NiceMock<mtd::MockDisplayReport>> const report{
+        std::make_shared<NiceMock<mtd::MockDisplayReport>>()};
+};
+}
+
+TEST_F(VirtualDisplayBuffer, is_a_software_render_target)
+{
+    auto const display_buffer = display_buffer_at(60);
+
+    EXPECT_THAT(
+        dynamic_cast<mir::renderer::software::RenderTarget*>(display_buffer->native_display_buffer()),
+        Eq(display_buffer.get()));
+
+    auto const mapping = display_buffer->map_back_buffer();
+    EXPECT_THAT(mapping->size(), Eq(size));
+    EXPECT_THAT(mapping->format(), Eq(mir_pixel_format_xrgb_8888));
+    EXPECT_THAT(mapping->len(), Eq(size_t(4 * 2 * 4)));
+}
+
+TEST_F(VirtualDisplayBuffer, swap_buffers_gives_a_new_back_buffer)
+{
+    auto const display_buffer = display_buffer_at(60);
+
+    {
+        auto const mapping = display_buffer->map_back_buffer();
+        memset(mapping->data(), 0xff, mapping->len());
+    }
+    display_buffer->swap_buffers();
+
+    auto const mapping = display_buffer->map_back_buffer();
+    EXPECT_THAT(mapping->data()[0], Eq(0));
+}
+
+TEST_F(VirtualDisplayBuffer, has_no_vblank_timing_before_first_post)
+{
+    auto const display_buffer = display_buffer_at(60);
+
+    EXPECT_THAT(display_buffer->vblank_timing(), Eq(std::nullopt));
+}
+
+TEST_F(VirtualDisplayBuffer, post_waits_for_the_next_vblank)
+{
+    // A high rate keeps the test quick, while still being measurable
+    double const rate = 200;
+    auto const interval = 5ms;
+    auto const display_buffer = display_buffer_at(rate);
+
+    display_buffer->post();
+    auto const first = last_frame->load();
+    display_buffer->post();
+    auto const second = last_frame->load();
+    auto const after_second = std::chrono::steady_clock::now().time_since_epoch();
+
+    EXPECT_THAT(second.msc, Gt(first.msc));
+    EXPECT_THAT(second.ust.nanoseconds - first.ust.nanoseconds, Eq((second.msc - first.msc) * interval));
+    // post() only returns once the vblank it reports has happened
+    EXPECT_THAT(second.ust.nanoseconds, Le(after_second));
+    EXPECT_THAT(second.ust.clock_id, Eq(CLOCK_MONOTONIC));
+}
+
+TEST_F(VirtualDisplayBuffer, vblank_timing_follows_posts)
+{
+    auto const display_buffer = display_buffer_at(200);
+
+    display_buffer->post();
+
+    auto const timing = display_buffer->vblank_timing();
+    ASSERT_TRUE(timing);
+    EXPECT_THAT(timing->refresh_interval, Eq(5ms));
+    EXPECT_THAT(timing->last_vblank.msc, Eq(last_frame->load().msc));
+}
+
+TEST_F(VirtualDisplayBuffer, post_reports_vsync)
+{
+    auto const display_buffer = display_buffer_at(200);
+
+    EXPECT_CALL(*report, report_vsync(1, _));
+
+    display_buffer->post();
+}
+
+TEST_F(VirtualDisplayBuffer, unthrottled_post_does_not_wait)
+{
+    auto const display_buffer = display_buffer_at(0);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (auto i = 0; i != 100; ++i)
+        display_buffer->post();
+
+    EXPECT_THAT(last_frame->load().msc, Eq(100));
+    EXPECT_THAT(std::chrono::steady_clock::now() - start, Lt(1s));
+    EXPECT_THAT(display_buffer->vblank_timing(), Eq(std::nullopt));
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/platforms/virtual/platform.h"
+#include "mir/test/doubles/mock_display_report.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <stdexcept>
+
+namespace mg = mir::graphics;
+namespace mgv = mir::graphics::virt;
+namespace geom = mir::geometry;
+
+using namespace testing;
+
+namespace
+{
+MATCHER_P2(IsOutput, size, refresh_rate, "")
+{
+    return arg.size == size && arg.refresh_rate == refresh_rate;
+}
+}
+
+TEST(VirtualPlatform, parses_single_output)
+{
+    EXPECT_THAT(
+        mgv::Platform::parse_output_configs("1280x1024"),
+        ElementsAre(IsOutput(geom::Size{1280, 1024}, 60.0)));
+}
+
+TEST(VirtualPlatform, parses_refresh_rate)
+{
+    EXPECT_THAT(
+        mgv::Platform::parse_output_configs("1920x1080@144"),
+        ElementsAre(IsOutput(geom::Size{1920, 1080}, 144.0)));
+    EXPECT_THAT(
+        mgv::Platform::parse_output_configs("1920x1080@59.94"),
+        ElementsAre(IsOutput(geom::Size{1920, 1080}, 59.94)));
+}
+
+TEST(VirtualPlatform, parses_unthrottled_refresh_rate)
+{
+    EXPECT_THAT(
+        mgv::Platform::parse_output_configs("640x480@0"),
+        ElementsAre(IsOutput(geom::Size{640, 480}, 0.0)));
+}
+
+TEST(VirtualPlatform, parses_multiple_outputs)
+{
+    EXPECT_THAT(
+        mgv::Platform::parse_output_configs("1280x1024:640x480@30:1920x1080"),
+        ElementsAre(
+            IsOutput(geom::Size{1280, 1024}, 60.0),
+            IsOutput(geom::Size{640, 480}, 30.0),
+            IsOutput(geom::Size{1920, 1080}, 60.0)));
+}
+
+TEST(VirtualPlatform, rejects_malformed_outputs)
+{
+    for (auto const config : {
+        "", "1280", "x1024", "1280x", "1280*1024", "1280x1024@", "1280x1024@fast",
+        "0x1024", "1280x-1", "1280x1024@-60", "12abx1024", "1280x1024:", ":1280x1024",
+        "99999999999x1024"})
+    {
+        EXPECT_THROW(mgv::Platform::parse_output_configs(config), std::runtime_error) << "config: \"" << config << "\"";
+    }
+}
+
+TEST(VirtualPlatform, needs_at_least_one_output)
+{
+    EXPECT_THROW(
+        (mgv::Platform{{}, std::make_shared<NiceMock<mir::test::doubles::MockDisplayReport>>()}),
+        std::runtime_error);
+}
@@ -490,3 +490,345 @@ TEST_F(GLRenderer, sets_viewport_downscaled_wide)
 
     mrg::Renderer renderer(mock_display_buffer);
 }
+
+TEST_F(GLRenderer, scissors_redraw_to_area_damaged_since_buffer_was_last_drawn)
+{
+    mir::geometry::Rectangle const view_area{{0,0}, {1920,1080}};
+    mir::geometry::Rectangle const before{{10,20}, {30,40}};
+    mir::geometry::Rectangle const after{{50,20}, {30,40}};
+
+    ON_CALL(mock_egl, eglGetCurrentDisplay())
+        .WillByDefault(Return(mock_egl.fake_egl_display));
+    ON_CALL(mock_egl, eglQueryString(_, EGL_EXTENSIONS))
+        .WillByDefault(Return("EGL_EXT_buffer_age"));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_WIDTH,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1920), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_HEIGHT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1080), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_BUFFER_AGE_EXT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1), Return(EGL_TRUE)));
+    ON_CALL(mock_display_buffer, view_area())
+        .WillByDefault(Return(view_area));
+    EXPECT_CALL(*renderable, transformation()).WillRepeatedly(Return(glm::mat4(1)));
+    EXPECT_CALL(*renderable, screen_position()).WillRepeatedly(Return(before));
+
+    mrg::Renderer renderer(mock_display_buffer);
+    renderer.render(renderable_list);
+
+    EXPECT_CALL(*renderable, screen_position()).WillRepeatedly(Return(after));
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST));
+    // The union of the old and new positions, in GL's bottom-left origin
+    EXPECT_CALL(mock_gl, glScissor(10, 1080 - 60, 70, 40));
+    EXPECT_CALL(mock_gl, glClear(_));
+
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, scissors_redraw_to_damage_reported_for_new_buffer)
+{
+    mir::geometry::Rectangle const view_area{{0,0}, {1920,1080}};
+    mir::geometry::Rectangle const position{{100,200}, {60,80}};
+    auto const first_buffer = std::make_shared<mtd::StubBuffer>(mir::geometry::Size{30,40});
+    auto const second_buffer = std::make_shared<mtd::StubBuffer>(mir::geometry::Size{30,40});
+
+    ON_CALL(mock_egl, eglGetCurrentDisplay())
+        .WillByDefault(Return(mock_egl.fake_egl_display));
+    ON_CALL(mock_egl, eglQueryString(_, EGL_EXTENSIONS))
+        .WillByDefault(Return("EGL_EXT_buffer_age"));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_WIDTH,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1920), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_HEIGHT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1080), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_BUFFER_AGE_EXT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1), Return(EGL_TRUE)));
+    ON_CALL(mock_display_buffer, view_area())
+        .WillByDefault(Return(view_area));
+    EXPECT_CALL(*renderable, transformation()).WillRepeatedly(Return(glm::mat4(1)));
+    EXPECT_CALL(*renderable, screen_position()).WillRepeatedly(Return(position));
+    EXPECT_CALL(*renderable, buffer()).WillRepeatedly(Return(first_buffer));
+
+    mrg::Renderer renderer(mock_display_buffer);
+    renderer.render(renderable_list);
+
+    EXPECT_CALL(*renderable, buffer()).WillRepeatedly(Return(second_buffer));
+    EXPECT_CALL(*renderable, damage_since(first_buffer->id()))
+        .WillRepeatedly(Return(mir::geometry::Rectangles{{{5,10}, {10,5}}}));
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST));
+    // The buffer is drawn at twice its size, in GL's bottom-left origin
+    EXPECT_CALL(mock_gl, glScissor(110, 1080 - 230, 20, 10));
+    EXPECT_CALL(mock_gl, glClear(_));
+
+    renderer.render(renderable_list);
+}
+
+TEST_F(GLRenderer, redraws_everything_when_buffer_age_is_unknown)
+{
+    mir::geometry::Rectangle const view_area{{0,0}, {1920,1080}};
+
+    ON_CALL(mock_egl, eglGetCurrentDisplay())
+        .WillByDefault(Return(mock_egl.fake_egl_display));
+    ON_CALL(mock_egl, eglQueryString(_, EGL_EXTENSIONS))
+        .WillByDefault(Return("EGL_EXT_buffer_age"));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_WIDTH,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1920), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_HEIGHT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(1080), Return(EGL_TRUE)));
+    ON_CALL(mock_egl, eglQuerySurface(_,_,EGL_BUFFER_AGE_EXT,_))
+        .WillByDefault(DoAll(SetArgPointee<3>(0), Return(EGL_TRUE)));
+    ON_CALL(mock_display_buffer, view_area())
+        .WillByDefault(Return(view_area));
+    EXPECT_CALL(*renderable, transformation()).WillRepeatedly(Return(glm::mat4(1)));
+
+    mrg::Renderer renderer(mock_display_buffer);
+    renderer.render(renderable_list);
+
+    EXPECT_CALL(mock_gl, glEnable(GL_SCISSOR_TEST)).Times(0);
+    EXPECT_CALL(mock_gl, glScissor(_, _, _, _)).Times(0);
+
+    renderer.render(renderable_list);
+}
+
+namespace
+{
+auto renderable_at(
+    std::shared_ptr<mg::Buffer> const& buffer,
+    mir::geometry::Rectangle const& position) -> std::shared_ptr<mtd::MockRenderable>
+{
+    auto const renderable = std::make_shared<testing::NiceMock<mtd::MockRenderable>>();
+    ON_CALL(*renderable, id()).WillByDefault(Return(renderable.get()));
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(buffer));
+    ON_CALL(*renderable, alpha()).WillByDefault(Return(1.0f));
+    ON_CALL(*renderable, transformation()).WillByDefault(Return(glm::mat4(1)));
+    ON_CALL(*renderable, screen_position()).WillByDefault(Return(position));
+    return renderable;
+}
+}
+
+TEST_F(GLRenderer, draws_renderables_sharing_a_texture_in_one_call)
+{
+    mg::RenderableList const renderables{
+        renderable_at(mock_buffer, {{0, 0}, {10, 10}}),
+        renderable_at(mock_buffer, {{20, 0}, {10, 10}}),
+        renderable_at(mock_buffer, {{40, 0}, {10, 10}})};
+
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 0, 18));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render(renderables);
+}
+
+TEST_F(GLRenderer, uploads_all_vertices_once_per_frame)
+{
+    auto const other_buffer = std::make_shared<testing::NiceMock<mtd::MockTextureBuffer>>();
+    ON_CALL(*other_buffer, shader(_)).WillByDefault(testing::Invoke(
+        [](auto& factory) -> mg::gl::Program&
+        {
+            static int unused = 2;
+            return factory.compile_fragment_shader(&unused, "extension code", "other fragment code");
+        }));
+
+    mg::RenderableList const renderables{
+        renderable_at(mock_buffer, {{0, 0}, {10, 10}}),
+        renderable_at(other_buffer, {{5, 5}, {10, 10}})};
+
+    EXPECT_CALL(mock_gl, glBufferData(GL_ARRAY_BUFFER, 12 * sizeof(mgl::Vertex), _, _));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 0, 6));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 6, 6));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render(renderables);
+}
+
+TEST_F(GLRenderer, does_not_batch_past_an_overlapping_renderable)
+{
+    auto const other_buffer = std::make_shared<testing::NiceMock<mtd::MockTextureBuffer>>();
+    ON_CALL(*other_buffer, shader(_)).WillByDefault(testing::Invoke(
+        [](auto& factory) -> mg::gl::Program&
+        {
+            static int unused = 1;
+            return factory.compile_fragment_shader(&unused, "extension code", "fragment code");
+        }));
+
+    // The middle renderable is on top of the first and below the last
+    mg::RenderableList const renderables{
+        renderable_at(mock_buffer, {{0, 0}, {10, 10}}),
+        renderable_at(other_buffer, {{5, 5}, {10, 10}}),
+        renderable_at(mock_buffer, {{10, 10}, {10, 10}})};
+
+    InSequence seq;
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 0, 6));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 6, 6));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 12, 6));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render(renderables);
+}
+
+TEST_F(GLRenderer, batches_past_renderables_that_do_not_overlap)
+{
+    auto const other_buffer = std::make_shared<testing::NiceMock<mtd::MockTextureBuffer>>();
+    ON_CALL(*other_buffer, shader(_)).WillByDefault(testing::Invoke(
+        [](auto& factory) -> mg::gl::Program&
+        {
+            static int unused = 1;
+            return factory.compile_fragment_shader(&unused, "extension code", "fragment code");
+        }));
+
+    mg::RenderableList const renderables{
+        renderable_at(mock_buffer, {{0, 0}, {10, 10}}),
+        renderable_at(other_buffer, {{100, 100}, {10, 10}}),
+        renderable_at(mock_buffer, {{10, 10}, {10, 10}})};
+
+    InSequence seq;
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 0, 12));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 12, 6));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render(renderables);
+}
+
+namespace
+{
+GLuint const uploaded_texture{0x5e7};
+
+auto uploadable_buffer(
+    mg::BufferID id,
+    mir::geometry::Size size) -> std::shared_ptr<mtd::MockUploadableTextureBuffer>
+{
+    auto const buffer = std::make_shared<testing::NiceMock<mtd::MockUploadableTextureBuffer>>(
+        size, mir::geometry::Stride{size.width.as_int() * 4}, mir_pixel_format_argb_8888);
+    ON_CALL(*buffer, id()).WillByDefault(Return(id));
+    ON_CALL(*buffer, shader(_)).WillByDefault(testing::Invoke(
+        [](auto& factory) -> mg::gl::Program&
+        {
+            static int unused = 3;
+            return factory.compile_fragment_shader(&unused, "extension code", "uploaded fragment code");
+        }));
+    return buffer;
+}
+}
+
+TEST_F(GLRenderer, uploads_successive_cpu_buffers_into_one_texture)
+{
+    auto const first_buffer = uploadable_buffer(mg::BufferID{1}, {30, 40});
+    auto const second_buffer = uploadable_buffer(mg::BufferID{2}, {30, 40});
+    auto const renderable = renderable_at(first_buffer, {{0, 0}, {30, 40}});
+
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).WillOnce(SetArgPointee<1>(uploaded_texture));
+    EXPECT_CALL(*first_buffer, bind()).Times(0);
+    EXPECT_CALL(*second_buffer, bind()).Times(0);
+    EXPECT_CALL(*first_buffer, upload_to_bound_texture(testing::Eq(std::nullopt)));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render({renderable});
+
+    mir::geometry::Rectangles const damage{{{5, 10}, {10, 5}}};
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(second_buffer));
+    ON_CALL(*renderable, damage_since(mg::BufferID{1})).WillByDefault(Return(damage));
+
+    EXPECT_CALL(mock_gl, glBindTexture(GL_TEXTURE_2D, uploaded_texture)).Times(AtLeast(1));
+    EXPECT_CALL(*second_buffer, upload_to_bound_texture(testing::Optional(damage)));
+
+    renderer.render({renderable});
+}
+
+TEST_F(GLRenderer, does_not_upload_an_unchanged_cpu_buffer_again)
+{
+    auto const buffer = uploadable_buffer(mg::BufferID{1}, {30, 40});
+    auto const renderable = renderable_at(buffer, {{0, 0}, {30, 40}});
+
+    ON_CALL(mock_gl, glGenTextures(1, _)).WillByDefault(SetArgPointee<1>(uploaded_texture));
+    EXPECT_CALL(*buffer, upload_to_bound_texture(_)).Times(1);
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render({renderable});
+    renderer.render({renderable});
+}
+
+TEST_F(GLRenderer, uploads_all_of_a_cpu_buffer_with_a_new_size)
+{
+    auto const first_buffer = uploadable_buffer(mg::BufferID{1}, {30, 40});
+    auto const second_buffer = uploadable_buffer(mg::BufferID{2}, {60, 80});
+    auto const renderable = renderable_at(first_buffer, {{0, 0}, {30, 40}});
+
+    ON_CALL(mock_gl, glGenTextures(1, _)).WillByDefault(SetArgPointee<1>(uploaded_texture));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render({renderable});
+
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(second_buffer));
+    ON_CALL(*renderable, damage_since(_))
+        .WillByDefault(Return(mir::geometry::Rectangles{{{5, 10}, {10, 5}}}));
+
+    EXPECT_CALL(*second_buffer, upload_to_bound_texture(testing::Eq(std::nullopt)));
+
+    renderer.render({renderable});
+}
+
+TEST_F(GLRenderer, renderables_showing_one_cpu_buffer_share_its_texture)
+{
+    auto const buffer = uploadable_buffer(mg::BufferID{1}, {10, 10});
+    mg::RenderableList const renderables{
+        renderable_at(buffer, {{0, 0}, {10, 10}}),
+        renderable_at(buffer, {{20, 0}, {10, 10}})};
+
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).WillOnce(SetArgPointee<1>(uploaded_texture));
+    EXPECT_CALL(*buffer, upload_to_bound_texture(_)).Times(1);
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLES, 0, 12));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render(renderables);
+}
+
+TEST_F(GLRenderer, does_not_take_over_texture_of_cpu_buffer_still_shown)
+{
+    GLuint const second_texture{0x5e8};
+    auto const first_buffer = uploadable_buffer(mg::BufferID{1}, {10, 10});
+    auto const second_buffer = uploadable_buffer(mg::BufferID{2}, {10, 10});
+    auto const changing = renderable_at(first_buffer, {{0, 0}, {10, 10}});
+    auto const unchanged = renderable_at(first_buffer, {{20, 0}, {10, 10}});
+
+    EXPECT_CALL(mock_gl, glGenTextures(1, _))
+        .WillOnce(SetArgPointee<1>(uploaded_texture))
+        .WillOnce(SetArgPointee<1>(second_texture));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render({changing, unchanged});
+
+    ON_CALL(*changing, buffer()).WillByDefault(Return(second_buffer));
+    ON_CALL(*changing, damage_since(_))
+        .WillByDefault(Return(mir::geometry::Rectangles{{{5, 5}, {1, 1}}}));
+
+    // The other renderable still needs the first buffer's texture, so the second gets all of its own
+    EXPECT_CALL(*first_buffer, upload_to_bound_texture(_)).Times(0);
+    EXPECT_CALL(*second_buffer, upload_to_bound_texture(testing::Eq(std::nullopt)));
+    EXPECT_CALL(mock_gl, glDeleteTextures(_, _)).Times(0);
+
+    renderer.render({changing, unchanged});
+}
+
+TEST_F(GLRenderer, deletes_texture_of_renderable_no_longer_rendered)
+{
+    auto const buffer = uploadable_buffer(mg::BufferID{1}, {30, 40});
+
+    ON_CALL(mock_gl, glGenTextures(1, _)).WillByDefault(SetArgPointee<1>(uploaded_texture));
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render({renderable_at(buffer, {{0, 0}, {30, 40}})});
+
+    EXPECT_CALL(mock_gl, glDeleteTextures(1, Pointee(uploaded_texture)));
+
+    renderer.render({});
+}
+
+TEST_F(GLRenderer, does_not_time_frames_until_gpu_time_is_requested)
+{
+    ON_CALL(mock_gl, glGetString(GL_EXTENSIONS))
+        .WillByDefault(Return(reinterpret_cast<GLubyte const*>("GL_EXT_disjoint_timer_query")));
+
+    EXPECT_CALL(mock_egl, eglGetProcAddress(testing::StrEq("glBeginQueryEXT"))).Times(0);
+
+    mrg::Renderer renderer(display_buffer);
+    renderer.render(renderable_list);
+    renderer.render(renderable_list);
+}
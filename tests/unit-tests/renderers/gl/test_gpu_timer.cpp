@@ -0,0 +1,301 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/renderers/gl/gpu_timer.h"
+#include "mir/test/doubles/mock_gl.h"
+#include "mir/test/doubles/mock_egl.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <GLES2/gl2ext.h>
+
+#include <map>
+
+namespace mrg = mir::renderer::gl;
+namespace mtd = mir::test::doubles;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+/// Just enough of GL_EXT_disjoint_timer_query
+struct FakeTimerQueries
+{
+    struct Query
+    {
+        bool available = false;
+        GLuint64 elapsed = 0;
+    };
+
+    GLuint next_id = 1;
+    std::map<GLuint, Query> queries;
+    std::vector<GLuint> ended;
+    bool disjoint = false;
+} fake;
+
+void GL_APIENTRY fake_glGenQueriesEXT(GLsizei n, GLuint* ids)
+{
+    for (auto i = 0; i != n; ++i)
+    {
+        ids[i] = fake.next_id++;
+        fake.queries[ids[i]];
+    }
+}
+
+void GL_APIENTRY fake_glDeleteQueriesEXT(GLsizei n, GLuint const* ids)
+{
+    for (auto i = 0; i != n; ++i)
+        fake.queries.erase(ids[i]);
+}
+
+void GL_APIENTRY fake_glBeginQueryEXT(GLenum, GLuint id)
+{
+    fake.queries[id] = {};
+    fake.ended.push_back(id);
+}
+
+void GL_APIENTRY fake_glEndQueryEXT(GLenum)
+{
+}
+
+void GL_APIENTRY fake_glGetQueryObjectuivEXT(GLuint id, GLenum, GLuint* value)
+{
+    *value = fake.queries[id].available;
+}
+
+void GL_APIENTRY fake_glGetQueryObjectui64vEXT(GLuint id, GLenum, GLuint64* value)
+{
+    *value = fake.queries[id].elapsed;
+}
+
+template<typename Function>
+auto proc(Function* function)
+{
+    return reinterpret_cast<void(*)()>(function);
+}
+
+auto gl_str(char const* str)
+{
+    return reinterpret_cast<GLubyte const*>(str);
+}
+
+struct GPUTimer : Test
+{
+    GPUTimer()
+    {
+        fake = FakeTimerQueries{};
+
+        ON_CALL(mock_gl, glGetIntegerv(GL_GPU_DISJOINT_EXT, _))
+            .WillByDefault(Invoke([](GLenum, GLint* value) { *value = std::exchange(fake.disjoint, false); }));
+
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glGenQueriesEXT")))
+            .WillByDefault(Return(proc(&fake_glGenQueriesEXT)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glDeleteQueriesEXT")))
+            .WillByDefault(Return(proc(&fake_glDeleteQueriesEXT)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glBeginQueryEXT")))
+            .WillByDefault(Return(proc(&fake_glBeginQueryEXT)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glEndQueryEXT")))
+            .WillByDefault(Return(proc(&fake_glEndQueryEXT)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glGetQueryObjectuivEXT")))
+            .WillByDefault(Return(proc(&fake_glGetQueryObjectuivEXT)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glGetQueryObjectui64vEXT")))
+            .WillByDefault(Return(proc(&fake_glGetQueryObjectui64vEXT)));
+    }
+
+    void provide_timer_queries()
+    {
+        ON_CALL(mock_gl, glGetString(GL_EXTENSIONS))
+            .WillByDefault(Return(gl_str("GL_OES_EGL_image GL_EXT_disjoint_timer_query")));
+    }
+
+    void provide_fences()
+    {
+        ON_CALL(mock_egl, eglQueryString(_, EGL_EXTENSIONS))
+            .WillByDefault(Return("EGL_KHR_image_base EGL_KHR_fence_sync"));
+    }
+
+    void time_frame()
+    {
+        timer->begin_frame();
+        timer->end_frame();
+    }
+
+    NiceMock<mtd::MockGL> mock_gl;
+    NiceMock<mtd::MockEGL> mock_egl;
+    std::unique_ptr<mrg::GPUTimer> timer;
+};
+}
+
+TEST_F(GPUTimer, reports_timer_query_result_once_available)
+{
+    provide_timer_queries();
+    timer = mrg::GPUTimer::create();
+
+    time_frame();
+    ASSERT_THAT(fake.ended.size(), Eq(1u));
+
+    EXPECT_THAT(timer->completed_frame(), Eq(std::nullopt));
+
+    fake.queries[fake.ended[0]] = {true, 1234567};
+    EXPECT_THAT(timer->completed_frame(), Eq(1234567ns));
+    EXPECT_THAT(timer->completed_frame(), Eq(std::nullopt));
+}
+
+TEST_F(GPUTimer, reports_frames_in_order)
+{
+    provide_timer_queries();
+    timer = mrg::GPUTimer::create();
+
+    time_frame();
+    time_frame();
+    ASSERT_THAT(fake.ended.size(), Eq(2u));
+
+    fake.queries[fake.ended[1]] = {true, 2000};
+    EXPECT_THAT(timer->completed_frame(), Eq(std::nullopt));
+
+    fake.queries[fake.ended[0]] = {true, 1000};
+    EXPECT_THAT(timer->completed_frame(), Eq(1000ns));
+    EXPECT_THAT(timer->completed_frame(), Eq(2000ns));
+}
+
+TEST_F(GPUTimer, reuses_queries)
+{
+    provide_timer_queries();
+    timer = mrg::GPUTimer::create();
+
+    for (auto i = 0; i != 10; ++i)
+    {
+        time_frame();
+        fake.queries[fake.ended.back()] = {true, 1000};
+        EXPECT_THAT(timer->completed_frame(), Eq(1000ns));
+    }
+
+    EXPECT_THAT(fake.next_id, Eq(2u));
+}
+
+TEST_F(GPUTimer, discards_timings_spanning_a_disjoint_event)
+{
+    provide_timer_queries();
+    timer = mrg::GPUTimer::create();
+
+    time_frame();
+    fake.queries[fake.ended[0]] = {true, 1000};
+    fake.disjoint = true;
+
+    EXPECT_THAT(timer->completed_frame(), Eq(std::nullopt));
+
+    time_frame();
+    fake.queries[fake.ended[1]] = {true, 2000};
+    EXPECT_THAT(timer->completed_frame(), Eq(2000ns));
+}
+
+TEST_F(GPUTimer, stops_timing_when_results_are_not_collected)
+{
+    provide_timer_queries();
+    timer = mrg::GPUTimer::create();
+
+    for (auto i = 0; i != 100; ++i)
+        time_frame();
+
+    EXPECT_THAT(fake.queries.size(), Lt(100u));
+}
+
+TEST_F(GPUTimer, deletes_its_queries)
+{
+    provide_timer_queries();
+    timer = mrg::GPUTimer::create();
+
+    time_frame();
+    time_frame();
+    fake.queries[fake.ended[0]] = {true, 1000};
+    timer->completed_frame();
+
+    timer.reset();
+    EXPECT_THAT(fake.queries, IsEmpty());
+}
+
+TEST_F(GPUTimer, falls_back_to_fences_without_timer_queries)
+{
+    provide_fences();
+    auto const fence = reinterpret_cast<EGLSyncKHR>(0xfe);
+
+    timer = mrg::GPUTimer::create();
+
+    InSequence seq;
+    EXPECT_CALL(mock_gl, glFlush());
+    EXPECT_CALL(mock_egl, eglCreateSyncKHR(_, EGL_SYNC_FENCE_KHR, _))
+        .WillOnce(Return(fence));
+    EXPECT_CALL(mock_egl, eglClientWaitSyncKHR(_, fence, _, _))
+        .WillOnce(Return(EGL_CONDITION_SATISFIED_KHR));
+    EXPECT_CALL(mock_egl, eglDestroySyncKHR(_, fence));
+
+    time_frame();
+    auto const gpu_time = timer->completed_frame();
+    ASSERT_TRUE(gpu_time);
+    EXPECT_THAT(*gpu_time, Ge(0ns));
+}
+
+TEST_F(GPUTimer, polls_fence_without_waiting)
+{
+    provide_fences();
+    auto const fence = reinterpret_cast<EGLSyncKHR>(0xfe);
+
+    timer = mrg::GPUTimer::create();
+
+    ON_CALL(mock_egl, eglCreateSyncKHR(_, EGL_SYNC_FENCE_KHR, _))
+        .WillByDefault(Return(fence));
+    EXPECT_CALL(mock_egl, eglClientWaitSyncKHR(_, fence, _, 0))
+        .WillOnce(Return(EGL_CONDITION_SATISFIED_KHR));
+
+    time_frame();
+    timer->completed_frame();
+}
+
+TEST_F(GPUTimer, keeps_fence_until_it_signals)
+{
+    provide_fences();
+    auto const fence = reinterpret_cast<EGLSyncKHR>(0xfe);
+
+    timer = mrg::GPUTimer::create();
+
+    InSequence seq;
+    EXPECT_CALL(mock_egl, eglCreateSyncKHR(_, EGL_SYNC_FENCE_KHR, _))
+        .WillOnce(Return(fence));
+    EXPECT_CALL(mock_egl, eglClientWaitSyncKHR(_, fence, _, _))
+        .WillOnce(Return(EGL_TIMEOUT_EXPIRED_KHR));
+    EXPECT_CALL(mock_egl, eglClientWaitSyncKHR(_, fence, _, _))
+        .WillOnce(Return(EGL_CONDITION_SATISFIED_KHR));
+    EXPECT_CALL(mock_egl, eglDestroySyncKHR(_, fence));
+
+    time_frame();
+    EXPECT_THAT(timer->completed_frame(), Eq(std::nullopt));
+
+    // The fence is still outstanding, so the next frame doesn't get one of its own
+    time_frame();
+    EXPECT_THAT(timer->completed_frame(), Ne(std::nullopt));
+}
+
+TEST_F(GPUTimer, reports_nothing_without_timer_queries_or_fences)
+{
+    timer = mrg::GPUTimer::create();
+
+    EXPECT_CALL(mock_egl, eglCreateSyncKHR(_, _, _)).Times(0);
+
+    time_frame();
+    EXPECT_THAT(timer->completed_frame(), Eq(std::nullopt));
+}
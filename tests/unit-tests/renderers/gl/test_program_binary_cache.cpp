@@ -0,0 +1,311 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/renderers/gl/program_binary_cache.h"
+#include "mir/test/doubles/mock_gl.h"
+#include "mir/test/doubles/mock_egl.h"
+#include "mir_test_framework/temporary_environment_value.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <boost/filesystem.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace mrg = mir::renderer::gl;
+namespace mtd = mir::test::doubles;
+namespace mtf = mir_test_framework;
+
+using namespace testing;
+
+namespace
+{
+GLuint const linked_program = 7;
+GLuint const loaded_program = 9;
+GLenum const binary_format = 0x1234;
+
+std::vector<char> driver_binary{'b', 'i', 'n', 'a', 'r', 'y'};
+std::vector<char> loaded_binary;
+GLenum loaded_format{0};
+
+void GL_APIENTRY fake_glGetProgramBinaryOES(
+    GLuint, GLsizei buffer_size, GLsizei* length, GLenum* format, void* binary)
+{
+    auto const size = std::min<GLsizei>(buffer_size, driver_binary.size());
+    memcpy(binary, driver_binary.data(), size);
+    *length = size;
+    *format = binary_format;
+}
+
+void GL_APIENTRY fake_glProgramBinaryOES(GLuint, GLenum format, void const* binary, GLint length)
+{
+    loaded_format = format;
+    loaded_binary.assign(static_cast<char const*>(binary), static_cast<char const*>(binary) + length);
+}
+
+auto gl_str(char const* str)
+{
+    return reinterpret_cast<GLubyte const*>(str);
+}
+
+struct ProgramBinaryCache : Test
+{
+    ProgramBinaryCache()
+    {
+        auto tmp_name = std::unique_ptr<char[], void(*)(void*)>{strdup("/tmp/mir_shader_cache_XXXXXX"), &free};
+        if (mkdtemp(tmp_name.get()) == NULL)
+        {
+            throw std::system_error{errno, std::system_category(), "Failed to create temporary directory"};
+        }
+        temporary_directory = tmp_name.get();
+        directory = temporary_directory + "/mir/shaders";
+
+        loaded_binary.clear();
+        loaded_format = 0;
+
+        ON_CALL(mock_gl, glGetString(GL_EXTENSIONS))
+            .WillByDefault(Return(gl_str("GL_OES_EGL_image GL_OES_get_program_binary")));
+        ON_CALL(mock_gl, glGetString(GL_VENDOR)).WillByDefault(Return(gl_str("Vendor")));
+        ON_CALL(mock_gl, glGetString(GL_RENDERER)).WillByDefault(Return(gl_str("Renderer")));
+        ON_CALL(mock_gl, glGetString(GL_VERSION)).WillByDefault(Return(gl_str("OpenGL ES 2.0 Driver 1.0")));
+        ON_CALL(mock_gl, glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, _))
+            .WillByDefault(SetArgPointee<1>(1));
+        ON_CALL(mock_gl, glGetProgramiv(_, GL_PROGRAM_BINARY_LENGTH_OES, _))
+            .WillByDefault(SetArgPointee<2>(driver_binary.size()));
+        ON_CALL(mock_gl, glCreateProgram()).WillByDefault(Return(loaded_program));
+
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glGetProgramBinaryOES")))
+            .WillByDefault(Return(reinterpret_cast<void(*)()>(&fake_glGetProgramBinaryOES)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glProgramBinaryOES")))
+            .WillByDefault(Return(reinterpret_cast<void(*)()>(&fake_glProgramBinaryOES)));
+    }
+
+    ~ProgramBinaryCache()
+    {
+        boost::system::error_code ignored;
+        boost::filesystem::remove_all(temporary_directory, ignored);
+    }
+
+    auto files_in_cache() -> int
+    {
+        boost::system::error_code ignored;
+        if (!boost::filesystem::is_directory(directory, ignored))
+            return 0;
+
+        return std::distance(boost::filesystem::directory_iterator{directory}, {});
+    }
+
+    auto cache_file() -> std::string
+    {
+        return boost::filesystem::directory_iterator{directory}->path().string();
+    }
+
+    auto read_cache_file() -> std::string
+    {
+        std::ifstream in{cache_file(), std::ios::binary};
+        return {std::istreambuf_iterator<char>{in}, {}};
+    }
+
+    void write_cache_file(std::string const& contents)
+    {
+        std::ofstream out{cache_file(), std::ios::binary | std::ios::trunc};
+        out << contents;
+    }
+
+    /// Offset of the binary's length in a cache file, which follows the header, key and format
+    auto binary_length_offset(std::string const& contents) -> size_t
+    {
+        return contents.size() - driver_binary.size() - sizeof(uint64_t);
+    }
+
+    NiceMock<mtd::MockGL> mock_gl;
+    NiceMock<mtd::MockEGL> mock_egl;
+    std::string temporary_directory;
+    std::string directory;
+    std::string const vertex_source{"void main() { gl_Position = vec4(0.0); }\n"};
+    std::string const fragment_source{"void main() { gl_FragColor = vec4(1.0); }\n"};
+};
+}
+
+TEST_F(ProgramBinaryCache, misses_when_empty)
+{
+    mrg::ProgramBinaryCache const cache{directory};
+
+    EXPECT_CALL(mock_gl, glCreateProgram()).Times(0);
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(0u));
+}
+
+TEST_F(ProgramBinaryCache, stored_program_is_loaded_from_its_binary)
+{
+    mrg::ProgramBinaryCache const cache{directory};
+    cache.store(linked_program, vertex_source, fragment_source);
+
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(loaded_program));
+    EXPECT_THAT(loaded_format, Eq(binary_format));
+    EXPECT_THAT(loaded_binary, Eq(driver_binary));
+}
+
+TEST_F(ProgramBinaryCache, stored_program_survives_restart)
+{
+    mrg::ProgramBinaryCache{directory}.store(linked_program, vertex_source, fragment_source);
+
+    mrg::ProgramBinaryCache const cache{directory};
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(loaded_program));
+}
+
+TEST_F(ProgramBinaryCache, misses_for_different_sources)
+{
+    mrg::ProgramBinaryCache const cache{directory};
+    cache.store(linked_program, vertex_source, fragment_source);
+
+    EXPECT_THAT(cache.load(vertex_source, "void main() { gl_FragColor = vec4(0.5); }\n"), Eq(0u));
+    EXPECT_THAT(cache.load("void main() { gl_Position = vec4(1.0); }\n", fragment_source), Eq(0u));
+}
+
+TEST_F(ProgramBinaryCache, misses_after_driver_update)
+{
+    mrg::ProgramBinaryCache{directory}.store(linked_program, vertex_source, fragment_source);
+
+    ON_CALL(mock_gl, glGetString(GL_VERSION)).WillByDefault(Return(gl_str("OpenGL ES 2.0 Driver 1.1")));
+
+    mrg::ProgramBinaryCache const cache{directory};
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(0u));
+}
+
+TEST_F(ProgramBinaryCache, discards_binary_rejected_by_driver)
+{
+    mrg::ProgramBinaryCache const cache{directory};
+    cache.store(linked_program, vertex_source, fragment_source);
+
+    ON_CALL(mock_gl, glGetProgramiv(loaded_program, GL_LINK_STATUS, _))
+        .WillByDefault(SetArgPointee<2>(GL_FALSE));
+
+    EXPECT_CALL(mock_gl, glDeleteProgram(loaded_program));
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(0u));
+}
+
+TEST_F(ProgramBinaryCache, misses_for_truncated_file)
+{
+    mrg::ProgramBinaryCache const cache{directory};
+    cache.store(linked_program, vertex_source, fragment_source);
+
+    auto const contents = read_cache_file();
+    write_cache_file(contents.substr(0, contents.size() - 1));
+
+    EXPECT_CALL(mock_gl, glCreateProgram()).Times(0);
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(0u));
+}
+
+TEST_F(ProgramBinaryCache, misses_for_binary_length_beyond_end_of_file)
+{
+    mrg::ProgramBinaryCache const cache{directory};
+    cache.store(linked_program, vertex_source, fragment_source);
+
+    auto contents = read_cache_file();
+    auto const huge = std::numeric_limits<uint64_t>::max();
+    contents.replace(binary_length_offset(contents), sizeof huge, reinterpret_cast<char const*>(&huge), sizeof huge);
+    write_cache_file(contents);
+
+    EXPECT_CALL(mock_gl, glCreateProgram()).Times(0);
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(0u));
+}
+
+TEST_F(ProgramBinaryCache, misses_for_key_length_beyond_end_of_file)
+{
+    mrg::ProgramBinaryCache const cache{directory};
+    cache.store(linked_program, vertex_source, fragment_source);
+
+    // Keep just the header and a key length that claims far more data than follows it
+    auto const header_size = read_cache_file().find('\n') + 1;
+    auto contents = read_cache_file().substr(0, header_size);
+    auto const huge = std::numeric_limits<uint64_t>::max();
+    contents.append(reinterpret_cast<char const*>(&huge), sizeof huge);
+    write_cache_file(contents);
+
+    EXPECT_CALL(mock_gl, glCreateProgram()).Times(0);
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(0u));
+}
+
+TEST_F(ProgramBinaryCache, concurrent_stores_leave_one_intact_file)
+{
+    mrg::ProgramBinaryCache const cache{directory};
+
+    std::vector<std::thread> writers;
+    for (auto i = 0; i != 8; ++i)
+    {
+        writers.emplace_back([&] { cache.store(linked_program, vertex_source, fragment_source); });
+    }
+    for (auto& writer : writers)
+    {
+        writer.join();
+    }
+
+    EXPECT_THAT(files_in_cache(), Eq(1));
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(loaded_program));
+    EXPECT_THAT(loaded_binary, Eq(driver_binary));
+}
+
+TEST_F(ProgramBinaryCache, caches_nothing_without_extension)
+{
+    ON_CALL(mock_gl, glGetString(GL_EXTENSIONS)).WillByDefault(Return(gl_str("GL_OES_EGL_image")));
+
+    mrg::ProgramBinaryCache const cache{directory};
+    cache.store(linked_program, vertex_source, fragment_source);
+
+    EXPECT_THAT(files_in_cache(), Eq(0));
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(0u));
+}
+
+TEST_F(ProgramBinaryCache, caches_nothing_without_binary_formats)
+{
+    ON_CALL(mock_gl, glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, _))
+        .WillByDefault(SetArgPointee<1>(0));
+
+    mrg::ProgramBinaryCache const cache{directory};
+    cache.store(linked_program, vertex_source, fragment_source);
+
+    EXPECT_THAT(files_in_cache(), Eq(0));
+}
+
+TEST_F(ProgramBinaryCache, caches_nothing_without_directory)
+{
+    mrg::ProgramBinaryCache const cache{""};
+    cache.store(linked_program, vertex_source, fragment_source);
+
+    EXPECT_THAT(cache.load(vertex_source, fragment_source), Eq(0u));
+}
+
+TEST_F(ProgramBinaryCache, default_directory_is_under_xdg_cache_home)
+{
+    mtf::TemporaryEnvironmentValue const cache_home{"XDG_CACHE_HOME", "/var/cache/me"};
+
+    EXPECT_THAT(mrg::ProgramBinaryCache::default_directory(), Eq("/var/cache/me/mir/shaders"));
+}
+
+TEST_F(ProgramBinaryCache, default_directory_falls_back_to_home)
+{
+    mtf::TemporaryEnvironmentValue const cache_home{"XDG_CACHE_HOME", nullptr};
+    mtf::TemporaryEnvironmentValue const home{"HOME", "/home/me"};
+
+    EXPECT_THAT(mrg::ProgramBinaryCache::default_directory(), Eq("/home/me/.cache/mir/shaders"));
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/renderers/software/blend.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+
+namespace mrs = mir::renderer::software;
+
+using namespace testing;
+
+namespace
+{
+/// A premultiplied pixel: no channel may exceed its alpha
+uint32_t premultiplied(std::mt19937& rng)
+{
+    std::uniform_int_distribution<uint32_t> byte{0, 255};
+    auto const alpha = byte(rng);
+    std::uniform_int_distribution<uint32_t> channel{0, alpha};
+    return (alpha << 24) | (channel(rng) << 16) | (channel(rng) << 8) | channel(rng);
+}
+
+auto random_row(std::mt19937& rng, size_t count) -> std::vector<uint32_t>
+{
+    std::vector<uint32_t> row(count);
+    for (auto& pixel : row)
+        pixel = premultiplied(rng);
+    return row;
+}
+
+auto blended(
+    mrs::BlendImplementation implementation,
+    std::vector<uint32_t> dst,
+    std::vector<uint32_t> const& src,
+    uint8_t alpha,
+    bool opaque) -> std::vector<uint32_t>
+{
+    mrs::blend_row_for(implementation)(dst.data(), src.data(), src.size(), alpha, opaque);
+    return dst;
+}
+
+struct Blend : TestWithParam<mrs::BlendImplementation>
+{
+};
+}
+
+TEST_P(Blend, opaque_source_replaces_destination)
+{
+    std::vector<uint32_t> const dst(13, 0xff102030);
+    std::vector<uint32_t> const src(13, 0xff405060);
+
+    EXPECT_THAT(blended(GetParam(), dst, src, 255, false), Each(Eq(0xff405060)));
+}
+
+TEST_P(Blend, transparent_source_leaves_destination_alone)
+{
+    std::vector<uint32_t> const dst(13, 0xff102030);
+    std::vector<uint32_t> const src(13, 0x00000000);
+
+    EXPECT_THAT(blended(GetParam(), dst, src, 255, false), Each(Eq(0xff102030)));
+}
+
+TEST_P(Blend, opaque_flag_ignores_source_alpha)
+{
+    std::vector<uint32_t> const dst(13, 0xff102030);
+    std::vector<uint32_t> const src(13, 0x00405060);
+
+    EXPECT_THAT(blended(GetParam(), dst, src, 255, true), Each(Eq(0xff405060)));
+}
+
+TEST_P(Blend, half_transparent_source_is_mixed_with_destination)
+{
+    std::vector<uint32_t> const dst(13, 0xffffffff);
+    std::vector<uint32_t> const src(13, 0x80000000);
+
+    // 0 + 255 × (255 - 128) / 255
+    EXPECT_THAT(blended(GetParam(), dst, src, 255, false), Each(Eq(0xff7f7f7f)));
+}
+
+TEST_P(Blend, matches_scalar_implementation)
+{
+    std::mt19937 rng{42};
+
+    // Odd lengths exercise the leftovers after the vector loops
+    for (size_t count : {1u, 3u, 4u, 7u, 8u, 9u, 31u, 257u})
+    {
+        auto const dst = random_row(rng, count);
+        auto const src = random_row(rng, count);
+
+        for (uint8_t alpha : {0, 1, 127, 128, 254, 255})
+        {
+            for (bool opaque : {false, true})
+            {
+                EXPECT_THAT(
+                    blended(GetParam(), dst, src, alpha, opaque),
+                    Eq(blended(mrs::BlendImplementation::scalar, dst, src, alpha, opaque)))
+                    << "count=" << count << " alpha=" << int(alpha) << " opaque=" << opaque;
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Available,
+    Blend,
+    ValuesIn(mrs::available_blend_implementations()));
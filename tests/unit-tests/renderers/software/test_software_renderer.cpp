@@ -0,0 +1,233 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/renderers/software/renderer.h"
+#include "mir/renderer/sw/render_target.h"
+#include "mir/graphics/display_buffer.h"
+#include "mir/test/doubles/fake_renderable.h"
+#include "mir/test/doubles/stub_buffer.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstring>
+
+namespace mg = mir::graphics;
+namespace mrs = mir::renderer::software;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+using namespace testing;
+
+namespace
+{
+uint32_t const black{0xff000000};
+uint32_t const red{0xffff0000};
+uint32_t const green{0xff00ff00};
+uint32_t const blue{0xff0000ff};
+
+/// A display buffer rendered into memory, in xrgb_8888
+class MemoryDisplayBuffer :
+    public mg::DisplayBuffer,
+    public mg::NativeDisplayBuffer,
+    public mrs::RenderTarget
+{
+public:
+    MemoryDisplayBuffer(geom::Size const& size, geom::Rectangle const& view_area)
+        : target{mg::BufferProperties{size, mir_pixel_format_xrgb_8888, mg::BufferUsage::software}},
+          area{view_area}
+    {
+    }
+
+    auto view_area() const -> geom::Rectangle override { return area; }
+    bool overlay(mg::RenderableList const&) override { return false; }
+    auto transformation() const -> glm::mat2 override { return glm::mat2{1}; }
+    auto native_display_buffer() -> mg::NativeDisplayBuffer* override { return this; }
+
+    auto map_back_buffer() -> std::unique_ptr<mrs::Mapping<unsigned char>> override
+    {
+        return target.map_writeable();
+    }
+
+    void swap_buffers() override
+    {
+        ++swaps;
+    }
+
+    auto pixel(int x, int y) const -> uint32_t
+    {
+        uint32_t value;
+        memcpy(&value, target.written_pixels.data() + y * target.buf_stride.as_int() + x * 4, sizeof value);
+        return value;
+    }
+
+    mtd::StubBuffer target;
+    geom::Rectangle const area;
+    int swaps{0};
+};
+
+/// A buffer whose pixels are given row by row
+auto buffer_of(geom::Size const& size, MirPixelFormat format, std::vector<uint32_t> const& pixels)
+    -> std::shared_ptr<mtd::StubBuffer>
+{
+    auto const buffer = std::make_shared<mtd::StubBuffer>(
+        mg::BufferProperties{size, format, mg::BufferUsage::software});
+    memcpy(buffer->written_pixels.data(), pixels.data(), pixels.size() * sizeof pixels[0]);
+    return buffer;
+}
+
+class ClippedRenderable : public mtd::FakeRenderable
+{
+public:
+    ClippedRenderable(geom::Rectangle const& position, geom::Rectangle const& clip)
+        : FakeRenderable{position},
+          clip{clip}
+    {
+    }
+
+    std::experimental::optional<geom::Rectangle> clip_area() const override
+    {
+        return clip;
+    }
+
+private:
+    geom::Rectangle const clip;
+};
+
+struct SoftwareRenderer : Test
+{
+    auto renderable_at(geom::Rectangle const& position, std::shared_ptr<mg::Buffer> const& buffer)
+        -> std::shared_ptr<mtd::FakeRenderable>
+    {
+        auto const renderable = std::make_shared<mtd::FakeRenderable>(position);
+        renderable->set_buffer(buffer);
+        return renderable;
+    }
+
+    auto row(int y) const -> std::vector<uint32_t>
+    {
+        std::vector<uint32_t> pixels;
+        for (auto x = 0; x != display_buffer.target.buf_size.width.as_int(); ++x)
+            pixels.push_back(display_buffer.pixel(x, y));
+        return pixels;
+    }
+
+    MemoryDisplayBuffer display_buffer{{4, 4}, {{0, 0}, {4, 4}}};
+};
+}
+
+TEST_F(SoftwareRenderer, clears_to_opaque_black_and_swaps)
+{
+    mrs::Renderer renderer{display_buffer};
+    renderer.render({});
+
+    for (auto y = 0; y != 4; ++y)
+        EXPECT_THAT(row(y), Each(Eq(black)));
+    EXPECT_THAT(display_buffer.swaps, Eq(1));
+}
+
+TEST_F(SoftwareRenderer, draws_buffer_at_its_screen_position)
+{
+    auto const buffer = buffer_of({2, 2}, mir_pixel_format_xrgb_8888, {red, green, blue, red});
+
+    mrs::Renderer renderer{display_buffer};
+    renderer.render({renderable_at({{1, 1}, {2, 2}}, buffer)});
+
+    EXPECT_THAT(row(0), ElementsAre(black, black, black, black));
+    EXPECT_THAT(row(1), ElementsAre(black, red, green, black));
+    EXPECT_THAT(row(2), ElementsAre(black, blue, red, black));
+    EXPECT_THAT(row(3), ElementsAre(black, black, black, black));
+}
+
+TEST_F(SoftwareRenderer, scales_buffer_to_its_screen_position)
+{
+    auto const buffer = buffer_of({2, 1}, mir_pixel_format_xrgb_8888, {red, green});
+
+    mrs::Renderer renderer{display_buffer};
+    renderer.render({renderable_at({{0, 1}, {4, 2}}, buffer)});
+
+    EXPECT_THAT(row(0), Each(Eq(black)));
+    EXPECT_THAT(row(1), ElementsAre(red, red, green, green));
+    EXPECT_THAT(row(2), ElementsAre(red, red, green, green));
+    EXPECT_THAT(row(3), Each(Eq(black)));
+}
+
+TEST_F(SoftwareRenderer, draws_only_within_clip_area)
+{
+    auto const buffer = buffer_of({4, 4}, mir_pixel_format_xrgb_8888, std::vector<uint32_t>(16, red));
+    auto const renderable = std::make_shared<ClippedRenderable>(
+        geom::Rectangle{{0, 0}, {4, 4}},
+        geom::Rectangle{{1, 2}, {2, 1}});
+    renderable->set_buffer(buffer);
+
+    mrs::Renderer renderer{display_buffer};
+    renderer.render({renderable});
+
+    EXPECT_THAT(row(0), Each(Eq(black)));
+    EXPECT_THAT(row(1), Each(Eq(black)));
+    EXPECT_THAT(row(2), ElementsAre(black, red, red, black));
+    EXPECT_THAT(row(3), Each(Eq(black)));
+}
+
+TEST_F(SoftwareRenderer, swaps_red_and_blue_for_buffers_in_the_other_channel_order)
+{
+    // In xbgr_8888, red is in the low byte
+    auto const buffer = buffer_of({2, 1}, mir_pixel_format_xbgr_8888, {0xff0000ff, 0xffff0000});
+
+    mrs::Renderer renderer{display_buffer};
+    renderer.render({renderable_at({{0, 0}, {2, 1}}, buffer)});
+
+    EXPECT_THAT(row(0), ElementsAre(red, blue, black, black));
+}
+
+TEST_F(SoftwareRenderer, maps_viewport_onto_whole_target)
+{
+    // A scaled output: each target pixel covers 2x2 of screen, which starts at (10, 10)
+    MemoryDisplayBuffer scaled_display_buffer{{4, 4}, {{10, 10}, {8, 8}}};
+    auto const buffer = buffer_of({1, 1}, mir_pixel_format_xrgb_8888, {green});
+
+    mrs::Renderer renderer{scaled_display_buffer};
+    renderer.render({renderable_at({{12, 14}, {4, 2}}, buffer)});
+
+    EXPECT_THAT(scaled_display_buffer.pixel(0, 2), Eq(black));
+    EXPECT_THAT(scaled_display_buffer.pixel(1, 2), Eq(green));
+    EXPECT_THAT(scaled_display_buffer.pixel(2, 2), Eq(green));
+    EXPECT_THAT(scaled_display_buffer.pixel(3, 2), Eq(black));
+    EXPECT_THAT(scaled_display_buffer.pixel(1, 1), Eq(black));
+    EXPECT_THAT(scaled_display_buffer.pixel(1, 3), Eq(black));
+}
+
+TEST_F(SoftwareRenderer, follows_viewport_changes)
+{
+    auto const buffer = buffer_of({1, 1}, mir_pixel_format_xrgb_8888, {green});
+
+    mrs::Renderer renderer{display_buffer};
+    renderer.set_viewport({{100, 0}, {4, 4}});
+    renderer.render({renderable_at({{101, 0}, {1, 1}}, buffer)});
+
+    EXPECT_THAT(row(0), ElementsAre(black, green, black, black));
+}
+
+TEST_F(SoftwareRenderer, skips_renderables_outside_viewport)
+{
+    auto const buffer = buffer_of({1, 1}, mir_pixel_format_xrgb_8888, {green});
+
+    mrs::Renderer renderer{display_buffer};
+    renderer.render({renderable_at({{10, 10}, {1, 1}}, buffer)});
+
+    for (auto y = 0; y != 4; ++y)
+        EXPECT_THAT(row(y), Each(Eq(black)));
+}
@@ -1256,6 +1256,26 @@ TEST_F(BasicSurfaceTest, moving_surface_repositions_all_associated_streams)
     EXPECT_THAT(renderables[1], IsRenderableOfPosition(pt + d));
 }
 
+TEST_F(BasicSurfaceTest, renderables_report_opaque_region_of_their_stream_on_screen)
+{
+    using namespace testing;
+    geom::Displacement const d{19,99};
+    auto buffer_stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
+
+    std::list<ms::StreamInfo> streams = {
+        { mock_buffer_stream, {0,0}, {} },
+        { buffer_stream, d, geom::Size{100, 50}, std::vector<geom::Rectangle>{{{10, 10}, {200, 20}}} }
+    };
+    surface.set_streams(streams);
+
+    auto renderables = surface.generate_renderables(this);
+    ASSERT_THAT(renderables.size(), Eq(2));
+    EXPECT_THAT(renderables[0]->opaque_region(), Eq(std::nullopt));
+    EXPECT_THAT(
+        renderables[1]->opaque_region(),
+        Optional(ElementsAre(geom::Rectangle{rect.top_left + d + geom::Displacement{10, 10}, {90, 20}})));
+}
+
 TEST_F(BasicSurfaceTest, can_remove_all_streams)
 {
     using namespace testing;
@@ -1638,3 +1658,81 @@ TEST_F(BasicSurfaceTest, buffer_can_be_submitted_to_set_stream_after_surface_des
     surface.reset();
     callback({10, 10});
 }
+
+TEST_F(BasicSurfaceTest, renderables_of_an_unchanged_surface_take_a_fresh_buffer_each_frame)
+{
+    using namespace testing;
+
+    auto const buffer1 = std::make_shared<mtd::StubBuffer>();
+    auto const buffer2 = std::make_shared<mtd::StubBuffer>();
+    EXPECT_CALL(*mock_buffer_stream, lock_compositor_buffer(compositor_id))
+        .WillOnce(Return(buffer1))
+        .WillOnce(Return(buffer2));
+
+    auto renderables = surface.generate_renderables(compositor_id);
+    ASSERT_THAT(renderables.size(), Eq(1));
+    EXPECT_THAT(renderables[0]->buffer(), Eq(buffer1));
+    EXPECT_THAT(renderables[0]->screen_position().top_left, Eq(rect.top_left));
+
+    renderables = surface.generate_renderables(compositor_id);
+    ASSERT_THAT(renderables.size(), Eq(1));
+    EXPECT_THAT(renderables[0]->buffer(), Eq(buffer2));
+    EXPECT_THAT(renderables[0]->screen_position().top_left, Eq(rect.top_left));
+}
+
+TEST_F(BasicSurfaceTest, renderables_reflect_changes_since_the_last_frame)
+{
+    using namespace testing;
+
+    geom::Point const new_top_left{23, 42};
+    float const new_alpha{0.5f};
+    geom::Rectangle const new_clip_area{{0, 0}, {100, 100}};
+
+    surface.generate_renderables(compositor_id);
+
+    surface.move_to(new_top_left);
+    auto renderables = surface.generate_renderables(compositor_id);
+    ASSERT_THAT(renderables.size(), Eq(1));
+    EXPECT_THAT(renderables[0]->screen_position().top_left, Eq(new_top_left));
+
+    surface.set_alpha(new_alpha);
+    renderables = surface.generate_renderables(compositor_id);
+    ASSERT_THAT(renderables.size(), Eq(1));
+    EXPECT_THAT(renderables[0]->alpha(), FloatEq(new_alpha));
+    EXPECT_THAT(renderables[0]->screen_position().top_left, Eq(new_top_left));
+
+    surface.set_clip_area(new_clip_area);
+    renderables = surface.generate_renderables(compositor_id);
+    ASSERT_THAT(renderables.size(), Eq(1));
+    EXPECT_THAT(renderables[0]->clip_area(), Eq(std::experimental::make_optional(new_clip_area)));
+}
+
+TEST_F(BasicSurfaceTest, earlier_renderables_are_unaffected_by_changes_to_the_surface)
+{
+    using namespace testing;
+
+    auto const earlier = surface.generate_renderables(compositor_id);
+    ASSERT_THAT(earlier.size(), Eq(1));
+
+    surface.set_alpha(0.5f);
+    surface.move_to({23, 42});
+    surface.generate_renderables(compositor_id);
+
+    EXPECT_THAT(earlier[0]->alpha(), FloatEq(1.0f));
+    EXPECT_THAT(earlier[0]->screen_position().top_left, Eq(rect.top_left));
+}
+
+TEST_F(BasicSurfaceTest, renderables_allow_tearing_once_the_surface_does)
+{
+    using namespace testing;
+
+    auto renderables = surface.generate_renderables(compositor_id);
+    ASSERT_THAT(renderables.size(), Eq(1));
+    EXPECT_FALSE(renderables[0]->allow_tearing());
+
+    surface.set_allow_tearing(true);
+    renderables = surface.generate_renderables(compositor_id);
+    ASSERT_THAT(renderables.size(), Eq(1));
+    EXPECT_TRUE(surface.allow_tearing());
+    EXPECT_TRUE(renderables[0]->allow_tearing());
+}
@@ -25,6 +25,7 @@
 #include "mir/test/doubles/mock_display.h"
 #include "mir/test/doubles/mock_compositor.h"
 #include "mir/test/doubles/null_display_configuration.h"
+#include "mir/test/doubles/null_display_sync_group.h"
 #include "mir/test/doubles/stub_display_configuration.h"
 #include "mir/test/doubles/mock_scene_session.h"
 #include "mir/test/doubles/stub_session.h"
@@ -285,6 +286,33 @@ TEST_F(MediatingDisplayChangerTest, handles_hardware_change_when_display_buffers
     changer->configure_for_hardware_change(mt::fake_shared(conf));
 }
 
+TEST_F(MediatingDisplayChangerTest, only_reconfigures_compositing_for_sync_groups_not_preserved_by_display)
+{
+    using namespace testing;
+    mtd::NullDisplayConfiguration conf;
+    mtd::NullDisplaySyncGroup preserved_group;
+    mtd::NullDisplaySyncGroup replaced_group;
+
+    ON_CALL(mock_display, apply_if_configuration_preserves_display_buffers(_))
+        .WillByDefault(Return(false));
+    ON_CALL(mock_display, for_each_display_sync_group_preserved_by(Ref(conf), _))
+        .WillByDefault(WithArg<1>(Invoke([&](auto const& f) { f(preserved_group); })));
+
+    EXPECT_CALL(mock_compositor, stop()).Times(0);
+    EXPECT_CALL(mock_compositor, start()).Times(0);
+    EXPECT_CALL(mock_compositor, reconfigure(_, _))
+        .WillOnce(Invoke(
+            [&](auto const& is_preserved, auto const& change)
+            {
+                EXPECT_TRUE(is_preserved(preserved_group));
+                EXPECT_FALSE(is_preserved(replaced_group));
+                change();
+            }));
+    EXPECT_CALL(mock_display, configure(Ref(conf)));
+
+    changer->configure_for_hardware_change(mt::fake_shared(conf));
+}
+
 TEST_F(MediatingDisplayChangerTest, handles_error_when_applying_hardware_change)
 {
     using namespace testing;
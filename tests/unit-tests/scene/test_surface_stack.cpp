@@ -559,6 +559,40 @@ TEST_F(SurfaceStack, scene_observer_can_async_query_scene_within_surface_exists_
 }
 
 
+TEST_F(SurfaceStack, readers_see_a_consistent_stack_while_it_is_modified)
+{
+    using namespace ::testing;
+
+    stack.add_surface(stub_surface1, mi::InputReceptionMode::normal);
+    stack.add_surface(stub_surface2, mi::InputReceptionMode::normal);
+
+    std::atomic<bool> done{false};
+    auto const reader = std::async(std::launch::async, [&]
+        {
+            while (!done)
+            {
+                EXPECT_THAT(stack.scene_elements_for(compositor_id), SizeIs(2));
+                EXPECT_THAT(stack.stacking_order_of({stub_surface1, stub_surface2}), SizeIs(2));
+            }
+        });
+
+    for (auto i = 0; i != 1000; ++i)
+    {
+        stack.raise(i % 2 ? stub_surface1 : stub_surface2);
+        stack.add_surface(invisible_stub_surface, mi::InputReceptionMode::normal);
+        stack.remove_surface(invisible_stub_surface);
+    }
+    done = true;
+    reader.wait();
+
+    EXPECT_THAT(
+        stack.scene_elements_for(compositor_id),
+        ElementsAre(
+            SceneElementForStream(stub_buffer_stream2),
+            SceneElementForStream(stub_buffer_stream1)));
+}
+
+
 TEST_F(SurfaceStack, scene_observer_can_remove_surface_from_scene_within_surface_exists_notification)
 {
     using namespace ::testing;
@@ -934,6 +968,31 @@ TEST_F(SurfaceStack, removed_overlays_are_removed)
             SceneElementForStream(stub_buffer_stream2)));
 }
 
+TEST_F(SurfaceStack, released_scene_elements_do_not_keep_renderables_alive)
+{
+    using namespace ::testing;
+
+    auto const overlay = std::make_shared<mtd::StubRenderable>();
+    auto const use_count = overlay.use_count();
+
+    stack.register_compositor(this);
+    stack.add_surface(stub_surface1, mi::InputReceptionMode::normal);
+    stack.add_input_visualization(overlay);
+
+    for (auto i = 0; i != 3; ++i)
+    {
+        auto const elements = stack.scene_elements_for(this);
+        EXPECT_THAT(elements, ElementsAre(SceneElementForStream(stub_buffer_stream1), SceneElementForStream(overlay)));
+    }
+
+    stack.remove_input_visualization(overlay);
+    EXPECT_THAT(overlay.use_count(), Eq(use_count));
+
+    auto const elements = stack.scene_elements_for(this);
+    EXPECT_THAT(elements, ElementsAre(SceneElementForStream(stub_buffer_stream1)));
+    stack.unregister_compositor(this);
+}
+
 TEST_F(SurfaceStack, scene_observers_notified_of_generic_scene_change)
 {
     MockSceneObserver o1, o2;
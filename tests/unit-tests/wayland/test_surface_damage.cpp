@@ -0,0 +1,101 @@
+/*
+ * Copyright © 2022 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_wayland/surface_damage.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <limits>
+
+namespace mf = mir::frontend;
+namespace geom = mir::geometry;
+
+using namespace testing;
+
+namespace
+{
+auto rects(std::initializer_list<geom::Rectangle> list) -> geom::Rectangles
+{
+    return geom::Rectangles{list};
+}
+
+geom::Size const buffer_size{640, 480};
+}
+
+TEST(SurfaceDamage, no_damage_is_unknown_damage)
+{
+    mf::SurfaceDamage damage;
+
+    EXPECT_THAT(damage.empty(), Eq(true));
+    EXPECT_THAT(damage.in_buffer_coordinates(buffer_size, 1), Eq(std::nullopt));
+}
+
+TEST(SurfaceDamage, buffer_damage_is_reported_unchanged)
+{
+    mf::SurfaceDamage damage;
+    damage.add_buffer_damage(10, 20, 30, 40);
+
+    EXPECT_THAT(damage.in_buffer_coordinates(buffer_size, 2), Eq(rects({{{10, 20}, {30, 40}}})));
+}
+
+TEST(SurfaceDamage, surface_damage_is_scaled_to_buffer)
+{
+    mf::SurfaceDamage damage;
+    damage.add_surface_damage(10, 20, 30, 40);
+
+    EXPECT_THAT(damage.in_buffer_coordinates(buffer_size, 2), Eq(rects({{{20, 40}, {60, 80}}})));
+}
+
+TEST(SurfaceDamage, damage_is_clipped_to_buffer)
+{
+    mf::SurfaceDamage damage;
+    damage.add_buffer_damage(600, -10, 100, 20);
+
+    EXPECT_THAT(damage.in_buffer_coordinates(buffer_size, 1), Eq(rects({{{600, 0}, {40, 10}}})));
+}
+
+TEST(SurfaceDamage, whole_surface_damage_does_not_overflow)
+{
+    auto const max = std::numeric_limits<int32_t>::max();
+    mf::SurfaceDamage damage;
+    damage.add_surface_damage(0, 0, max, max);
+
+    EXPECT_THAT(damage.in_buffer_coordinates(buffer_size, 3), Eq(rects({{{0, 0}, buffer_size}})));
+}
+
+TEST(SurfaceDamage, empty_areas_are_ignored)
+{
+    mf::SurfaceDamage damage;
+    damage.add_surface_damage(10, 10, 0, 10);
+    damage.add_buffer_damage(10, 10, 10, -1);
+
+    EXPECT_THAT(damage.empty(), Eq(true));
+}
+
+TEST(SurfaceDamage, added_damage_accumulates)
+{
+    mf::SurfaceDamage cached;
+    cached.add_buffer_damage(0, 0, 10, 10);
+    mf::SurfaceDamage damage;
+    damage.add_buffer_damage(20, 20, 10, 10);
+
+    damage.add(cached);
+
+    EXPECT_THAT(
+        damage.in_buffer_coordinates(buffer_size, 1),
+        Eq(rects({{{20, 20}, {10, 10}}, {{0, 0}, {10, 10}}})));
+}